@@ -0,0 +1,332 @@
+/*
+* Asynchronous compute scheduler
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanAsyncCompute.h"
+
+#include <iomanip>
+#include <sstream>
+
+#include "VulkanInitializers.hpp"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	namespace
+	{
+		// Frames skipped after switching modes (timestamps lag behind and the queues need to settle) and frames measured per mode
+		constexpr uint32_t comparisonSkipFrames{ 10 };
+		constexpr uint32_t comparisonMeasureFrames{ 120 };
+	}
+
+	void AsyncCompute::create(vks::VulkanDevice* device)
+	{
+		this->device = device;
+		// VulkanDevice prefers a compute queue family without graphics support, so this usually is a dedicated (async) compute queue
+		vkGetDeviceQueue(device->logicalDevice, device->queueFamilyIndices.compute, 0, &queue);
+
+		VkCommandPoolCreateInfo cmdPoolInfo = vks::initializers::commandPoolCreateInfo();
+		cmdPoolInfo.queueFamilyIndex = device->queueFamilyIndices.compute;
+		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		VK_CHECK_RESULT(vkCreateCommandPool(device->logicalDevice, &cmdPoolInfo, nullptr, &commandPool));
+
+		VkSemaphoreCreateInfo semaphoreCI = vks::initializers::semaphoreCreateInfo();
+		VkFenceCreateInfo fenceCI = vks::initializers::fenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
+		for (auto& slot : slots) {
+			slot.commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, commandPool);
+			VK_CHECK_RESULT(vkCreateFence(device->logicalDevice, &fenceCI, nullptr, &slot.fence));
+			VK_CHECK_RESULT(vkCreateSemaphore(device->logicalDevice, &semaphoreCI, nullptr, &slot.computeComplete));
+			VK_CHECK_RESULT(vkCreateSemaphore(device->logicalDevice, &semaphoreCI, nullptr, &slot.graphicsComplete));
+		}
+
+		// Timestamps at the start and end of each step
+		stats.timestampsSupported = device->queueFamilyProperties[device->queueFamilyIndices.compute].timestampValidBits > 0;
+		if (stats.timestampsSupported) {
+			VkQueryPoolCreateInfo queryPoolCI{ .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+			queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolCI.queryCount = 2 * copyCount;
+			VK_CHECK_RESULT(vkCreateQueryPool(device->logicalDevice, &queryPoolCI, nullptr, &queryPool));
+		}
+
+		statsStart = std::chrono::high_resolution_clock::now();
+	}
+
+	void AsyncCompute::destroy()
+	{
+		if (!device) {
+			return;
+		}
+		if (queue != VK_NULL_HANDLE) {
+			vkQueueWaitIdle(queue);
+		}
+		for (auto& output : outputs) {
+			for (auto& copy : output.copies) {
+				copy.destroy();
+			}
+		}
+		outputs.clear();
+		for (auto& slot : slots) {
+			vkDestroyFence(device->logicalDevice, slot.fence, nullptr);
+			vkDestroySemaphore(device->logicalDevice, slot.computeComplete, nullptr);
+			vkDestroySemaphore(device->logicalDevice, slot.graphicsComplete, nullptr);
+			slot = {};
+		}
+		if (queryPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(device->logicalDevice, queryPool, nullptr);
+			queryPool = VK_NULL_HANDLE;
+		}
+		if (commandPool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(device->logicalDevice, commandPool, nullptr);
+			commandPool = VK_NULL_HANDLE;
+		}
+		device = nullptr;
+	}
+
+	bool AsyncCompute::dedicatedQueue() const
+	{
+		return device->queueFamilyIndices.compute != device->queueFamilyIndices.graphics;
+	}
+
+	uint32_t AsyncCompute::addOutput(VkBuffer source, VkDeviceSize size, VkBufferUsageFlags usage, VkPipelineStageFlags graphicsStages, VkAccessFlags graphicsAccess)
+	{
+		Output output{ .source = source, .size = size, .graphicsStages = graphicsStages, .graphicsAccess = graphicsAccess };
+		for (auto& copy : output.copies) {
+			VK_CHECK_RESULT(device->createBuffer(usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &copy, size));
+		}
+		outputs.push_back(output);
+		return static_cast<uint32_t>(outputs.size() - 1);
+	}
+
+	void AsyncCompute::readTimestamps(uint32_t copy)
+	{
+		if (!stats.timestampsSupported || !slots[copy].timestampsWritten) {
+			return;
+		}
+		std::array<uint64_t, 2> timestamps{};
+		if (vkGetQueryPoolResults(device->logicalDevice, queryPool, copy * 2, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+			return;
+		}
+		const float stepTime = (float)(timestamps[1] - timestamps[0]) * device->properties.limits.timestampPeriod / 1000000.0f;
+		// Smooth values for display
+		stats.stepTime = stats.stepTime * 0.9f + stepTime * 0.1f;
+		if (comparison.active && comparison.frame > comparisonSkipFrames) {
+			comparison.stepTime += stepTime;
+		}
+	}
+
+	void AsyncCompute::submit(const std::function<void(VkCommandBuffer commandBuffer)>& recordStep)
+	{
+		// Alternate between the copies, the copy written last is the one graphics reads from if overlap is enabled
+		const uint32_t writeCopy = (stepCount == 0) ? 0 : (latestCopy + 1) % copyCount;
+		Slot& slot = slots[writeCopy];
+
+		VK_CHECK_RESULT(vkWaitForFences(device->logicalDevice, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(device->logicalDevice, 1, &slot.fence));
+		readTimestamps(writeCopy);
+
+		VkCommandBuffer cmdBuffer = slot.commandBuffer;
+		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
+
+		if (stats.timestampsSupported) {
+			vkCmdResetQueryPool(cmdBuffer, queryPool, writeCopy * 2, 2);
+			vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, writeCopy * 2);
+		}
+
+		// The previous step's copy may still read from the sources, so the new step must not overwrite them before that has finished
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+		// The new step reads (and overwrites) what the previous step wrote, so those writes need to be made visible
+		VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		recordStep(cmdBuffer);
+
+		// Make the simulation results visible to the copy
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		for (auto& output : outputs) {
+			VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+			bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer = output.source;
+			bufferBarrier.size = output.size;
+			bufferBarriers.push_back(bufferBarrier);
+		}
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), 0, nullptr);
+
+		for (auto& output : outputs) {
+			VkBufferCopy copyRegion{ .size = output.size };
+			vkCmdCopyBuffer(cmdBuffer, output.source, output.copies[writeCopy].buffer, 1, &copyRegion);
+		}
+
+		// Release the written copies to the graphics queue family
+		// The copies are overwritten as a whole, so there is no need to transfer ownership back to compute after graphics has read them
+		if (dedicatedQueue()) {
+			bufferBarriers.clear();
+			for (auto& output : outputs) {
+				VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+				bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				bufferBarrier.dstAccessMask = 0;
+				bufferBarrier.srcQueueFamilyIndex = device->queueFamilyIndices.compute;
+				bufferBarrier.dstQueueFamilyIndex = device->queueFamilyIndices.graphics;
+				bufferBarrier.buffer = output.copies[writeCopy].buffer;
+				bufferBarrier.size = output.size;
+				bufferBarriers.push_back(bufferBarrier);
+			}
+			vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), 0, nullptr);
+		}
+
+		if (stats.timestampsSupported) {
+			vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, writeCopy * 2 + 1);
+		}
+
+		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+
+		// Wait for all graphics submissions that still read from a copy, with overlap this is only the previous frame, which read the copy written now
+		// Without overlap this also includes the previous frame reading the other copy, which serializes compute and graphics
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitStages;
+		for (auto& waitSlot : slots) {
+			if (waitSlot.graphicsPending) {
+				waitSemaphores.push_back(waitSlot.graphicsComplete);
+				waitStages.push_back(overlap ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+				waitSlot.graphicsPending = false;
+			}
+		}
+
+		VkSubmitInfo submitInfo = vks::initializers::submitInfo();
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &cmdBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &slot.computeComplete;
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, slot.fence));
+
+		stepCount++;
+		slot.step = stepCount;
+		slot.computePending = true;
+		slot.acquirePending = dedicatedQueue();
+		slot.timestampsWritten = stats.timestampsSupported;
+		// Graphics reads the copy of the previous step with overlap enabled, there is no previous step for the very first frame though
+		graphicsCopy = (overlap && stepCount > 1) ? latestCopy : writeCopy;
+		latestCopy = writeCopy;
+
+		statsSteps++;
+		const auto now = std::chrono::high_resolution_clock::now();
+		const double elapsed = std::chrono::duration<double>(now - statsStart).count();
+		if (elapsed >= 1.0) {
+			stats.stepsPerSecond = (float)(statsSteps / elapsed);
+			statsSteps = 0;
+			statsStart = now;
+		}
+
+		if (comparison.active) {
+			updateComparison();
+		}
+	}
+
+	VkBuffer AsyncCompute::graphicsBuffer(uint32_t output) const
+	{
+		return outputs[output].copies[graphicsCopy].buffer;
+	}
+
+	void AsyncCompute::recordGraphicsAcquire(VkCommandBuffer commandBuffer)
+	{
+		Slot& slot = slots[graphicsCopy];
+		if (!slot.acquirePending) {
+			return;
+		}
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		VkPipelineStageFlags dstStages = 0;
+		for (auto& output : outputs) {
+			VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+			bufferBarrier.srcAccessMask = 0;
+			bufferBarrier.dstAccessMask = output.graphicsAccess;
+			bufferBarrier.srcQueueFamilyIndex = device->queueFamilyIndices.compute;
+			bufferBarrier.dstQueueFamilyIndex = device->queueFamilyIndices.graphics;
+			bufferBarrier.buffer = output.copies[graphicsCopy].buffer;
+			bufferBarrier.size = output.size;
+			bufferBarriers.push_back(bufferBarrier);
+			dstStages |= output.graphicsStages;
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStages, 0, 0, nullptr, static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), 0, nullptr);
+		slot.acquirePending = false;
+	}
+
+	void AsyncCompute::addGraphicsSemaphores(std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages, std::vector<VkSemaphore>& signalSemaphores)
+	{
+		VkPipelineStageFlags graphicsStages = 0;
+		for (auto& output : outputs) {
+			graphicsStages |= output.graphicsStages;
+		}
+		// Wait for the step that wrote the copy read in this frame
+		// Steps older than that one (e.g. after switching from overlapped to serialized) also need to be waited on, so their semaphores are unsignaled before being reused
+		const uint64_t readStep = slots[graphicsCopy].step;
+		for (auto& slot : slots) {
+			if (slot.computePending && slot.step <= readStep) {
+				waitSemaphores.push_back(slot.computeComplete);
+				waitStages.push_back(graphicsStages);
+				slot.computePending = false;
+			}
+		}
+		signalSemaphores.push_back(slots[graphicsCopy].graphicsComplete);
+		slots[graphicsCopy].graphicsPending = true;
+	}
+
+	void AsyncCompute::startComparison(std::function<void(const std::string& result)> onResult)
+	{
+		comparison.active = true;
+		comparison.onResult = onResult;
+		comparison.previousOverlap = overlap;
+		comparison.frame = 0;
+		comparison.stepTime = 0.0;
+		comparisonResults.clear();
+		overlap = false;
+	}
+
+	bool AsyncCompute::comparing() const
+	{
+		return comparison.active;
+	}
+
+	// Each mode is measured over a fixed number of frames, starting with serialized execution
+	void AsyncCompute::updateComparison()
+	{
+		comparison.frame++;
+		if (comparison.frame == comparisonSkipFrames) {
+			comparison.start = std::chrono::high_resolution_clock::now();
+			comparison.stepTime = 0.0;
+		}
+		if (comparison.frame < comparisonSkipFrames + comparisonMeasureFrames) {
+			return;
+		}
+		const double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - comparison.start).count();
+		std::stringstream result;
+		result << std::fixed << std::setprecision(3) << (overlap ? "on" : "off") << "," << comparisonMeasureFrames / elapsed << ",";
+		if (stats.timestampsSupported) {
+			result << comparison.stepTime / comparisonMeasureFrames;
+		} else {
+			result << "n/a";
+		}
+		comparisonResults.push_back(result.str());
+		if (comparison.onResult) {
+			comparison.onResult(result.str());
+		}
+		comparison.frame = 0;
+		if (!overlap) {
+			overlap = true;
+		} else {
+			comparison.active = false;
+			overlap = comparison.previousOverlap;
+		}
+	}
+}
@@ -0,0 +1,120 @@
+/*
+* Asynchronous compute scheduler
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Runs a simulation step on the (dedicated, if available) compute queue and publishes its results to the graphics queue
+* The simulation keeps its state in buffers owned by the compute queue, at the end of every step the results are copied into one of two copies of each output buffer
+* With overlap enabled, graphics renders frame N from the copy written by the previous step while the step for frame N+1 writes to the other copy,
+* so both queues can execute at the same time. Without overlap, graphics waits for the step submitted in the same frame (serialized)
+* Queue family ownership transfers for the output copies are recorded automatically if the compute and graphics queue families differ
+*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanBuffer.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	class AsyncCompute
+	{
+	public:
+		// Compute writes one copy of an output while graphics reads the other one
+		static constexpr uint32_t copyCount{ 2 };
+
+		struct Output {
+			// Buffer written by the simulation, this stays owned by the compute queue family
+			VkBuffer source{ VK_NULL_HANDLE };
+			VkDeviceSize size{ 0 };
+			// Pipeline stages and access types graphics uses to read the output
+			VkPipelineStageFlags graphicsStages{ 0 };
+			VkAccessFlags graphicsAccess{ 0 };
+			std::array<vks::Buffer, copyCount> copies;
+		};
+
+		struct Stats {
+			bool timestampsSupported{ false };
+			// Simulation steps per second, measured on the host
+			float stepsPerSecond{ 0.0f };
+			// GPU time of a single simulation step in milliseconds (including the copy to the output)
+			float stepTime{ 0.0f };
+		};
+
+		vks::VulkanDevice* device{ nullptr };
+		VkQueue queue{ VK_NULL_HANDLE };
+		VkCommandPool commandPool{ VK_NULL_HANDLE };
+		std::vector<Output> outputs;
+		// If true, graphics reads the results of the previous step, so the current step can run in parallel to rendering
+		bool overlap{ true };
+		Stats stats;
+		// Results of the last overlap comparison, one line of comma separated values per mode
+		std::vector<std::string> comparisonResults;
+		static constexpr const char* comparisonHeader{ "overlap,steps/s,step time (ms)" };
+
+		/** @brief Gets the compute queue from the device's compute queue family and creates the command buffers and synchronization primitives */
+		void create(vks::VulkanDevice* device);
+		void destroy();
+		/** @brief Returns true if compute work runs on a queue from a different family than graphics */
+		bool dedicatedQueue() const;
+		/** @brief Adds an output that gets copied from the simulation's source buffer after every step, returns the output's index */
+		uint32_t addOutput(VkBuffer source, VkDeviceSize size, VkBufferUsageFlags usage, VkPipelineStageFlags graphicsStages, VkAccessFlags graphicsAccess);
+		/** @brief Records and submits one simulation step, must be called exactly once per frame before the graphics submission */
+		void submit(const std::function<void(VkCommandBuffer commandBuffer)>& recordStep);
+		/** @brief Returns the copy of an output that graphics reads in the current frame */
+		VkBuffer graphicsBuffer(uint32_t output) const;
+		/** @brief Records the queue family ownership acquire barriers for the copies read in the current frame (if required) */
+		void recordGraphicsAcquire(VkCommandBuffer commandBuffer);
+		/** @brief Adds the semaphores the graphics submission of the current frame needs to wait on and signal */
+		void addGraphicsSemaphores(std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages, std::vector<VkSemaphore>& signalSemaphores);
+		/** @brief Measures simulation throughput without and with overlap over the next frames, results are stored in comparisonResults and also passed to onResult (if set) */
+		void startComparison(std::function<void(const std::string& result)> onResult = nullptr);
+		bool comparing() const;
+
+	private:
+		struct Slot {
+			VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+			VkFence fence{ VK_NULL_HANDLE };
+			// Signaled by the step writing this copy, waited on by the graphics submission reading it
+			VkSemaphore computeComplete{ VK_NULL_HANDLE };
+			// Signaled by the graphics submission reading this copy, waited on by the step that writes it next
+			VkSemaphore graphicsComplete{ VK_NULL_HANDLE };
+			bool computePending{ false };
+			bool graphicsPending{ false };
+			bool acquirePending{ false };
+			bool timestampsWritten{ false };
+			// Number of the simulation step that last wrote this copy
+			uint64_t step{ 0 };
+		};
+		std::array<Slot, copyCount> slots;
+		VkQueryPool queryPool{ VK_NULL_HANDLE };
+		uint64_t stepCount{ 0 };
+		// Copy written by the last step and copy read by graphics in the current frame
+		uint32_t latestCopy{ 0 };
+		uint32_t graphicsCopy{ 0 };
+		std::chrono::time_point<std::chrono::high_resolution_clock> statsStart;
+		uint32_t statsSteps{ 0 };
+		struct {
+			bool active{ false };
+			bool previousOverlap{ true };
+			uint32_t frame{ 0 };
+			std::chrono::time_point<std::chrono::high_resolution_clock> start;
+			double stepTime{ 0.0 };
+			std::function<void(const std::string& result)> onResult;
+		} comparison;
+		void readTimestamps(uint32_t copy);
+		void updateComparison();
+	};
+}
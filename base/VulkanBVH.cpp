@@ -0,0 +1,428 @@
+/*
+* Bounding volume hierarchy for CPU side culling and ray queries
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanBVH.h"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <thread>
+#include <utility>
+
+namespace vks
+{
+	namespace
+	{
+		constexpr uint8_t allPlanes{ 0x3f };
+		// Parallel builds split the tree into about this many subtrees per thread, but not into subtrees smaller than minSubtreeSize items
+		constexpr uint32_t subtreesPerThread{ 8 };
+		constexpr uint32_t minSubtreeSize{ 1024 };
+
+		// Returns the planes the box still needs to be tested against for its children, or -1 if the box is outside the frustum
+		int32_t classify(const AABB& aabb, const vks::Frustum& frustum, uint8_t planeMask)
+		{
+			for (uint32_t i = 0; i < 6; i++) {
+				if (!(planeMask & (1 << i))) {
+					continue;
+				}
+				const glm::vec4& plane = frustum.planes[i];
+				const glm::vec3 normal = glm::vec3(plane);
+				// The corner furthest along the plane normal decides if the box is outside, the opposite corner if it's fully inside
+				const glm::vec3 positive = glm::vec3(normal.x >= 0.0f ? aabb.max.x : aabb.min.x, normal.y >= 0.0f ? aabb.max.y : aabb.min.y, normal.z >= 0.0f ? aabb.max.z : aabb.min.z);
+				const glm::vec3 negative = glm::vec3(normal.x >= 0.0f ? aabb.min.x : aabb.max.x, normal.y >= 0.0f ? aabb.min.y : aabb.max.y, normal.z >= 0.0f ? aabb.min.z : aabb.max.z);
+				if (glm::dot(normal, positive) + plane.w < 0.0f) {
+					return -1;
+				}
+				if (glm::dot(normal, negative) + plane.w >= 0.0f) {
+					planeMask &= ~(1 << i);
+				}
+			}
+			return planeMask;
+		}
+	}
+
+	void AABB::extend(const glm::vec3& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	void AABB::extend(const AABB& aabb)
+	{
+		min = glm::min(min, aabb.min);
+		max = glm::max(max, aabb.max);
+	}
+
+	bool AABB::valid() const
+	{
+		return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+	}
+
+	glm::vec3 AABB::center() const
+	{
+		return (min + max) * 0.5f;
+	}
+
+	float AABB::surfaceArea() const
+	{
+		if (!valid()) {
+			return 0.0f;
+		}
+		const glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	AABB AABB::transform(const glm::mat4& matrix) const
+	{
+		if (!valid()) {
+			return *this;
+		}
+		// Transforming the center and the half extents (with the absolute matrix) is equal to transforming all eight corners
+		const glm::vec3 center = glm::vec3(matrix * glm::vec4(this->center(), 1.0f));
+		const glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+		const glm::vec3 extent = absolute * ((max - min) * 0.5f);
+		AABB result;
+		result.min = center - extent;
+		result.max = center + extent;
+		return result;
+	}
+
+	float AABB::intersect(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) const
+	{
+		const glm::vec3 t0 = (min - origin) * inverseDirection;
+		const glm::vec3 t1 = (max - origin) * inverseDirection;
+		const glm::vec3 tMin = glm::min(t0, t1);
+		const glm::vec3 tMax = glm::max(t0, t1);
+		const float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+		const float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+		return (enter <= exit) ? enter : FLT_MAX;
+	}
+
+	void BVH::buildNodes(std::vector<Node>& targetNodes, std::vector<uint32_t>& targetParents, const std::vector<glm::vec3>& centroids, uint32_t deferLimit, std::vector<uint32_t>& deferred)
+	{
+		struct Bin {
+			AABB bounds;
+			uint32_t count{ 0 };
+		};
+		std::vector<Bin> bins(3 * binCount);
+		std::vector<float> rightCosts(binCount);
+		std::vector<uint32_t> stack{ 0 };
+
+		while (!stack.empty()) {
+			const uint32_t nodeIndex = stack.back();
+			stack.pop_back();
+			// Children are appended to the node array, so only copies of the node's values are used below
+			const uint32_t firstItem = targetNodes[nodeIndex].firstItem;
+			const uint32_t itemCount = targetNodes[nodeIndex].itemCount;
+
+			if (itemCount < deferLimit && itemCount > maxLeafSize) {
+				deferred.push_back(nodeIndex);
+				continue;
+			}
+
+			AABB nodeBounds, centroidBounds;
+			for (uint32_t i = firstItem; i < firstItem + itemCount; i++) {
+				nodeBounds.extend(itemBounds[itemIndices[i]]);
+				centroidBounds.extend(centroids[itemIndices[i]]);
+			}
+			targetNodes[nodeIndex].bounds = nodeBounds;
+
+			bool leaf = itemCount <= maxLeafSize;
+			uint32_t splitItem = firstItem + itemCount / 2;
+			if (!leaf) {
+				// Evaluate the SAH at all bin boundaries of the three axes, costs are scaled by the node's surface area
+				float bestCost = FLT_MAX;
+				int32_t bestAxis = -1;
+				uint32_t bestBin = 0;
+				const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+				glm::vec3 scale;
+				for (int32_t axis = 0; axis < 3; axis++) {
+					scale[axis] = (extent[axis] > 0.0f) ? static_cast<float>(binCount) / extent[axis] : 0.0f;
+				}
+				// The items are binned along all three axes in a single pass over the node's items
+				std::fill(bins.begin(), bins.end(), Bin{});
+				for (uint32_t i = firstItem; i < firstItem + itemCount; i++) {
+					const uint32_t item = itemIndices[i];
+					const glm::vec3 position = (centroids[item] - centroidBounds.min) * scale;
+					for (int32_t axis = 0; axis < 3; axis++) {
+						Bin& bin = bins[axis * binCount + std::min(binCount - 1, static_cast<uint32_t>(position[axis]))];
+						bin.bounds.extend(itemBounds[item]);
+						bin.count++;
+					}
+				}
+				for (int32_t axis = 0; axis < 3; axis++) {
+					if (extent[axis] <= 0.0f) {
+						continue;
+					}
+					const Bin* axisBins = &bins[axis * binCount];
+					AABB accumulated;
+					uint32_t accumulatedCount = 0;
+					for (uint32_t bin = binCount - 1; bin > 0; bin--) {
+						accumulated.extend(axisBins[bin].bounds);
+						accumulatedCount += axisBins[bin].count;
+						rightCosts[bin] = accumulatedCount * accumulated.surfaceArea();
+					}
+					accumulated = AABB{};
+					accumulatedCount = 0;
+					for (uint32_t bin = 0; bin < binCount - 1; bin++) {
+						accumulated.extend(axisBins[bin].bounds);
+						accumulatedCount += axisBins[bin].count;
+						const float splitCost = accumulatedCount * accumulated.surfaceArea() + rightCosts[bin + 1];
+						if (accumulatedCount > 0 && accumulatedCount < itemCount && splitCost < bestCost) {
+							bestCost = splitCost;
+							bestAxis = axis;
+							bestBin = bin;
+						}
+					}
+				}
+
+				if (bestAxis >= 0) {
+					// Traversing a node is assumed to cost as much as testing an item
+					const float leafCost = itemCount * nodeBounds.surfaceArea();
+					if (nodeBounds.surfaceArea() + bestCost >= leafCost) {
+						leaf = true;
+					} else {
+						const float axisScale = scale[bestAxis];
+						const float minimum = centroidBounds.min[bestAxis];
+						auto middle = std::partition(itemIndices.begin() + firstItem, itemIndices.begin() + firstItem + itemCount, [&](uint32_t item) {
+							return std::min(binCount - 1, static_cast<uint32_t>((centroids[item][bestAxis] - minimum) * axisScale)) <= bestBin;
+						});
+						splitItem = static_cast<uint32_t>(middle - itemIndices.begin());
+					}
+				}
+				// If all centroids coincide the items are split in half, so a large number of overlapping items doesn't end up in a single leaf
+			}
+
+			if (leaf) {
+				targetNodes[nodeIndex].child = 0;
+				for (uint32_t i = firstItem; i < firstItem + itemCount; i++) {
+					itemLeaves[itemIndices[i]] = nodeIndex;
+				}
+				continue;
+			}
+
+			const uint32_t childIndex = static_cast<uint32_t>(targetNodes.size());
+			targetNodes[nodeIndex].child = childIndex;
+			targetNodes.push_back({ AABB{}, 0, firstItem, splitItem - firstItem });
+			targetNodes.push_back({ AABB{}, 0, splitItem, firstItem + itemCount - splitItem });
+			targetParents.push_back(nodeIndex);
+			targetParents.push_back(nodeIndex);
+			stack.push_back(childIndex);
+			stack.push_back(childIndex + 1);
+		}
+	}
+
+	void BVH::build(const std::vector<AABB>& bounds)
+	{
+		const uint32_t count = static_cast<uint32_t>(bounds.size());
+		itemBounds = bounds;
+		itemIndices.resize(count);
+		std::iota(itemIndices.begin(), itemIndices.end(), 0);
+		itemLeaves.assign(count, 0);
+		nodes.clear();
+		parents.clear();
+		dirtyLeaves.clear();
+		buildCost = 0.0f;
+		if (count == 0) {
+			dirty.clear();
+			return;
+		}
+
+		const uint32_t threads = std::min((threadCount > 0) ? threadCount : std::max(std::thread::hardware_concurrency(), 1u), count);
+
+		std::vector<glm::vec3> centroids(count);
+		parallelFor(count, threads, [&](uint32_t i) {
+			centroids[i] = bounds[i].center();
+		});
+
+		nodes.reserve(2 * static_cast<size_t>(count));
+		parents.reserve(2 * static_cast<size_t>(count));
+		nodes.push_back({ AABB{}, 0, 0, count });
+		parents.push_back(0);
+
+		// The upper levels are built on the calling thread until the nodes are small enough to be handed out as tasks
+		// Subtrees work on disjoint ranges of itemIndices, so they can be built in parallel into separate node arrays
+		const uint32_t deferLimit = (threads > 1) ? std::max(count / (threads * subtreesPerThread), minSubtreeSize) : 0;
+		std::vector<uint32_t> deferred;
+		buildNodes(nodes, parents, centroids, deferLimit, deferred);
+
+		if (!deferred.empty()) {
+			// Larger subtrees first, so the last tasks to be picked up are the small ones
+			std::sort(deferred.begin(), deferred.end(), [&](uint32_t l, uint32_t r) { return nodes[l].itemCount > nodes[r].itemCount; });
+			std::vector<std::vector<Node>> subtreeNodes(deferred.size());
+			std::vector<std::vector<uint32_t>> subtreeParents(deferred.size());
+			parallelFor(static_cast<uint32_t>(deferred.size()), threads, [&](uint32_t i) {
+				std::vector<uint32_t> none;
+				subtreeNodes[i].push_back(nodes[deferred[i]]);
+				subtreeParents[i].push_back(0);
+				buildNodes(subtreeNodes[i], subtreeParents[i], centroids, 0, none);
+			});
+			// Append the subtrees, the subtree root replaces the deferred node and all other nodes are offset to the end of the node array
+			for (size_t i = 0; i < deferred.size(); i++) {
+				const uint32_t root = deferred[i];
+				const uint32_t base = static_cast<uint32_t>(nodes.size()) - 1;
+				const auto remap = [root, base](uint32_t index) { return (index == 0) ? root : base + index; };
+				for (size_t j = 0; j < subtreeNodes[i].size(); j++) {
+					Node node = subtreeNodes[i][j];
+					if (!node.isLeaf()) {
+						node.child = remap(node.child);
+					}
+					if (j == 0) {
+						nodes[root] = node;
+					} else {
+						nodes.push_back(node);
+						parents.push_back(remap(subtreeParents[i][j]));
+					}
+				}
+				const Node& subtreeRoot = nodes[root];
+				for (uint32_t j = subtreeRoot.firstItem; j < subtreeRoot.firstItem + subtreeRoot.itemCount; j++) {
+					itemLeaves[itemIndices[j]] = remap(itemLeaves[itemIndices[j]]);
+				}
+			}
+			// Bounds of the upper levels were computed from the items directly, so they're already final
+		}
+
+		dirty.assign(nodes.size(), 0);
+		buildCost = cost();
+	}
+
+	void BVH::update(uint32_t item, const AABB& bounds)
+	{
+		itemBounds[item] = bounds;
+		const uint32_t leaf = itemLeaves[item];
+		if (!dirty[leaf]) {
+			dirty[leaf] = 1;
+			dirtyLeaves.push_back(leaf);
+		}
+	}
+
+	void BVH::refit()
+	{
+		for (uint32_t leaf : dirtyLeaves) {
+			dirty[leaf] = 0;
+			Node& node = nodes[leaf];
+			node.bounds = AABB{};
+			for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+				node.bounds.extend(itemBounds[itemIndices[i]]);
+			}
+			// Walk up until a parent's bounds don't change, everything above it is still valid
+			uint32_t nodeIndex = leaf;
+			while (nodeIndex != 0) {
+				Node& parent = nodes[parents[nodeIndex]];
+				AABB bounds = nodes[parent.child].bounds;
+				bounds.extend(nodes[parent.child + 1].bounds);
+				if (bounds.min == parent.bounds.min && bounds.max == parent.bounds.max) {
+					break;
+				}
+				parent.bounds = bounds;
+				nodeIndex = parents[nodeIndex];
+			}
+		}
+		dirtyLeaves.clear();
+	}
+
+	float BVH::cost() const
+	{
+		if (nodes.empty() || nodes[0].bounds.surfaceArea() <= 0.0f) {
+			return 0.0f;
+		}
+		float sum = 0.0f;
+		for (const Node& node : nodes) {
+			sum += node.bounds.surfaceArea() * (node.isLeaf() ? static_cast<float>(node.itemCount) : 1.0f);
+		}
+		return sum / nodes[0].bounds.surfaceArea();
+	}
+
+	void BVH::queryFrustum(const vks::Frustum& frustum, std::vector<uint32_t>& items) const
+	{
+		if (nodes.empty()) {
+			return;
+		}
+		std::vector<std::pair<uint32_t, uint8_t>> stack;
+		stack.reserve(64);
+		stack.push_back({ 0, allPlanes });
+		while (!stack.empty()) {
+			const auto [nodeIndex, parentMask] = stack.back();
+			stack.pop_back();
+			const Node& node = nodes[nodeIndex];
+			const int32_t mask = classify(node.bounds, frustum, parentMask);
+			if (mask < 0) {
+				continue;
+			}
+			if (mask == 0) {
+				// Fully inside, all items of the subtree are visible
+				items.insert(items.end(), itemIndices.begin() + node.firstItem, itemIndices.begin() + node.firstItem + node.itemCount);
+				continue;
+			}
+			if (node.isLeaf()) {
+				for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+					if (classify(itemBounds[itemIndices[i]], frustum, static_cast<uint8_t>(mask)) >= 0) {
+						items.push_back(itemIndices[i]);
+					}
+				}
+				continue;
+			}
+			stack.push_back({ node.child, static_cast<uint8_t>(mask) });
+			stack.push_back({ node.child + 1, static_cast<uint8_t>(mask) });
+		}
+	}
+
+	uint32_t BVH::queryRay(const glm::vec3& origin, const glm::vec3& direction, float& distance, float maxDistance, const std::function<float(uint32_t item, float distance)>& intersect) const
+	{
+		uint32_t hit = UINT32_MAX;
+		distance = maxDistance;
+		if (nodes.empty()) {
+			return hit;
+		}
+		const glm::vec3 inverseDirection = 1.0f / direction;
+		const float rootDistance = nodes[0].bounds.intersect(origin, inverseDirection, distance);
+		if (rootDistance == FLT_MAX) {
+			return hit;
+		}
+		std::vector<std::pair<uint32_t, float>> stack;
+		stack.reserve(64);
+		stack.push_back({ 0, rootDistance });
+		while (!stack.empty()) {
+			const auto [nodeIndex, entryDistance] = stack.back();
+			stack.pop_back();
+			// A closer hit may have been found since the node was pushed
+			if (entryDistance > distance) {
+				continue;
+			}
+			const Node& node = nodes[nodeIndex];
+			if (node.isLeaf()) {
+				for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+					const uint32_t item = itemIndices[i];
+					float itemDistance = itemBounds[item].intersect(origin, inverseDirection, distance);
+					if (itemDistance != FLT_MAX && intersect) {
+						itemDistance = intersect(item, itemDistance);
+					}
+					if (itemDistance < distance) {
+						distance = itemDistance;
+						hit = item;
+					}
+				}
+				continue;
+			}
+			// Visit the closer child first by pushing it last
+			const float distances[2] = {
+				nodes[node.child].bounds.intersect(origin, inverseDirection, distance),
+				nodes[node.child + 1].bounds.intersect(origin, inverseDirection, distance)
+			};
+			const uint32_t nearChild = (distances[1] < distances[0]) ? 1 : 0;
+			if (distances[1 - nearChild] != FLT_MAX) {
+				stack.push_back({ node.child + 1 - nearChild, distances[1 - nearChild] });
+			}
+			if (distances[nearChild] != FLT_MAX) {
+				stack.push_back({ node.child + nearChild, distances[nearChild] });
+			}
+		}
+		return hit;
+	}
+}
@@ -0,0 +1,101 @@
+/*
+* Bounding volume hierarchy for CPU side culling and ray queries
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Binary tree over a set of axis aligned bounding boxes (items), which are referenced by their index in the array passed to build:
+* - The tree is built top-down with the surface area heuristic (SAH), split candidates are evaluated at bin boundaries of the item centroids
+* - Nodes are stored in a single array with children always placed after their parent, items of a subtree occupy a contiguous range of itemIndices
+* - Moving items only requires updating their bounds and refitting the affected nodes, the topology is kept until the tree is rebuilt
+* - Refitting degrades the tree over time, compare cost() against buildCost to decide when a rebuild pays off
+* - With threadCount other than one, the upper levels are built first and the remaining subtrees are then built in parallel
+* Frustum queries track which planes still need to be tested, so subtrees fully inside the frustum are accepted without further tests
+*/
+
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include "frustum.hpp"
+
+namespace vks
+{
+	struct AABB {
+		glm::vec3 min{ FLT_MAX };
+		glm::vec3 max{ -FLT_MAX };
+
+		void extend(const glm::vec3& point);
+		void extend(const AABB& aabb);
+		bool valid() const;
+		glm::vec3 center() const;
+		float surfaceArea() const;
+		/** @brief Returns the bounds of the box transformed by the given matrix */
+		AABB transform(const glm::mat4& matrix) const;
+		/** @brief Returns the distance along the ray at which it enters the box or FLT_MAX if it misses, inverseDirection is 1 / direction */
+		float intersect(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) const;
+	};
+
+	class BVH
+	{
+	public:
+		struct Node {
+			AABB bounds;
+			// Index of the first child for inner nodes, the second child follows directly after it, 0 for leaves
+			uint32_t child{ 0 };
+			// Range of the subtree's items in itemIndices
+			uint32_t firstItem{ 0 };
+			uint32_t itemCount{ 0 };
+			bool isLeaf() const { return child == 0; }
+		};
+
+		std::vector<Node> nodes;
+		// Item indices ordered so that the items of each node are contiguous
+		std::vector<uint32_t> itemIndices;
+		std::vector<AABB> itemBounds;
+
+		// Nodes with at most this many items are not split any further
+		uint32_t maxLeafSize{ 4 };
+		// Number of bins used to evaluate split candidates per axis
+		uint32_t binCount{ 16 };
+		// Number of threads used for building, 0 uses all hardware threads
+		uint32_t threadCount{ 1 };
+		// SAH cost of the tree right after the last build
+		float buildCost{ 0.0f };
+
+		/** @brief (Re)builds the tree for the given item bounds */
+		void build(const std::vector<AABB>& bounds);
+		/** @brief Updates the bounds of an item, the tree nodes are adjusted on the next refit */
+		void update(uint32_t item, const AABB& bounds);
+		/** @brief Adjusts the bounds of all nodes containing items that were updated since the last refit */
+		void refit();
+		/** @brief SAH cost of the current tree, relative to the surface area of the root */
+		float cost() const;
+		bool empty() const { return nodes.empty(); }
+		const AABB& bounds() const { return nodes[0].bounds; }
+
+		/** @brief Appends the indices of all items whose bounds intersect the frustum */
+		void queryFrustum(const vks::Frustum& frustum, std::vector<uint32_t>& items) const;
+		/**
+		* @brief Finds the closest item hit by a ray
+		* @param intersect Optional exact test for an item whose bounds are hit, gets the distance at which the ray enters the bounds and returns the hit distance or FLT_MAX for a miss
+		* @return Index of the closest item or UINT32_MAX if nothing was hit, distance receives the hit distance
+		*/
+		uint32_t queryRay(const glm::vec3& origin, const glm::vec3& direction, float& distance, float maxDistance = FLT_MAX, const std::function<float(uint32_t item, float distance)>& intersect = nullptr) const;
+
+	private:
+		/** @brief Splits the nodes on the stack starting with targetNodes[0], nodes with less than deferLimit items are added to deferred instead of being split */
+		void buildNodes(std::vector<Node>& targetNodes, std::vector<uint32_t>& targetParents, const std::vector<glm::vec3>& centroids, uint32_t deferLimit, std::vector<uint32_t>& deferred);
+		// Leaf containing each item and the parent of each node, used to propagate updates
+		std::vector<uint32_t> itemLeaves;
+		std::vector<uint32_t> parents;
+		std::vector<uint8_t> dirty;
+		std::vector<uint32_t> dirtyLeaves;
+	};
+}
@@ -0,0 +1,182 @@
+/*
+* Process-wide bindless texture table
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanBindlessTable.h"
+
+#include <algorithm>
+
+#include "VulkanTools.h"
+
+namespace vks
+{
+	BindlessTable bindlessTable;
+
+	bool BindlessTable::supported(const VkPhysicalDeviceFeatures& features, const VkPhysicalDeviceVulkan12Features& features12)
+	{
+		return features.shaderSampledImageArrayDynamicIndexing && features12.runtimeDescriptorArray && features12.descriptorBindingPartiallyBound &&
+			features12.descriptorBindingVariableDescriptorCount && features12.descriptorBindingSampledImageUpdateAfterBind;
+	}
+
+	void BindlessTable::enableFeatures(VkPhysicalDeviceFeatures& features, VkPhysicalDeviceVulkan12Features& features12)
+	{
+		// Texture indices are dynamically uniform (e.g. taken from push constants), so non-uniform indexing isn't required
+		features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+		features12.descriptorIndexing = VK_TRUE;
+		features12.runtimeDescriptorArray = VK_TRUE;
+		features12.descriptorBindingPartiallyBound = VK_TRUE;
+		features12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+		features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	}
+
+	void BindlessTable::create(vks::VulkanDevice* device, uint32_t capacity)
+	{
+		assert(!active());
+		this->device = device;
+
+		// The array may not exceed the update after bind limits
+		VkPhysicalDeviceVulkan12Properties properties12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES };
+		VkPhysicalDeviceProperties2 properties2{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &properties12 };
+		vkGetPhysicalDeviceProperties2(device->physicalDevice, &properties2);
+		capacity = std::min({ capacity, properties12.maxDescriptorSetUpdateAfterBindSampledImages, properties12.maxDescriptorSetUpdateAfterBindSamplers,
+			properties12.maxPerStageDescriptorUpdateAfterBindSampledImages, properties12.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+		VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity };
+		VkDescriptorPoolCreateInfo descriptorPoolCI{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+			.maxSets = 1,
+			.poolSizeCount = 1,
+			.pPoolSizes = &poolSize
+		};
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolCI, nullptr, &descriptorPool));
+
+		// Descriptors may be written while the set is bound and unused entries don't need to be valid
+		VkDescriptorSetLayoutBinding binding{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = capacity,
+			.stageFlags = VK_SHADER_STAGE_ALL
+		};
+		const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCI{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+			.bindingCount = 1,
+			.pBindingFlags = &bindingFlags
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.pNext = &bindingFlagsCI,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+			.bindingCount = 1,
+			.pBindings = &binding
+		};
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorSetLayoutCI, nullptr, &descriptorSetLayout));
+
+		VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountAI{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+			.descriptorSetCount = 1,
+			.pDescriptorCounts = &capacity
+		};
+		VkDescriptorSetAllocateInfo allocInfo{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.pNext = &variableCountAI,
+			.descriptorPool = descriptorPool,
+			.descriptorSetCount = 1,
+			.pSetLayouts = &descriptorSetLayout
+		};
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &allocInfo, &descriptorSet));
+
+		stats = {};
+		stats.capacity = capacity;
+	}
+
+	void BindlessTable::destroy()
+	{
+		if (!active()) {
+			return;
+		}
+		vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayout, nullptr);
+		descriptorPool = VK_NULL_HANDLE;
+		descriptorSetLayout = VK_NULL_HANDLE;
+		descriptorSet = VK_NULL_HANDLE;
+		device = nullptr;
+		entries.clear();
+		freeIndices.clear();
+		indices.clear();
+		stats = {};
+	}
+
+	bool BindlessTable::active() const
+	{
+		return descriptorSet != VK_NULL_HANDLE;
+	}
+
+	uint32_t BindlessTable::add(const VkDescriptorImageInfo& descriptor)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const std::pair<uint64_t, uint64_t> key{ (uint64_t)descriptor.imageView, (uint64_t)descriptor.sampler };
+		auto it = indices.find(key);
+		if (it != indices.end()) {
+			entries[it->second].refCount++;
+			stats.references++;
+			return it->second;
+		}
+
+		uint32_t index;
+		if (!freeIndices.empty()) {
+			index = freeIndices.back();
+			freeIndices.pop_back();
+		} else {
+			if (entries.size() >= stats.capacity) {
+				vks::tools::exitFatal("Bindless table is full, increase its capacity", -1);
+			}
+			index = static_cast<uint32_t>(entries.size());
+			entries.emplace_back();
+		}
+		entries[index].descriptor = descriptor;
+		entries[index].refCount = 1;
+		indices[key] = index;
+		stats.descriptors++;
+		stats.references++;
+
+		// The set is created with update after bind, so this is fine even if it's bound in a command buffer that's currently being recorded
+		VkWriteDescriptorSet writeDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = descriptorSet,
+			.dstBinding = 0,
+			.dstArrayElement = index,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.pImageInfo = &entries[index].descriptor
+		};
+		vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+		return index;
+	}
+
+	void BindlessTable::remove(uint32_t index)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if ((index >= entries.size()) || (entries[index].refCount == 0)) {
+			return;
+		}
+		stats.references--;
+		if (--entries[index].refCount > 0) {
+			return;
+		}
+		// Partially bound: The stale descriptor can stay in the set as long as no shader accesses it
+		indices.erase({ (uint64_t)entries[index].descriptor.imageView, (uint64_t)entries[index].descriptor.sampler });
+		freeIndices.push_back(index);
+		stats.descriptors--;
+	}
+
+	void BindlessTable::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set) const
+	{
+		vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &descriptorSet, 0, nullptr);
+	}
+}
@@ -0,0 +1,79 @@
+/*
+* Process-wide bindless texture table
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* A single descriptor set with one large, partially bound array of combined image samplers that's created with update after bind
+* Once the table has been created, every vks::Texture and vkglTF::Texture registers its descriptor when it's set up and gets an index into the array,
+* so shaders can select textures by index and the set only needs to be bound once per command buffer
+* Textures sharing the same image view and sampler (e.g. images shared via the glTF resource cache) share the same index
+* Requires descriptor indexing (Vulkan 1.2), see supported and enableFeatures
+*/
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	class BindlessTable
+	{
+	public:
+		static constexpr uint32_t invalidIndex{ ~0u };
+
+		struct Statistics {
+			// Number of descriptors the table can hold
+			uint32_t capacity{ 0 };
+			// Number of distinct descriptors currently registered
+			uint32_t descriptors{ 0 };
+			// Number of textures currently registered (including those sharing a descriptor)
+			uint32_t references{ 0 };
+		} stats;
+
+		VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
+		VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+
+		/** @brief Returns true if the device supports all features required by the table */
+		static bool supported(const VkPhysicalDeviceFeatures& features, const VkPhysicalDeviceVulkan12Features& features12);
+		/** @brief Enables the features required by the table, the Vulkan 1.2 features need to be chained into device creation */
+		static void enableFeatures(VkPhysicalDeviceFeatures& features, VkPhysicalDeviceVulkan12Features& features12);
+
+		/** @brief Creates the descriptor set, the capacity is clamped to the device's update after bind limits */
+		void create(vks::VulkanDevice* device, uint32_t capacity = 4096);
+		void destroy();
+		/** @brief Returns true if the table has been created, textures only register with an active table */
+		bool active() const;
+		/** @brief Registers an image descriptor and returns its index, registering the same view and sampler again returns the same index */
+		uint32_t add(const VkDescriptorImageInfo& descriptor);
+		/** @brief Releases a reference to an index returned by add, the index is reused once all references have been released */
+		void remove(uint32_t index);
+		/** @brief Binds the table's descriptor set to the given set number */
+		void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set) const;
+
+	private:
+		struct Entry {
+			VkDescriptorImageInfo descriptor{};
+			uint32_t refCount{ 0 };
+		};
+		vks::VulkanDevice* device{ nullptr };
+		VkDescriptorPool descriptorPool{ VK_NULL_HANDLE };
+		std::vector<Entry> entries;
+		std::vector<uint32_t> freeIndices;
+		// Maps image view and sampler to the index of their descriptor
+		std::map<std::pair<uint64_t, uint64_t>, uint32_t> indices;
+		std::mutex mutex;
+	};
+
+	extern BindlessTable bindlessTable;
+}
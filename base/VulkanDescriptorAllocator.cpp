@@ -0,0 +1,275 @@
+/*
+* Growable descriptor allocator and descriptor set layout cache
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanDescriptorAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "VulkanTools.h"
+
+namespace vks
+{
+	DescriptorLayoutCache descriptorLayoutCache;
+
+	namespace
+	{
+		// Upper limit for the number of sets per pool, pools only grow up to this size
+		constexpr uint32_t maxSetsPerPool{ 4096 };
+
+		// Covers the descriptor types used by the samples
+		const std::vector<DescriptorAllocator::PoolSizeRatio> defaultRatios = {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1.0f },
+		};
+
+		inline void hashCombine(size_t& seed, size_t value)
+		{
+			seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		}
+	}
+
+	/*
+		Descriptor allocator
+	*/
+
+	void DescriptorAllocator::create(VkDevice device, uint32_t initialSetsPerPool, const std::vector<PoolSizeRatio>& ratios, VkDescriptorPoolCreateFlags flags)
+	{
+		this->device = device;
+		this->flags = flags;
+		this->ratios = ratios.empty() ? defaultRatios : ratios;
+		setsPerPool = std::max(initialSetsPerPool, 1u);
+		stats = {};
+	}
+
+	void DescriptorAllocator::destroy()
+	{
+		for (auto pool : readyPools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+		for (auto pool : fullPools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+		readyPools.clear();
+		fullPools.clear();
+	}
+
+	void DescriptorAllocator::fitRatios(VkDescriptorSetLayout layout)
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		if (!descriptorLayoutCache.getBindings(layout, bindings)) {
+			return;
+		}
+		for (auto& binding : bindings) {
+			uint32_t count = 0;
+			for (auto& other : bindings) {
+				if (other.descriptorType == binding.descriptorType) {
+					count += other.descriptorCount;
+				}
+			}
+			auto it = std::find_if(ratios.begin(), ratios.end(), [&binding](const PoolSizeRatio& ratio) { return ratio.type == binding.descriptorType; });
+			if (it == ratios.end()) {
+				ratios.push_back({ binding.descriptorType, static_cast<float>(count) });
+			} else {
+				it->ratio = std::max(it->ratio, static_cast<float>(count));
+			}
+		}
+	}
+
+	VkDescriptorPool DescriptorAllocator::getPool(VkDescriptorSetLayout layout)
+	{
+		if (!readyPools.empty()) {
+			return readyPools.back();
+		}
+		fitRatios(layout);
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (auto& ratio : ratios) {
+			poolSizes.push_back({ ratio.type, std::max(static_cast<uint32_t>(ratio.ratio * setsPerPool), 1u) });
+		}
+		VkDescriptorPoolCreateInfo descriptorPoolCI{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.flags = flags,
+			.maxSets = setsPerPool,
+			.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+			.pPoolSizes = poolSizes.data()
+		};
+		VkDescriptorPool pool{ VK_NULL_HANDLE };
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolCI, nullptr, &pool));
+		readyPools.push_back(pool);
+		stats.pools++;
+		// The next pool will be larger, so the number of pools stays low even if the initial size was way off
+		setsPerPool = std::min(setsPerPool + setsPerPool / 2 + 1, maxSetsPerPool);
+		return pool;
+	}
+
+	VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout, const void* pNext)
+	{
+		assert(device != VK_NULL_HANDLE);
+		VkDescriptorSetAllocateInfo allocInfo{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.pNext = pNext,
+			.descriptorPool = getPool(layout),
+			.descriptorSetCount = 1,
+			.pSetLayouts = &layout
+		};
+		VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+		VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+		if ((result == VK_ERROR_OUT_OF_POOL_MEMORY) || (result == VK_ERROR_FRAGMENTED_POOL)) {
+			// Retire the exhausted pool and retry with a new one, which is sized to fit at least this layout's descriptors
+			fullPools.push_back(readyPools.back());
+			readyPools.pop_back();
+			stats.exhausted++;
+			allocInfo.descriptorPool = getPool(layout);
+			result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+		}
+		VK_CHECK_RESULT(result);
+		stats.sets++;
+		return descriptorSet;
+	}
+
+	void DescriptorAllocator::reset()
+	{
+		for (auto pool : readyPools) {
+			VK_CHECK_RESULT(vkResetDescriptorPool(device, pool, 0));
+		}
+		for (auto pool : fullPools) {
+			VK_CHECK_RESULT(vkResetDescriptorPool(device, pool, 0));
+			readyPools.push_back(pool);
+		}
+		fullPools.clear();
+		stats.sets = 0;
+		stats.resets++;
+	}
+
+	/*
+		Per-frame descriptor allocator
+	*/
+
+	void FrameDescriptorAllocator::create(VkDevice device, uint32_t frameCount, uint32_t initialSetsPerPool, const std::vector<DescriptorAllocator::PoolSizeRatio>& ratios)
+	{
+		frames.resize(frameCount);
+		for (auto& frame : frames) {
+			frame.create(device, initialSetsPerPool, ratios);
+		}
+		currentFrame = 0;
+	}
+
+	void FrameDescriptorAllocator::destroy()
+	{
+		for (auto& frame : frames) {
+			frame.destroy();
+		}
+		frames.clear();
+	}
+
+	void FrameDescriptorAllocator::beginFrame(uint32_t frameIndex)
+	{
+		assert(frameIndex < frames.size());
+		currentFrame = frameIndex;
+		frames[currentFrame].reset();
+	}
+
+	VkDescriptorSet FrameDescriptorAllocator::allocate(VkDescriptorSetLayout layout, const void* pNext)
+	{
+		return frames[currentFrame].allocate(layout, pNext);
+	}
+
+	const DescriptorAllocator::Statistics& FrameDescriptorAllocator::stats() const
+	{
+		return frames[currentFrame].stats;
+	}
+
+	/*
+		Descriptor set layout cache
+	*/
+
+	bool DescriptorLayoutCache::LayoutKey::operator==(const LayoutKey& other) const
+	{
+		if ((flags != other.flags) || (bindings.size() != other.bindings.size())) {
+			return false;
+		}
+		for (size_t i = 0; i < bindings.size(); i++) {
+			const VkDescriptorSetLayoutBinding& a = bindings[i];
+			const VkDescriptorSetLayoutBinding& b = other.bindings[i];
+			if ((a.binding != b.binding) || (a.descriptorType != b.descriptorType) || (a.descriptorCount != b.descriptorCount) || (a.stageFlags != b.stageFlags) || (a.pImmutableSamplers != b.pImmutableSamplers)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t DescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const
+	{
+		size_t hash = std::hash<uint32_t>()(key.flags);
+		for (auto& binding : key.bindings) {
+			hashCombine(hash, std::hash<uint32_t>()(binding.binding));
+			hashCombine(hash, std::hash<uint32_t>()(binding.descriptorType));
+			hashCombine(hash, std::hash<uint32_t>()(binding.descriptorCount));
+			hashCombine(hash, std::hash<uint32_t>()(binding.stageFlags));
+		}
+		return hash;
+	}
+
+	VkDescriptorSetLayout DescriptorLayoutCache::get(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags)
+	{
+		// Bindings are sorted, so the order in which they're passed doesn't matter
+		LayoutKey key{ .flags = flags, .bindings = bindings };
+		std::sort(key.bindings.begin(), key.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+		std::lock_guard<std::mutex> lock(mutex);
+		assert((this->device == VK_NULL_HANDLE) || (this->device == device));
+		this->device = device;
+		auto it = layouts.find(key);
+		if (it != layouts.end()) {
+			return it->second;
+		}
+		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.flags = flags,
+			.bindingCount = static_cast<uint32_t>(key.bindings.size()),
+			.pBindings = key.bindings.data()
+		};
+		VkDescriptorSetLayout layout{ VK_NULL_HANDLE };
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCI, nullptr, &layout));
+		layouts[key] = layout;
+		layoutBindings[layout] = key.bindings;
+		return layout;
+	}
+
+	void DescriptorLayoutCache::destroy()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& [key, layout] : layouts) {
+			vkDestroyDescriptorSetLayout(device, layout, nullptr);
+		}
+		layouts.clear();
+		layoutBindings.clear();
+		device = VK_NULL_HANDLE;
+	}
+
+	bool DescriptorLayoutCache::getBindings(VkDescriptorSetLayout layout, std::vector<VkDescriptorSetLayoutBinding>& bindings) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = layoutBindings.find(layout);
+		if (it == layoutBindings.end()) {
+			return false;
+		}
+		bindings = it->second;
+		return true;
+	}
+
+	size_t DescriptorLayoutCache::size() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return layouts.size();
+	}
+}
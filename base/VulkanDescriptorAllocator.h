@@ -0,0 +1,118 @@
+/*
+* Growable descriptor allocator and descriptor set layout cache
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Removes the need to size descriptor pools up front:
+* - DescriptorAllocator allocates sets from a chain of pools, if a pool is exhausted a new (larger) one is created and allocation is retried
+*   Pool sizes are derived from the number of sets per pool using per type ratios, so no exact descriptor counts are required
+*   Before a new pool is created, the ratios are raised to fit the bindings of the layout that's being allocated (as stored in the layout cache)
+*   Resetting the allocator resets all pools with vkResetDescriptorPool and keeps them for reuse
+* - FrameDescriptorAllocator keeps one such allocator per frame in flight for transient sets that are allocated every frame
+*   Once a frame's fence has been waited on, its allocator is reset in one go instead of freeing sets individually
+* - DescriptorLayoutCache returns the same layout for identical bindings, so layouts can be requested where they're needed instead of being passed around
+*/
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+namespace vks
+{
+	class DescriptorAllocator
+	{
+	public:
+		// Number of descriptors of a given type per set in a pool
+		struct PoolSizeRatio {
+			VkDescriptorType type;
+			float ratio;
+		};
+
+		struct Statistics {
+			// Number of pools created
+			uint32_t pools{ 0 };
+			// Number of sets allocated since the last reset
+			uint32_t sets{ 0 };
+			// Number of times an allocation failed because a pool was exhausted and a new pool had to be used
+			uint32_t exhausted{ 0 };
+			uint32_t resets{ 0 };
+		} stats;
+
+		/** @brief Prepares the allocator, the first pool is created on the first allocation and each new pool can hold 50% more sets than the previous one */
+		void create(VkDevice device, uint32_t initialSetsPerPool = 64, const std::vector<PoolSizeRatio>& ratios = {}, VkDescriptorPoolCreateFlags flags = 0);
+		void destroy();
+		/** @brief Allocates a descriptor set from the current pool, moving on to a new pool if it's exhausted */
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout, const void* pNext = nullptr);
+		/** @brief Resets all pools, all sets allocated from this allocator become invalid */
+		void reset();
+
+	private:
+		VkDevice device{ VK_NULL_HANDLE };
+		VkDescriptorPoolCreateFlags flags{ 0 };
+		std::vector<PoolSizeRatio> ratios;
+		uint32_t setsPerPool{ 0 };
+		// Pools that still have space left and pools that have been exhausted since the last reset
+		std::vector<VkDescriptorPool> readyPools;
+		std::vector<VkDescriptorPool> fullPools;
+		VkDescriptorPool getPool(VkDescriptorSetLayout layout);
+		/** @brief Raises the ratios so a pool can hold its number of sets with the given layout */
+		void fitRatios(VkDescriptorSetLayout layout);
+	};
+
+	class FrameDescriptorAllocator
+	{
+	public:
+		/** @brief Creates one allocator per frame in flight */
+		void create(VkDevice device, uint32_t frameCount, uint32_t initialSetsPerPool = 64, const std::vector<DescriptorAllocator::PoolSizeRatio>& ratios = {});
+		void destroy();
+		/** @brief Makes the given frame's allocator current and resets it, the frame's previous command buffers must have completed execution */
+		void beginFrame(uint32_t frameIndex);
+		/** @brief Allocates a set that's valid until the current frame's allocator is reset again */
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout, const void* pNext = nullptr);
+		/** @brief Returns the statistics of the current frame's allocator */
+		const DescriptorAllocator::Statistics& stats() const;
+
+	private:
+		std::vector<DescriptorAllocator> frames;
+		uint32_t currentFrame{ 0 };
+	};
+
+	class DescriptorLayoutCache
+	{
+	public:
+		/** @brief Returns a layout for the given bindings, the layout is owned by the cache and must not be destroyed by the caller */
+		VkDescriptorSetLayout get(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags = 0);
+		/** @brief Destroys all cached layouts */
+		void destroy();
+		/** @brief Returns the bindings of a layout created by the cache, false if the layout is unknown */
+		bool getBindings(VkDescriptorSetLayout layout, std::vector<VkDescriptorSetLayoutBinding>& bindings) const;
+		/** @brief Number of distinct layouts that have been created */
+		size_t size() const;
+
+	private:
+		struct LayoutKey {
+			VkDescriptorSetLayoutCreateFlags flags{ 0 };
+			std::vector<VkDescriptorSetLayoutBinding> bindings;
+			bool operator==(const LayoutKey& other) const;
+		};
+		struct LayoutKeyHash {
+			size_t operator()(const LayoutKey& key) const;
+		};
+		VkDevice device{ VK_NULL_HANDLE };
+		std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> layouts;
+		// Reverse lookup used by the allocators to size their pools
+		std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSetLayoutBinding>> layoutBindings;
+		mutable std::mutex mutex;
+	};
+
+	// Shared by all samples and the glTF model loader, destroyed together with the device
+	extern DescriptorLayoutCache descriptorLayoutCache;
+}
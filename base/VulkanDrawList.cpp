@@ -0,0 +1,109 @@
+/*
+* Sorted draw list
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanDrawList.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace vks
+{
+	namespace
+	{
+		constexpr uint32_t bucketShift{ 62 };
+		constexpr uint64_t pipelineMask{ 0x3fff };
+		constexpr uint64_t materialMask{ 0xffff };
+
+		// Bits of a non-negative float compare like the float itself
+		uint32_t depthBits(float depth)
+		{
+			depth = std::max(depth, 0.0f);
+			uint32_t bits;
+			memcpy(&bits, &depth, sizeof(bits));
+			return bits;
+		}
+	}
+
+	uint64_t DrawList::makeKey(Bucket bucket, uint32_t pipeline, uint32_t material, float depth)
+	{
+		uint64_t key = static_cast<uint64_t>(bucket) << bucketShift;
+		if (bucket == Bucket::AlphaBlend) {
+			// Back-to-front: larger distances need to come first
+			key |= static_cast<uint64_t>(~depthBits(depth)) << 30;
+			key |= (pipeline & pipelineMask) << 16;
+			key |= (material & materialMask);
+		} else {
+			key |= (pipeline & pipelineMask) << 48;
+			key |= (material & materialMask) << 32;
+			key |= depthBits(depth);
+		}
+		return key;
+	}
+
+	DrawList::Bucket DrawList::getBucket(uint64_t key)
+	{
+		return static_cast<Bucket>(key >> bucketShift);
+	}
+
+	void DrawList::clear()
+	{
+		entries.clear();
+	}
+
+	void DrawList::add(uint64_t key, uint32_t item)
+	{
+		entries.push_back({ key, item });
+	}
+
+	void DrawList::sort()
+	{
+		const size_t count = entries.size();
+		if (count < 2) {
+			return;
+		}
+		scratch.resize(count);
+		// Histograms for all eight bytes are gathered in a single pass
+		std::array<std::array<uint32_t, 256>, 8> histograms{};
+		for (const Entry& entry : entries) {
+			for (uint32_t byte = 0; byte < 8; byte++) {
+				histograms[byte][(entry.key >> (byte * 8)) & 0xff]++;
+			}
+		}
+		Entry* source = entries.data();
+		Entry* destination = scratch.data();
+		for (uint32_t byte = 0; byte < 8; byte++) {
+			std::array<uint32_t, 256>& histogram = histograms[byte];
+			// All keys share this byte, the pass wouldn't change the order
+			if (histogram[(source[0].key >> (byte * 8)) & 0xff] == count) {
+				continue;
+			}
+			uint32_t offset = 0;
+			for (uint32_t& bin : histogram) {
+				const uint32_t binCount = bin;
+				bin = offset;
+				offset += binCount;
+			}
+			for (size_t i = 0; i < count; i++) {
+				destination[histogram[(source[i].key >> (byte * 8)) & 0xff]++] = source[i];
+			}
+			std::swap(source, destination);
+		}
+		if (source != entries.data()) {
+			entries.swap(scratch);
+		}
+	}
+
+	std::pair<size_t, size_t> DrawList::range(Bucket bucket) const
+	{
+		const auto compare = [](const Entry& entry, uint64_t key) { return entry.key < key; };
+		auto begin = std::lower_bound(entries.begin(), entries.end(), static_cast<uint64_t>(bucket) << bucketShift, compare);
+		auto end = std::lower_bound(begin, entries.end(), (static_cast<uint64_t>(bucket) + 1) << bucketShift, compare);
+		return { static_cast<size_t>(begin - entries.begin()), static_cast<size_t>(end - entries.begin()) };
+	}
+}
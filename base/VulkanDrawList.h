@@ -0,0 +1,57 @@
+/*
+* Sorted draw list
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Collects draws with 64 bit sort keys, so a frame's draws can be gathered in a single pass and emitted in an order that minimizes state changes:
+* - The top bits select the bucket (opaque, alpha masked, alpha blended), so all draws of a bucket end up next to each other
+* - Opaque and masked draws are sorted by pipeline, then material and then front-to-back, so pipeline and descriptor binds are only needed when these change
+* - Blended draws are sorted back-to-front first, as their order matters for correct results, and by pipeline and material for draws at the same depth
+* Keys are sorted with a least significant digit radix sort, passes for bytes that are the same in all keys are skipped
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace vks
+{
+	class DrawList
+	{
+	public:
+		enum class Bucket : uint32_t { Opaque = 0, AlphaMask = 1, AlphaBlend = 2 };
+
+		struct Entry {
+			uint64_t key;
+			// Index of the draw in the caller's data
+			uint32_t item;
+		};
+		std::vector<Entry> entries;
+
+		/**
+		* @brief Builds a sort key
+		* @param pipeline Identifier of the pipeline (or pipeline state) used by the draw, only the lower 14 bits are used
+		* @param material Identifier of the material (descriptor set) used by the draw, only the lower 16 bits are used
+		* @param depth Distance to the viewer, negative values are clamped to zero
+		*/
+		static uint64_t makeKey(Bucket bucket, uint32_t pipeline, uint32_t material, float depth);
+		static Bucket getBucket(uint64_t key);
+
+		void clear();
+		void add(uint64_t key, uint32_t item);
+		/** @brief Sorts the entries by key, draws with the same key keep the order they were added in */
+		void sort();
+		/** @brief Range [first, last) of the sorted entries that belong to the given bucket */
+		std::pair<size_t, size_t> range(Bucket bucket) const;
+
+	private:
+		std::vector<Entry> scratch;
+	};
+}
@@ -24,6 +24,9 @@ namespace vks
 	{
 		VkImage image;
 		VkDeviceMemory memory;
+		// Size of the memory and whether it's lazily allocated (only committed by the implementation if required)
+		VkDeviceSize memorySize;
+		bool lazilyAllocated;
 		VkImageView view;
 		VkFormat format;
 		VkImageSubresourceRange subresourceRange;
@@ -174,6 +177,13 @@ namespace vks
 			image.samples = createinfo.imageSampleCount;
 			image.tiling = VK_IMAGE_TILING_OPTIMAL;
 			image.usage = createinfo.usage;
+			// Attachments that are only used within the render pass aren't stored (see below), so they can be transient
+			const VkImageUsageFlags attachmentUsages = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+			const bool transient = (createinfo.usage & ~attachmentUsages) == 0;
+			if (transient)
+			{
+				image.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+			}
 
 			VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
 			VkMemoryRequirements memReqs;
@@ -182,7 +192,18 @@ namespace vks
 			VK_CHECK_RESULT(vkCreateImage(vulkanDevice->logicalDevice, &image, nullptr, &attachment.image));
 			vkGetImageMemoryRequirements(vulkanDevice->logicalDevice, attachment.image, &memReqs);
 			memAlloc.allocationSize = memReqs.size;
-			memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			// Transient attachments use lazily allocated memory if the implementation supports it (e.g. on tile based GPUs)
+			VkBool32 lazyMemoryType = VK_FALSE;
+			if (transient)
+			{
+				memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &lazyMemoryType);
+			}
+			if (!lazyMemoryType)
+			{
+				memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			}
+			attachment.memorySize = memReqs.size;
+			attachment.lazilyAllocated = lazyMemoryType;
 			VK_CHECK_RESULT(vkAllocateMemory(vulkanDevice->logicalDevice, &memAlloc, nullptr, &attachment.memory));
 			VK_CHECK_RESULT(vkBindImageMemory(vulkanDevice->logicalDevice, attachment.image, attachment.memory, 0));
 
@@ -0,0 +1,337 @@
+/*
+* Minimal KTX2 container reader with optional Basis Universal and Zstd transcoding
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanKTX2.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "VulkanTools.h"
+#include "parallel.hpp"
+
+#if defined(VKS_KTX2_ZSTD)
+#include <zstd.h>
+#endif
+
+#if defined(VKS_KTX2_BASISU)
+#include <basisu_transcoder.h>
+#endif
+
+#if defined(__ANDROID__)
+#include <android/asset_manager.h>
+#endif
+
+namespace vks
+{
+	namespace ktx2
+	{
+		namespace
+		{
+			const uint8_t identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+			// Data format descriptor values (Khronos Data Format Specification)
+			constexpr uint32_t colorModelETC1S{ 163 };
+			constexpr uint32_t colorModelUASTC{ 166 };
+			constexpr uint32_t transferFunctionSRGB{ 2 };
+
+			// Fixed size part of the KTX2 header, directly followed by the level index
+			constexpr size_t headerSize{ 80 };
+
+			template<typename T>
+			T read(const std::vector<uint8_t>& data, size_t offset)
+			{
+				T value;
+				memcpy(&value, data.data() + offset, sizeof(T));
+				return value;
+			}
+
+			bool formatSupported(vks::VulkanDevice* device, VkFormat format)
+			{
+				VkFormatProperties formatProperties;
+				vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
+				return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) && (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_TRANSFER_DST_BIT);
+			}
+
+			// Level data offsets need to be aligned for buffer to image copies (multiple of the texel block size and four)
+			VkDeviceSize alignLevelOffset(VkDeviceSize offset)
+			{
+				return (offset + 15) & ~VkDeviceSize(15);
+			}
+
+#if defined(VKS_KTX2_BASISU)
+			basist::transcoder_texture_format basisFormat(TranscodeTarget target)
+			{
+				switch (target) {
+				case TranscodeTarget::BC7:
+					return basist::transcoder_texture_format::cTFBC7_RGBA;
+				case TranscodeTarget::ASTC4x4:
+					return basist::transcoder_texture_format::cTFASTC_4x4_RGBA;
+				case TranscodeTarget::ETC2:
+					return basist::transcoder_texture_format::cTFETC2_RGBA;
+				default:
+					return basist::transcoder_texture_format::cTFRGBA32;
+				}
+			}
+#endif
+		}
+
+		bool File::isBasis() const
+		{
+			return (supercompressionScheme == SupercompressionScheme::BasisLZ) || (colorModel == colorModelUASTC);
+		}
+
+		bool isKTX2(const std::vector<uint8_t>& data)
+		{
+			return (data.size() >= sizeof(identifier)) && (memcmp(data.data(), identifier, sizeof(identifier)) == 0);
+		}
+
+		bool readFileData(const std::string& filename, std::vector<uint8_t>& data)
+		{
+#if defined(__ANDROID__)
+			AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
+			if (!asset) {
+				return false;
+			}
+			size_t size = AAsset_getLength(asset);
+			data.resize(size);
+			AAsset_read(asset, data.data(), size);
+			AAsset_close(asset);
+#else
+			std::ifstream is(filename, std::ios::binary | std::ios::ate);
+			if (!is.is_open()) {
+				return false;
+			}
+			size_t size = static_cast<size_t>(is.tellg());
+			is.seekg(0, std::ios::beg);
+			data.resize(size);
+			is.read(reinterpret_cast<char*>(data.data()), size);
+			is.close();
+#endif
+			return true;
+		}
+
+		bool parse(File& file)
+		{
+			const size_t size = file.data.size();
+			if ((size < headerSize) || !isKTX2(file.data)) {
+				return false;
+			}
+
+			file.vkFormat = static_cast<VkFormat>(read<uint32_t>(file.data, 12));
+			file.typeSize = read<uint32_t>(file.data, 16);
+			file.width = read<uint32_t>(file.data, 20);
+			file.height = read<uint32_t>(file.data, 24);
+			file.depth = read<uint32_t>(file.data, 28);
+			file.layerCount = read<uint32_t>(file.data, 32);
+			file.faceCount = read<uint32_t>(file.data, 36);
+			file.levelCount = std::max(read<uint32_t>(file.data, 40), 1u);
+			file.supercompressionScheme = static_cast<SupercompressionScheme>(read<uint32_t>(file.data, 44));
+			const uint32_t dfdOffset = read<uint32_t>(file.data, 48);
+			const uint32_t dfdLength = read<uint32_t>(file.data, 52);
+
+			if (size < headerSize + file.levelCount * sizeof(LevelIndex)) {
+				return false;
+			}
+			file.levelIndex.resize(file.levelCount);
+			memcpy(file.levelIndex.data(), file.data.data() + headerSize, file.levelCount * sizeof(LevelIndex));
+			for (auto& level : file.levelIndex) {
+				if (level.byteOffset + level.byteLength > size) {
+					return false;
+				}
+			}
+
+			// The basic data format descriptor block tells us about the color model (Basis or not), transfer function and channels
+			if ((dfdLength >= 28) && (dfdOffset + dfdLength <= size)) {
+				file.colorModel = file.data[dfdOffset + 12];
+				file.srgb = file.data[dfdOffset + 14] == transferFunctionSRGB;
+				const uint16_t descriptorBlockSize = read<uint16_t>(file.data, dfdOffset + 10);
+				const uint32_t sampleCount = descriptorBlockSize > 24 ? (descriptorBlockSize - 24) / 16 : 0;
+				if (file.colorModel == colorModelETC1S) {
+					file.hasAlpha = sampleCount > 1;
+				}
+				if ((file.colorModel == colorModelUASTC) && (sampleCount > 0)) {
+					const uint8_t channelId = file.data[dfdOffset + 28 + 3] & 0xF;
+					file.hasAlpha = (channelId == 3) || (channelId == 5);
+				}
+			}
+			return true;
+		}
+
+		TranscodeTarget selectTranscodeTarget(vks::VulkanDevice* device, bool srgb, VkFormat& format)
+		{
+			struct Candidate {
+				TranscodeTarget target;
+				VkBool32 featureEnabled;
+				VkFormat unorm;
+				VkFormat srgb;
+			};
+			const std::vector<Candidate> candidates = {
+				{ TranscodeTarget::BC7, device->enabledFeatures.textureCompressionBC, VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK },
+				{ TranscodeTarget::ASTC4x4, device->enabledFeatures.textureCompressionASTC_LDR, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_SRGB_BLOCK },
+				{ TranscodeTarget::ETC2, device->enabledFeatures.textureCompressionETC2, VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK },
+			};
+			for (auto& candidate : candidates) {
+				VkFormat candidateFormat = srgb ? candidate.srgb : candidate.unorm;
+				if (candidate.featureEnabled && formatSupported(device, candidateFormat)) {
+					format = candidateFormat;
+					return candidate.target;
+				}
+			}
+			// Uncompressed fallback is always supported
+			format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+			return TranscodeTarget::RGBA8;
+		}
+
+		bool supportsSupercompression(SupercompressionScheme scheme)
+		{
+			switch (scheme) {
+			case SupercompressionScheme::None:
+				return true;
+#if defined(VKS_KTX2_ZSTD)
+			case SupercompressionScheme::Zstd:
+				return true;
+#endif
+#if defined(VKS_KTX2_BASISU)
+			case SupercompressionScheme::BasisLZ:
+				return true;
+#endif
+			default:
+				return false;
+			}
+		}
+
+		const char* transcodeTargetName(TranscodeTarget target)
+		{
+			switch (target) {
+			case TranscodeTarget::BC7:
+				return "BC7";
+			case TranscodeTarget::ASTC4x4:
+				return "ASTC 4x4";
+			case TranscodeTarget::ETC2:
+				return "ETC2 RGBA";
+			case TranscodeTarget::RGBA8:
+				return "RGBA8";
+			default:
+				return "none";
+			}
+		}
+
+		bool decode(const File& file, vks::VulkanDevice* device, DecodedImage& image, uint32_t threadCount)
+		{
+			// Only single layer 2D textures are supported for now
+			if ((file.layerCount > 1) || (file.faceCount > 1) || (file.depth > 1)) {
+				std::cerr << "KTX2: Only 2D textures are supported\n";
+				return false;
+			}
+
+			image.width = file.width;
+			image.height = file.height;
+			image.levels.resize(file.levelCount);
+
+			if (file.isBasis()) {
+#if defined(VKS_KTX2_BASISU)
+				image.target = selectTranscodeTarget(device, file.srgb, image.format);
+				const basist::transcoder_texture_format targetFormat = basisFormat(image.target);
+				const bool uncompressed = basist::basis_transcoder_format_is_uncompressed(targetFormat);
+				const uint32_t bytesPerBlock = basist::basis_get_bytes_per_block_or_pixel(targetFormat);
+
+				// Calculate level sizes and offsets up-front, so workers can write into their slice of the output without synchronization
+				VkDeviceSize offset{ 0 };
+				for (uint32_t i = 0; i < file.levelCount; i++) {
+					Level& level = image.levels[i];
+					level.width = std::max(file.width >> i, 1u);
+					level.height = std::max(file.height >> i, 1u);
+					const uint32_t blockOrPixelCount = uncompressed ? level.width * level.height : ((level.width + 3) / 4) * ((level.height + 3) / 4);
+					level.offset = offset;
+					level.size = blockOrPixelCount * bytesPerBlock;
+					offset = alignLevelOffset(offset + level.size);
+				}
+				image.data.resize(offset);
+
+				static std::once_flag initFlag;
+				std::call_once(initFlag, []() { basist::basisu_transcoder_init(); });
+
+				basist::ktx2_transcoder transcoder;
+				if (!transcoder.init(file.data.data(), static_cast<uint32_t>(file.data.size())) || !transcoder.start_transcoding()) {
+					std::cerr << "KTX2: Could not initialize Basis Universal transcoder\n";
+					return false;
+				}
+				std::atomic<bool> success{ true };
+				parallelFor(file.levelCount, threadCount, [&](uint32_t i) {
+					// Each worker needs its own transcoder state, the transcoder itself is shared read-only
+					basist::ktx2_transcoder_state state;
+					const Level& level = image.levels[i];
+					const uint32_t outputSize = uncompressed ? level.width * level.height : static_cast<uint32_t>(level.size / bytesPerBlock);
+					if (!transcoder.transcode_image_level(i, 0, 0, image.data.data() + level.offset, outputSize, targetFormat, 0, 0, 0, -1, -1, &state)) {
+						success = false;
+					}
+				});
+				if (!success) {
+					std::cerr << "KTX2: Basis Universal transcoding failed\n";
+					return false;
+				}
+#else
+				std::cerr << "KTX2: Basis Universal payloads require building with VKS_KTX2_BASISU\n";
+				return false;
+#endif
+			} else {
+				if (file.vkFormat == VK_FORMAT_UNDEFINED) {
+					std::cerr << "KTX2: File does not specify a Vulkan format\n";
+					return false;
+				}
+				if (!supportsSupercompression(file.supercompressionScheme)) {
+					std::cerr << "KTX2: Unsupported supercompression scheme " << static_cast<uint32_t>(file.supercompressionScheme) << "\n";
+					return false;
+				}
+				if (!formatSupported(device, file.vkFormat)) {
+					std::cerr << "KTX2: Format " << static_cast<uint32_t>(file.vkFormat) << " is not supported by the device\n";
+					return false;
+				}
+				image.format = file.vkFormat;
+				image.target = TranscodeTarget::None;
+
+				VkDeviceSize offset{ 0 };
+				for (uint32_t i = 0; i < file.levelCount; i++) {
+					Level& level = image.levels[i];
+					level.width = std::max(file.width >> i, 1u);
+					level.height = std::max(file.height >> i, 1u);
+					level.offset = offset;
+					level.size = (file.supercompressionScheme == SupercompressionScheme::None) ? file.levelIndex[i].byteLength : file.levelIndex[i].uncompressedByteLength;
+					offset = alignLevelOffset(offset + level.size);
+				}
+				image.data.resize(offset);
+
+				std::atomic<bool> success{ true };
+				parallelFor(file.levelCount, threadCount, [&](uint32_t i) {
+					const LevelIndex& index = file.levelIndex[i];
+					const Level& level = image.levels[i];
+					if (file.supercompressionScheme == SupercompressionScheme::None) {
+						memcpy(image.data.data() + level.offset, file.data.data() + index.byteOffset, index.byteLength);
+					}
+#if defined(VKS_KTX2_ZSTD)
+					if (file.supercompressionScheme == SupercompressionScheme::Zstd) {
+						size_t result = ZSTD_decompress(image.data.data() + level.offset, level.size, file.data.data() + index.byteOffset, index.byteLength);
+						if (ZSTD_isError(result) || (result != level.size)) {
+							success = false;
+						}
+					}
+#endif
+				});
+				if (!success) {
+					std::cerr << "KTX2: Zstd decompression failed\n";
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+}
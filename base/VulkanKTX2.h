@@ -0,0 +1,105 @@
+/*
+* Minimal KTX2 container reader with optional Basis Universal and Zstd transcoding
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* The vendored libktx only supports KTX 1.x, so this implements just enough of the KTX 2.0 spec to load 2D textures:
+* - Uncompressed and block compressed payloads (any vkFormat stored in the file)
+* - Zstd supercompressed payloads (requires building with VKS_KTX2_ZSTD)
+* - Basis Universal ETC1S (BasisLZ) and UASTC payloads (requires building with VKS_KTX2_BASISU)
+* Basis payloads are transcoded to the best format the device supports (BC7 > ASTC 4x4 > ETC2 > RGBA8)
+* Mip levels are decoded in parallel on worker threads
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	namespace ktx2
+	{
+		enum class SupercompressionScheme : uint32_t {
+			None = 0,
+			BasisLZ = 1,
+			Zstd = 2,
+			ZLIB = 3
+		};
+
+		enum class TranscodeTarget {
+			None,
+			BC7,
+			ASTC4x4,
+			ETC2,
+			RGBA8
+		};
+
+		struct LevelIndex {
+			uint64_t byteOffset;
+			uint64_t byteLength;
+			uint64_t uncompressedByteLength;
+		};
+
+		struct Level {
+			// Offset of this level in the decoded data
+			VkDeviceSize offset{ 0 };
+			VkDeviceSize size{ 0 };
+			uint32_t width{ 0 };
+			uint32_t height{ 0 };
+		};
+
+		struct File {
+			VkFormat vkFormat{ VK_FORMAT_UNDEFINED };
+			uint32_t typeSize{ 0 };
+			uint32_t width{ 0 };
+			uint32_t height{ 0 };
+			uint32_t depth{ 0 };
+			uint32_t layerCount{ 0 };
+			uint32_t faceCount{ 0 };
+			uint32_t levelCount{ 0 };
+			SupercompressionScheme supercompressionScheme{ SupercompressionScheme::None };
+			// Data format descriptor color model (163 = ETC1S, 166 = UASTC)
+			uint32_t colorModel{ 0 };
+			bool srgb{ false };
+			bool hasAlpha{ false };
+			std::vector<LevelIndex> levelIndex;
+			// Raw file contents, level index offsets point into this
+			std::vector<uint8_t> data;
+			bool isBasis() const;
+		};
+
+		/** @brief Result of loading a KTX2 file: tightly packed mip chain (level 0 first) in the final GPU format */
+		struct DecodedImage {
+			VkFormat format{ VK_FORMAT_UNDEFINED };
+			TranscodeTarget target{ TranscodeTarget::None };
+			uint32_t width{ 0 };
+			uint32_t height{ 0 };
+			std::vector<Level> levels;
+			std::vector<uint8_t> data;
+		};
+
+		/** @brief Returns true if the file contents start with the KTX2 identifier */
+		bool isKTX2(const std::vector<uint8_t>& data);
+		/** @brief Reads the complete contents of a file (or Android asset), returns false if it can't be opened */
+		bool readFileData(const std::string& filename, std::vector<uint8_t>& data);
+		/** @brief Validates the header and level index of the contents stored in file.data, returns false on error */
+		bool parse(File& file);
+		/** @brief Selects the transcode target for Basis payloads based on the device's enabled compression features and format support */
+		TranscodeTarget selectTranscodeTarget(vks::VulkanDevice* device, bool srgb, VkFormat& format);
+		/** @brief Decodes (and if required transcodes) all mip levels using up to threadCount worker threads (0 = hardware concurrency) */
+		bool decode(const File& file, vks::VulkanDevice* device, DecodedImage& image, uint32_t threadCount = 0);
+		/** @brief Returns true if the loader has been built with support for the given supercompression scheme */
+		bool supportsSupercompression(SupercompressionScheme scheme);
+		const char* transcodeTargetName(TranscodeTarget target);
+	}
+}
@@ -0,0 +1,275 @@
+/*
+* Quadric error based triangle mesh simplification
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanMeshSimplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace vks
+{
+	namespace meshsimplify
+	{
+		namespace
+		{
+			struct Vector3 {
+				float x, y, z;
+			};
+
+			inline Vector3 operator-(const Vector3& a, const Vector3& b)
+			{
+				return { a.x - b.x, a.y - b.y, a.z - b.z };
+			}
+
+			inline Vector3 cross(const Vector3& a, const Vector3& b)
+			{
+				return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+			}
+
+			inline float dot(const Vector3& a, const Vector3& b)
+			{
+				return a.x * b.x + a.y * b.y + a.z * b.z;
+			}
+
+			// Symmetric 4x4 matrix of the plane equations, evaluates to the summed squared distance to all planes
+			struct Quadric {
+				double a00{ 0 }, a11{ 0 }, a22{ 0 }, a01{ 0 }, a02{ 0 }, a12{ 0 };
+				double b0{ 0 }, b1{ 0 }, b2{ 0 };
+				double c{ 0 };
+
+				void addPlane(const Vector3& n, float d)
+				{
+					a00 += n.x * n.x; a11 += n.y * n.y; a22 += n.z * n.z;
+					a01 += n.x * n.y; a02 += n.x * n.z; a12 += n.y * n.z;
+					b0 += n.x * d; b1 += n.y * d; b2 += n.z * d;
+					c += static_cast<double>(d) * d;
+				}
+
+				void add(const Quadric& q)
+				{
+					a00 += q.a00; a11 += q.a11; a22 += q.a22;
+					a01 += q.a01; a02 += q.a02; a12 += q.a12;
+					b0 += q.b0; b1 += q.b1; b2 += q.b2;
+					c += q.c;
+				}
+
+				double error(const Vector3& v) const
+				{
+					const double rx = a00 * v.x + a01 * v.y + a02 * v.z;
+					const double ry = a01 * v.x + a11 * v.y + a12 * v.z;
+					const double rz = a02 * v.x + a12 * v.y + a22 * v.z;
+					const double e = rx * v.x + ry * v.y + rz * v.z + 2.0 * (b0 * v.x + b1 * v.y + b2 * v.z) + c;
+					return std::max(e, 0.0);
+				}
+			};
+
+			struct Collapse {
+				uint32_t from;
+				uint32_t to;
+				double cost;
+			};
+
+			inline uint64_t edgeKey(uint32_t a, uint32_t b)
+			{
+				return (a < b) ? ((static_cast<uint64_t>(a) << 32) | b) : ((static_cast<uint64_t>(b) << 32) | a);
+			}
+		}
+
+		float simplify(std::vector<uint32_t>& destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride, size_t targetIndexCount, float targetError)
+		{
+			destination.assign(indices, indices + indexCount);
+			if (indexCount < 3 || vertexCount == 0) {
+				return 0.0f;
+			}
+
+			std::vector<Vector3> vertexPositions(vertexCount);
+			for (size_t i = 0; i < vertexCount; i++) {
+				memcpy(&vertexPositions[i], reinterpret_cast<const uint8_t*>(positions) + i * positionStride, sizeof(Vector3));
+			}
+
+			// Vertices with the same position are welded for topology, so attribute seams don't show up as open borders
+			std::vector<uint32_t> weld(vertexCount);
+			std::vector<uint32_t> weldCount(vertexCount, 0);
+			{
+				struct PositionHash {
+					size_t operator()(const Vector3& v) const
+					{
+						uint32_t h[3];
+						memcpy(h, &v, sizeof(h));
+						return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+					}
+				};
+				struct PositionEqual {
+					bool operator()(const Vector3& a, const Vector3& b) const
+					{
+						return memcmp(&a, &b, sizeof(Vector3)) == 0;
+					}
+				};
+				std::unordered_map<Vector3, uint32_t, PositionHash, PositionEqual> positionMap;
+				positionMap.reserve(vertexCount);
+				for (uint32_t i = 0; i < vertexCount; i++) {
+					weld[i] = positionMap.emplace(vertexPositions[i], i).first->second;
+					weldCount[weld[i]]++;
+				}
+			}
+
+			// Lock vertices on borders, seams and non-manifold edges
+			std::vector<uint8_t> locked(vertexCount, 0);
+			{
+				std::unordered_map<uint64_t, uint32_t> edgeUse;
+				edgeUse.reserve(indexCount);
+				for (size_t i = 0; i < indexCount; i += 3) {
+					for (int e = 0; e < 3; e++) {
+						edgeUse[edgeKey(weld[indices[i + e]], weld[indices[i + (e + 1) % 3]])]++;
+					}
+				}
+				std::vector<uint8_t> weldLocked(vertexCount, 0);
+				for (auto& [key, count] : edgeUse) {
+					if (count != 2) {
+						weldLocked[key >> 32] = 1;
+						weldLocked[key & 0xffffffff] = 1;
+					}
+				}
+				for (size_t i = 0; i < vertexCount; i++) {
+					locked[i] = weldLocked[weld[i]] || (weldCount[weld[i]] > 1);
+				}
+			}
+
+			std::vector<Quadric> quadrics(vertexCount);
+			for (size_t i = 0; i < indexCount; i += 3) {
+				const Vector3& p0 = vertexPositions[indices[i + 0]];
+				const Vector3& p1 = vertexPositions[indices[i + 1]];
+				const Vector3& p2 = vertexPositions[indices[i + 2]];
+				Vector3 n = cross(p1 - p0, p2 - p0);
+				const float length = sqrtf(dot(n, n));
+				if (length == 0.0f) {
+					continue;
+				}
+				n = { n.x / length, n.y / length, n.z / length };
+				const float d = -dot(n, p0);
+				for (int c = 0; c < 3; c++) {
+					quadrics[indices[i + c]].addPlane(n, d);
+				}
+			}
+
+			const double maxCost = static_cast<double>(targetError) * targetError;
+			double resultCost = 0.0;
+			std::vector<uint32_t> remap(vertexCount);
+			std::vector<uint8_t> touched(vertexCount);
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+			std::vector<uint32_t> adjacency;
+			std::vector<Collapse> collapses;
+
+			while (destination.size() > targetIndexCount) {
+				// Triangles adjacent to each vertex
+				std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+				for (uint32_t index : destination) {
+					adjacencyOffsets[index + 1]++;
+				}
+				for (size_t i = 0; i < vertexCount; i++) {
+					adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+				}
+				adjacency.resize(destination.size());
+				{
+					std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+					for (size_t i = 0; i < destination.size(); i++) {
+						adjacency[fill[destination[i]]++] = static_cast<uint32_t>(i / 3);
+					}
+				}
+
+				collapses.clear();
+				for (size_t i = 0; i < destination.size(); i += 3) {
+					for (int e = 0; e < 3; e++) {
+						const uint32_t a = destination[i + e];
+						const uint32_t b = destination[i + (e + 1) % 3];
+						Quadric q = quadrics[a];
+						q.add(quadrics[b]);
+						if (!locked[a]) {
+							collapses.push_back({ a, b, q.error(vertexPositions[b]) });
+						}
+						if (!locked[b]) {
+							collapses.push_back({ b, a, q.error(vertexPositions[a]) });
+						}
+					}
+				}
+				std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.cost < r.cost; });
+
+				for (uint32_t i = 0; i < vertexCount; i++) {
+					remap[i] = i;
+				}
+				std::fill(touched.begin(), touched.end(), 0);
+				size_t triangleCount = destination.size() / 3;
+				size_t applied = 0;
+				for (const Collapse& collapse : collapses) {
+					if (triangleCount * 3 <= targetIndexCount) {
+						break;
+					}
+					if (collapse.cost > maxCost) {
+						break;
+					}
+					if (touched[collapse.from] || touched[collapse.to]) {
+						continue;
+					}
+					// Reject collapses that would flip one of the triangles that remain around the moved vertex
+					bool flips = false;
+					uint32_t removed = 0;
+					for (uint32_t t = adjacencyOffsets[collapse.from]; t < adjacencyOffsets[collapse.from + 1] && !flips; t++) {
+						const uint32_t* triangle = &destination[adjacency[t] * 3];
+						if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+							removed++;
+							continue;
+						}
+						Vector3 p[3], q[3];
+						for (int c = 0; c < 3; c++) {
+							p[c] = vertexPositions[triangle[c]];
+							q[c] = (triangle[c] == collapse.from) ? vertexPositions[collapse.to] : p[c];
+						}
+						const Vector3 n0 = cross(p[1] - p[0], p[2] - p[0]);
+						const Vector3 n1 = cross(q[1] - q[0], q[2] - q[0]);
+						flips = dot(n0, n1) <= 0.0f;
+					}
+					if (flips) {
+						continue;
+					}
+					remap[collapse.from] = collapse.to;
+					quadrics[collapse.to].add(quadrics[collapse.from]);
+					// The adjacency is only valid for the state at the start of the pass, so the whole neighborhood is frozen until the next pass
+					for (uint32_t t = adjacencyOffsets[collapse.from]; t < adjacencyOffsets[collapse.from + 1]; t++) {
+						const uint32_t* triangle = &destination[adjacency[t] * 3];
+						touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+					}
+					triangleCount -= removed;
+					resultCost = std::max(resultCost, collapse.cost);
+					applied++;
+				}
+				if (applied == 0) {
+					break;
+				}
+
+				// Apply the collapses and remove triangles that became degenerate
+				size_t writeIndex = 0;
+				for (size_t i = 0; i < destination.size(); i += 3) {
+					const uint32_t a = remap[destination[i + 0]];
+					const uint32_t b = remap[destination[i + 1]];
+					const uint32_t c = remap[destination[i + 2]];
+					if (weld[a] == weld[b] || weld[b] == weld[c] || weld[a] == weld[c]) {
+						continue;
+					}
+					destination[writeIndex++] = a;
+					destination[writeIndex++] = b;
+					destination[writeIndex++] = c;
+				}
+				destination.resize(writeIndex);
+			}
+
+			return static_cast<float>(sqrt(resultCost));
+		}
+	}
+}
@@ -0,0 +1,38 @@
+/*
+* Quadric error based triangle mesh simplification
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Reduces the triangle count of an indexed mesh by collapsing edges into one of their existing vertices, so the simplified index lists can share the vertex buffer of the original mesh
+* - Every vertex accumulates the planes of its adjacent triangles in a quadric, the cost of a collapse is the quadric error of the moved vertex at its new position
+* - Collapses are done in passes: candidates are sorted by cost and applied greedily as long as they don't touch a vertex that was already changed in that pass
+* - Collapses that would flip a triangle are rejected
+* - Vertices on open borders, attribute seams (multiple vertices with the same position) and non-manifold edges are locked, so the outline and texture seams of a mesh are kept intact
+* The returned error is the square root of the largest collapse cost, an approximation of the geometric deviation in the units of the vertex positions
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vks
+{
+	namespace meshsimplify
+	{
+		/**
+		* @brief Simplifies a triangle list until it has at most targetIndexCount indices or no collapse below targetError is left
+		* @param destination Receives the simplified triangle list, references the same vertices as the source
+		* @param indices Triangle list with indices in [0, vertexCount)
+		* @param positions First vertex position (three floats)
+		* @param positionStride Distance between two vertex positions in bytes
+		* @return Error of the simplified mesh in the units of the vertex positions
+		*/
+		float simplify(std::vector<uint32_t>& destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride, size_t targetIndexCount, float targetError);
+	}
+}
@@ -0,0 +1,458 @@
+/*
+* Decoder for meshoptimizer compressed vertex and index data (EXT_meshopt_compression)
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanMeshopt.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace vks
+{
+	namespace meshopt
+	{
+		namespace
+		{
+			// Upper four bits of the first byte of each stream, the lower four bits contain the version
+			constexpr uint8_t vertexHeader{ 0xa0 };
+			constexpr uint8_t indexHeader{ 0xe0 };
+			constexpr uint8_t sequenceHeader{ 0xd0 };
+
+			// Attribute data is split into blocks that fit into 8 KB, every byte of an element is encoded in groups of 16 values
+			constexpr size_t vertexBlockSizeBytes{ 8192 };
+			constexpr size_t vertexBlockMaxSize{ 256 };
+			constexpr size_t byteGroupSize{ 16 };
+			// A group never reads more than this, the stream is padded so the last group can be read without bounds checks
+			constexpr size_t byteGroupDecodeLimit{ 24 };
+			constexpr size_t tailMaxSize{ 32 };
+
+			inline uint8_t unzigzag8(uint8_t v)
+			{
+				return static_cast<uint8_t>(-(v & 1) ^ (v >> 1));
+			}
+
+			size_t getVertexBlockSize(size_t stride)
+			{
+				size_t result = vertexBlockSizeBytes / stride;
+				result &= ~(byteGroupSize - 1);
+				return (result < vertexBlockMaxSize) ? result : vertexBlockMaxSize;
+			}
+
+			// Unpacks 16 values of the given bit width, values with all bits set are followed by a full byte in the stream
+			template<int bits>
+			const uint8_t* decodeBytesGroupPacked(const uint8_t* data, uint8_t* buffer)
+			{
+				constexpr int valuesPerByte = 8 / bits;
+				constexpr uint8_t sentinel = (1 << bits) - 1;
+				const uint8_t* extra = data + byteGroupSize / valuesPerByte;
+				for (size_t i = 0; i < byteGroupSize / valuesPerByte; i++) {
+					uint8_t byte = data[i];
+					for (int j = 0; j < valuesPerByte; j++) {
+						const uint8_t value = byte >> (8 - bits);
+						byte = static_cast<uint8_t>(byte << bits);
+						*buffer++ = (value == sentinel) ? *extra++ : value;
+					}
+				}
+				return extra;
+			}
+
+			const uint8_t* decodeBytes(const uint8_t* data, const uint8_t* dataEnd, uint8_t* buffer, size_t bufferSize)
+			{
+				// Two bits per group select its encoding, rounded up to full bytes
+				const uint8_t* header = data;
+				const size_t headerSize = (bufferSize / byteGroupSize + 3) / 4;
+				if (static_cast<size_t>(dataEnd - data) < headerSize) {
+					return nullptr;
+				}
+				data += headerSize;
+				for (size_t i = 0; i < bufferSize; i += byteGroupSize) {
+					if (static_cast<size_t>(dataEnd - data) < byteGroupDecodeLimit) {
+						return nullptr;
+					}
+					const size_t group = i / byteGroupSize;
+					switch ((header[group / 4] >> ((group % 4) * 2)) & 3) {
+					case 0:
+						memset(buffer + i, 0, byteGroupSize);
+						break;
+					case 1:
+						data = decodeBytesGroupPacked<2>(data, buffer + i);
+						break;
+					case 2:
+						data = decodeBytesGroupPacked<4>(data, buffer + i);
+						break;
+					case 3:
+						memcpy(buffer + i, data, byteGroupSize);
+						data += byteGroupSize;
+						break;
+					}
+				}
+				return data;
+			}
+
+			const uint8_t* decodeVertexBlock(const uint8_t* data, const uint8_t* dataEnd, uint8_t* destination, size_t count, size_t stride, uint8_t lastVertex[256])
+			{
+				uint8_t buffer[vertexBlockMaxSize];
+				const size_t countAligned = (count + byteGroupSize - 1) & ~(byteGroupSize - 1);
+				// Every byte of the elements is stored as its own stream of deltas to the same byte of the previous element
+				for (size_t k = 0; k < stride; k++) {
+					data = decodeBytes(data, dataEnd, buffer, countAligned);
+					if (!data) {
+						return nullptr;
+					}
+					uint8_t previous = lastVertex[k];
+					for (size_t i = 0; i < count; i++) {
+						const uint8_t value = unzigzag8(buffer[i]) + previous;
+						destination[i * stride + k] = value;
+						previous = value;
+					}
+				}
+				memcpy(lastVertex, destination + (count - 1) * stride, stride);
+				return data;
+			}
+
+			inline uint32_t decodeVByte(const uint8_t*& data)
+			{
+				const uint8_t lead = *data++;
+				if (lead < 128) {
+					return lead;
+				}
+				// Up to four more bytes, the loop always terminates even for malformed data
+				uint32_t result = lead & 127;
+				uint32_t shift = 7;
+				for (int i = 0; i < 4; i++) {
+					const uint8_t group = *data++;
+					result |= static_cast<uint32_t>(group & 127) << shift;
+					shift += 7;
+					if (group < 128) {
+						break;
+					}
+				}
+				return result;
+			}
+
+			inline uint32_t decodeIndex(const uint8_t*& data, uint32_t last)
+			{
+				const uint32_t v = decodeVByte(data);
+				const uint32_t delta = (v >> 1) ^ (0u - (v & 1));
+				return last + delta;
+			}
+
+			inline void writeIndex(void* destination, size_t index, size_t indexSize, uint32_t value)
+			{
+				if (indexSize == 2) {
+					static_cast<uint16_t*>(destination)[index] = static_cast<uint16_t>(value);
+				} else {
+					static_cast<uint32_t*>(destination)[index] = value;
+				}
+			}
+
+			struct IndexFifos {
+				uint32_t edges[16][2];
+				uint32_t vertices[16];
+				size_t edgeOffset{ 0 };
+				size_t vertexOffset{ 0 };
+
+				IndexFifos()
+				{
+					memset(edges, -1, sizeof(edges));
+					memset(vertices, -1, sizeof(vertices));
+				}
+				void pushEdge(uint32_t a, uint32_t b)
+				{
+					edges[edgeOffset][0] = a;
+					edges[edgeOffset][1] = b;
+					edgeOffset = (edgeOffset + 1) & 15;
+				}
+				// The fifos have to be updated exactly like the encoder did, vertices are only pushed if the condition is met
+				void pushVertex(uint32_t v, bool condition = true)
+				{
+					vertices[vertexOffset] = v;
+					vertexOffset = (vertexOffset + (condition ? 1 : 0)) & 15;
+				}
+			};
+
+			template<typename T>
+			void filterOctahedral(T* data, size_t count)
+			{
+				const float max = static_cast<float>((1 << (sizeof(T) * 8 - 1)) - 1);
+				for (size_t i = 0; i < count; i++) {
+					// x and y are stored in octahedral encoding, z contains the encoded length
+					float x = static_cast<float>(data[i * 4 + 0]);
+					float y = static_cast<float>(data[i * 4 + 1]);
+					float z = static_cast<float>(data[i * 4 + 2]) - fabsf(x) - fabsf(y);
+					const float t = (z < 0.0f) ? z : 0.0f;
+					x += (x >= 0.0f) ? t : -t;
+					y += (y >= 0.0f) ? t : -t;
+					const float scale = max / sqrtf(x * x + y * y + z * z);
+					data[i * 4 + 0] = static_cast<T>(static_cast<int>(x * scale + (x >= 0.0f ? 0.5f : -0.5f)));
+					data[i * 4 + 1] = static_cast<T>(static_cast<int>(y * scale + (y >= 0.0f ? 0.5f : -0.5f)));
+					data[i * 4 + 2] = static_cast<T>(static_cast<int>(z * scale + (z >= 0.0f ? 0.5f : -0.5f)));
+				}
+			}
+
+			void filterQuaternion(int16_t* data, size_t count)
+			{
+				const float scale = 1.0f / sqrtf(2.0f);
+				for (size_t i = 0; i < count; i++) {
+					// The fourth component stores the index of the omitted (largest) component in the lower two bits and the encoding scale in the others
+					const int sf = data[i * 4 + 3] | 3;
+					const float ss = scale / static_cast<float>(sf);
+					const float x = static_cast<float>(data[i * 4 + 0]) * ss;
+					const float y = static_cast<float>(data[i * 4 + 1]) * ss;
+					const float z = static_cast<float>(data[i * 4 + 2]) * ss;
+					const float ww = 1.0f - x * x - y * y - z * z;
+					const float w = sqrtf(ww >= 0.0f ? ww : 0.0f);
+					const int qc = data[i * 4 + 3] & 3;
+					data[i * 4 + ((qc + 1) & 3)] = static_cast<int16_t>(static_cast<int>(x * 32767.0f + (x >= 0.0f ? 0.5f : -0.5f)));
+					data[i * 4 + ((qc + 2) & 3)] = static_cast<int16_t>(static_cast<int>(y * 32767.0f + (y >= 0.0f ? 0.5f : -0.5f)));
+					data[i * 4 + ((qc + 3) & 3)] = static_cast<int16_t>(static_cast<int>(z * 32767.0f + (z >= 0.0f ? 0.5f : -0.5f)));
+					data[i * 4 + ((qc + 0) & 3)] = static_cast<int16_t>(static_cast<int>(w * 32767.0f + 0.5f));
+				}
+			}
+
+			void filterExponential(uint32_t* data, size_t count)
+			{
+				for (size_t i = 0; i < count; i++) {
+					// 24 bit signed mantissa and 8 bit signed exponent
+					const uint32_t v = data[i];
+					const int32_t mantissa = static_cast<int32_t>(v << 8) >> 8;
+					const int32_t exponent = static_cast<int32_t>(v) >> 24;
+					const float value = ldexpf(static_cast<float>(mantissa), exponent);
+					memcpy(&data[i], &value, sizeof(float));
+				}
+			}
+		}
+
+		bool decodeVertexBuffer(void* destination, size_t count, size_t stride, const uint8_t* data, size_t size)
+		{
+			if ((stride == 0) || (stride > 256) || (stride % 4 != 0)) {
+				return false;
+			}
+			const uint8_t* dataEnd = data + size;
+			if (size < 1 + stride) {
+				return false;
+			}
+			if ((*data & 0xf0) != vertexHeader || (*data & 0x0f) > 0) {
+				return false;
+			}
+			data++;
+
+			// The first element's bytes are the baseline for the deltas and stored at the end of the stream
+			uint8_t lastVertex[256];
+			memcpy(lastVertex, dataEnd - stride, stride);
+
+			uint8_t* vertexData = static_cast<uint8_t*>(destination);
+			const size_t blockSize = getVertexBlockSize(stride);
+			for (size_t offset = 0; offset < count; offset += blockSize) {
+				const size_t blockCount = (offset + blockSize < count) ? blockSize : count - offset;
+				data = decodeVertexBlock(data, dataEnd, vertexData + offset * stride, blockCount, stride, lastVertex);
+				if (!data) {
+					return false;
+				}
+			}
+
+			const size_t tailSize = (stride < tailMaxSize) ? tailMaxSize : stride;
+			return static_cast<size_t>(dataEnd - data) == tailSize;
+		}
+
+		bool decodeIndexBuffer(void* destination, size_t count, size_t indexSize, const uint8_t* data, size_t size)
+		{
+			if ((count % 3 != 0) || ((indexSize != 2) && (indexSize != 4))) {
+				return false;
+			}
+			// Smallest valid stream: header, one code byte per triangle and the 16 byte auxiliary code table
+			if (size < 1 + count / 3 + 16) {
+				return false;
+			}
+			if ((data[0] & 0xf0) != indexHeader) {
+				return false;
+			}
+			const int version = data[0] & 0x0f;
+			if (version > 1) {
+				return false;
+			}
+
+			IndexFifos fifos;
+			uint32_t next = 0;
+			uint32_t last = 0;
+			// Version 1 uses the fifo codes 13 and 14 to encode free indices that differ by -1 or 1 from the last one
+			const int fecMax = (version >= 1) ? 13 : 15;
+
+			const uint8_t* code = data + 1;
+			const uint8_t* stream = code + count / 3;
+			const uint8_t* streamSafeEnd = data + size - 16;
+			const uint8_t* codeAuxTable = streamSafeEnd;
+
+			for (size_t i = 0; i < count; i += 3) {
+				// A triangle reads at most 16 bytes, which is guaranteed by the auxiliary table at the end
+				if (stream > streamSafeEnd) {
+					return false;
+				}
+				const uint8_t codeTri = *code++;
+				uint32_t a, b, c;
+				if (codeTri < 0xf0) {
+					// Triangle shares an edge with a recent triangle
+					const int fe = codeTri >> 4;
+					a = fifos.edges[(fifos.edgeOffset - 1 - fe) & 15][0];
+					b = fifos.edges[(fifos.edgeOffset - 1 - fe) & 15][1];
+					const int fec = codeTri & 15;
+					if (fec < fecMax) {
+						c = (fec == 0) ? next++ : fifos.vertices[(fifos.vertexOffset - 1 - fec) & 15];
+						fifos.pushVertex(c, fec == 0);
+					} else {
+						last = c = (fec != 15) ? last + (fec - (fec ^ 3)) : decodeIndex(stream, last);
+						fifos.pushVertex(c);
+					}
+					fifos.pushEdge(c, b);
+					fifos.pushEdge(a, c);
+				} else {
+					int fea, feb, fec;
+					if (codeTri < 0xfe) {
+						// Common combinations of vertex fifo codes are stored in the table
+						const uint8_t codeAux = codeAuxTable[codeTri & 15];
+						fea = 0;
+						feb = codeAux >> 4;
+						fec = codeAux & 15;
+					} else {
+						const uint8_t codeAux = *stream++;
+						fea = (codeTri == 0xfe) ? 0 : 15;
+						feb = codeAux >> 4;
+						fec = codeAux & 15;
+						if (codeAux == 0) {
+							next = 0;
+						}
+					}
+					// New vertices are numbered before free indices are decoded, this matches the encoder
+					a = (fea == 0) ? next++ : 0;
+					b = (feb == 0) ? next++ : fifos.vertices[(fifos.vertexOffset - feb) & 15];
+					c = (fec == 0) ? next++ : fifos.vertices[(fifos.vertexOffset - fec) & 15];
+					if (fea == 15) {
+						last = a = decodeIndex(stream, last);
+					}
+					if (feb == 15) {
+						last = b = decodeIndex(stream, last);
+					}
+					if (fec == 15) {
+						last = c = decodeIndex(stream, last);
+					}
+					fifos.pushVertex(a);
+					fifos.pushVertex(b, (feb == 0) || (feb == 15));
+					fifos.pushVertex(c, (fec == 0) || (fec == 15));
+					fifos.pushEdge(b, a);
+					fifos.pushEdge(c, b);
+					fifos.pushEdge(a, c);
+				}
+				writeIndex(destination, i + 0, indexSize, a);
+				writeIndex(destination, i + 1, indexSize, b);
+				writeIndex(destination, i + 2, indexSize, c);
+			}
+			// All data has to be consumed up to the auxiliary table
+			return stream == streamSafeEnd;
+		}
+
+		bool decodeIndexSequence(void* destination, size_t count, size_t indexSize, const uint8_t* data, size_t size)
+		{
+			if ((indexSize != 2) && (indexSize != 4)) {
+				return false;
+			}
+			// Smallest valid stream: header, one byte per index and a four byte tail
+			if (size < 1 + count + 4) {
+				return false;
+			}
+			if (((data[0] & 0xf0) != sequenceHeader) || ((data[0] & 0x0f) > 1)) {
+				return false;
+			}
+			const uint8_t* stream = data + 1;
+			const uint8_t* streamSafeEnd = data + size - 4;
+			uint32_t last[2] = { 0, 0 };
+			for (size_t i = 0; i < count; i++) {
+				// An index reads at most 5 bytes, which is guaranteed by the tail
+				if (stream >= streamSafeEnd) {
+					return false;
+				}
+				uint32_t v = decodeVByte(stream);
+				// Lowest bit selects one of the two baselines the index is encoded against
+				const uint32_t baseline = v & 1;
+				v >>= 1;
+				const uint32_t delta = (v >> 1) ^ (0u - (v & 1));
+				last[baseline] += delta;
+				writeIndex(destination, i, indexSize, last[baseline]);
+			}
+			return stream == streamSafeEnd;
+		}
+
+		void applyFilter(void* data, size_t count, size_t stride, Filter filter)
+		{
+			switch (filter) {
+			case Filter::None:
+				break;
+			case Filter::Octahedral:
+				if (stride == 4) {
+					filterOctahedral(static_cast<int8_t*>(data), count);
+				} else if (stride == 8) {
+					filterOctahedral(static_cast<int16_t*>(data), count);
+				}
+				break;
+			case Filter::Quaternion:
+				if (stride == 8) {
+					filterQuaternion(static_cast<int16_t*>(data), count);
+				}
+				break;
+			case Filter::Exponential:
+				filterExponential(static_cast<uint32_t*>(data), count * (stride / 4));
+				break;
+			}
+		}
+
+		bool decode(void* destination, size_t count, size_t stride, const uint8_t* data, size_t size, Mode mode, Filter filter)
+		{
+			switch (mode) {
+			case Mode::Attributes:
+				if (!decodeVertexBuffer(destination, count, stride, data, size)) {
+					return false;
+				}
+				applyFilter(destination, count, stride, filter);
+				return true;
+			case Mode::Triangles:
+				return decodeIndexBuffer(destination, count, stride, data, size);
+			case Mode::Indices:
+				return decodeIndexSequence(destination, count, stride, data, size);
+			}
+			return false;
+		}
+
+		bool parseMode(const std::string& name, Mode& mode)
+		{
+			if (name == "ATTRIBUTES") {
+				mode = Mode::Attributes;
+			} else if (name == "TRIANGLES") {
+				mode = Mode::Triangles;
+			} else if (name == "INDICES") {
+				mode = Mode::Indices;
+			} else {
+				return false;
+			}
+			return true;
+		}
+
+		bool parseFilter(const std::string& name, Filter& filter)
+		{
+			if (name.empty() || (name == "NONE")) {
+				filter = Filter::None;
+			} else if (name == "OCTAHEDRAL") {
+				filter = Filter::Octahedral;
+			} else if (name == "QUATERNION") {
+				filter = Filter::Quaternion;
+			} else if (name == "EXPONENTIAL") {
+				filter = Filter::Exponential;
+			} else {
+				return false;
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,45 @@
+/*
+* Decoder for meshoptimizer compressed vertex and index data (EXT_meshopt_compression)
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Implements the decoding side of the bitstreams defined by the EXT_meshopt_compression glTF extension, so no external library is required:
+* - Attributes: byte wise delta and zigzag encoded vertex data, packed into groups of 2, 4 or 8 bit values
+* - Triangles: triangle lists encoded with an edge and a vertex fifo
+* - Indices: index sequences encoded as vbyte deltas against two baselines
+* The octahedral, quaternion and exponential filters are applied to attribute data after decoding
+* See https://github.com/KhronosGroup/glTF/tree/main/extensions/2.0/Vendor/EXT_meshopt_compression for the format
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vks
+{
+	namespace meshopt
+	{
+		enum class Mode { Attributes, Triangles, Indices };
+		enum class Filter { None, Octahedral, Quaternion, Exponential };
+
+		/** @brief Decodes count elements of the given byte stride into destination, returns false if the data is malformed */
+		bool decodeVertexBuffer(void* destination, size_t count, size_t stride, const uint8_t* data, size_t size);
+		/** @brief Decodes a triangle list with count indices (multiple of three) of size 2 or 4 */
+		bool decodeIndexBuffer(void* destination, size_t count, size_t indexSize, const uint8_t* data, size_t size);
+		/** @brief Decodes an arbitrary index sequence with count indices of size 2 or 4 */
+		bool decodeIndexSequence(void* destination, size_t count, size_t indexSize, const uint8_t* data, size_t size);
+		/** @brief Applies a filter to decoded attribute data in place */
+		void applyFilter(void* data, size_t count, size_t stride, Filter filter);
+		/** @brief Decodes a compressed buffer view with the mode and filter stored in its extension, returns false if the data is malformed */
+		bool decode(void* destination, size_t count, size_t stride, const uint8_t* data, size_t size, Mode mode, Filter filter);
+		/** @brief Converts the mode and filter names used by the glTF extension, returns false for unknown names */
+		bool parseMode(const std::string& name, Mode& mode);
+		bool parseFilter(const std::string& name, Filter& filter);
+	}
+}
@@ -0,0 +1,464 @@
+/*
+* Background pipeline compiler
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanPipelineCompiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+#include "VulkanTools.h"
+
+namespace vks
+{
+	namespace
+	{
+		// FNV-1a, fed with the individual members of the state structures so padding bytes never end up in the hash
+		class Hasher
+		{
+		public:
+			uint64_t hash{ 14695981039346656037ull };
+
+			void addBytes(const void* data, size_t size)
+			{
+				const uint8_t* bytes = static_cast<const uint8_t*>(data);
+				for (size_t i = 0; i < size; i++) {
+					hash ^= bytes[i];
+					hash *= 1099511628211ull;
+				}
+			}
+
+			template <typename... T>
+			void add(const T&... values)
+			{
+				(addBytes(&values, sizeof(values)), ...);
+			}
+		};
+
+		// Copy of a shader stage including its entry point and specialization constants
+		struct ShaderStage {
+			VkPipelineShaderStageCreateInfo createInfo{};
+			std::string entryPoint;
+			VkSpecializationInfo specializationInfo{};
+			std::vector<VkSpecializationMapEntry> mapEntries;
+			std::vector<uint8_t> specializationData;
+
+			ShaderStage(const VkPipelineShaderStageCreateInfo& source, Hasher& hasher) : createInfo(source), entryPoint(source.pName)
+			{
+				// Stage chains (e.g. required subgroup size) aren't copied
+				createInfo.pNext = nullptr;
+				hasher.add(source.flags, source.stage, source.module);
+				hasher.addBytes(entryPoint.data(), entryPoint.size());
+				if (source.pSpecializationInfo) {
+					mapEntries.assign(source.pSpecializationInfo->pMapEntries, source.pSpecializationInfo->pMapEntries + source.pSpecializationInfo->mapEntryCount);
+					const uint8_t* data = static_cast<const uint8_t*>(source.pSpecializationInfo->pData);
+					specializationData.assign(data, data + source.pSpecializationInfo->dataSize);
+					for (auto& entry : mapEntries) {
+						hasher.add(entry.constantID, entry.offset, entry.size);
+					}
+					hasher.addBytes(specializationData.data(), specializationData.size());
+				}
+			}
+
+			void fixup()
+			{
+				createInfo.pName = entryPoint.c_str();
+				createInfo.pSpecializationInfo = nullptr;
+				if (!mapEntries.empty()) {
+					specializationInfo = {
+						.mapEntryCount = static_cast<uint32_t>(mapEntries.size()),
+						.pMapEntries = mapEntries.data(),
+						.dataSize = specializationData.size(),
+						.pData = specializationData.data()
+					};
+					createInfo.pSpecializationInfo = &specializationInfo;
+				}
+			}
+		};
+
+		// Owning copy of a graphics pipeline create info
+		// The dynamic rendering structure is the only extension structure that's carried over, pNext chains of the individual states are dropped
+		struct GraphicsPipelineDesc {
+			VkGraphicsPipelineCreateInfo createInfo{};
+			std::vector<ShaderStage> stages;
+			std::vector<VkPipelineShaderStageCreateInfo> stageCreateInfos;
+			VkPipelineVertexInputStateCreateInfo vertexInputState{};
+			std::vector<VkVertexInputBindingDescription> vertexBindings;
+			std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+			VkPipelineInputAssemblyStateCreateInfo inputAssemblyState{};
+			VkPipelineTessellationStateCreateInfo tessellationState{};
+			VkPipelineViewportStateCreateInfo viewportState{};
+			std::vector<VkViewport> viewports;
+			std::vector<VkRect2D> scissors;
+			VkPipelineRasterizationStateCreateInfo rasterizationState{};
+			VkPipelineMultisampleStateCreateInfo multisampleState{};
+			std::vector<VkSampleMask> sampleMask;
+			VkPipelineDepthStencilStateCreateInfo depthStencilState{};
+			VkPipelineColorBlendStateCreateInfo colorBlendState{};
+			std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+			VkPipelineDynamicStateCreateInfo dynamicState{};
+			std::vector<VkDynamicState> dynamicStates;
+			VkPipelineRenderingCreateInfo renderingInfo{};
+			std::vector<VkFormat> colorAttachmentFormats;
+			uint64_t hash{ 0 };
+
+			explicit GraphicsPipelineDesc(const VkGraphicsPipelineCreateInfo& source)
+			{
+				Hasher hasher;
+				createInfo = source;
+				createInfo.pNext = nullptr;
+				hasher.add(source.flags, source.layout, source.renderPass, source.subpass);
+
+				for (const VkBaseInStructure* next = static_cast<const VkBaseInStructure*>(source.pNext); next; next = next->pNext) {
+					if (next->sType == VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO) {
+						const VkPipelineRenderingCreateInfo* rendering = reinterpret_cast<const VkPipelineRenderingCreateInfo*>(next);
+						renderingInfo = *rendering;
+						renderingInfo.pNext = nullptr;
+						colorAttachmentFormats.assign(rendering->pColorAttachmentFormats, rendering->pColorAttachmentFormats + rendering->colorAttachmentCount);
+						hasher.add(rendering->viewMask, rendering->depthAttachmentFormat, rendering->stencilAttachmentFormat);
+						hasher.addBytes(colorAttachmentFormats.data(), colorAttachmentFormats.size() * sizeof(VkFormat));
+					}
+				}
+
+				stages.reserve(source.stageCount);
+				for (uint32_t i = 0; i < source.stageCount; i++) {
+					stages.emplace_back(source.pStages[i], hasher);
+				}
+				if (source.pVertexInputState) {
+					vertexInputState = *source.pVertexInputState;
+					vertexBindings.assign(source.pVertexInputState->pVertexBindingDescriptions, source.pVertexInputState->pVertexBindingDescriptions + source.pVertexInputState->vertexBindingDescriptionCount);
+					vertexAttributes.assign(source.pVertexInputState->pVertexAttributeDescriptions, source.pVertexInputState->pVertexAttributeDescriptions + source.pVertexInputState->vertexAttributeDescriptionCount);
+					for (auto& binding : vertexBindings) {
+						hasher.add(binding.binding, binding.stride, binding.inputRate);
+					}
+					for (auto& attribute : vertexAttributes) {
+						hasher.add(attribute.location, attribute.binding, attribute.format, attribute.offset);
+					}
+				}
+				if (source.pInputAssemblyState) {
+					inputAssemblyState = *source.pInputAssemblyState;
+					hasher.add(inputAssemblyState.topology, inputAssemblyState.primitiveRestartEnable);
+				}
+				if (source.pTessellationState) {
+					tessellationState = *source.pTessellationState;
+					hasher.add(tessellationState.patchControlPoints);
+				}
+				if (source.pViewportState) {
+					viewportState = *source.pViewportState;
+					if (source.pViewportState->pViewports) {
+						viewports.assign(source.pViewportState->pViewports, source.pViewportState->pViewports + source.pViewportState->viewportCount);
+						hasher.addBytes(viewports.data(), viewports.size() * sizeof(VkViewport));
+					}
+					if (source.pViewportState->pScissors) {
+						scissors.assign(source.pViewportState->pScissors, source.pViewportState->pScissors + source.pViewportState->scissorCount);
+						hasher.addBytes(scissors.data(), scissors.size() * sizeof(VkRect2D));
+					}
+					hasher.add(viewportState.viewportCount, viewportState.scissorCount);
+				}
+				if (source.pRasterizationState) {
+					rasterizationState = *source.pRasterizationState;
+					const auto& s = rasterizationState;
+					hasher.add(s.depthClampEnable, s.rasterizerDiscardEnable, s.polygonMode, s.cullMode, s.frontFace, s.depthBiasEnable, s.depthBiasConstantFactor, s.depthBiasClamp, s.depthBiasSlopeFactor, s.lineWidth);
+				}
+				if (source.pMultisampleState) {
+					multisampleState = *source.pMultisampleState;
+					const auto& s = multisampleState;
+					if (s.pSampleMask) {
+						sampleMask.assign(s.pSampleMask, s.pSampleMask + (s.rasterizationSamples + 31) / 32);
+						hasher.addBytes(sampleMask.data(), sampleMask.size() * sizeof(VkSampleMask));
+					}
+					hasher.add(s.rasterizationSamples, s.sampleShadingEnable, s.minSampleShading, s.alphaToCoverageEnable, s.alphaToOneEnable);
+				}
+				if (source.pDepthStencilState) {
+					depthStencilState = *source.pDepthStencilState;
+					const auto& s = depthStencilState;
+					hasher.add(s.depthTestEnable, s.depthWriteEnable, s.depthCompareOp, s.depthBoundsTestEnable, s.stencilTestEnable, s.minDepthBounds, s.maxDepthBounds);
+					for (const VkStencilOpState& op : { s.front, s.back }) {
+						hasher.add(op.failOp, op.passOp, op.depthFailOp, op.compareOp, op.compareMask, op.writeMask, op.reference);
+					}
+				}
+				if (source.pColorBlendState) {
+					colorBlendState = *source.pColorBlendState;
+					blendAttachments.assign(source.pColorBlendState->pAttachments, source.pColorBlendState->pAttachments + source.pColorBlendState->attachmentCount);
+					hasher.add(colorBlendState.logicOpEnable, colorBlendState.logicOp, colorBlendState.blendConstants);
+					for (auto& a : blendAttachments) {
+						hasher.add(a.blendEnable, a.srcColorBlendFactor, a.dstColorBlendFactor, a.colorBlendOp, a.srcAlphaBlendFactor, a.dstAlphaBlendFactor, a.alphaBlendOp, a.colorWriteMask);
+					}
+				}
+				if (source.pDynamicState) {
+					dynamicState = *source.pDynamicState;
+					dynamicStates.assign(source.pDynamicState->pDynamicStates, source.pDynamicState->pDynamicStates + source.pDynamicState->dynamicStateCount);
+					hasher.addBytes(dynamicStates.data(), dynamicStates.size() * sizeof(VkDynamicState));
+				}
+				hash = hasher.hash;
+
+				// Point the copy at the owned data, the descriptor lives on the heap and is never moved after this
+				for (auto& stage : stages) {
+					stage.fixup();
+					stageCreateInfos.push_back(stage.createInfo);
+				}
+				createInfo.pStages = stageCreateInfos.data();
+				if (source.pVertexInputState) {
+					vertexInputState.pNext = nullptr;
+					vertexInputState.pVertexBindingDescriptions = vertexBindings.data();
+					vertexInputState.pVertexAttributeDescriptions = vertexAttributes.data();
+					createInfo.pVertexInputState = &vertexInputState;
+				}
+				if (source.pInputAssemblyState) {
+					inputAssemblyState.pNext = nullptr;
+					createInfo.pInputAssemblyState = &inputAssemblyState;
+				}
+				if (source.pTessellationState) {
+					tessellationState.pNext = nullptr;
+					createInfo.pTessellationState = &tessellationState;
+				}
+				if (source.pViewportState) {
+					viewportState.pNext = nullptr;
+					viewportState.pViewports = viewports.empty() ? nullptr : viewports.data();
+					viewportState.pScissors = scissors.empty() ? nullptr : scissors.data();
+					createInfo.pViewportState = &viewportState;
+				}
+				if (source.pRasterizationState) {
+					rasterizationState.pNext = nullptr;
+					createInfo.pRasterizationState = &rasterizationState;
+				}
+				if (source.pMultisampleState) {
+					multisampleState.pNext = nullptr;
+					multisampleState.pSampleMask = sampleMask.empty() ? nullptr : sampleMask.data();
+					createInfo.pMultisampleState = &multisampleState;
+				}
+				if (source.pDepthStencilState) {
+					depthStencilState.pNext = nullptr;
+					createInfo.pDepthStencilState = &depthStencilState;
+				}
+				if (source.pColorBlendState) {
+					colorBlendState.pNext = nullptr;
+					colorBlendState.pAttachments = blendAttachments.data();
+					createInfo.pColorBlendState = &colorBlendState;
+				}
+				if (source.pDynamicState) {
+					dynamicState.pNext = nullptr;
+					dynamicState.pDynamicStates = dynamicStates.data();
+					createInfo.pDynamicState = &dynamicState;
+				}
+				if (renderingInfo.sType == VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO) {
+					renderingInfo.pColorAttachmentFormats = colorAttachmentFormats.data();
+					createInfo.pNext = &renderingInfo;
+				}
+			}
+		};
+
+		struct ComputePipelineDesc {
+			VkComputePipelineCreateInfo createInfo{};
+			std::vector<ShaderStage> stage;
+			uint64_t hash{ 0 };
+
+			explicit ComputePipelineDesc(const VkComputePipelineCreateInfo& source)
+			{
+				Hasher hasher;
+				createInfo = source;
+				createInfo.pNext = nullptr;
+				hasher.add(source.flags, source.layout);
+				stage.emplace_back(source.stage, hasher);
+				stage[0].fixup();
+				createInfo.stage = stage[0].createInfo;
+				hash = hasher.hash;
+			}
+		};
+	}
+
+	/*
+		Pipeline compiler
+	*/
+
+	void PipelineCompiler::create(VkDevice device, VkPipelineCache pipelineCache, uint32_t threadCount)
+	{
+		assert(workers.empty());
+		this->device = device;
+		this->pipelineCache = pipelineCache;
+		if (threadCount == 0) {
+			threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+		stop = false;
+		unmerged = 0;
+		statistics = {};
+		VkPipelineCacheCreateInfo pipelineCacheCI{ .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+		workerCaches.resize(threadCount);
+		for (auto& cache : workerCaches) {
+			VK_CHECK_RESULT(vkCreatePipelineCache(device, &pipelineCacheCI, nullptr, &cache));
+		}
+		for (uint32_t i = 0; i < threadCount; i++) {
+			workers.emplace_back(&PipelineCompiler::workerFn, this, i);
+		}
+	}
+
+	void PipelineCompiler::destroy()
+	{
+		if (workers.empty()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+			// Requests that haven't been started are answered with a null handle, so nobody waits on them forever
+			while (!jobs.empty()) {
+				jobs.top().promise->set_value(VK_NULL_HANDLE);
+				jobs.pop();
+			}
+		}
+		jobAvailable.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		workers.clear();
+		mergeCaches();
+		for (auto cache : workerCaches) {
+			vkDestroyPipelineCache(device, cache, nullptr);
+		}
+		workerCaches.clear();
+		for (auto pipeline : pipelines) {
+			vkDestroyPipeline(device, pipeline, nullptr);
+		}
+		pipelines.clear();
+		futures.clear();
+	}
+
+	void PipelineCompiler::workerFn(uint32_t index)
+	{
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobAvailable.wait(lock, [this] { return stop || !jobs.empty(); });
+				if (stop) {
+					return;
+				}
+				job = jobs.top();
+				jobs.pop();
+				running++;
+			}
+			const auto tStart = std::chrono::high_resolution_clock::now();
+			VkPipeline pipeline = job.function(workerCaches[index]);
+			const double compileTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (pipeline != VK_NULL_HANDLE) {
+					pipelines.push_back(pipeline);
+				}
+				statistics.compiled++;
+				unmerged++;
+				statistics.compileTime += compileTime;
+				running--;
+				job.promise->set_value(pipeline);
+			}
+			jobsDone.notify_all();
+		}
+	}
+
+	std::shared_future<VkPipeline> PipelineCompiler::enqueue(uint64_t hash, CreateFunction function, Priority priority)
+	{
+		assert(!workers.empty());
+		std::lock_guard<std::mutex> lock(mutex);
+		statistics.requests++;
+		if (auto it = futures.find(hash); it != futures.end()) {
+			statistics.deduplicated++;
+			return it->second;
+		}
+		auto promise = std::make_shared<std::promise<VkPipeline>>();
+		std::shared_future<VkPipeline> future = promise->get_future().share();
+		futures[hash] = future;
+		jobs.push({ .priority = priority, .sequence = sequence++, .function = std::move(function), .promise = promise });
+		jobAvailable.notify_one();
+		return future;
+	}
+
+	std::shared_future<VkPipeline> PipelineCompiler::compile(const VkGraphicsPipelineCreateInfo& createInfo, Priority priority)
+	{
+		auto desc = std::make_shared<GraphicsPipelineDesc>(createInfo);
+		const uint64_t hash = desc->hash;
+		return enqueue(hash, [this, desc](VkPipelineCache cache) {
+			VkPipeline pipeline{ VK_NULL_HANDLE };
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, cache, 1, &desc->createInfo, nullptr, &pipeline));
+			return pipeline;
+		}, priority);
+	}
+
+	std::shared_future<VkPipeline> PipelineCompiler::compile(const VkComputePipelineCreateInfo& createInfo, Priority priority)
+	{
+		auto desc = std::make_shared<ComputePipelineDesc>(createInfo);
+		// Keeps compute and graphics pipelines apart in the unlikely case their states hash to the same value
+		const uint64_t hash = desc->hash ^ 0x9e3779b97f4a7c15ull;
+		return enqueue(hash, [this, desc](VkPipelineCache cache) {
+			VkPipeline pipeline{ VK_NULL_HANDLE };
+			VK_CHECK_RESULT(vkCreateComputePipelines(device, cache, 1, &desc->createInfo, nullptr, &pipeline));
+			return pipeline;
+		}, priority);
+	}
+
+	std::shared_future<VkPipeline> PipelineCompiler::compile(uint64_t hash, CreateFunction function, Priority priority)
+	{
+		return enqueue(hash, std::move(function), priority);
+	}
+
+	void PipelineCompiler::mergeCaches()
+	{
+		if ((pipelineCache == VK_NULL_HANDLE) || workerCaches.empty()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (unmerged == 0) {
+				return;
+			}
+			unmerged = 0;
+			statistics.cacheMerges++;
+		}
+		// Only the destination cache needs external synchronization, the workers may keep using their caches while they're merged
+		VK_CHECK_RESULT(vkMergePipelineCaches(device, pipelineCache, static_cast<uint32_t>(workerCaches.size()), workerCaches.data()));
+	}
+
+	uint32_t PipelineCompiler::pending() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return static_cast<uint32_t>(jobs.size()) + running;
+	}
+
+	void PipelineCompiler::wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		jobsDone.wait(lock, [this] { return jobs.empty() && (running == 0); });
+	}
+
+	PipelineCompiler::Statistics PipelineCompiler::stats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return statistics;
+	}
+
+	/*
+		Async pipeline
+	*/
+
+	bool AsyncPipeline::ready()
+	{
+		if (pipeline != VK_NULL_HANDLE) {
+			return true;
+		}
+		if (!future.valid() || (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)) {
+			return false;
+		}
+		pipeline = future.get();
+		return pipeline != VK_NULL_HANDLE;
+	}
+
+	VkPipeline AsyncPipeline::get()
+	{
+		// The future is only polled until the pipeline is available, after that this is a plain member access
+		return ready() ? pipeline : fallback;
+	}
+}
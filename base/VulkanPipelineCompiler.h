@@ -0,0 +1,124 @@
+/*
+* Background pipeline compiler
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Moves pipeline creation off the main thread:
+* - Requests are queued by priority and compiled on a pool of worker threads, each request returns a future for the pipeline
+* - Graphics pipeline create infos are deep copied when they're submitted, so the caller's state structures don't need to outlive the call
+* - Requests are identified by a hash of their state, requesting a pipeline that has already been requested returns the same future
+* - Each worker compiles into its own pipeline cache, these are merged into the application's pipeline cache with vkMergePipelineCaches
+* Samples can render with a cheap fallback pipeline (see AsyncPipeline) until the actual pipeline has been compiled, so they don't have to wait for all pipelines before the first frame
+* All pipelines returned by the compiler are owned by it and destroyed together with it
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+namespace vks
+{
+	class PipelineCompiler
+	{
+	public:
+		// Requests with a higher priority are compiled first, requests with the same priority are compiled in submission order
+		enum class Priority { Low = 0, Normal = 1, High = 2 };
+
+		// Creates a pipeline using the given (worker) pipeline cache, used for pipelines that can't be described by a single create info
+		using CreateFunction = std::function<VkPipeline(VkPipelineCache)>;
+
+		struct Statistics {
+			uint32_t requests{ 0 };
+			// Requests that returned the future of an earlier request with the same hash
+			uint32_t deduplicated{ 0 };
+			uint32_t compiled{ 0 };
+			// Summed up time the workers spent compiling in milliseconds
+			double compileTime{ 0.0 };
+			uint32_t cacheMerges{ 0 };
+		};
+
+		/** @brief Starts the workers, a thread count of zero uses all but one of the available hardware threads */
+		void create(VkDevice device, VkPipelineCache pipelineCache, uint32_t threadCount = 0);
+		/** @brief Drops pending requests, waits for the workers, merges their caches and destroys all pipelines created by the compiler */
+		void destroy();
+		/** @brief Queues a graphics pipeline, the create info is copied so it may go out of scope after this call */
+		std::shared_future<VkPipeline> compile(const VkGraphicsPipelineCreateInfo& createInfo, Priority priority = Priority::Normal);
+		/** @brief Queues a compute pipeline */
+		std::shared_future<VkPipeline> compile(const VkComputePipelineCreateInfo& createInfo, Priority priority = Priority::Normal);
+		/** @brief Queues a custom pipeline creation, the hash is supplied by the caller and is used for deduplication */
+		std::shared_future<VkPipeline> compile(uint64_t hash, CreateFunction function, Priority priority = Priority::Normal);
+		/** @brief Merges the worker caches into the application's pipeline cache if new pipelines have been compiled since the last merge, must be called from the thread that owns that cache */
+		void mergeCaches();
+		/** @brief Number of requests that haven't been finished yet */
+		uint32_t pending() const;
+		/** @brief Blocks until all queued requests have been compiled */
+		void wait();
+		Statistics stats() const;
+
+	private:
+		struct Job {
+			Priority priority;
+			uint64_t sequence;
+			CreateFunction function;
+			std::shared_ptr<std::promise<VkPipeline>> promise;
+		};
+		struct JobOrder {
+			bool operator()(const Job& a, const Job& b) const
+			{
+				return (a.priority != b.priority) ? (a.priority < b.priority) : (a.sequence > b.sequence);
+			}
+		};
+		VkDevice device{ VK_NULL_HANDLE };
+		VkPipelineCache pipelineCache{ VK_NULL_HANDLE };
+		std::vector<std::thread> workers;
+		std::vector<VkPipelineCache> workerCaches;
+		std::priority_queue<Job, std::vector<Job>, JobOrder> jobs;
+		std::unordered_map<uint64_t, std::shared_future<VkPipeline>> futures;
+		std::vector<VkPipeline> pipelines;
+		uint64_t sequence{ 0 };
+		uint32_t running{ 0 };
+		// Pipelines compiled since the worker caches were last merged
+		uint32_t unmerged{ 0 };
+		bool stop{ false };
+		Statistics statistics;
+		mutable std::mutex mutex;
+		std::condition_variable jobAvailable;
+		std::condition_variable jobsDone;
+		void workerFn(uint32_t index);
+		std::shared_future<VkPipeline> enqueue(uint64_t hash, CreateFunction function, Priority priority);
+	};
+
+	// Pipeline that's compiled in the background with a fallback that's used until it's ready
+	class AsyncPipeline
+	{
+	public:
+		std::shared_future<VkPipeline> future;
+		// Must be compatible with the compiled pipeline (same layout and render pass), owned by the caller
+		VkPipeline fallback{ VK_NULL_HANDLE };
+
+		AsyncPipeline() = default;
+		AsyncPipeline(std::shared_future<VkPipeline> future, VkPipeline fallback) : future(std::move(future)), fallback(fallback) {}
+		/** @brief Returns true once the background compilation has finished */
+		bool ready();
+		/** @brief Returns the compiled pipeline if it's ready, the fallback otherwise */
+		VkPipeline get();
+
+	private:
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+	};
+}
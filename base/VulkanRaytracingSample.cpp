@@ -16,7 +16,7 @@ void VulkanRaytracingSample::setupRenderPass()
 	vkDestroyRenderPass(device, renderPass, nullptr);
 
 	VkAttachmentLoadOp colorLoadOp{ VK_ATTACHMENT_LOAD_OP_LOAD };
-	VkImageLayout colorInitialLayout{ VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+	VkImageLayout colorInitialLayout{ swapChain.presentLayout };
 	
 	if (rayQueryOnly) {
 		colorLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
@@ -32,7 +32,7 @@ void VulkanRaytracingSample::setupRenderPass()
 			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 			.initialLayout = colorInitialLayout,
-			.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+			.finalLayout = swapChain.presentLayout
 		},
 		VkAttachmentDescription{
 			.format = depthFormat,
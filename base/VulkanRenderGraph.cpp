@@ -0,0 +1,445 @@
+/*
+* Frame graph with automatic barrier and layout management
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanRenderGraph.h"
+
+#include "VulkanDebug.h"
+#include "VulkanInitializers.hpp"
+
+namespace vks
+{
+	namespace
+	{
+		constexpr VkAccessFlags2 writeAccessMask{ VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_SHADER_WRITE_BIT |
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT };
+
+		// The legacy stage flags share their bit values with synchronization2, only the stages that were split up need to be mapped
+		VkPipelineStageFlags toLegacyStages(VkPipelineStageFlags2 stages)
+		{
+			VkPipelineStageFlags result = static_cast<VkPipelineStageFlags>(stages & 0xFFFFFFFFull);
+			if (stages & (VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_RESOLVE_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT)) {
+				result |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+			}
+			if (stages & (VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT)) {
+				result |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+			}
+			return result;
+		}
+
+		VkAccessFlags toLegacyAccess(VkAccessFlags2 access)
+		{
+			VkAccessFlags result = static_cast<VkAccessFlags>(access & 0xFFFFFFFFull);
+			if (access & (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT)) {
+				result |= VK_ACCESS_SHADER_READ_BIT;
+			}
+			if (access & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT) {
+				result |= VK_ACCESS_SHADER_WRITE_BIT;
+			}
+			return result;
+		}
+	}
+
+	const RenderGraph::Usage RenderGraph::colorAttachment{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	const RenderGraph::Usage RenderGraph::depthStencilAttachment{ VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+	const RenderGraph::Usage RenderGraph::depthStencilReadOnly{ VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+	const RenderGraph::Usage RenderGraph::sampledFragment{ VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	const RenderGraph::Usage RenderGraph::sampledCompute{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	const RenderGraph::Usage RenderGraph::storageReadFragment{ VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+	const RenderGraph::Usage RenderGraph::storageReadCompute{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+	const RenderGraph::Usage RenderGraph::storageWriteCompute{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+	const RenderGraph::Usage RenderGraph::transferRead{ VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+	const RenderGraph::Usage RenderGraph::transferWrite{ VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+
+	RenderGraph::Pass& RenderGraph::Pass::addAccess(Resource resource, const Usage& usage, AccessType type)
+	{
+		// Multiple accesses of the same resource within a pass are merged into one
+		for (auto& access : accesses) {
+			if (access.resource != resource) {
+				continue;
+			}
+			if (access.usage.layout != usage.layout) {
+				vks::tools::exitFatal("Render graph pass \"" + name + "\" uses a resource with different image layouts", -1);
+			}
+			access.usage.stages |= usage.stages;
+			access.usage.access |= usage.access;
+			if (access.type == AccessType::Reference) {
+				access.type = type;
+			} else if ((type != AccessType::Reference) && (type != access.type)) {
+				access.type = AccessType::ReadWrite;
+			}
+			return *this;
+		}
+		accesses.push_back({ resource, usage, type });
+		return *this;
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::read(Resource resource, const Usage& usage)
+	{
+		return addAccess(resource, usage, AccessType::Read);
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::write(Resource resource, const Usage& usage)
+	{
+		return addAccess(resource, usage, AccessType::Write);
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::readWrite(Resource resource, const Usage& usage)
+	{
+		return addAccess(resource, usage, AccessType::ReadWrite);
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::reference(Resource resource, const Usage& usage)
+	{
+		return addAccess(resource, usage, AccessType::Reference);
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::external()
+	{
+		isExternal = true;
+		return *this;
+	}
+
+	bool RenderGraph::Pass::culled() const
+	{
+		return isCulled;
+	}
+
+	const std::string& RenderGraph::Pass::getName() const
+	{
+		return name;
+	}
+
+	uint64_t RenderGraph::ResourceInfo::key() const
+	{
+		return (image != VK_NULL_HANDLE) ? (uint64_t)image : (uint64_t)buffer;
+	}
+
+	void RenderGraph::reset()
+	{
+		passes.clear();
+		orderedPasses.clear();
+		resources.clear();
+		executionOrder.clear();
+	}
+
+	void RenderGraph::invalidate()
+	{
+		states.clear();
+		aliases.clear();
+	}
+
+	void RenderGraph::addAliases(const std::vector<VkImage>& images)
+	{
+		for (auto image : images) {
+			std::vector<uint64_t>& imageAliases = aliases[(uint64_t)image];
+			for (auto alias : images) {
+				if (alias != image) {
+					imageAliases.push_back((uint64_t)alias);
+				}
+			}
+		}
+	}
+
+	RenderGraph::Resource RenderGraph::importImage(const std::string& name, VkImage image, const VkImageSubresourceRange& subresourceRange)
+	{
+		for (size_t i = 0; i < resources.size(); i++) {
+			if (resources[i].image == image) {
+				return static_cast<Resource>(i);
+			}
+		}
+		ResourceInfo info{};
+		info.name = name;
+		info.image = image;
+		info.subresourceRange = subresourceRange;
+		resources.push_back(info);
+		return static_cast<Resource>(resources.size() - 1);
+	}
+
+	RenderGraph::Resource RenderGraph::importBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+	{
+		for (size_t i = 0; i < resources.size(); i++) {
+			if (resources[i].buffer == buffer) {
+				return static_cast<Resource>(i);
+			}
+		}
+		ResourceInfo info{};
+		info.name = name;
+		info.buffer = buffer;
+		info.offset = offset;
+		info.size = size;
+		resources.push_back(info);
+		return static_cast<Resource>(resources.size() - 1);
+	}
+
+	RenderGraph::Pass& RenderGraph::addPass(const std::string& name, std::function<void(VkCommandBuffer commandBuffer)> record)
+	{
+		Pass& pass = passes.emplace_back();
+		pass.name = name;
+		pass.record = record;
+		return pass;
+	}
+
+	void RenderGraph::compile()
+	{
+		// Culling: Walk the passes backwards, starting at the external ones, and only keep passes that write resources read by a pass that's kept
+		std::vector<bool> needed(resources.size(), false);
+		for (auto pass = passes.rbegin(); pass != passes.rend(); pass++) {
+			bool used = pass->isExternal;
+			for (auto& access : pass->accesses) {
+				if (((access.type == Pass::AccessType::Write) || (access.type == Pass::AccessType::ReadWrite)) && needed[access.resource]) {
+					used = true;
+				}
+			}
+			pass->isCulled = !used;
+			if (!used) {
+				continue;
+			}
+			// Passes before this one only need to provide the contents of resources this one doesn't overwrite completely
+			for (auto& access : pass->accesses) {
+				if (access.type == Pass::AccessType::Write) {
+					needed[access.resource] = false;
+				}
+			}
+			for (auto& access : pass->accesses) {
+				if ((access.type == Pass::AccessType::Read) || (access.type == Pass::AccessType::ReadWrite)) {
+					needed[access.resource] = true;
+				}
+			}
+		}
+
+		std::vector<Pass*> activePasses;
+		for (auto& pass : passes) {
+			if (!pass.isCulled) {
+				activePasses.push_back(&pass);
+			}
+		}
+		stats.passes = static_cast<uint32_t>(passes.size());
+		stats.culledPasses = static_cast<uint32_t>(passes.size() - activePasses.size());
+
+		// Dependencies: A pass depends on earlier passes that access the same resource if either of them writes it, external passes keep their relative order
+		const size_t count = activePasses.size();
+		std::vector<std::vector<bool>> dependsOn(count, std::vector<bool>(count, false));
+		std::vector<uint32_t> dependencyCount(count, 0);
+		auto writes = [](Pass::AccessType type) { return (type == Pass::AccessType::Write) || (type == Pass::AccessType::ReadWrite); };
+		for (size_t j = 0; j < count; j++) {
+			for (size_t i = 0; i < j; i++) {
+				bool dependency = activePasses[i]->isExternal && activePasses[j]->isExternal;
+				for (auto& accessI : activePasses[i]->accesses) {
+					for (auto& accessJ : activePasses[j]->accesses) {
+						if ((accessI.resource == accessJ.resource) && (writes(accessI.type) || writes(accessJ.type))) {
+							dependency = true;
+						}
+					}
+				}
+				if (dependency) {
+					dependsOn[j][i] = true;
+					dependencyCount[j]++;
+				}
+			}
+		}
+
+		// Ordering: Topological sort that prefers passes not depending on the previously scheduled one
+		// This moves independent work between a producer and its consumer, so the GPU has something to do while waiting at the consumer's barrier
+		orderedPasses.clear();
+		executionOrder.clear();
+		std::vector<bool> scheduled(count, false);
+		size_t last = count;
+		for (size_t n = 0; n < count; n++) {
+			size_t next = count;
+			for (size_t i = 0; i < count; i++) {
+				if (scheduled[i] || (dependencyCount[i] > 0)) {
+					continue;
+				}
+				if (next == count) {
+					next = i;
+				}
+				if ((last == count) || !dependsOn[i][last]) {
+					next = i;
+					break;
+				}
+			}
+			scheduled[next] = true;
+			for (size_t j = 0; j < count; j++) {
+				if (dependsOn[j][next]) {
+					dependencyCount[j]--;
+				}
+			}
+			orderedPasses.push_back(activePasses[next]);
+			executionOrder.push_back(activePasses[next]->name);
+			last = next;
+		}
+	}
+
+	void RenderGraph::execute(VkCommandBuffer commandBuffer)
+	{
+		stats.barrierBatches = 0;
+		stats.imageBarriers = 0;
+		stats.bufferBarriers = 0;
+
+		for (auto pass : orderedPasses) {
+			std::vector<VkImageMemoryBarrier2> imageBarriers;
+			std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+
+			for (auto& access : pass->accesses) {
+				const ResourceInfo& info = resources[access.resource];
+				ResourceState& state = states[info.key()];
+				const Usage& usage = access.usage;
+				const bool isImage = (info.image != VK_NULL_HANDLE);
+				const bool isWrite = (access.type == Pass::AccessType::Write) || (access.type == Pass::AccessType::ReadWrite);
+				const bool layoutChange = isImage && (state.layout != usage.layout);
+
+				VkPipelineStageFlags2 srcStages{ VK_PIPELINE_STAGE_2_NONE };
+				VkAccessFlags2 srcAccess{ VK_ACCESS_2_NONE };
+				bool barrier{ false };
+
+				const auto imageAliases = isImage ? aliases.find(info.key()) : aliases.end();
+
+				if (isWrite || layoutChange) {
+					// Wait for all previous accesses (write after read only needs an execution dependency), image layout transitions always need a barrier
+					srcStages = state.writeStages | state.readStages;
+					srcAccess = state.writeAccess;
+					// The memory may have been used by an alias since, so its accesses also need to finish
+					if (imageAliases != aliases.end()) {
+						for (auto alias : imageAliases->second) {
+							const ResourceState& aliasState = states[alias];
+							srcStages |= aliasState.writeStages | aliasState.readStages;
+							srcAccess |= aliasState.writeAccess;
+						}
+					}
+					barrier = layoutChange || (srcStages != VK_PIPELINE_STAGE_2_NONE);
+				} else if (state.writeStages != VK_PIPELINE_STAGE_2_NONE) {
+					// Read after write, only required if the write hasn't already been made visible to these stages
+					barrier = ((usage.stages & ~state.visibleStages) != 0) || ((usage.access & ~state.visibleAccess) != 0);
+					srcStages = state.writeStages;
+					srcAccess = state.writeAccess;
+				}
+
+				if (barrier) {
+					if (isImage) {
+						VkImageMemoryBarrier2 imageBarrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+						imageBarrier.srcStageMask = srcStages;
+						imageBarrier.srcAccessMask = srcAccess;
+						imageBarrier.dstStageMask = usage.stages;
+						imageBarrier.dstAccessMask = usage.access;
+						// Passes that overwrite the image don't need its previous contents
+						imageBarrier.oldLayout = (layoutChange && (access.type == Pass::AccessType::Write)) ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+						imageBarrier.newLayout = usage.layout;
+						imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						imageBarrier.image = info.image;
+						imageBarrier.subresourceRange = info.subresourceRange;
+						imageBarriers.push_back(imageBarrier);
+					} else {
+						VkBufferMemoryBarrier2 bufferBarrier{ .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+						bufferBarrier.srcStageMask = srcStages;
+						bufferBarrier.srcAccessMask = srcAccess;
+						bufferBarrier.dstStageMask = usage.stages;
+						bufferBarrier.dstAccessMask = usage.access;
+						bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						bufferBarrier.buffer = info.buffer;
+						bufferBarrier.offset = info.offset;
+						bufferBarrier.size = info.size;
+						bufferBarriers.push_back(bufferBarrier);
+					}
+				}
+
+				// Update the resource's state
+				if (isWrite) {
+					state.writeStages = usage.stages;
+					state.writeAccess = usage.access & writeAccessMask;
+					state.readStages = VK_PIPELINE_STAGE_2_NONE;
+					state.visibleStages = VK_PIPELINE_STAGE_2_NONE;
+					state.visibleAccess = VK_ACCESS_2_NONE;
+				} else if (layoutChange) {
+					// Later accesses need to wait for the layout transition, which completes before the stages of this pass
+					state.writeStages = usage.stages;
+					state.writeAccess = VK_ACCESS_2_NONE;
+					state.readStages = usage.stages;
+					state.visibleStages = usage.stages;
+					state.visibleAccess = usage.access;
+				} else {
+					state.readStages |= usage.stages;
+					if (barrier) {
+						state.visibleStages |= usage.stages;
+						state.visibleAccess |= usage.access;
+					}
+				}
+				if (isImage) {
+					state.layout = usage.layout;
+				}
+				// Writing to or transitioning the image invalidates the contents of its aliases
+				if ((isWrite || layoutChange) && (imageAliases != aliases.end())) {
+					for (auto alias : imageAliases->second) {
+						states[alias].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+					}
+				}
+			}
+
+			if (!imageBarriers.empty() || !bufferBarriers.empty()) {
+				recordBarriers(commandBuffer, imageBarriers, bufferBarriers);
+			}
+			vks::debugutils::cmdBeginLabel(commandBuffer, pass->name, glm::vec4(0.5f, 0.76f, 0.34f, 1.0f));
+			pass->record(commandBuffer);
+			vks::debugutils::cmdEndLabel(commandBuffer);
+		}
+	}
+
+	void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<VkImageMemoryBarrier2>& imageBarriers, const std::vector<VkBufferMemoryBarrier2>& bufferBarriers)
+	{
+		stats.barrierBatches++;
+		stats.imageBarriers += static_cast<uint32_t>(imageBarriers.size());
+		stats.bufferBarriers += static_cast<uint32_t>(bufferBarriers.size());
+
+		if (synchronization2) {
+			VkDependencyInfo dependencyInfo{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+			dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+			dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+			dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+			dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+			vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+			return;
+		}
+
+		// Legacy barriers share a single set of stage masks for the whole batch
+		VkPipelineStageFlags srcStages{ 0 };
+		VkPipelineStageFlags dstStages{ 0 };
+		std::vector<VkImageMemoryBarrier> legacyImageBarriers;
+		for (auto& barrier : imageBarriers) {
+			VkImageMemoryBarrier legacyBarrier = vks::initializers::imageMemoryBarrier();
+			legacyBarrier.srcAccessMask = toLegacyAccess(barrier.srcAccessMask);
+			legacyBarrier.dstAccessMask = toLegacyAccess(barrier.dstAccessMask);
+			legacyBarrier.oldLayout = barrier.oldLayout;
+			legacyBarrier.newLayout = barrier.newLayout;
+			legacyBarrier.image = barrier.image;
+			legacyBarrier.subresourceRange = barrier.subresourceRange;
+			legacyImageBarriers.push_back(legacyBarrier);
+			srcStages |= toLegacyStages(barrier.srcStageMask);
+			dstStages |= toLegacyStages(barrier.dstStageMask);
+		}
+		std::vector<VkBufferMemoryBarrier> legacyBufferBarriers;
+		for (auto& barrier : bufferBarriers) {
+			VkBufferMemoryBarrier legacyBarrier = vks::initializers::bufferMemoryBarrier();
+			legacyBarrier.srcAccessMask = toLegacyAccess(barrier.srcAccessMask);
+			legacyBarrier.dstAccessMask = toLegacyAccess(barrier.dstAccessMask);
+			legacyBarrier.buffer = barrier.buffer;
+			legacyBarrier.offset = barrier.offset;
+			legacyBarrier.size = barrier.size;
+			legacyBufferBarriers.push_back(legacyBarrier);
+			srcStages |= toLegacyStages(barrier.srcStageMask);
+			dstStages |= toLegacyStages(barrier.dstStageMask);
+		}
+		vkCmdPipelineBarrier(commandBuffer,
+			(srcStages != 0) ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			(dstStages != 0) ? dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			static_cast<uint32_t>(legacyBufferBarriers.size()), legacyBufferBarriers.data(),
+			static_cast<uint32_t>(legacyImageBarriers.size()), legacyImageBarriers.data());
+	}
+}
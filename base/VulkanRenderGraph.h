@@ -0,0 +1,158 @@
+/*
+* Frame graph with automatic barrier and layout management
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Passes declare which images and buffers they read and write (and how), the graph then derives everything else:
+* - Passes that don't contribute to an external pass (e.g. the one rendering to the swapchain) are culled
+* - Passes are ordered so that independent work is placed between a producer and its consumer where possible
+* - Image layout transitions and memory dependencies are generated with synchronization2 and batched into a single barrier per pass,
+*   read after read accesses and accesses that have already been made visible don't generate a barrier at all
+* The last access of every resource is kept across frames, so the graph can be rebuilt every frame (reset, declare, compile, execute)
+* This requires command buffers to be submitted in the order they are recorded
+* Render passes used with the graph should have initialLayout = finalLayout = the layout of the attachment usage and no external subpass dependencies
+* If synchronization2 isn't enabled, barriers are translated to and recorded with vkCmdPipelineBarrier
+* Images that share memory (see TransientAllocator) can be registered as aliases, the first access of an image after one of its aliases
+* has been used waits for the alias' accesses and discards the image's contents
+*/
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanTools.h"
+
+namespace vks
+{
+	class RenderGraph
+	{
+	public:
+		// Handle of an image or buffer imported into the graph
+		using Resource = uint32_t;
+
+		// Describes how a pass accesses a resource
+		struct Usage {
+			VkPipelineStageFlags2 stages{ VK_PIPELINE_STAGE_2_NONE };
+			VkAccessFlags2 access{ VK_ACCESS_2_NONE };
+			// Ignored for buffers
+			VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		};
+
+		// Common resource usages
+		static const Usage colorAttachment;
+		static const Usage depthStencilAttachment;
+		static const Usage depthStencilReadOnly;
+		static const Usage sampledFragment;
+		static const Usage sampledCompute;
+		static const Usage storageReadFragment;
+		static const Usage storageReadCompute;
+		static const Usage storageWriteCompute;
+		static const Usage transferRead;
+		static const Usage transferWrite;
+
+		class Pass
+		{
+		public:
+			/** @brief The pass reads the resource */
+			Pass& read(Resource resource, const Usage& usage);
+			/** @brief The pass overwrites the resource, previous contents are discarded (e.g. attachments that are cleared) */
+			Pass& write(Resource resource, const Usage& usage);
+			/** @brief The pass modifies the resource, previous contents are preserved */
+			Pass& readWrite(Resource resource, const Usage& usage);
+			/** @brief The resource is bound (e.g. in a descriptor set) but may not be accessed, it's transitioned to the usage's layout but doesn't keep the passes writing it alive */
+			Pass& reference(Resource resource, const Usage& usage);
+			/** @brief The pass has side effects outside of the graph (e.g. rendering to the swapchain) and is never culled */
+			Pass& external();
+			/** @brief Returns true if the pass has been culled by the last call to compile */
+			bool culled() const;
+			const std::string& getName() const;
+
+		private:
+			friend class RenderGraph;
+			enum class AccessType { Read, Write, ReadWrite, Reference };
+			struct Access {
+				Resource resource;
+				Usage usage;
+				AccessType type;
+			};
+			std::string name;
+			std::function<void(VkCommandBuffer commandBuffer)> record;
+			std::vector<Access> accesses;
+			bool isExternal{ false };
+			bool isCulled{ false };
+			Pass& addAccess(Resource resource, const Usage& usage, AccessType type);
+		};
+
+		struct Stats {
+			uint32_t passes{ 0 };
+			uint32_t culledPasses{ 0 };
+			// Number of barrier commands recorded by the last execution
+			uint32_t barrierBatches{ 0 };
+			uint32_t imageBarriers{ 0 };
+			uint32_t bufferBarriers{ 0 };
+		};
+
+		// Set to true if the synchronization2 feature has been enabled, otherwise legacy barriers are recorded
+		bool synchronization2{ false };
+		Stats stats;
+		// Names of the passes that are executed, in execution order (updated by compile)
+		std::vector<std::string> executionOrder;
+
+		/** @brief Removes all passes and resources, the last known state of the resources is kept */
+		void reset();
+		/** @brief Forgets the last known state of all resources and all aliases, must be called if resources are destroyed (e.g. on resize) */
+		void invalidate();
+		/** @brief Marks images as sharing the same memory, aliases persist until invalidate is called */
+		void addAliases(const std::vector<VkImage>& images);
+		/** @brief Imports an image, importing the same image twice returns the same handle */
+		Resource importImage(const std::string& name, VkImage image, const VkImageSubresourceRange& subresourceRange);
+		/** @brief Imports a buffer, importing the same buffer twice returns the same handle */
+		Resource importBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+		/** @brief Adds a pass, the passed function records its commands once the graph is executed */
+		Pass& addPass(const std::string& name, std::function<void(VkCommandBuffer commandBuffer)> record);
+		/** @brief Culls unused passes and determines the execution order */
+		void compile();
+		/** @brief Records barriers and commands of all passes that haven't been culled into the command buffer */
+		void execute(VkCommandBuffer commandBuffer);
+
+	private:
+		struct ResourceInfo {
+			std::string name;
+			VkImage image{ VK_NULL_HANDLE };
+			VkImageSubresourceRange subresourceRange{};
+			VkBuffer buffer{ VK_NULL_HANDLE };
+			VkDeviceSize offset{ 0 };
+			VkDeviceSize size{ VK_WHOLE_SIZE };
+			uint64_t key() const;
+		};
+		// Last known access of a resource, persists across frames
+		struct ResourceState {
+			VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+			// Stages and (write) access of the last write
+			VkPipelineStageFlags2 writeStages{ VK_PIPELINE_STAGE_2_NONE };
+			VkAccessFlags2 writeAccess{ VK_ACCESS_2_NONE };
+			// Stages that accessed the resource since the last write
+			VkPipelineStageFlags2 readStages{ VK_PIPELINE_STAGE_2_NONE };
+			// Stages and access types the last write has already been made visible to
+			VkPipelineStageFlags2 visibleStages{ VK_PIPELINE_STAGE_2_NONE };
+			VkAccessFlags2 visibleAccess{ VK_ACCESS_2_NONE };
+		};
+		std::vector<ResourceInfo> resources;
+		std::deque<Pass> passes;
+		std::vector<Pass*> orderedPasses;
+		std::unordered_map<uint64_t, ResourceState> states;
+		// Keys of the images sharing memory with an image
+		std::unordered_map<uint64_t, std::vector<uint64_t>> aliases;
+		void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<VkImageMemoryBarrier2>& imageBarriers, const std::vector<VkBufferMemoryBarrier2>& bufferBarriers);
+	};
+}
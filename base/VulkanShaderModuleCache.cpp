@@ -0,0 +1,202 @@
+/*
+* Shader module cache
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanShaderModuleCache.h"
+
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__ANDROID__)
+#include "VulkanAndroid.h"
+#include <android/asset_manager.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "VulkanTools.h"
+
+namespace vks
+{
+	namespace
+	{
+		// Read only view of a file's contents, mapped into memory where the platform allows it
+		class MappedFile
+		{
+		public:
+			const uint32_t* data{ nullptr };
+			size_t size{ 0 };
+
+			explicit MappedFile(const std::string& fileName)
+			{
+#if defined(_WIN32)
+				file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (file == INVALID_HANDLE_VALUE) {
+					return;
+				}
+				LARGE_INTEGER fileSize{};
+				GetFileSizeEx(file, &fileSize);
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping == nullptr) {
+					return;
+				}
+				view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				if (view != nullptr) {
+					data = static_cast<const uint32_t*>(view);
+					size = static_cast<size_t>(fileSize.QuadPart);
+				}
+#elif defined(__ANDROID__)
+				// Assets are packed into the apk, uncompressed assets are mapped by the asset manager
+				asset = AAssetManager_open(androidApp->activity->assetManager, fileName.c_str(), AASSET_MODE_BUFFER);
+				if (!asset) {
+					return;
+				}
+				size = AAsset_getLength(asset);
+				const void* buffer = AAsset_getBuffer(asset);
+				// SPIR-V needs to be 4 byte aligned, which isn't guaranteed for assets inside the apk
+				if (buffer && (reinterpret_cast<uintptr_t>(buffer) % sizeof(uint32_t) == 0)) {
+					data = static_cast<const uint32_t*>(buffer);
+				} else {
+					copy.resize((size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+					AAsset_seek(asset, 0, SEEK_SET);
+					AAsset_read(asset, copy.data(), size);
+					data = copy.data();
+				}
+#else
+				fd = open(fileName.c_str(), O_RDONLY);
+				if (fd < 0) {
+					return;
+				}
+				struct stat fileStat{};
+				if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size == 0)) {
+					return;
+				}
+				void* mapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapped != MAP_FAILED) {
+					data = static_cast<const uint32_t*>(mapped);
+					size = static_cast<size_t>(fileStat.st_size);
+				}
+#endif
+			}
+
+			~MappedFile()
+			{
+#if defined(_WIN32)
+				if (view != nullptr) {
+					UnmapViewOfFile(view);
+				}
+				if (mapping != nullptr) {
+					CloseHandle(mapping);
+				}
+				if (file != INVALID_HANDLE_VALUE) {
+					CloseHandle(file);
+				}
+#elif defined(__ANDROID__)
+				if (asset) {
+					AAsset_close(asset);
+				}
+#else
+				if (data) {
+					munmap(const_cast<uint32_t*>(data), size);
+				}
+				if (fd >= 0) {
+					close(fd);
+				}
+#endif
+			}
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+		private:
+#if defined(_WIN32)
+			HANDLE file{ INVALID_HANDLE_VALUE };
+			HANDLE mapping{ nullptr };
+			LPVOID view{ nullptr };
+#elif defined(__ANDROID__)
+			AAsset* asset{ nullptr };
+			std::vector<uint32_t> copy;
+#else
+			int fd{ -1 };
+#endif
+		};
+
+		// FNV-1a over the SPIR-V words, the size is part of the hash so files that only differ in trailing zeros don't collide
+		uint64_t hashCode(const uint32_t* code, size_t size)
+		{
+			uint64_t hash = 14695981039346656037ull ^ size;
+			const size_t wordCount = size / sizeof(uint32_t);
+			for (size_t i = 0; i < wordCount; i++) {
+				hash ^= code[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+	}
+
+	void ShaderModuleCache::create(VkDevice device)
+	{
+		this->device = device;
+	}
+
+	void ShaderModuleCache::clear()
+	{
+		fileModules.clear();
+		contentModules.clear();
+	}
+
+	VkShaderModule ShaderModuleCache::load(const std::string& fileName, bool* created)
+	{
+		assert(device != VK_NULL_HANDLE);
+		const auto tStart = std::chrono::high_resolution_clock::now();
+		if (created) {
+			*created = false;
+		}
+		stats.requests++;
+
+		if (auto it = fileModules.find(fileName); it != fileModules.end()) {
+			stats.fileHits++;
+			return it->second;
+		}
+
+		MappedFile file(fileName);
+		if (!file.data) {
+			std::cerr << "Error: Could not open shader file \"" << fileName << "\"" << "\n";
+			return VK_NULL_HANDLE;
+		}
+		stats.bytesMapped += file.size;
+
+		VkShaderModule shaderModule{ VK_NULL_HANDLE };
+		const uint64_t hash = hashCode(file.data, file.size);
+		if (auto it = contentModules.find(hash); it != contentModules.end()) {
+			stats.contentHits++;
+			shaderModule = it->second;
+		} else {
+			VkShaderModuleCreateInfo moduleCreateInfo{
+				.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+				.codeSize = file.size,
+				.pCode = file.data
+			};
+			VK_CHECK_RESULT(vkCreateShaderModule(device, &moduleCreateInfo, nullptr, &shaderModule));
+			contentModules[hash] = shaderModule;
+			stats.modules++;
+			if (created) {
+				*created = true;
+			}
+		}
+		fileModules[fileName] = shaderModule;
+		stats.loadTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+		return shaderModule;
+	}
+}
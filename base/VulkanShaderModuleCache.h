@@ -0,0 +1,53 @@
+/*
+* Shader module cache
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Loads SPIR-V files by mapping them into memory and creating the shader module straight from the mapping (no intermediate copy)
+* Modules are deduplicated twice:
+* - A file that has already been loaded returns its module without touching the file again
+* - A file with the same contents as an already loaded file (e.g. copies of common vertex shaders) returns that module, files are identified by a hash of their contents
+* The cache doesn't own the modules, they're destroyed by whoever requested them first (the base class for all sample shaders)
+*/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "vulkan/vulkan.h"
+
+namespace vks
+{
+	class ShaderModuleCache
+	{
+	public:
+		struct Statistics {
+			uint32_t requests{ 0 };
+			// Number of modules actually created
+			uint32_t modules{ 0 };
+			// Requests for files that have been loaded before
+			uint32_t fileHits{ 0 };
+			// Requests for files whose contents matched an already created module
+			uint32_t contentHits{ 0 };
+			size_t bytesMapped{ 0 };
+			// Time spent loading files and creating modules
+			double loadTime{ 0.0 };
+		} stats;
+
+		void create(VkDevice device);
+		/** @brief Forgets all modules, does not destroy them */
+		void clear();
+		/** @brief Returns a module for the given SPIR-V file, created is set to true if a new module had to be created */
+		VkShaderModule load(const std::string& fileName, bool* created = nullptr);
+
+	private:
+		VkDevice device{ VK_NULL_HANDLE };
+		std::unordered_map<std::string, VkShaderModule> fileModules;
+		std::unordered_map<uint64_t, VkShaderModule> contentModules;
+	};
+}
@@ -9,6 +9,7 @@
 */
 
 #include "VulkanSwapChain.h"
+#include <fstream>
 
 /** @brief Creates the platform specific surface abstraction of the native platform window used for presentation */	
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
@@ -233,9 +234,17 @@ void VulkanSwapChain::create(uint32_t& width, uint32_t& height, bool vsync, bool
 	// This mode waits for the vertical blank ("v-sync")
 	VkPresentModeKHR swapchainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
 
+	// An explicitly requested present mode takes precedence if the surface supports it
+	const bool desiredPresentModeSupported = (desiredPresentMode != VK_PRESENT_MODE_MAX_ENUM_KHR) && (std::find(presentModes.begin(), presentModes.end(), desiredPresentMode) != presentModes.end());
+	if (desiredPresentModeSupported) {
+		swapchainPresentMode = desiredPresentMode;
+	} else if (desiredPresentMode != VK_PRESENT_MODE_MAX_ENUM_KHR) {
+		std::cerr << "Requested present mode is not supported by the surface, using default\n";
+	}
+
 	// If v-sync is not requested, try to find a mailbox mode
 	// It's the lowest latency non-tearing present mode available
-	if (!vsync)
+	if (!vsync && !desiredPresentModeSupported)
 	{
 		for (size_t i = 0; i < presentModeCount; i++)
 		{
@@ -251,8 +260,13 @@ void VulkanSwapChain::create(uint32_t& width, uint32_t& height, bool vsync, bool
 		}
 	}
 
+	presentMode = swapchainPresentMode;
+
 	// Determine the number of images
 	uint32_t desiredNumberOfSwapchainImages = surfaceCaps.minImageCount + 1;
+	if (desiredImageCount > 0) {
+		desiredNumberOfSwapchainImages = std::max(desiredImageCount, surfaceCaps.minImageCount);
+	}
 	if ((surfaceCaps.maxImageCount > 0) && (desiredNumberOfSwapchainImages > surfaceCaps.maxImageCount)) {
 		desiredNumberOfSwapchainImages = surfaceCaps.maxImageCount;
 	}
@@ -347,12 +361,41 @@ void VulkanSwapChain::create(uint32_t& width, uint32_t& height, bool vsync, bool
 
 VkResult VulkanSwapChain::acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t& imageIndex)
 {
+	if (offscreen) {
+		// Offscreen images are simply used in order, the semaphore is signalled with an empty submission so that the sample's synchronization stays the same as with a swapchain
+		imageIndex = (lastSubmittedImage + 1) % imageCount;
+		VkSubmitInfo submitInfo{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.signalSemaphoreCount = presentCompleteSemaphore != VK_NULL_HANDLE ? 1u : 0u,
+			.pSignalSemaphores = &presentCompleteSemaphore
+		};
+		return vkQueueSubmit(offscreenQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	}
 	// By setting timeout to UINT64_MAX we will always wait until the next image has been acquired or an actual error is thrown
 	// With that we don't have to handle VK_NOT_READY
 	return vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, presentCompleteSemaphore, (VkFence)nullptr, &imageIndex);
 }
 void VulkanSwapChain::cleanup()
 {
+	if (offscreen) {
+		for (auto i = 0; i < images.size(); i++) {
+			vkDestroyImageView(device, imageViews[i], nullptr);
+			vkDestroyImage(device, images[i], nullptr);
+			vkFreeMemory(device, offscreenImages[i].memory, nullptr);
+			if (offscreenImages[i].readbackBuffer != VK_NULL_HANDLE) {
+				vkDestroyBuffer(device, offscreenImages[i].readbackBuffer, nullptr);
+				vkFreeMemory(device, offscreenImages[i].readbackMemory, nullptr);
+			}
+		}
+		if (offscreenCmdPool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(device, offscreenCmdPool, nullptr);
+		}
+		images.clear();
+		imageViews.clear();
+		offscreenImages.clear();
+		offscreenCmdPool = VK_NULL_HANDLE;
+		return;
+	}
 	if (swapChain != VK_NULL_HANDLE) {
 		for (auto i = 0; i < images.size(); i++) {
 			vkDestroyImageView(device, imageViews[i], nullptr);
@@ -366,6 +409,202 @@ void VulkanSwapChain::cleanup()
 	swapChain = VK_NULL_HANDLE;
 }
 
+uint32_t VulkanSwapChain::getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((typeBits & (1 << i)) && ((memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)) {
+			return i;
+		}
+	}
+	vks::tools::exitFatal("Could not find a matching memory type for the offscreen images", -1);
+	return 0;
+}
+
+void VulkanSwapChain::createOffscreen(uint32_t width, uint32_t height, uint32_t queueFamilyIndex, VkQueue queue, uint32_t imageCount, bool readback)
+{
+	assert(physicalDevice);
+	assert(device);
+
+	offscreen = true;
+	presentLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	offscreenQueue = queue;
+	offscreenWidth = width;
+	offscreenHeight = height;
+	queueNodeIndex = queueFamilyIndex;
+	lastSubmittedImage = UINT32_MAX;
+	this->imageCount = imageCount;
+
+	// Use the same format preference as for the swapchain, so that samples see the same color format in both modes
+	const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
+	std::vector<VkFormat> preferredImageFormats = {
+		VK_FORMAT_B8G8R8A8_UNORM,
+		VK_FORMAT_R8G8B8A8_UNORM,
+		VK_FORMAT_A8B8G8R8_UNORM_PACK32
+	};
+	colorFormat = VK_FORMAT_UNDEFINED;
+	for (auto& format : preferredImageFormats) {
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+		if ((formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures) {
+			colorFormat = format;
+			break;
+		}
+	}
+	if (colorFormat == VK_FORMAT_UNDEFINED) {
+		vks::tools::exitFatal("Could not find a suitable color format for offscreen rendering", -1);
+	}
+	colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+
+	images.resize(imageCount);
+	imageViews.resize(imageCount);
+	offscreenImages.resize(imageCount);
+
+	for (uint32_t i = 0; i < imageCount; i++) {
+		VkImageCreateInfo imageCI{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = colorFormat,
+			.extent = { width, height, 1 },
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			// Same usage flags the swapchain images are created with
+			.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+		};
+		VK_CHECK_RESULT(vkCreateImage(device, &imageCI, nullptr, &images[i]));
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(device, images[i], &memReqs);
+		VkMemoryAllocateInfo memAlloc{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			.allocationSize = memReqs.size,
+			.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+		};
+		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &offscreenImages[i].memory));
+		VK_CHECK_RESULT(vkBindImageMemory(device, images[i], offscreenImages[i].memory, 0));
+
+		VkImageViewCreateInfo colorAttachmentView{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = images[i],
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = colorFormat,
+			.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A },
+			.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
+		};
+		VK_CHECK_RESULT(vkCreateImageView(device, &colorAttachmentView, nullptr, &imageViews[i]));
+	}
+
+	if (!readback) {
+		return;
+	}
+
+	// Readback: Every image gets a host visible buffer and a pre-recorded command buffer that copies the image into it
+	VkCommandPoolCreateInfo cmdPoolCI{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.queueFamilyIndex = queueFamilyIndex
+	};
+	VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolCI, nullptr, &offscreenCmdPool));
+	const VkDeviceSize bufferSize = (VkDeviceSize)width * height * 4;
+	for (uint32_t i = 0; i < imageCount; i++) {
+		OffscreenImage& offscreenImage = offscreenImages[i];
+		VkBufferCreateInfo bufferCI{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = bufferSize,
+			.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+		};
+		VK_CHECK_RESULT(vkCreateBuffer(device, &bufferCI, nullptr, &offscreenImage.readbackBuffer));
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(device, offscreenImage.readbackBuffer, &memReqs);
+		VkMemoryAllocateInfo memAlloc{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			.allocationSize = memReqs.size,
+			.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+		};
+		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &offscreenImage.readbackMemory));
+		VK_CHECK_RESULT(vkBindBufferMemory(device, offscreenImage.readbackBuffer, offscreenImage.readbackMemory, 0));
+		VK_CHECK_RESULT(vkMapMemory(device, offscreenImage.readbackMemory, 0, VK_WHOLE_SIZE, 0, &offscreenImage.readbackMapped));
+
+		VkCommandBufferAllocateInfo cmdBufAllocateInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = offscreenCmdPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1
+		};
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &offscreenImage.readbackCmdBuffer));
+		VkCommandBuffer cmdBuffer = offscreenImage.readbackCmdBuffer;
+		VkCommandBufferBeginInfo cmdBufInfo{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
+		// Samples leave the image in presentLayout (transfer source), the memory dependency on the rendering is provided by the semaphore wait at the transfer stage
+		VkBufferImageCopy copyRegion{
+			.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+			.imageExtent = { width, height, 1 }
+		};
+		vkCmdCopyImageToBuffer(cmdBuffer, images[i], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, offscreenImage.readbackBuffer, 1, &copyRegion);
+		VkBufferMemoryBarrier bufferBarrier{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.buffer = offscreenImage.readbackBuffer,
+			.size = VK_WHOLE_SIZE
+		};
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+	}
+}
+
+VkResult VulkanSwapChain::submitOffscreen(uint32_t imageIndex, VkSemaphore waitSemaphore)
+{
+	assert(offscreen);
+	// Consumes the render complete semaphore (like the presentation engine would) and optionally copies the image to the host
+	const VkPipelineStageFlags waitStageMask{ VK_PIPELINE_STAGE_TRANSFER_BIT };
+	VkSubmitInfo submitInfo{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.waitSemaphoreCount = 1,
+		.pWaitSemaphores = &waitSemaphore,
+		.pWaitDstStageMask = &waitStageMask,
+	};
+	if (offscreenImages[imageIndex].readbackCmdBuffer != VK_NULL_HANDLE) {
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &offscreenImages[imageIndex].readbackCmdBuffer;
+	}
+	lastSubmittedImage = imageIndex;
+	return vkQueueSubmit(offscreenQueue, 1, &submitInfo, VK_NULL_HANDLE);
+}
+
+bool VulkanSwapChain::saveOffscreenImage(const std::string& filename)
+{
+	if (!offscreen || (lastSubmittedImage == UINT32_MAX) || (offscreenImages[lastSubmittedImage].readbackMapped == nullptr)) {
+		return false;
+	}
+	std::ofstream file(filename, std::ios::out | std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	file << "P6\n" << offscreenWidth << "\n" << offscreenHeight << "\n" << 255 << "\n";
+	// PPM stores RGB, so BGR(A) formats need to be swizzled
+	const bool swizzle = (colorFormat == VK_FORMAT_B8G8R8A8_UNORM);
+	const uint8_t* data = static_cast<const uint8_t*>(offscreenImages[lastSubmittedImage].readbackMapped);
+	std::vector<uint8_t> row(offscreenWidth * 3);
+	for (uint32_t y = 0; y < offscreenHeight; y++) {
+		for (uint32_t x = 0; x < offscreenWidth; x++) {
+			const uint8_t* texel = data + (y * offscreenWidth + x) * 4;
+			row[x * 3 + 0] = swizzle ? texel[2] : texel[0];
+			row[x * 3 + 1] = texel[1];
+			row[x * 3 + 2] = swizzle ? texel[0] : texel[2];
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), row.size());
+	}
+	file.close();
+	return true;
+}
+
 #if defined(_DIRECT2DISPLAY)
 /**
 * Create direct to display surface
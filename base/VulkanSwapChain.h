@@ -34,6 +34,21 @@ private:
 	VkDevice device{ VK_NULL_HANDLE };
 	VkPhysicalDevice physicalDevice{ VK_NULL_HANDLE };
 	VkSurfaceKHR surface{ VK_NULL_HANDLE };
+	// Resources for the offscreen image ring that replaces the swapchain when running without a window
+	struct OffscreenImage {
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkBuffer readbackBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory readbackMemory{ VK_NULL_HANDLE };
+		void* readbackMapped{ nullptr };
+		VkCommandBuffer readbackCmdBuffer{ VK_NULL_HANDLE };
+	};
+	std::vector<OffscreenImage> offscreenImages{};
+	VkQueue offscreenQueue{ VK_NULL_HANDLE };
+	VkCommandPool offscreenCmdPool{ VK_NULL_HANDLE };
+	uint32_t offscreenWidth{ 0 };
+	uint32_t offscreenHeight{ 0 };
+	uint32_t lastSubmittedImage{ UINT32_MAX };
+	uint32_t getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
 public:
 	VkFormat colorFormat{};
 	VkColorSpaceKHR colorSpace{};
@@ -42,6 +57,16 @@ public:
 	std::vector<VkImageView> imageViews{};
 	uint32_t queueNodeIndex{ UINT32_MAX };
 	uint32_t imageCount{ 0 };
+	/** @brief Set if the images are an application owned offscreen ring instead of presentable swapchain images */
+	bool offscreen{ false };
+	/** @brief Layout the images have to be left in at the end of a frame, offscreen images use a transfer source layout as the present layout requires VK_KHR_swapchain */
+	VkImageLayout presentLayout{ VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+	/** @brief Number of images to request on creation, 0 selects the default (minimum image count + 1), clamped to the surface limits */
+	uint32_t desiredImageCount{ 0 };
+	/** @brief Present mode to use if supported by the surface, VK_PRESENT_MODE_MAX_ENUM_KHR selects the default based on v-sync */
+	VkPresentModeKHR desiredPresentMode{ VK_PRESENT_MODE_MAX_ENUM_KHR };
+	/** @brief Present mode the swapchain has been created with */
+	VkPresentModeKHR presentMode{ VK_PRESENT_MODE_FIFO_KHR };
 
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
 	void initSurface(void* platformHandle, void* platformWindow);
@@ -86,6 +111,28 @@ public:
 	* @return VkResult of the image acquisition
 	*/
 	VkResult acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t& imageIndex);
+	/**
+	* Create a ring of offscreen images to be used instead of a swapchain (no surface or presentation engine required)
+	*
+	* @param width Width of the offscreen images
+	* @param height Height of the offscreen images
+	* @param queueFamilyIndex Queue family the images are rendered and submitted on
+	* @param queue Queue used to signal image acquisition and to execute the optional readback
+	* @param imageCount Number of images in the ring
+	* @param readback If true, each submitted image is copied to host visible memory so it can be stored with saveOffscreenImage
+	*/
+	void createOffscreen(uint32_t width, uint32_t height, uint32_t queueFamilyIndex, VkQueue queue, uint32_t imageCount = 3, bool readback = false);
+	/**
+	* Replaces presentation for the offscreen image ring
+	*
+	* @param imageIndex Index of the image that has been rendered to
+	* @param waitSemaphore Semaphore signalled when rendering to the image has finished
+	*
+	* @return VkResult of the queue submission
+	*/
+	VkResult submitOffscreen(uint32_t imageIndex, VkSemaphore waitSemaphore);
+	/** @brief Stores the last submitted offscreen image as a binary PPM file, readback must be enabled and the device must be idle */
+	bool saveOffscreenImage(const std::string& filename);
 	/* Free all Vulkan resources acquired by the swapchain */
 	void cleanup();
 };
@@ -15,10 +15,24 @@ namespace vks
 		descriptor.sampler = sampler;
 		descriptor.imageView = view;
 		descriptor.imageLayout = imageLayout;
+		// Textures that can be sampled register with the bindless table, a changed descriptor gets a new index
+		if (bindlessTable.active() && (sampler != VK_NULL_HANDLE) && (view != VK_NULL_HANDLE))
+		{
+			if (bindlessIndex != BindlessTable::invalidIndex)
+			{
+				bindlessTable.remove(bindlessIndex);
+			}
+			bindlessIndex = bindlessTable.add(descriptor);
+		}
 	}
 
 	void Texture::destroy()
 	{
+		if (bindlessIndex != BindlessTable::invalidIndex)
+		{
+			bindlessTable.remove(bindlessIndex);
+			bindlessIndex = BindlessTable::invalidIndex;
+		}
 		vkDestroyImageView(device->logicalDevice, view, nullptr);
 		vkDestroyImage(device->logicalDevice, image, nullptr);
 		if (sampler)
@@ -55,7 +69,7 @@ namespace vks
 	/**
 	* Load a 2D texture including all mip levels
 	*
-	* @param filename File to load (supports .ktx)
+	* @param filename File to load (supports .ktx and .ktx2, for the latter the format argument is ignored)
 	* @param format Vulkan format of the image data stored in the file
 	* @param device Vulkan device to create the texture on
 	* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
@@ -65,9 +79,23 @@ namespace vks
 	*/
 	void Texture2D::loadFromFile(std::string filename, VkFormat format, vks::VulkanDevice *device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout)
 	{
+		// The file is only read once, its identifier selects the loader
+		std::vector<uint8_t> fileData;
+		if (!vks::ktx2::readFileData(filename, fileData)) {
+			vks::tools::exitFatal("Could not load texture from " + filename + "\n\nMake sure the assets submodule has been checked out and is up-to-date.", -1);
+		}
+
+		// KTX 2.0 files are not supported by libktx, and use a separate loader that also takes care of transcoding
+		if (vks::ktx2::isKTX2(fileData)) {
+			loadFromKTX2File(filename, std::move(fileData), device, copyQueue, imageUsageFlags, imageLayout);
+			return;
+		}
+
 		ktxTexture* ktxTexture;
-		ktxResult result = loadKTXFile(filename, &ktxTexture);
+		ktxResult result = ktxTexture_CreateFromMemory(fileData.data(), fileData.size(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTexture);
 		assert(result == KTX_SUCCESS);
+		fileData.clear();
+		fileData.shrink_to_fit();
 
 		this->device = device;
 		width = ktxTexture->baseWidth;
@@ -238,6 +266,141 @@ namespace vks
 		updateDescriptor();
 	}
 
+	/**
+	* Load a 2D texture including all mip levels from a KTX 2.0 file
+	* Basis Universal payloads are transcoded to the best compressed format supported by the device, mip levels are decoded on worker threads
+	*
+	* @param filename Name of the file the contents were read from (used for error messages)
+	* @param fileData Complete contents of the .ktx2 file, as read by Texture2D::loadFromFile
+	* @param device Vulkan device to create the texture on
+	* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
+	* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
+	* @param (Optional) imageLayout Usage layout for the texture (defaults VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	*
+	* @note The format of the texture is taken from the file or the transcode target and stored in the format member
+	*/
+	void Texture2D::loadFromKTX2File(std::string filename, std::vector<uint8_t> fileData, vks::VulkanDevice *device, VkQueue copyQueue, VkImageUsageFlags imageUsageFlags, VkImageLayout imageLayout)
+	{
+		vks::ktx2::File ktx2File;
+		ktx2File.data = std::move(fileData);
+		if (!vks::ktx2::parse(ktx2File)) {
+			vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe KTX2 header or level index is invalid.", -1);
+		}
+		vks::ktx2::DecodedImage decodedImage;
+		if (!vks::ktx2::decode(ktx2File, device, decodedImage)) {
+			vks::tools::exitFatal("Could not decode KTX2 texture " + filename, -1);
+		}
+		// The encoded file contents are no longer required
+		ktx2File.data.clear();
+		ktx2File.data.shrink_to_fit();
+
+		this->device = device;
+		width = decodedImage.width;
+		height = decodedImage.height;
+		mipLevels = static_cast<uint32_t>(decodedImage.levels.size());
+		format = decodedImage.format;
+		transcodeTarget = decodedImage.target;
+
+		// Create a host-visible staging buffer that contains the decoded image data
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingMemory;
+		VkBufferCreateInfo bufferCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = decodedImage.data.size(),
+			.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		};
+		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
+		VkMemoryAllocateInfo memAllocInfo{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			.allocationSize = memReqs.size,
+			.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+		};
+		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
+		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
+		uint8_t *data;
+		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
+		memcpy(data, decodedImage.data.data(), decodedImage.data.size());
+		vkUnmapMemory(device->logicalDevice, stagingMemory);
+
+		// Setup buffer copy regions for each mip level
+		std::vector<VkBufferImageCopy> bufferCopyRegions;
+		for (uint32_t i = 0; i < mipLevels; i++) {
+			const vks::ktx2::Level& level = decodedImage.levels[i];
+			bufferCopyRegions.push_back({
+				.bufferOffset = level.offset,
+				.imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = i, .baseArrayLayer = 0, .layerCount = 1 },
+				.imageExtent = {.width = level.width, .height = level.height, .depth = 1 },
+			});
+		}
+
+		// Create optimal tiled target image
+		VkImageCreateInfo imageCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = format,
+			.extent = {.width = width, .height = height, .depth = 1 },
+			.mipLevels = mipLevels,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = imageUsageFlags | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
+		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
+		memAllocInfo.allocationSize = memReqs.size;
+		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
+		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+
+		VkImageSubresourceRange subresourceRange{ .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = mipLevels, .layerCount = 1, };
+
+		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
+		this->imageLayout = imageLayout;
+		vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout, subresourceRange);
+		device->flushCommandBuffer(copyCmd, copyQueue);
+
+		// Clean up staging resources
+		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
+
+		// Create a default sampler
+		VkSamplerCreateInfo samplerCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+			.magFilter = VK_FILTER_LINEAR,
+			.minFilter = VK_FILTER_LINEAR,
+			.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+			.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			.mipLodBias = 0.0f,
+			.anisotropyEnable = device->enabledFeatures.samplerAnisotropy,
+			.maxAnisotropy = device->enabledFeatures.samplerAnisotropy ? device->properties.limits.maxSamplerAnisotropy : 1.0f,
+			.compareOp = VK_COMPARE_OP_NEVER,
+			.minLod = 0.0f,
+			.maxLod = (float)mipLevels,
+			.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE
+		};
+		VK_CHECK_RESULT(vkCreateSampler(device->logicalDevice, &samplerCreateInfo, nullptr, &sampler));
+
+		VkImageViewCreateInfo viewCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = image,
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = format,
+			.subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = mipLevels, .baseArrayLayer = 0, .layerCount = 1 },
+		};
+		VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
+
+		updateDescriptor();
+	}
+
 	/**
 	* Creates a 2D texture from a buffer
 	*
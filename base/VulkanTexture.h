@@ -18,8 +18,10 @@
 #include <ktx.h>
 #include <ktxvulkan.h>
 
+#include "VulkanBindlessTable.h"
 #include "VulkanBuffer.h"
 #include "VulkanDevice.h"
+#include "VulkanKTX2.h"
 #include "VulkanTools.h"
 
 #if defined(__ANDROID__)
@@ -42,6 +44,8 @@ class Texture
 	VkDescriptorImageInfo descriptor;
 	VkSampler             sampler;
 	VkFormat			  format;
+	// Index into the bindless table, only valid if the table was active when the descriptor was updated
+	uint32_t              bindlessIndex{ BindlessTable::invalidIndex };
 
 	void      updateDescriptor();
 	void      destroy();
@@ -51,6 +55,9 @@ class Texture
 class Texture2D : public Texture
 {
   public:
+	// Format Basis Universal payloads have been transcoded to (None for regular textures)
+	vks::ktx2::TranscodeTarget transcodeTarget{ vks::ktx2::TranscodeTarget::None };
+
 	void loadFromFile(
 	    std::string        filename,
 	    VkFormat           format,
@@ -58,6 +65,13 @@ class Texture2D : public Texture
 	    VkQueue            copyQueue,
 	    VkImageUsageFlags  imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT,
 	    VkImageLayout      imageLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	void loadFromKTX2File(
+	    std::string          filename,
+	    std::vector<uint8_t> fileData,
+	    vks::VulkanDevice   *device,
+	    VkQueue              copyQueue,
+	    VkImageUsageFlags    imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT,
+	    VkImageLayout        imageLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	void fromBuffer(
 	    void *             buffer,
 	    VkDeviceSize       bufferSize,
@@ -0,0 +1,341 @@
+/*
+* GPU texture processing: single pass compute mip generation and real-time block compression
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanTextureProcessor.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "VulkanBuffer.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	namespace
+	{
+		struct MipGenPushConstants {
+			uint32_t mipCount;
+			uint32_t workGroupCount;
+		};
+
+		struct CompressPushConstants {
+			uint32_t width;
+			uint32_t height;
+			uint32_t blocksPerRow;
+			uint32_t blockOffset;
+		};
+
+		bool formatFeaturesSupported(vks::VulkanDevice* device, VkFormat format, VkFormatFeatureFlags features)
+		{
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
+			return (formatProperties.optimalTilingFeatures & features) == features;
+		}
+	}
+
+	VkPipeline TextureProcessor::createComputePipeline(const std::string& filename, VkPipelineLayout pipelineLayout)
+	{
+#if defined(__ANDROID__)
+		AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
+		if (!asset) {
+			return VK_NULL_HANDLE;
+		}
+		AAsset_close(asset);
+		VkShaderModule shaderModule = vks::tools::loadShader(androidApp->activity->assetManager, filename.c_str(), device->logicalDevice);
+#else
+		if (!vks::tools::fileExists(filename)) {
+			return VK_NULL_HANDLE;
+		}
+		VkShaderModule shaderModule = vks::tools::loadShader(filename.c_str(), device->logicalDevice);
+#endif
+		VkComputePipelineCreateInfo pipelineCI{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = shaderModule,
+				.pName = "main"
+			},
+			.layout = pipelineLayout
+		};
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+		VK_CHECK_RESULT(vkCreateComputePipelines(device->logicalDevice, pipelineCache, 1, &pipelineCI, nullptr, &pipeline));
+		vkDestroyShaderModule(device->logicalDevice, shaderModule, nullptr);
+		return pipeline;
+	}
+
+	void TextureProcessor::createImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory, VkDeviceSize& memorySize)
+	{
+		VkImageCreateInfo imageCI{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = format,
+			.extent = {.width = width, .height = height, .depth = 1 },
+			.mipLevels = mipLevels,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = usage,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCI, nullptr, &image));
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
+		VkMemoryAllocateInfo memAllocInfo{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			.allocationSize = memReqs.size,
+			.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+		};
+		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &memory));
+		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, memory, 0));
+		memorySize = memReqs.size;
+	}
+
+	void TextureProcessor::create(vks::VulkanDevice* device, const std::string& shaderPath, VkPipelineCache pipelineCache)
+	{
+		this->device = device;
+		this->pipelineCache = pipelineCache;
+
+		if (!formatFeaturesSupported(device, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+			return;
+		}
+
+		// Mip generation: One storage image per mip level and an atomic counter used to find the last active workgroup
+		std::array<VkDescriptorSetLayoutBinding, 2> setLayoutBindings{
+			VkDescriptorSetLayoutBinding{ .binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = maxMipLevels, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+			VkDescriptorSetLayoutBinding{ .binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO, .bindingCount = static_cast<uint32_t>(setLayoutBindings.size()), .pBindings = setLayoutBindings.data() };
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorSetLayoutCI, nullptr, &mipGen.descriptorSetLayout));
+		VkPushConstantRange pushConstantRange{ .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(MipGenPushConstants) };
+		VkPipelineLayoutCreateInfo pipelineLayoutCI{ .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO, .setLayoutCount = 1, .pSetLayouts = &mipGen.descriptorSetLayout, .pushConstantRangeCount = 1, .pPushConstantRanges = &pushConstantRange };
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device->logicalDevice, &pipelineLayoutCI, nullptr, &mipGen.pipelineLayout));
+		mipGen.pipeline = createComputePipeline(shaderPath + "mipgen.comp.spv", mipGen.pipelineLayout);
+
+		// Compression: Source mip level as a storage image and a buffer receiving the compressed blocks
+		setLayoutBindings[0].descriptorCount = 1;
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorSetLayoutCI, nullptr, &compress.descriptorSetLayout));
+		pushConstantRange.size = sizeof(CompressPushConstants);
+		pipelineLayoutCI.pSetLayouts = &compress.descriptorSetLayout;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device->logicalDevice, &pipelineLayoutCI, nullptr, &compress.pipelineLayout));
+		if (device->enabledFeatures.textureCompressionBC) {
+			if (formatFeaturesSupported(device, VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT)) {
+				compress.bc1 = createComputePipeline(shaderPath + "bc1compress.comp.spv", compress.pipelineLayout);
+			}
+			if (formatFeaturesSupported(device, VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT)) {
+				compress.bc7 = createComputePipeline(shaderPath + "bc7compress.comp.spv", compress.pipelineLayout);
+			}
+		}
+	}
+
+	void TextureProcessor::destroy()
+	{
+		if (!device) {
+			return;
+		}
+		vkDestroyPipeline(device->logicalDevice, mipGen.pipeline, nullptr);
+		vkDestroyPipelineLayout(device->logicalDevice, mipGen.pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device->logicalDevice, mipGen.descriptorSetLayout, nullptr);
+		vkDestroyPipeline(device->logicalDevice, compress.bc1, nullptr);
+		vkDestroyPipeline(device->logicalDevice, compress.bc7, nullptr);
+		vkDestroyPipelineLayout(device->logicalDevice, compress.pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device->logicalDevice, compress.descriptorSetLayout, nullptr);
+		mipGen = {};
+		compress = {};
+	}
+
+	bool TextureProcessor::supported() const
+	{
+		return mipGen.pipeline != VK_NULL_HANDLE;
+	}
+
+	bool TextureProcessor::compressionSupported(Compression compression) const
+	{
+		switch (compression) {
+		case Compression::None:
+			return true;
+		case Compression::BC1:
+			return compress.bc1 != VK_NULL_HANDLE;
+		case Compression::BC7:
+			return compress.bc7 != VK_NULL_HANDLE;
+		}
+		return false;
+	}
+
+	void TextureProcessor::upload(const uint8_t* rgba, uint32_t width, uint32_t height, VkQueue queue, Compression compression, Result& result)
+	{
+		assert(supported());
+
+		// BC1 can't store alpha, so fall back to BC7 for images that make use of it
+		if (compression == Compression::BC1) {
+			for (size_t i = 0; i < size_t(width) * height; i++) {
+				if (rgba[i * 4 + 3] != 255) {
+					compression = Compression::BC7;
+					break;
+				}
+			}
+		}
+		if (!compressionSupported(compression)) {
+			compression = Compression::None;
+		}
+
+		const uint32_t mipLevels = std::min(static_cast<uint32_t>(floor(log2(std::max(width, height))) + 1), maxMipLevels);
+		const VkDeviceSize imageSize = VkDeviceSize(width) * height * 4;
+
+		vks::Buffer stagingBuffer;
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, imageSize, (void*)rgba));
+		vks::Buffer counterBuffer;
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &counterBuffer, sizeof(uint32_t)));
+
+		// Uncompressed image that'll receive the generated mip chain
+		VkImage image;
+		VkDeviceMemory memory;
+		VkDeviceSize memorySize;
+		createImage(VK_FORMAT_R8G8B8A8_UNORM, width, height, mipLevels, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, image, memory, memorySize);
+		std::vector<VkImageView> mipViews(mipLevels);
+		for (uint32_t i = 0; i < mipLevels; i++) {
+			VkImageViewCreateInfo viewCI{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+				.image = image,
+				.viewType = VK_IMAGE_VIEW_TYPE_2D,
+				.format = VK_FORMAT_R8G8B8A8_UNORM,
+				.subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = i, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1 },
+			};
+			VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCI, nullptr, &mipViews[i]));
+		}
+
+		// Block compressed images store their data in 4x4 blocks of 8 (BC1) or 16 (BC7) bytes, we calculate offsets for all levels up-front
+		const VkDeviceSize blockSize = (compression == Compression::BC1) ? 8 : 16;
+		std::vector<VkBufferImageCopy> copyRegions;
+		std::vector<uint32_t> blockOffsets;
+		uint32_t blockCount{ 0 };
+		if (compression != Compression::None) {
+			for (uint32_t i = 0; i < mipLevels; i++) {
+				const uint32_t mipWidth = std::max(width >> i, 1u);
+				const uint32_t mipHeight = std::max(height >> i, 1u);
+				blockOffsets.push_back(blockCount);
+				copyRegions.push_back({
+					.bufferOffset = blockCount * blockSize,
+					.imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = i, .baseArrayLayer = 0, .layerCount = 1 },
+					.imageExtent = {.width = mipWidth, .height = mipHeight, .depth = 1 },
+				});
+				blockCount += ((mipWidth + 3) / 4) * ((mipHeight + 3) / 4);
+			}
+		}
+		vks::Buffer blockBuffer;
+		if (compression != Compression::None) {
+			VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &blockBuffer, blockCount * blockSize));
+		}
+
+		// Descriptors are only required for the duration of this upload, so they come from a temporary pool
+		std::array<VkDescriptorPoolSize, 2> poolSizes{
+			VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = maxMipLevels * 2 },
+			VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = maxMipLevels + 1 },
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolCI{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO, .maxSets = maxMipLevels + 1, .poolSizeCount = static_cast<uint32_t>(poolSizes.size()), .pPoolSizes = poolSizes.data() };
+		VkDescriptorPool descriptorPool;
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolCI, nullptr, &descriptorPool));
+
+		VkCommandBuffer cmdBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+
+		// Upload the base level
+		VkImageSubresourceRange subresourceRange{ .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = mipLevels, .baseArrayLayer = 0, .layerCount = 1 };
+		vks::tools::setImageLayout(cmdBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		VkBufferImageCopy baseLevelCopy{
+			.imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1 },
+			.imageExtent = {.width = width, .height = height, .depth = 1 },
+		};
+		vkCmdCopyBufferToImage(cmdBuffer, stagingBuffer.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &baseLevelCopy);
+		vkCmdFillBuffer(cmdBuffer, counterBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+		VkMemoryBarrier memoryBarrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT, .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+		vks::tools::insertImageMemoryBarrier(cmdBuffer, image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, subresourceRange);
+
+		// Generate all mip levels with a single dispatch
+		{
+			VkDescriptorSet descriptorSet;
+			VkDescriptorSetAllocateInfo allocInfo{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, .descriptorPool = descriptorPool, .descriptorSetCount = 1, .pSetLayouts = &mipGen.descriptorSetLayout };
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &allocInfo, &descriptorSet));
+			// Unused array elements point to the last mip level, they're never accessed by the shader
+			std::array<VkDescriptorImageInfo, maxMipLevels> imageInfos{};
+			for (uint32_t i = 0; i < maxMipLevels; i++) {
+				imageInfos[i] = { .imageView = mipViews[std::min(i, mipLevels - 1)], .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+			}
+			std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{
+				VkWriteDescriptorSet{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = descriptorSet, .dstBinding = 0, .descriptorCount = maxMipLevels, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = imageInfos.data() },
+				VkWriteDescriptorSet{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = descriptorSet, .dstBinding = 1, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .pBufferInfo = &counterBuffer.descriptor },
+			};
+			vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+			// Each workgroup covers a 64x64 tile of the base level
+			const uint32_t groupCountX = (width + 63) / 64;
+			const uint32_t groupCountY = (height + 63) / 64;
+			MipGenPushConstants pushConstants{ .mipCount = mipLevels, .workGroupCount = groupCountX * groupCountY };
+			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mipGen.pipeline);
+			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mipGen.pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+			vkCmdPushConstants(cmdBuffer, mipGen.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MipGenPushConstants), &pushConstants);
+			vkCmdDispatch(cmdBuffer, groupCountX, groupCountY, 1);
+		}
+
+		if (compression == Compression::None) {
+			vks::tools::insertImageMemoryBarrier(cmdBuffer, image, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, subresourceRange);
+			device->flushCommandBuffer(cmdBuffer, queue, true);
+			result = { .image = image, .memory = memory, .memorySize = memorySize, .format = VK_FORMAT_R8G8B8A8_UNORM, .mipLevels = mipLevels };
+		} else {
+			memoryBarrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT, .dstAccessMask = VK_ACCESS_SHADER_READ_BIT };
+			vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+			// Compress all mip levels into the block buffer
+			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, (compression == Compression::BC1) ? compress.bc1 : compress.bc7);
+			for (uint32_t i = 0; i < mipLevels; i++) {
+				VkDescriptorSet descriptorSet;
+				VkDescriptorSetAllocateInfo allocInfo{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, .descriptorPool = descriptorPool, .descriptorSetCount = 1, .pSetLayouts = &compress.descriptorSetLayout };
+				VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &allocInfo, &descriptorSet));
+				VkDescriptorImageInfo imageInfo{ .imageView = mipViews[i], .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+				std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{
+					VkWriteDescriptorSet{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = descriptorSet, .dstBinding = 0, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &imageInfo },
+					VkWriteDescriptorSet{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = descriptorSet, .dstBinding = 1, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .pBufferInfo = &blockBuffer.descriptor },
+				};
+				vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+				const uint32_t mipWidth = std::max(width >> i, 1u);
+				const uint32_t mipHeight = std::max(height >> i, 1u);
+				const uint32_t blocksPerRow = (mipWidth + 3) / 4;
+				const uint32_t blockRows = (mipHeight + 3) / 4;
+				CompressPushConstants pushConstants{ .width = mipWidth, .height = mipHeight, .blocksPerRow = blocksPerRow, .blockOffset = blockOffsets[i] };
+				vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compress.pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+				vkCmdPushConstants(cmdBuffer, compress.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CompressPushConstants), &pushConstants);
+				vkCmdDispatch(cmdBuffer, (blocksPerRow + 7) / 8, (blockRows + 7) / 8, 1);
+			}
+
+			// Copy the compressed blocks into the final image
+			result.format = (compression == Compression::BC1) ? VK_FORMAT_BC1_RGB_UNORM_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+			result.mipLevels = mipLevels;
+			createImage(result.format, width, height, mipLevels, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, result.image, result.memory, result.memorySize);
+			memoryBarrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT, .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT };
+			vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			vks::tools::setImageLayout(cmdBuffer, result.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+			vkCmdCopyBufferToImage(cmdBuffer, blockBuffer.buffer, result.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+			vks::tools::setImageLayout(cmdBuffer, result.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+			device->flushCommandBuffer(cmdBuffer, queue, true);
+
+			// The uncompressed mip chain is no longer required
+			vkDestroyImage(device->logicalDevice, image, nullptr);
+			vkFreeMemory(device->logicalDevice, memory, nullptr);
+			blockBuffer.destroy();
+		}
+
+		for (auto& view : mipViews) {
+			vkDestroyImageView(device->logicalDevice, view, nullptr);
+		}
+		vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
+		stagingBuffer.destroy();
+		counterBuffer.destroy();
+	}
+}
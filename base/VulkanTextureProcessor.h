@@ -0,0 +1,74 @@
+/*
+* GPU texture processing: single pass compute mip generation and real-time block compression
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Used for textures that come as plain RGBA data (e.g. PNG or JPEG images referenced by glTF files)
+* Instead of generating the mip chain with a chain of image blits, all mip levels are generated with a single compute dispatch
+* The resulting mip chain can then optionally be compressed to BC1 or BC7 in compute, reducing memory and bandwidth requirements by 4-8x
+*/
+
+#pragma once
+
+#include <string>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	class TextureProcessor
+	{
+	public:
+		enum class Compression {
+			None,
+			// BC1 only stores RGB, images with non-opaque alpha values will use BC7 instead
+			BC1,
+			BC7
+		};
+
+		struct Result {
+			VkImage image{ VK_NULL_HANDLE };
+			VkDeviceMemory memory{ VK_NULL_HANDLE };
+			VkDeviceSize memorySize{ 0 };
+			VkFormat format{ VK_FORMAT_UNDEFINED };
+			uint32_t mipLevels{ 0 };
+		};
+
+		// Limited by the number of storage images bound by the mip generation shader (14 levels cover 8192x8192)
+		static constexpr uint32_t maxMipLevels{ 14 };
+
+		vks::VulkanDevice* device{ nullptr };
+
+		/** @brief Loads the shaders (SPIR-V from shaderPath) and creates the compute pipelines, pipelines whose SPIR-V is missing are skipped and reported as unsupported */
+		void create(vks::VulkanDevice* device, const std::string& shaderPath, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+		void destroy();
+		/** @brief Returns true if compute mip generation can be used on this device */
+		bool supported() const;
+		/** @brief Returns true if the given compression can be used on this device */
+		bool compressionSupported(Compression compression) const;
+		/** @brief Uploads RGBA8 image data, generates all mip levels and optionally compresses them, the image is in shader read only layout afterwards */
+		void upload(const uint8_t* rgba, uint32_t width, uint32_t height, VkQueue queue, Compression compression, Result& result);
+
+	private:
+		VkPipelineCache pipelineCache{ VK_NULL_HANDLE };
+		struct {
+			VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
+			VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
+			VkPipeline pipeline{ VK_NULL_HANDLE };
+		} mipGen;
+		struct {
+			VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
+			VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
+			VkPipeline bc1{ VK_NULL_HANDLE };
+			VkPipeline bc7{ VK_NULL_HANDLE };
+		} compress;
+		VkPipeline createComputePipeline(const std::string& filename, VkPipelineLayout pipelineLayout);
+		void createImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory, VkDeviceSize& memorySize);
+	};
+}
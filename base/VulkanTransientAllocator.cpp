@@ -0,0 +1,159 @@
+/*
+* Transient attachment allocator
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanTransientAllocator.h"
+
+#include <algorithm>
+
+#include "VulkanInitializers.hpp"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	namespace
+	{
+		// Usages that allow an image to be transient, the contents of such images never leave the render pass
+		constexpr VkImageUsageFlags attachmentUsages{ VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT };
+	}
+
+	void TransientAllocator::create(vks::VulkanDevice* device)
+	{
+		this->device = device;
+	}
+
+	void TransientAllocator::destroy()
+	{
+		if (!device) {
+			return;
+		}
+		for (auto& image : images) {
+			vkDestroyImage(device->logicalDevice, image.image, nullptr);
+		}
+		for (auto& block : blocks) {
+			vkFreeMemory(device->logicalDevice, block.memory, nullptr);
+		}
+		images.clear();
+		blocks.clear();
+	}
+
+	VkImage TransientAllocator::createImage(VkImageCreateInfo createInfo, uint32_t firstUse, uint32_t lastUse)
+	{
+		assert(firstUse <= lastUse);
+		Image image{};
+		image.firstUse = firstUse;
+		image.lastUse = lastUse;
+		image.transient = lazyAllocation && ((createInfo.usage & ~attachmentUsages) == 0);
+		if (image.transient) {
+			createInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &createInfo, nullptr, &image.image));
+		vkGetImageMemoryRequirements(device->logicalDevice, image.image, &image.memoryRequirements);
+		images.push_back(image);
+		return image.image;
+	}
+
+	void TransientAllocator::allocate()
+	{
+		stats = {};
+		stats.images = static_cast<uint32_t>(images.size());
+
+		// Transient images are backed by lazily allocated memory of their own if available, all others are candidates for aliasing
+		std::vector<uint32_t> candidates;
+		for (uint32_t i = 0; i < images.size(); i++) {
+			Image& image = images[i];
+			stats.unaliasedSize += image.memoryRequirements.size;
+			if (image.transient) {
+				VkBool32 found{ VK_FALSE };
+				const uint32_t memoryTypeIndex = device->getMemoryType(image.memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &found);
+				if (found) {
+					image.block = static_cast<uint32_t>(blocks.size());
+					blocks.push_back({ .size = image.memoryRequirements.size, .memoryTypeIndex = memoryTypeIndex, .lazy = true, .images = { i } });
+					continue;
+				}
+			}
+			candidates.push_back(i);
+		}
+
+		// Place the largest images first, every image goes into the first block with a matching memory type that isn't used during its lifetime
+		// All images are bound at offset zero, so a block is as large as the largest image placed into it
+		std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) { return images[a].memoryRequirements.size > images[b].memoryRequirements.size; });
+		for (auto index : candidates) {
+			Image& image = images[index];
+			const uint32_t memoryTypeIndex = device->getMemoryType(image.memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			Block* target{ nullptr };
+			if (aliasing) {
+				for (auto& block : blocks) {
+					if (block.lazy || (block.memoryTypeIndex != memoryTypeIndex)) {
+						continue;
+					}
+					bool overlaps{ false };
+					for (auto other : block.images) {
+						if ((image.firstUse <= images[other].lastUse) && (images[other].firstUse <= image.lastUse)) {
+							overlaps = true;
+							break;
+						}
+					}
+					if (!overlaps) {
+						target = &block;
+						break;
+					}
+				}
+			}
+			if (!target) {
+				target = &blocks.emplace_back();
+				target->memoryTypeIndex = memoryTypeIndex;
+			}
+			target->size = std::max(target->size, image.memoryRequirements.size);
+			target->images.push_back(index);
+			image.block = static_cast<uint32_t>(target - blocks.data());
+		}
+
+		for (auto& block : blocks) {
+			VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
+			memAlloc.allocationSize = block.size;
+			memAlloc.memoryTypeIndex = block.memoryTypeIndex;
+			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAlloc, nullptr, &block.memory));
+			for (auto index : block.images) {
+				VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, images[index].image, block.memory, 0));
+			}
+			stats.allocatedSize += block.size;
+			if (block.lazy) {
+				stats.lazyImages++;
+				stats.lazySize += block.size;
+			}
+		}
+		stats.allocations = static_cast<uint32_t>(blocks.size());
+		updateCommitment();
+	}
+
+	std::vector<std::vector<VkImage>> TransientAllocator::aliasGroups() const
+	{
+		std::vector<std::vector<VkImage>> groups;
+		for (auto& block : blocks) {
+			if (block.images.size() > 1) {
+				std::vector<VkImage>& group = groups.emplace_back();
+				for (auto index : block.images) {
+					group.push_back(images[index].image);
+				}
+			}
+		}
+		return groups;
+	}
+
+	void TransientAllocator::updateCommitment()
+	{
+		stats.lazyCommittedSize = 0;
+		for (auto& block : blocks) {
+			if (block.lazy) {
+				VkDeviceSize committed{ 0 };
+				vkGetDeviceMemoryCommitment(device->logicalDevice, block.memory, &committed);
+				stats.lazyCommittedSize += committed;
+			}
+		}
+	}
+}
@@ -0,0 +1,83 @@
+/*
+* Transient attachment allocator
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+*/
+
+/*
+* Allocates the memory for render target images that are recreated together (e.g. on resize)
+* - Images that are only used as attachments get the transient attachment usage flag and are backed by lazily allocated memory if the implementation offers it
+*   (on tile based GPUs such attachments may never need physical memory at all)
+* - All other images are placed in shared memory blocks: Images whose lifetimes (the range of passes in a frame they are used in) don't overlap are bound to the same memory
+* Images sharing memory need to be synchronized against each other, the render graph does this automatically if the groups returned by aliasGroups are registered with it
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	class TransientAllocator
+	{
+	public:
+		struct Stats {
+			uint32_t images{ 0 };
+			// Number of memory allocations done by the last call to allocate
+			uint32_t allocations{ 0 };
+			uint32_t lazyImages{ 0 };
+			// Memory required if every image had its own allocation
+			VkDeviceSize unaliasedSize{ 0 };
+			// Memory actually allocated, including lazily allocated memory
+			VkDeviceSize allocatedSize{ 0 };
+			// Size of the lazily allocated memory and how much of it has been committed by the implementation (updated by updateCommitment)
+			VkDeviceSize lazySize{ 0 };
+			VkDeviceSize lazyCommittedSize{ 0 };
+		};
+
+		vks::VulkanDevice* device{ nullptr };
+		// Share memory between images with non-overlapping lifetimes
+		bool aliasing{ true };
+		// Use transient attachments with lazily allocated memory where possible
+		bool lazyAllocation{ true };
+		Stats stats;
+
+		void create(vks::VulkanDevice* device);
+		/** @brief Destroys all images and frees their memory */
+		void destroy();
+		/** @brief Creates an image that's used from pass firstUse up to and including pass lastUse, memory is bound by allocate, so views must be created afterwards */
+		VkImage createImage(VkImageCreateInfo createInfo, uint32_t firstUse, uint32_t lastUse);
+		/** @brief Allocates and binds memory for all images created since the last call to destroy */
+		void allocate();
+		/** @brief Returns the groups of images that share the same memory */
+		std::vector<std::vector<VkImage>> aliasGroups() const;
+		/** @brief Queries how much of the lazily allocated memory has been committed */
+		void updateCommitment();
+
+	private:
+		struct Image {
+			VkImage image{ VK_NULL_HANDLE };
+			uint32_t firstUse{ 0 };
+			uint32_t lastUse{ 0 };
+			bool transient{ false };
+			VkMemoryRequirements memoryRequirements{};
+			// Index of the memory block the image is bound to
+			uint32_t block{ 0 };
+		};
+		struct Block {
+			VkDeviceMemory memory{ VK_NULL_HANDLE };
+			VkDeviceSize size{ 0 };
+			uint32_t memoryTypeIndex{ 0 };
+			bool lazy{ false };
+			std::vector<uint32_t> images;
+		};
+		std::vector<Image> images;
+		std::vector<Block> blocks;
+	};
+}
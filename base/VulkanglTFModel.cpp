@@ -18,17 +18,50 @@
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 
 #include "VulkanglTFModel.h"
+#include "VulkanMeshSimplify.h"
+#include "VulkanMeshopt.h"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <unordered_set>
 
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutImage = VK_NULL_HANDLE;
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutUbo = VK_NULL_HANDLE;
 VkMemoryPropertyFlags vkglTF::memoryPropertyFlags = 0;
 uint32_t vkglTF::descriptorBindingFlags = vkglTF::DescriptorBindingFlags::ImageBaseColor;
+uint32_t vkglTF::nodeBufferFrameCount = 3;
+std::string vkglTF::shadersPath;
+uint32_t vkglTF::extractionThreadCount = 0;
+vkglTF::LODSettings vkglTF::lodSettings;
+vkglTF::ResourceCache vkglTF::resourceCache;
 
 /*
 	We use a custom image loading function with tinyglTF, so we can do custom stuff loading ktx textures
 */
 bool loadImageDataFunc(tinygltf::Image* image, const int imageIndex, std::string* error, std::string* warning, int req_width, int req_height, const unsigned char* bytes, int size, void* userData)
 {
+	// Images are cached by their encoded content, so if the image is already cached there is no need to decode it again
+	vkglTF::Model* model = static_cast<vkglTF::Model*>(userData);
+	if (model && (imageIndex >= 0)) {
+		// The key also includes the device and the processing flags that change the resulting image
+		const VkDevice device = model->device->logicalDevice;
+		const uint32_t processingFlags = model->fileLoadingFlags & (vkglTF::FileLoadingFlags::GenerateMipsCompute | vkglTF::FileLoadingFlags::CompressTextures);
+		uint64_t key = vkglTF::ResourceCache::hash(bytes, size);
+		key = vkglTF::ResourceCache::hash(&device, sizeof(VkDevice), key);
+		key = vkglTF::ResourceCache::hash(&processingFlags, sizeof(uint32_t), key);
+		if (model->imageCacheKeys.size() <= static_cast<size_t>(imageIndex)) {
+			model->imageCacheKeys.resize(imageIndex + 1, 0);
+		}
+		model->imageCacheKeys[imageIndex] = key;
+		if (vkglTF::resourceCache.containsImage(key)) {
+			return true;
+		}
+	}
+
 	// KTX files will be handled by our own code
 	if (image->uri.find_last_of(".") != std::string::npos) {
 		if (image->uri.substr(image->uri.find_last_of(".") + 1) == "ktx") {
@@ -55,20 +88,157 @@ void vkglTF::Texture::updateDescriptor()
 	descriptor.sampler = sampler;
 	descriptor.imageView = view;
 	descriptor.imageLayout = imageLayout;
+	// Register with the bindless table, textures sharing a cached image also share its index
+	if (vks::bindlessTable.active()) {
+		if (bindlessIndex != vks::BindlessTable::invalidIndex) {
+			vks::bindlessTable.remove(bindlessIndex);
+		}
+		bindlessIndex = vks::bindlessTable.add(descriptor);
+	}
 }
 
 void vkglTF::Texture::destroy()
 {
+	if (bindlessIndex != vks::BindlessTable::invalidIndex) {
+		vks::bindlessTable.remove(bindlessIndex);
+		bindlessIndex = vks::BindlessTable::invalidIndex;
+	}
 	if (device)
 	{
+		// Images owned by the resource cache are destroyed once the last reference has been released
+		if (cacheKey != 0) {
+			resourceCache.release(device->logicalDevice, *this);
+			return;
+		}
 		vkDestroyImageView(device->logicalDevice, view, nullptr);
 		vkDestroyImage(device->logicalDevice, image, nullptr);
 		vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
-		vkDestroySampler(device->logicalDevice, sampler, nullptr);
+		resourceCache.releaseSampler(device->logicalDevice, sampler);
+	}
+}
+
+/*
+	Shared resource cache
+*/
+
+uint64_t vkglTF::ResourceCache::hash(const void* data, size_t size, uint64_t seed)
+{
+	uint64_t hash = seed;
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool vkglTF::ResourceCache::containsImage(uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return images.find(key) != images.end();
+}
+
+bool vkglTF::ResourceCache::acquireImage(uint64_t key, Texture& texture)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.imageRequests++;
+	auto it = images.find(key);
+	if (it == images.end()) {
+		return false;
 	}
+	ImageEntry& entry = it->second;
+	entry.refCount++;
+	stats.imageHits++;
+	stats.bytesSaved += entry.size;
+	texture.image = entry.image;
+	texture.deviceMemory = entry.memory;
+	texture.view = entry.view;
+	texture.imageLayout = entry.layout;
+	texture.sampler = entry.sampler;
+	texture.width = entry.width;
+	texture.height = entry.height;
+	texture.mipLevels = entry.mipLevels;
+	texture.layerCount = 1;
+	texture.cacheKey = key;
+	texture.updateDescriptor();
+	// The sampler is referenced by the cached image, so no need to look it up
+	for (auto& [samplerKey, samplerEntry] : samplers) {
+		if (samplerEntry.sampler == entry.sampler) {
+			samplerEntry.refCount++;
+			break;
+		}
+	}
+	return true;
+}
+
+void vkglTF::ResourceCache::addImage(uint64_t key, Texture& texture)
+{
+	VkMemoryRequirements memReqs;
+	vkGetImageMemoryRequirements(texture.device->logicalDevice, texture.image, &memReqs);
+	std::lock_guard<std::mutex> lock(mutex);
+	images[key] = { texture.image, texture.deviceMemory, texture.view, texture.imageLayout, texture.sampler, texture.width, texture.height, texture.mipLevels, memReqs.size, 1 };
+	texture.cacheKey = key;
+}
+
+VkSampler vkglTF::ResourceCache::acquireSampler(VkDevice device, const VkSamplerCreateInfo& createInfo)
+{
+	VkSampler sampler{ VK_NULL_HANDLE };
+	// Samplers with extension structures are not cached
+	if (createInfo.pNext) {
+		VK_CHECK_RESULT(vkCreateSampler(device, &createInfo, nullptr, &sampler));
+		return sampler;
+	}
+	// All members following pNext are 32 bit values, so there's no padding to take into account
+	const size_t offset = offsetof(VkSamplerCreateInfo, flags);
+	uint64_t key = hash(reinterpret_cast<const uint8_t*>(&createInfo) + offset, sizeof(VkSamplerCreateInfo) - offset);
+	key = hash(&device, sizeof(VkDevice), key);
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.samplerRequests++;
+	auto it = samplers.find(key);
+	if (it != samplers.end()) {
+		stats.samplerHits++;
+		it->second.refCount++;
+		return it->second.sampler;
+	}
+	VK_CHECK_RESULT(vkCreateSampler(device, &createInfo, nullptr, &sampler));
+	samplers[key] = { sampler, 1 };
+	return sampler;
+}
+
+void vkglTF::ResourceCache::releaseSampler(VkDevice device, VkSampler sampler)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto it = samplers.begin(); it != samplers.end(); ++it) {
+		if (it->second.sampler == sampler) {
+			if (--it->second.refCount == 0) {
+				vkDestroySampler(device, sampler, nullptr);
+				samplers.erase(it);
+			}
+			return;
+		}
+	}
+	// Not owned by the cache
+	vkDestroySampler(device, sampler, nullptr);
 }
 
-void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path, vks::VulkanDevice *device, VkQueue copyQueue)
+void vkglTF::ResourceCache::release(VkDevice device, Texture& texture)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = images.find(texture.cacheKey);
+		assert(it != images.end());
+		if (--it->second.refCount == 0) {
+			vkDestroyImageView(device, it->second.view, nullptr);
+			vkDestroyImage(device, it->second.image, nullptr);
+			vkFreeMemory(device, it->second.memory, nullptr);
+			images.erase(it);
+		}
+	}
+	releaseSampler(device, texture.sampler);
+	texture.cacheKey = 0;
+}
+
+void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path, vks::VulkanDevice *device, VkQueue copyQueue, vks::TextureProcessor* textureProcessor, vks::TextureProcessor::Compression compression)
 {
 	this->device = device;
 
@@ -82,7 +252,29 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 
 	VkFormat format;
 
-	if (!isKtx) {
+	if (!isKtx && textureProcessor && textureProcessor->supported()) {
+		// Texture was loaded using STB_Image, mip chain generation (and optional compression) is done in compute
+		std::vector<unsigned char> rgbaBuffer;
+		const unsigned char* buffer = gltfimage.image.data();
+		if (gltfimage.component == 3) {
+			rgbaBuffer.resize(size_t(gltfimage.width) * gltfimage.height * 4);
+			for (size_t i = 0; i < size_t(gltfimage.width) * gltfimage.height; ++i) {
+				memcpy(&rgbaBuffer[i * 4], &gltfimage.image[i * 3], 3);
+				rgbaBuffer[i * 4 + 3] = 255;
+			}
+			buffer = rgbaBuffer.data();
+		}
+		width = gltfimage.width;
+		height = gltfimage.height;
+		vks::TextureProcessor::Result result;
+		textureProcessor->upload(buffer, width, height, copyQueue, compression, result);
+		image = result.image;
+		deviceMemory = result.memory;
+		format = result.format;
+		mipLevels = result.mipLevels;
+		imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+	else if (!isKtx) {
 		// Texture was loaded using STB_Image
 
 		unsigned char* buffer = nullptr;
@@ -422,7 +614,7 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		.maxLod = (float)mipLevels,
 		.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
 	};
-	VK_CHECK_RESULT(vkCreateSampler(device->logicalDevice, &samplerInfo, nullptr, &sampler));
+	sampler = resourceCache.acquireSampler(device->logicalDevice, samplerInfo);
 
 	VkImageViewCreateInfo viewInfo{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -433,23 +625,15 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 	};
 	VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewInfo, nullptr, &view));
 
-	descriptor.sampler = sampler;
-	descriptor.imageView = view;
-	descriptor.imageLayout = imageLayout;
+	updateDescriptor();
 }
 
 /*
 	glTF material
 */
-void vkglTF::Material::createDescriptorSet(VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags)
+void vkglTF::Material::createDescriptorSet(vks::DescriptorAllocator& descriptorAllocator, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags)
 {
-	VkDescriptorSetAllocateInfo descriptorSetAllocInfo{
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-		.descriptorPool = descriptorPool,
-		.descriptorSetCount = 1,
-		.pSetLayouts = &descriptorSetLayout,
-	};
-	VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &descriptorSet));
+	descriptorSet = descriptorAllocator.allocate(descriptorSetLayout);
 	std::vector<VkDescriptorImageInfo> imageDescriptors{};
 	std::vector<VkWriteDescriptorSet> writeDescriptorSets{};
 	if (descriptorBindingFlags & DescriptorBindingFlags::ImageBaseColor) {
@@ -483,6 +667,19 @@ void vkglTF::Material::createDescriptorSet(VkDescriptorPool descriptorPool, VkDe
 /*
 	glTF primitive
 */
+uint32_t vkglTF::Primitive::selectLOD(float distance, float projectionScale, float maxPixelError) const
+{
+	// Projected error in pixels is error / distance * projectionScale, the error of the levels grows monotonically
+	uint32_t level = 0;
+	for (uint32_t i = 1; i < lods.size(); i++) {
+		if (lods[i].error * projectionScale > maxPixelError * std::max(distance, FLT_MIN)) {
+			break;
+		}
+		level = i;
+	}
+	return level;
+}
+
 void vkglTF::Primitive::setDimensions(glm::vec3 min, glm::vec3 max) {
 	dimensions.min = min;
 	dimensions.max = max;
@@ -497,20 +694,9 @@ void vkglTF::Primitive::setDimensions(glm::vec3 min, glm::vec3 max) {
 vkglTF::Mesh::Mesh(vks::VulkanDevice *device, glm::mat4 matrix) {
 	this->device = device;
 	this->uniformBlock.matrix = matrix;
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		sizeof(uniformBlock),
-		&uniformBuffer.buffer,
-		&uniformBuffer.memory,
-		&uniformBlock));
-	VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, uniformBuffer.memory, 0, sizeof(uniformBlock), 0, &uniformBuffer.mapped));
-	uniformBuffer.descriptor = { uniformBuffer.buffer, 0, sizeof(uniformBlock) };
 };
 
 vkglTF::Mesh::~Mesh() {
-	vkDestroyBuffer(device->logicalDevice, uniformBuffer.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, uniformBuffer.memory, nullptr);
     for(auto primitive : primitives)
     {
         delete primitive;
@@ -536,9 +722,10 @@ glm::mat4 vkglTF::Node::getMatrix() {
 
 void vkglTF::Node::update() {
 	if (mesh) {
+		// Only updates the node's data on the host, it's copied to the node buffer by Model::updateNodeBuffer
 		glm::mat4 m = getMatrix();
+		mesh->uniformBlock.matrix = m;
 		if (skin) {
-			mesh->uniformBlock.matrix = m;
 			// Update join matrices
 			glm::mat4 inverseTransform = glm::inverse(m);
 			for (size_t i = 0; i < skin->joints.size(); i++) {
@@ -548,9 +735,6 @@ void vkglTF::Node::update() {
 				mesh->uniformBlock.jointMatrix[i] = jointMat;
 			}
 			mesh->uniformBlock.jointcount = (float)skin->joints.size();
-			memcpy(mesh->uniformBuffer.mapped, &mesh->uniformBlock, sizeof(mesh->uniformBlock));
-		} else {
-			memcpy(mesh->uniformBuffer.mapped, &m, sizeof(glm::mat4));
 		}
 	}
 
@@ -623,6 +807,19 @@ VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputStat
 	return &pipelineVertexInputStateCreateInfo;
 }
 
+VkVertexInputBindingDescription vkglTF::Vertex::instanceInputBindingDescription(uint32_t binding) {
+	return VkVertexInputBindingDescription({ binding, sizeof(glm::mat4), VK_VERTEX_INPUT_RATE_INSTANCE });
+}
+
+std::vector<VkVertexInputAttributeDescription> vkglTF::Vertex::instanceInputAttributeDescriptions(uint32_t binding, uint32_t firstLocation) {
+	// A matrix attribute is passed as one vec4 per column
+	std::vector<VkVertexInputAttributeDescription> result;
+	for (uint32_t i = 0; i < 4; i++) {
+		result.push_back({ firstLocation + i, binding, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(sizeof(glm::vec4) * i) });
+	}
+	return result;
+}
+
 vkglTF::Texture* vkglTF::Model::getTexture(uint32_t index)
 {
 
@@ -729,9 +926,7 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 	};
 	VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &emptyTexture.view));
 
-	emptyTexture.descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	emptyTexture.descriptor.imageView = emptyTexture.view;
-	emptyTexture.descriptor.sampler = emptyTexture.sampler;
+	emptyTexture.updateDescriptor();
 
 	delete[] buffer;
 }
@@ -751,22 +946,413 @@ vkglTF::Model::~Model()
 	for (auto& node : nodes) {
 		delete node;
 	}
+	for (auto& buffer : instanceBuffers) {
+		buffer.destroy();
+	}
+	nodeBuffer.buffer.destroy();
+	destroyParallelDraw();
     for (auto& skin : skins) {
         delete skin;
     }
-	if (descriptorSetLayoutUbo != VK_NULL_HANDLE) {
-		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayoutUbo, nullptr);
-		descriptorSetLayoutUbo = VK_NULL_HANDLE;
+	// The layouts are owned by the layout cache
+	descriptorSetLayoutUbo = VK_NULL_HANDLE;
+	descriptorSetLayoutImage = VK_NULL_HANDLE;
+	descriptorAllocator.destroy();
+	emptyTexture.destroy();
+}
+
+namespace
+{
+	// Size of a file on disk (or in the apk on Android), zero if it can't be opened
+	size_t fileSize(const std::string& filename)
+	{
+#if defined(__ANDROID__)
+		AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_UNKNOWN);
+		if (!asset) {
+			return 0;
+		}
+		const size_t size = AAsset_getLength(asset);
+		AAsset_close(asset);
+		return size;
+#else
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		return file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+#endif
+	}
+
+	// Generated LOD chains by a hash of the source geometry and the LOD settings, so loading the same geometry again skips the simplification
+	struct LODChain {
+		// Indices of each generated level (not including the full detail level), local to the primitive's first vertex
+		std::vector<std::vector<uint32_t>> indices;
+		std::vector<float> errors;
+		size_t indexCount() const
+		{
+			size_t count = 0;
+			for (auto& levelIndices : indices) {
+				count += levelIndices.size();
+			}
+			return count;
+		}
+	};
+	// The oldest chains are evicted once the cached indices exceed this limit (64 MiB)
+	constexpr size_t lodCacheMaxIndices{ 16 * 1024 * 1024 };
+	std::unordered_map<uint64_t, LODChain> lodCache;
+	// Keys in insertion order and number of indices currently cached
+	std::deque<uint64_t> lodCacheOrder;
+	size_t lodCacheIndices{ 0 };
+	std::mutex lodCacheMutex;
+
+	// A refit BVH is rebuilt once its SAH cost exceeds the cost after the last build by this factor
+	constexpr float bvhRebuildFactor{ 2.0f };
+
+	// Primitives are split into ranges of at most this many vertices or indices, so a single large primitive is still spread across all workers
+	constexpr uint32_t extractionRangeSize{ 65536 };
+
+	// Reads vertex attributes of any component type and stride
+	// With KHR_mesh_quantization attributes may be stored as (normalized) integers, these are expanded to floats
+	struct AttributeReader {
+		const unsigned char* data{ nullptr };
+		size_t stride{ 0 };
+		int componentType{ TINYGLTF_COMPONENT_TYPE_FLOAT };
+		bool normalized{ false };
+		uint32_t components{ 0 };
+
+		template<typename T>
+		float convert(const unsigned char* source, float normalizationScale) const
+		{
+			T value;
+			memcpy(&value, source, sizeof(T));
+			// Signed normalized values are clamped, as both the minimum and the minimum + 1 map to -1.0
+			return normalized ? std::max(static_cast<float>(value) * normalizationScale, -1.0f) : static_cast<float>(value);
+		}
+
+		glm::vec4 read(size_t index, float defaultW = 0.0f) const
+		{
+			glm::vec4 value(0.0f, 0.0f, 0.0f, defaultW);
+			const unsigned char* element = data + index * stride;
+			if (componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
+				memcpy(&value, element, components * sizeof(float));
+				return value;
+			}
+			for (uint32_t c = 0; c < components; c++) {
+				switch (componentType) {
+				case TINYGLTF_COMPONENT_TYPE_BYTE:
+					value[c] = convert<int8_t>(element + c, 1.0f / 127.0f);
+					break;
+				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+					value[c] = convert<uint8_t>(element + c, 1.0f / 255.0f);
+					break;
+				case TINYGLTF_COMPONENT_TYPE_SHORT:
+					value[c] = convert<int16_t>(element + c * 2, 1.0f / 32767.0f);
+					break;
+				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+					value[c] = convert<uint16_t>(element + c * 2, 1.0f / 65535.0f);
+					break;
+				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+					value[c] = convert<uint32_t>(element + c * 4, 1.0f);
+					break;
+				}
+			}
+			return value;
+		}
+
+		explicit operator bool() const
+		{
+			return data != nullptr;
+		}
+	};
+
+	AttributeReader attributeReader(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const char* name)
+	{
+		AttributeReader reader{};
+		auto attribute = primitive.attributes.find(name);
+		if (attribute == primitive.attributes.end()) {
+			return reader;
+		}
+		const tinygltf::Accessor& accessor = model.accessors[attribute->second];
+		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+		reader.data = &(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]);
+		reader.componentType = accessor.componentType;
+		reader.normalized = accessor.normalized;
+		reader.components = std::min(static_cast<uint32_t>(tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type))), 4u);
+		reader.stride = static_cast<size_t>(std::max(accessor.ByteStride(view), 0));
+		return reader;
 	}
-	if (descriptorSetLayoutImage != VK_NULL_HANDLE) {
-		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayoutImage, nullptr);
-		descriptorSetLayoutImage = VK_NULL_HANDLE;
+
+	void extractVertices(const tinygltf::Model& model, const tinygltf::Primitive& primitive, uint32_t begin, uint32_t end, vkglTF::Vertex* vertices)
+	{
+		const AttributeReader positions = attributeReader(model, primitive, "POSITION");
+		const AttributeReader normals = attributeReader(model, primitive, "NORMAL");
+		const AttributeReader texCoords = attributeReader(model, primitive, "TEXCOORD_0");
+		const AttributeReader colors = attributeReader(model, primitive, "COLOR_0");
+		const AttributeReader tangents = attributeReader(model, primitive, "TANGENT");
+		const AttributeReader joints = attributeReader(model, primitive, "JOINTS_0");
+		const AttributeReader weights = attributeReader(model, primitive, "WEIGHTS_0");
+		const bool hasSkin = (joints && weights);
+
+		for (uint32_t v = begin; v < end; v++) {
+			vkglTF::Vertex& vert = vertices[v];
+			vert.pos = glm::vec3(positions.read(v));
+			vert.normal = normals ? glm::normalize(glm::vec3(normals.read(v))) : glm::vec3(0.0f);
+			vert.uv = texCoords ? glm::vec2(texCoords.read(v)) : glm::vec2(0.0f);
+			// Color buffer are either of type vec3 or vec4
+			vert.color = colors ? colors.read(v, 1.0f) : glm::vec4(1.0f);
+			vert.tangent = tangents ? tangents.read(v) : glm::vec4(0.0f);
+			vert.joint0 = hasSkin ? joints.read(v) : glm::vec4(0.0f);
+			vert.weight0 = hasSkin ? weights.read(v) : glm::vec4(0.0f);
+		}
+	}
+
+	// Indices are rebased to the primitive's first vertex in the model's vertex buffer
+	template<typename T>
+	void rebaseIndices(const T* source, uint32_t vertexStart, uint32_t begin, uint32_t end, uint32_t* indices)
+	{
+		for (uint32_t i = begin; i < end; i++) {
+			indices[i] = source[i] + vertexStart;
+		}
+	}
+
+	void extractIndices(const tinygltf::Model& model, const tinygltf::Primitive& primitive, uint32_t vertexStart, uint32_t begin, uint32_t end, uint32_t* indices)
+	{
+		const tinygltf::Accessor& accessor = model.accessors[primitive.indices];
+		const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+		const unsigned char* data = &model.buffers[bufferView.buffer].data[accessor.byteOffset + bufferView.byteOffset];
+		switch (accessor.componentType) {
+		case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+			rebaseIndices(reinterpret_cast<const uint32_t*>(data), vertexStart, begin, end, indices);
+			break;
+		case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+			rebaseIndices(reinterpret_cast<const uint16_t*>(data), vertexStart, begin, end, indices);
+			break;
+		case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+			rebaseIndices(reinterpret_cast<const uint8_t*>(data), vertexStart, begin, end, indices);
+			break;
+		}
 	}
-	vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
-	emptyTexture.destroy();
 }
 
-void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, uint32_t nodeIndex, const tinygltf::Model &model, std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer, float globalscale)
+void vkglTF::Model::decodeMeshoptBuffers(tinygltf::Model& gltfModel)
+{
+	const auto tStart = std::chrono::high_resolution_clock::now();
+	struct CompressedView {
+		const tinygltf::BufferView* view;
+		size_t buffer;
+		size_t byteOffset;
+		size_t size;
+		size_t count;
+		size_t stride;
+		vks::meshopt::Mode mode;
+		vks::meshopt::Filter filter;
+	};
+	std::vector<CompressedView> compressedViews;
+	for (const tinygltf::BufferView& view : gltfModel.bufferViews) {
+		auto extension = view.extensions.find("EXT_meshopt_compression");
+		if (extension == view.extensions.end()) {
+			continue;
+		}
+		const tinygltf::Value& meshopt = extension->second;
+		auto number = [&meshopt](const char* name) {
+			return meshopt.Has(name) ? static_cast<size_t>(meshopt.Get(name).GetNumberAsDouble()) : 0;
+		};
+		CompressedView compressedView{ .view = &view, .buffer = number("buffer"), .byteOffset = number("byteOffset"), .size = number("byteLength"), .count = number("count"), .stride = number("byteStride") };
+		const std::string filter = meshopt.Has("filter") ? meshopt.Get("filter").Get<std::string>() : "";
+		if (!meshopt.Has("mode") || !vks::meshopt::parseMode(meshopt.Get("mode").Get<std::string>(), compressedView.mode) || !vks::meshopt::parseFilter(filter, compressedView.filter)) {
+			vks::tools::exitFatal("Unsupported EXT_meshopt_compression mode or filter in \"" + path + "\"", -1);
+			return;
+		}
+		if ((compressedView.buffer >= gltfModel.buffers.size()) || (compressedView.byteOffset + compressedView.size > gltfModel.buffers[compressedView.buffer].data.size()) || (compressedView.count * compressedView.stride > view.byteLength)) {
+			vks::tools::exitFatal("Invalid EXT_meshopt_compression buffer view in \"" + path + "\"", -1);
+			return;
+		}
+		// The decoded data replaces the view's contents in its own buffer, which is usually a fallback buffer without any data
+		tinygltf::Buffer& target = gltfModel.buffers[view.buffer];
+		if (target.data.size() < view.byteOffset + view.byteLength) {
+			target.data.resize(view.byteOffset + view.byteLength);
+		}
+		stats.compressedSize += compressedView.size;
+		stats.decodedSize += compressedView.count * compressedView.stride;
+		compressedViews.push_back(compressedView);
+	}
+	if (compressedViews.empty()) {
+		return;
+	}
+
+	// Views are decoded into disjoint ranges, so they can be decoded in parallel
+	// Buffers aren't resized anymore at this point, so the pointers into them stay valid
+	std::atomic<bool> failed{ false };
+	vks::parallelFor(compressedViews.size(), vkglTF::extractionThreadCount, [&](size_t i) {
+		const CompressedView& compressedView = compressedViews[i];
+		const uint8_t* source = gltfModel.buffers[compressedView.buffer].data.data() + compressedView.byteOffset;
+		uint8_t* destination = gltfModel.buffers[compressedView.view->buffer].data.data() + compressedView.view->byteOffset;
+		if (!vks::meshopt::decode(destination, compressedView.count, compressedView.stride, source, compressedView.size, compressedView.mode, compressedView.filter)) {
+			failed = true;
+		}
+	});
+	if (failed) {
+		vks::tools::exitFatal("Could not decode EXT_meshopt_compression data in \"" + path + "\"", -1);
+	}
+	stats.decodeTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+}
+
+void vkglTF::Model::generateLODs(const std::vector<Vertex>& vertexBuffer, std::vector<uint32_t>& indexBuffer)
+{
+	const auto tStart = std::chrono::high_resolution_clock::now();
+	// Primitives shared by multiple nodes reference the same indices, so their chain is only generated once
+	std::vector<Primitive*> sources;
+	std::unordered_map<uint32_t, std::vector<Primitive*>> primitivesByFirstIndex;
+	for (Node* node : linearNodes) {
+		if (node->mesh) {
+			for (Primitive* primitive : node->mesh->primitives) {
+				auto& primitives = primitivesByFirstIndex[primitive->firstIndex];
+				if (primitives.empty()) {
+					sources.push_back(primitive);
+				}
+				primitives.push_back(primitive);
+			}
+		}
+	}
+
+	std::vector<LODChain> chains(sources.size());
+	std::atomic<uint32_t> cacheHits{ 0 };
+	vks::parallelFor(sources.size(), vkglTF::extractionThreadCount, [&](size_t i) {
+		const Primitive* primitive = sources[i];
+		const Vertex* vertices = &vertexBuffer[primitive->firstVertex];
+		std::vector<uint32_t> current(indexBuffer.begin() + primitive->firstIndex, indexBuffer.begin() + primitive->firstIndex + primitive->indexCount);
+		for (auto& index : current) {
+			index -= primitive->firstVertex;
+		}
+
+		uint64_t key = ResourceCache::hash(vertices, primitive->vertexCount * sizeof(Vertex));
+		key = ResourceCache::hash(current.data(), current.size() * sizeof(uint32_t), key);
+		key = ResourceCache::hash(&lodSettings, sizeof(LODSettings), key);
+		{
+			std::lock_guard<std::mutex> lock(lodCacheMutex);
+			auto cached = lodCache.find(key);
+			if (cached != lodCache.end()) {
+				chains[i] = cached->second;
+				cacheHits++;
+				return;
+			}
+		}
+
+		// Every level is simplified from the previous one, so the errors of the levels add up
+		LODChain& chain = chains[i];
+		const float errorLimit = lodSettings.maxError * primitive->dimensions.radius;
+		float error = 0.0f;
+		for (uint32_t level = 1; level < lodSettings.levelCount; level++) {
+			const size_t targetIndexCount = static_cast<size_t>(static_cast<float>(current.size() / 3) * lodSettings.reduction) * 3;
+			std::vector<uint32_t> simplified;
+			error += vks::meshsimplify::simplify(simplified, current.data(), current.size(), &vertices[0].pos.x, primitive->vertexCount, sizeof(Vertex), targetIndexCount, errorLimit);
+			// Stop once a level doesn't remove at least 5% of the triangles, e.g. if the rest of the mesh is locked or above the error limit
+			if (simplified.empty() || (simplified.size() * 20 > current.size() * 19)) {
+				break;
+			}
+			chain.indices.push_back(simplified);
+			chain.errors.push_back(error);
+			current = std::move(simplified);
+		}
+
+		std::lock_guard<std::mutex> lock(lodCacheMutex);
+		// Identical primitives may have been simplified by another thread in the meantime
+		if (!lodCache.emplace(key, chain).second) {
+			return;
+		}
+		lodCacheOrder.push_back(key);
+		lodCacheIndices += chain.indexCount();
+		while ((lodCacheIndices > lodCacheMaxIndices) && (lodCacheOrder.size() > 1)) {
+			auto evicted = lodCache.find(lodCacheOrder.front());
+			lodCacheIndices -= evicted->second.indexCount();
+			lodCache.erase(evicted);
+			lodCacheOrder.pop_front();
+		}
+	});
+
+	// The generated levels are appended to the model's index buffer, rebased to the primitive's first vertex
+	for (size_t i = 0; i < sources.size(); i++) {
+		const Primitive* source = sources[i];
+		std::vector<Primitive::LOD> lods = { { source->firstIndex, source->indexCount, 0.0f } };
+		for (size_t level = 0; level < chains[i].indices.size(); level++) {
+			const std::vector<uint32_t>& levelIndices = chains[i].indices[level];
+			lods.push_back({ static_cast<uint32_t>(indexBuffer.size()), static_cast<uint32_t>(levelIndices.size()), chains[i].errors[level] });
+			for (uint32_t index : levelIndices) {
+				indexBuffer.push_back(index + source->firstVertex);
+			}
+			stats.lodIndexCount += static_cast<uint32_t>(levelIndices.size());
+		}
+		for (Primitive* primitive : primitivesByFirstIndex[source->firstIndex]) {
+			primitive->lods = lods;
+		}
+	}
+	stats.lodCacheHits = cacheHits;
+	stats.lodTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+}
+
+void vkglTF::Model::extractPrimitives(const tinygltf::Model& model, std::vector<Vertex>& vertexBuffer, std::vector<uint32_t>& indexBuffer)
+{
+	const auto tStart = std::chrono::high_resolution_clock::now();
+	// The buffers are sized exactly once, every primitive is written to the offsets assigned while loading the nodes
+	vertexBuffer.resize(extractedVertexCount);
+	indexBuffer.resize(extractedIndexCount);
+
+	struct Range {
+		const PrimitiveExtraction* extraction;
+		bool indices;
+		uint32_t begin;
+		uint32_t end;
+	};
+	std::vector<Range> ranges;
+	for (auto& extraction : primitiveExtractions) {
+		for (uint32_t begin = 0; begin < extraction.target->vertexCount; begin += extractionRangeSize) {
+			ranges.push_back({ &extraction, false, begin, std::min(begin + extractionRangeSize, extraction.target->vertexCount) });
+		}
+		for (uint32_t begin = 0; begin < extraction.target->indexCount; begin += extractionRangeSize) {
+			ranges.push_back({ &extraction, true, begin, std::min(begin + extractionRangeSize, extraction.target->indexCount) });
+		}
+	}
+
+	// Ranges are written to disjoint parts of the buffers, so workers only need to share the index of the next range
+	stats.extractionThreads = vks::parallelFor(ranges.size(), vkglTF::extractionThreadCount, [&](size_t i) {
+		const Range& range = ranges[i];
+		const Primitive* target = range.extraction->target;
+		if (range.indices) {
+			extractIndices(model, *range.extraction->source, target->firstVertex, range.begin, range.end, &indexBuffer[target->firstIndex]);
+		} else {
+			extractVertices(model, *range.extraction->source, range.begin, range.end, &vertexBuffer[target->firstVertex]);
+		}
+	});
+	primitiveExtractions.clear();
+
+	stats.extractionTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+}
+
+void vkglTF::Model::loadPrimitives(const tinygltf::Mesh &mesh, Mesh *newMesh, const tinygltf::Model &model)
+{
+	// Only the sizes and final buffer offsets are determined here, the geometry is extracted once all nodes have been loaded (see extractPrimitives)
+	for (size_t j = 0; j < mesh.primitives.size(); j++) {
+		const tinygltf::Primitive &primitive = mesh.primitives[j];
+		if (primitive.indices < 0) {
+			continue;
+		}
+		// Position attribute is required
+		assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
+		const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
+		const tinygltf::Accessor &indexAccessor = model.accessors[primitive.indices];
+		if ((indexAccessor.componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT) && (indexAccessor.componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT) && (indexAccessor.componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE)) {
+			std::cerr << "Index component type " << indexAccessor.componentType << " not supported!" << std::endl;
+			continue;
+		}
+		Primitive *newPrimitive = new Primitive(extractedIndexCount, static_cast<uint32_t>(indexAccessor.count), primitive.material > -1 ? materials[primitive.material] : materials.back());
+		newPrimitive->firstVertex = extractedVertexCount;
+		newPrimitive->vertexCount = static_cast<uint32_t>(posAccessor.count);
+		newPrimitive->setDimensions(glm::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]), glm::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]));
+		newMesh->primitives.push_back(newPrimitive);
+		primitiveExtractions.push_back({ .source = &primitive, .target = newPrimitive });
+		extractedVertexCount += newPrimitive->vertexCount;
+		extractedIndexCount += newPrimitive->indexCount;
+	}
+}
+
+void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, uint32_t nodeIndex, const tinygltf::Model &model, float globalscale)
 {
 	vkglTF::Node *newNode = new Node{};
 	newNode->index = nodeIndex;
@@ -801,163 +1387,31 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 	// Node with children
 	if (node.children.size() > 0) {
 		for (auto i = 0; i < node.children.size(); i++) {
-			loadNode(newNode, model.nodes[node.children[i]], node.children[i], model, indexBuffer, vertexBuffer, globalscale);
+			loadNode(newNode, model.nodes[node.children[i]], node.children[i], model, globalscale);
 		}
 	}
 
 	// Node contains mesh data
 	if (node.mesh > -1) {
-		const tinygltf::Mesh mesh = model.meshes[node.mesh];
+		const tinygltf::Mesh &mesh = model.meshes[node.mesh];
 		Mesh *newMesh = new Mesh(device, newNode->matrix);
 		newMesh->name = mesh.name;
-		for (size_t j = 0; j < mesh.primitives.size(); j++) {
-			const tinygltf::Primitive &primitive = mesh.primitives[j];
-			if (primitive.indices < 0) {
-				continue;
-			}
-			uint32_t indexStart = static_cast<uint32_t>(indexBuffer.size());
-			uint32_t vertexStart = static_cast<uint32_t>(vertexBuffer.size());
-			uint32_t indexCount = 0;
-			uint32_t vertexCount = 0;
-			glm::vec3 posMin{};
-			glm::vec3 posMax{};
-			bool hasSkin = false;
-			// Vertices
-			{
-				const float *bufferPos = nullptr;
-				const float *bufferNormals = nullptr;
-				const float *bufferTexCoords = nullptr;
-				const float* bufferColors = nullptr;
-				const float *bufferTangents = nullptr;
-				uint32_t numColorComponents;
-				const uint16_t *bufferJoints = nullptr;
-				const float *bufferWeights = nullptr;
-
-				// Position attribute is required
-				assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
-
-				const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
-				const tinygltf::BufferView &posView = model.bufferViews[posAccessor.bufferView];
-				bufferPos = reinterpret_cast<const float *>(&(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
-				posMin = glm::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
-				posMax = glm::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
-
-				if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
-					const tinygltf::Accessor &normAccessor = model.accessors[primitive.attributes.find("NORMAL")->second];
-					const tinygltf::BufferView &normView = model.bufferViews[normAccessor.bufferView];
-					bufferNormals = reinterpret_cast<const float *>(&(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
-				}
-
-				if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
-					const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
-					const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-					bufferTexCoords = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
-				}
-
-				if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
-				{
-					const tinygltf::Accessor& colorAccessor = model.accessors[primitive.attributes.find("COLOR_0")->second];
-					const tinygltf::BufferView& colorView = model.bufferViews[colorAccessor.bufferView];
-					// Color buffer are either of type vec3 or vec4
-					numColorComponents = colorAccessor.type == TINYGLTF_PARAMETER_TYPE_FLOAT_VEC3 ? 3 : 4;
-					bufferColors = reinterpret_cast<const float*>(&(model.buffers[colorView.buffer].data[colorAccessor.byteOffset + colorView.byteOffset]));
-				}
-
-				if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
-				{
-					const tinygltf::Accessor &tangentAccessor = model.accessors[primitive.attributes.find("TANGENT")->second];
-					const tinygltf::BufferView &tangentView = model.bufferViews[tangentAccessor.bufferView];
-					bufferTangents = reinterpret_cast<const float *>(&(model.buffers[tangentView.buffer].data[tangentAccessor.byteOffset + tangentView.byteOffset]));
-				}
-
-				// Skinning
-				// Joints
-				if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) {
-					const tinygltf::Accessor &jointAccessor = model.accessors[primitive.attributes.find("JOINTS_0")->second];
-					const tinygltf::BufferView &jointView = model.bufferViews[jointAccessor.bufferView];
-					bufferJoints = reinterpret_cast<const uint16_t *>(&(model.buffers[jointView.buffer].data[jointAccessor.byteOffset + jointView.byteOffset]));
-				}
-
-				if (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end()) {
-					const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("WEIGHTS_0")->second];
-					const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-					bufferWeights = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
-				}
-
-				hasSkin = (bufferJoints && bufferWeights);
-
-				vertexCount = static_cast<uint32_t>(posAccessor.count);
-
-				for (size_t v = 0; v < posAccessor.count; v++) {
-					Vertex vert{};
-					vert.pos = glm::vec4(glm::make_vec3(&bufferPos[v * 3]), 1.0f);
-					vert.normal = glm::normalize(glm::vec3(bufferNormals ? glm::make_vec3(&bufferNormals[v * 3]) : glm::vec3(0.0f)));
-					vert.uv = bufferTexCoords ? glm::make_vec2(&bufferTexCoords[v * 2]) : glm::vec3(0.0f);
-					if (bufferColors) {
-						switch (numColorComponents) {
-							case 3: 
-								vert.color = glm::vec4(glm::make_vec3(&bufferColors[v * 3]), 1.0f);
-								break;
-							case 4:
-								vert.color = glm::make_vec4(&bufferColors[v * 4]);
-								break;
-						}
-					}
-					else {
-						vert.color = glm::vec4(1.0f);
-					}
-					vert.tangent = bufferTangents ? glm::vec4(glm::make_vec4(&bufferTangents[v * 4])) : glm::vec4(0.0f);
-					vert.joint0 = hasSkin ? glm::vec4(glm::make_vec4(&bufferJoints[v * 4])) : glm::vec4(0.0f);
-					vert.weight0 = hasSkin ? glm::make_vec4(&bufferWeights[v * 4]) : glm::vec4(0.0f);
-					vertexBuffer.push_back(vert);
-				}
-			}
-			// Indices
-			{
-				const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
-				const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-
-				indexCount = static_cast<uint32_t>(accessor.count);
-
-				switch (accessor.componentType) {
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-					uint32_t *buf = new uint32_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint32_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
-					}
-                    delete[] buf;
-					break;
-				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-					uint16_t *buf = new uint16_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint16_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
-					}
-                    delete[] buf;
-                    break;
-				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-					uint8_t *buf = new uint8_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint8_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
-					}
-                    delete[] buf;
-                    break;
-				}
-				default:
-					std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
-					return;
-				}
+		newMesh->index = node.mesh;
+		stats.meshNodes++;
+		// If this glTF mesh has already been loaded for another node, the new node references the same vertices and indices
+		// Pre-transformed vertices are different for every node, so in that case the geometry can't be shared
+		const bool preTransform = fileLoadingFlags & FileLoadingFlags::PreTransformVertices;
+		auto loadedMesh = loadedMeshes.find(node.mesh);
+		if (!preTransform && (loadedMesh != loadedMeshes.end())) {
+			for (Primitive* primitive : loadedMesh->second->primitives) {
+				newMesh->primitives.push_back(new Primitive(*primitive));
+				stats.unsharedVertexBufferSize += primitive->vertexCount * sizeof(Vertex);
+				stats.unsharedIndexBufferSize += primitive->indexCount * sizeof(uint32_t);
 			}
-			Primitive *newPrimitive = new Primitive(indexStart, indexCount, primitive.material > -1 ? materials[primitive.material] : materials.back());
-			newPrimitive->firstVertex = vertexStart;
-			newPrimitive->vertexCount = vertexCount;
-			newPrimitive->setDimensions(posMin, posMax);
-			newMesh->primitives.push_back(newPrimitive);
+		} else {
+			loadedMeshes[node.mesh] = newMesh;
+			stats.uniqueMeshes++;
+			loadPrimitives(mesh, newMesh, model);
 		}
 		newNode->mesh = newMesh;
 	}
@@ -1001,14 +1455,33 @@ void vkglTF::Model::loadSkins(tinygltf::Model &gltfModel)
 	}
 }
 
-void vkglTF::Model::loadImages(tinygltf::Model &gltfModel, vks::VulkanDevice *device, VkQueue transferQueue)
+void vkglTF::Model::loadImages(tinygltf::Model &gltfModel, vks::VulkanDevice *device, VkQueue transferQueue, uint32_t fileLoadingFlags)
 {
-	for (tinygltf::Image &image : gltfModel.images) {
+	// Optional compute based mip generation and compression for PNG/JPEG images
+	vks::TextureProcessor textureProcessor;
+	vks::TextureProcessor::Compression compression = vks::TextureProcessor::Compression::None;
+	if (fileLoadingFlags & (FileLoadingFlags::GenerateMipsCompute | FileLoadingFlags::CompressTextures)) {
+		textureProcessor.create(device, (vkglTF::shadersPath.empty() ? getShaderBasePath() + "glsl/" : vkglTF::shadersPath) + "base/");
+		if (fileLoadingFlags & FileLoadingFlags::CompressTextures) {
+			compression = vks::TextureProcessor::Compression::BC1;
+		}
+	}
+	for (size_t i = 0; i < gltfModel.images.size(); i++) {
 		vkglTF::Texture texture;
-		texture.fromglTfImage(image, path, device, transferQueue);
+		texture.device = device;
+		// Images that have already been loaded (by this or any other model) are taken from the shared cache
+		const uint64_t cacheKey = (i < imageCacheKeys.size()) ? imageCacheKeys[i] : 0;
+		if ((cacheKey == 0) || !resourceCache.acquireImage(cacheKey, texture)) {
+			texture.fromglTfImage(gltfModel.images[i], path, device, transferQueue, textureProcessor.device ? &textureProcessor : nullptr, compression);
+			if (cacheKey != 0) {
+				resourceCache.addImage(cacheKey, texture);
+			}
+		}
 		texture.index = static_cast<uint32_t>(textures.size());
 		textures.push_back(texture);
 	}
+	imageCacheKeys.clear();
+	textureProcessor.destroy();
 	// Create an empty texture to be used for empty material images
 	createEmptyTexture(transferQueue);
 }
@@ -1184,7 +1657,7 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 	if (fileLoadingFlags & FileLoadingFlags::DontLoadImages) {
 		gltfContext.SetImageLoader(loadImageDataFuncEmpty, nullptr);
 	} else {
-		gltfContext.SetImageLoader(loadImageDataFunc, nullptr);
+		gltfContext.SetImageLoader(loadImageDataFunc, this);
 	}
 #if defined(__ANDROID__)
 	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
@@ -1197,27 +1670,46 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 	std::string error, warning;
 
 	this->device = device;
+	this->fileLoadingFlags = fileLoadingFlags;
 
 #if defined(__ANDROID__)
 	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
 	// We let tinygltf handle this, by passing the asset manager of our app
 	tinygltf::asset_manager = androidApp->activity->assetManager;
 #endif
-	bool fileLoaded = gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
+	const auto tStart = std::chrono::high_resolution_clock::now();
+	// Binary glTF files contain the json and all buffers in a single file, so there are no additional files to open and no base64 encoded buffers to decode
+	const bool binary = (filename.size() > 4) && (filename.compare(filename.size() - 4, 4, ".glb") == 0);
+	bool fileLoaded = binary ? gltfContext.LoadBinaryFromFile(&gltfModel, &error, &warning, filename) : gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
 
 	std::vector<uint32_t> indexBuffer;
 	std::vector<Vertex> vertexBuffer;
 
+	stats = {};
 	if (fileLoaded) {
+		// On-disk size of the glTF file and all external buffers it references
+		stats.fileSize = fileSize(filename);
+		for (const tinygltf::Buffer& buffer : gltfModel.buffers) {
+			if (!buffer.uri.empty() && !tinygltf::IsDataURI(buffer.uri)) {
+				stats.fileSize += fileSize(path + "/" + buffer.uri);
+			}
+		}
+		decodeMeshoptBuffers(gltfModel);
 		if (!(fileLoadingFlags & FileLoadingFlags::DontLoadImages)) {
-			loadImages(gltfModel, device, transferQueue);
+			loadImages(gltfModel, device, transferQueue, fileLoadingFlags);
 		}
 		loadMaterials(gltfModel);
 		const tinygltf::Scene &scene = gltfModel.scenes[gltfModel.defaultScene > -1 ? gltfModel.defaultScene : 0];
+		loadedMeshes.clear();
+		primitiveExtractions.clear();
+		extractedVertexCount = 0;
+		extractedIndexCount = 0;
 		for (size_t i = 0; i < scene.nodes.size(); i++) {
-			const tinygltf::Node node = gltfModel.nodes[scene.nodes[i]];
-			loadNode(nullptr, node, scene.nodes[i], gltfModel, indexBuffer, vertexBuffer, scale);
+			const tinygltf::Node &node = gltfModel.nodes[scene.nodes[i]];
+			loadNode(nullptr, node, scene.nodes[i], gltfModel, scale);
 		}
+		loadedMeshes.clear();
+		extractPrimitives(gltfModel, vertexBuffer, indexBuffer);
 		if (gltfModel.animations.size() > 0) {
 			loadAnimations(gltfModel);
 		}
@@ -1245,10 +1737,15 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		const bool preMultiplyColor = fileLoadingFlags & FileLoadingFlags::PreMultiplyVertexColors;
 		const bool flipY = fileLoadingFlags & FileLoadingFlags::FlipY;
 		const bool flipUV = fileLoadingFlags & FileLoadingFlags::FlipUV;
+		// Vertices shared by multiple nodes must only be processed once
+		std::unordered_set<uint32_t> processedVertices;
 		for (Node* node : linearNodes) {
 			if (node->mesh) {
 				const glm::mat4 localMatrix = node->getMatrix();
 				for (Primitive* primitive : node->mesh->primitives) {
+					if (!processedVertices.insert(primitive->firstVertex).second) {
+						continue;
+					}
 					for (uint32_t i = 0; i < primitive->vertexCount; i++) {
 						Vertex& vertex = vertexBuffer[primitive->firstVertex + i];
 						// Pre-transform vertex positions by node-hierarchy
@@ -1275,6 +1772,10 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		}
 	}
 
+	if (fileLoadingFlags & FileLoadingFlags::GenerateLODs) {
+		generateLODs(vertexBuffer, indexBuffer);
+	}
+
 	for (auto& extension : gltfModel.extensionsUsed) {
 		if (extension == "KHR_materials_pbrSpecularGlossiness") {
 			std::cout << "Required extension: " << extension;
@@ -1286,6 +1787,28 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 	size_t indexBufferSize = indexBuffer.size() * sizeof(uint32_t);
 	indices.count = static_cast<uint32_t>(indexBuffer.size());
 	vertices.count = static_cast<uint32_t>(vertexBuffer.size());
+	stats.vertexBufferSize = vertexBufferSize;
+	stats.indexBufferSize = indexBufferSize;
+	stats.unsharedVertexBufferSize += vertexBufferSize;
+	stats.unsharedIndexBufferSize += indexBufferSize;
+	stats.loadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+
+	// Group mesh nodes by the glTF mesh they reference for instanced drawing
+	instanceGroups.clear();
+	if (!(fileLoadingFlags & FileLoadingFlags::PreTransformVertices)) {
+		std::unordered_map<int32_t, size_t> groupIndices;
+		for (Node* node : linearNodes) {
+			if (!node->mesh) {
+				continue;
+			}
+			auto it = groupIndices.find(node->mesh->index);
+			if (it == groupIndices.end()) {
+				it = groupIndices.emplace(node->mesh->index, instanceGroups.size()).first;
+				instanceGroups.push_back({ .mesh = node->mesh });
+			}
+			instanceGroups[it->second].nodes.push_back(node);
+		}
+	}
 
 	assert((vertexBufferSize > 0) && (indexBufferSize > 0));
 
@@ -1346,56 +1869,30 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 	vkDestroyBuffer(device->logicalDevice, indexStaging.buffer, nullptr);
 	vkFreeMemory(device->logicalDevice, indexStaging.memory, nullptr);
 
+	if (fileLoadingFlags & FileLoadingFlags::KeepGeometry) {
+		vertexData = std::move(vertexBuffer);
+		indexData = std::move(indexBuffer);
+	}
+
 	getSceneDimensions();
 
 	// Setup descriptors
-	uint32_t uboCount{ 0 };
-	uint32_t imageCount{ 0 };
-	for (auto& node : linearNodes) {
-		if (node->mesh) {
-			uboCount++;
-		}
-	}
-	for (auto& material : materials) {
-		if (material.baseColorTexture != nullptr) {
-			imageCount++;
-		}
-	}
-	std::vector<VkDescriptorPoolSize> poolSizes = {
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uboCount },
-	};
-	if (imageCount > 0) {
-		if (descriptorBindingFlags & DescriptorBindingFlags::ImageBaseColor) {
-			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount });
-		}
-		if (descriptorBindingFlags & DescriptorBindingFlags::ImageNormalMap) {
-			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount });
-		}
-	}
-	VkDescriptorPoolCreateInfo descriptorPoolCI{
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-		.maxSets = uboCount + imageCount,
-		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
-		.pPoolSizes = poolSizes.data()
-	};
-	VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolCI, nullptr, &descriptorPool));
+	// Sets are allocated from pools that grow on demand, so no need to count materials up front
+	// The model has a single set for the node buffer, all other sets contain up to two images
+	descriptorAllocator.create(device->logicalDevice, 64, { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f }, { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f } });
 
-	// Descriptors for per-node uniform buffers
+	// Descriptor for the node buffer shared by all mesh nodes
 	{
-		// Layout is global, so only create if it hasn't already been created before
+		// Layout is global, so only request it if it hasn't already been set before
 		if (descriptorSetLayoutUbo == VK_NULL_HANDLE) {
-			VkDescriptorSetLayoutBinding setLayoutBinding{ .binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_VERTEX_BIT };		
-			VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO, .bindingCount = 1, .pBindings = &setLayoutBinding };
-			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayoutCI, nullptr, &descriptorSetLayoutUbo));
-		}
-		for (auto node : nodes) {
-			prepareNodeDescriptor(node, descriptorSetLayoutUbo);
+			descriptorSetLayoutUbo = vks::descriptorLayoutCache.get(device->logicalDevice, { { .binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_VERTEX_BIT } });
 		}
+		prepareNodeBuffer(nodeBufferFrameCount);
 	}
 
 	// Descriptors for per-material images
 	{
-		// Layout is global, so only create if it hasn't already been created before
+		// Layout is global, so only request it if it hasn't already been set before
 		if (descriptorSetLayoutImage == VK_NULL_HANDLE) {
 			std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
 			if (descriptorBindingFlags & DescriptorBindingFlags::ImageBaseColor) {
@@ -1404,16 +1901,11 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 			if (descriptorBindingFlags & DescriptorBindingFlags::ImageNormalMap) {
 				setLayoutBindings.push_back({ .binding = static_cast<uint32_t>(setLayoutBindings.size()), .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT });
 			}
-			VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{
-				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-				.bindingCount = static_cast<uint32_t>(setLayoutBindings.size()),
-				.pBindings = setLayoutBindings.data(),
-			};
-			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayoutCI, nullptr, &descriptorSetLayoutImage));
+			descriptorSetLayoutImage = vks::descriptorLayoutCache.get(device->logicalDevice, setLayoutBindings);
 		}
 		for (auto& material : materials) {
 			if (material.baseColorTexture != nullptr) {
-				material.createDescriptorSet(descriptorPool, vkglTF::descriptorSetLayoutImage, descriptorBindingFlags);
+				material.createDescriptorSet(descriptorAllocator, vkglTF::descriptorSetLayoutImage, descriptorBindingFlags);
 			}
 		}
 	}
@@ -1427,7 +1919,7 @@ void vkglTF::Model::bindBuffers(VkCommandBuffer commandBuffer)
 	buffersBound = true;
 }
 
-void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
+void vkglTF::Model::drawNodePrimitives(Node* node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
 {
 	if (node->mesh) {
 		for (Primitive* primitive : node->mesh->primitives) {
@@ -1450,6 +1942,11 @@ void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t
 			}
 		}
 	}
+}
+
+void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
+{
+	drawNodePrimitives(node, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
 	for (auto& child : node->children) {
 		drawNode(child, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
 	}
@@ -1498,6 +1995,275 @@ void vkglTF::Model::getSceneDimensions()
 	dimensions.radius = glm::distance(dimensions.min, dimensions.max) / 2.0f;
 }
 
+void vkglTF::Model::buildDrawList(const glm::vec3& viewPos)
+{
+	auto tStart = std::chrono::high_resolution_clock::now();
+	drawItems.clear();
+	drawList.clear();
+	for (Node* node : linearNodes) {
+		if (!node->mesh || !node->visible) {
+			continue;
+		}
+		const glm::mat4 matrix = node->getMatrix();
+		for (Primitive* primitive : node->mesh->primitives) {
+			const Material& material = primitive->material;
+			vks::DrawList::Bucket bucket = vks::DrawList::Bucket::Opaque;
+			if (material.alphaMode == Material::ALPHAMODE_MASK) {
+				bucket = vks::DrawList::Bucket::AlphaMask;
+			} else if (material.alphaMode == Material::ALPHAMODE_BLEND) {
+				bucket = vks::DrawList::Bucket::AlphaBlend;
+			}
+			const float depth = glm::distance(viewPos, glm::vec3(matrix * glm::vec4(primitive->dimensions.center, 1.0f)));
+			// The pipeline is selected per bucket by the caller, so draws within a bucket are only grouped by material
+			const uint64_t key = vks::DrawList::makeKey(bucket, 0, static_cast<uint32_t>(&material - materials.data()), depth);
+			drawList.add(key, static_cast<uint32_t>(drawItems.size()));
+			drawItems.push_back({ node, primitive });
+		}
+	}
+	drawList.sort();
+	stats.drawListTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+}
+
+void vkglTF::Model::drawSorted(VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet, const std::function<void(VkCommandBuffer commandBuffer, vks::DrawList::Bucket bucket)>& bindBucket)
+{
+	if (!buffersBound) {
+		const VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+	const uint32_t bucketFlags = renderFlags & (RenderFlags::RenderOpaqueNodes | RenderFlags::RenderAlphaMaskedNodes | RenderFlags::RenderAlphaBlendedNodes);
+	const std::array<std::pair<vks::DrawList::Bucket, uint32_t>, 3> buckets = { {
+		{ vks::DrawList::Bucket::Opaque, RenderFlags::RenderOpaqueNodes },
+		{ vks::DrawList::Bucket::AlphaMask, RenderFlags::RenderAlphaMaskedNodes },
+		{ vks::DrawList::Bucket::AlphaBlend, RenderFlags::RenderAlphaBlendedNodes }
+	} };
+	stats.drawListDraws = 0;
+	stats.drawListBinds = 0;
+	VkDescriptorSet boundSet = VK_NULL_HANDLE;
+	for (const auto& [bucket, flag] : buckets) {
+		if (bucketFlags != 0 && !(bucketFlags & flag)) {
+			continue;
+		}
+		const auto [first, last] = drawList.range(bucket);
+		if (first == last) {
+			continue;
+		}
+		if (bindBucket) {
+			bindBucket(commandBuffer, bucket);
+			// A new pipeline may come with a different layout, so the material set has to be bound again
+			boundSet = VK_NULL_HANDLE;
+		}
+		for (size_t i = first; i < last; i++) {
+			const Primitive* primitive = drawItems[drawList.entries[i].item].primitive;
+			if ((renderFlags & RenderFlags::BindImages) && (primitive->material.descriptorSet != boundSet)) {
+				boundSet = primitive->material.descriptorSet;
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &boundSet, 0, nullptr);
+				stats.drawListBinds++;
+			}
+			vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+			stats.drawListDraws++;
+		}
+	}
+}
+
+void vkglTF::Model::destroyParallelDraw()
+{
+	// Finish outstanding jobs before the pools go away
+	if (parallelDraw.threadPool) {
+		parallelDraw.threadPool->wait();
+	}
+	for (auto& partition : parallelDraw.partitions) {
+		// Destroying the pool also frees its command buffers
+		vkDestroyCommandPool(device->logicalDevice, partition.commandPool, nullptr);
+	}
+	parallelDraw.partitions.clear();
+}
+
+void vkglTF::Model::prepareParallelDraw(uint32_t threadCount, uint32_t frameCount, uint32_t queueFamilyIndex)
+{
+	destroyParallelDraw();
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	threadCount = std::clamp(threadCount, 1u, std::max(static_cast<uint32_t>(meshNodes.size()), 1u));
+
+	if (!parallelDraw.threadPool || parallelDraw.threadPool->threads.size() != threadCount) {
+		parallelDraw.threadPool = std::make_shared<vks::ThreadPool>();
+		parallelDraw.threadPool->setThreadCount(threadCount);
+	}
+
+	// Split the mesh nodes into contiguous ranges with roughly the same number of primitives
+	uint32_t primitiveCount = 0;
+	for (Node* node : meshNodes) {
+		primitiveCount += static_cast<uint32_t>(node->mesh->primitives.size());
+	}
+	parallelDraw.partitions.resize(threadCount);
+	uint32_t partitionIndex = 0;
+	uint32_t assignedPrimitives = 0;
+	for (Node* node : meshNodes) {
+		while (partitionIndex + 1 < threadCount && assignedPrimitives >= (static_cast<uint64_t>(primitiveCount) * (partitionIndex + 1)) / threadCount) {
+			partitionIndex++;
+		}
+		parallelDraw.partitions[partitionIndex].nodes.push_back(node);
+		assignedPrimitives += static_cast<uint32_t>(node->mesh->primitives.size());
+	}
+
+	for (auto& partition : parallelDraw.partitions) {
+		VkCommandPoolCreateInfo commandPoolCI = vks::initializers::commandPoolCreateInfo();
+		commandPoolCI.queueFamilyIndex = queueFamilyIndex;
+		// Partitions are re-recorded individually
+		commandPoolCI.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		VK_CHECK_RESULT(vkCreateCommandPool(device->logicalDevice, &commandPoolCI, nullptr, &partition.commandPool));
+		partition.commandBuffers.resize(frameCount);
+		VkCommandBufferAllocateInfo commandBufferAI = vks::initializers::commandBufferAllocateInfo(partition.commandPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, frameCount);
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(device->logicalDevice, &commandBufferAI, partition.commandBuffers.data()));
+		partition.recordedKeys.assign(frameCount, 0);
+		partition.empty.assign(frameCount, true);
+	}
+}
+
+void vkglTF::Model::drawParallel(VkCommandBuffer commandBuffer, const ParallelDrawInfo& info)
+{
+	assert(!parallelDraw.partitions.empty());
+	auto tStart = std::chrono::high_resolution_clock::now();
+
+	// Everything the recorded commands depend on besides the node visibility
+	uint64_t baseKey = ResourceCache::hash(&info.stateKey, sizeof(info.stateKey));
+	baseKey = ResourceCache::hash(&info.renderFlags, sizeof(info.renderFlags), baseKey);
+	baseKey = ResourceCache::hash(&info.pipelineLayout, sizeof(info.pipelineLayout), baseKey);
+	baseKey = ResourceCache::hash(&info.bindImageSet, sizeof(info.bindImageSet), baseKey);
+	baseKey = ResourceCache::hash(&info.inheritanceInfo.renderPass, sizeof(VkRenderPass), baseKey);
+	baseKey = ResourceCache::hash(&info.inheritanceInfo.subpass, sizeof(uint32_t), baseKey);
+
+	stats.parallelDrawRecorded = 0;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(parallelDraw.partitions.size()); i++) {
+		ParallelDraw::Partition& partition = parallelDraw.partitions[i];
+		uint64_t key = baseKey;
+		bool empty = true;
+		for (Node* node : partition.nodes) {
+			key = ResourceCache::hash(&node->visible, sizeof(bool), key);
+			empty &= !node->visible;
+		}
+		// Zero marks command buffers that haven't been recorded yet
+		key |= 1;
+		if (partition.recordedKeys[info.frameIndex] == key) {
+			continue;
+		}
+		partition.recordedKeys[info.frameIndex] = key;
+		partition.empty[info.frameIndex] = empty;
+		if (empty) {
+			continue;
+		}
+		stats.parallelDrawRecorded++;
+		parallelDraw.threadPool->threads[i]->addJob([this, &partition, &info] {
+			VkCommandBuffer secondary = partition.commandBuffers[info.frameIndex];
+			VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::commandBufferBeginInfo();
+			commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			commandBufferBeginInfo.pInheritanceInfo = &info.inheritanceInfo;
+			VK_CHECK_RESULT(vkBeginCommandBuffer(secondary, &commandBufferBeginInfo));
+			if (info.beginCommands) {
+				info.beginCommands(secondary);
+			}
+			for (Node* node : partition.nodes) {
+				if (!node->visible) {
+					continue;
+				}
+				if (info.nodeCommands) {
+					info.nodeCommands(secondary, node);
+				} else {
+					drawNodePrimitives(node, secondary, info.renderFlags, info.pipelineLayout, info.bindImageSet);
+				}
+			}
+			VK_CHECK_RESULT(vkEndCommandBuffer(secondary));
+		});
+	}
+	parallelDraw.threadPool->wait();
+
+	std::vector<VkCommandBuffer> secondaries;
+	for (auto& partition : parallelDraw.partitions) {
+		if (!partition.empty[info.frameIndex]) {
+			secondaries.push_back(partition.commandBuffers[info.frameIndex]);
+		}
+	}
+	if (!secondaries.empty()) {
+		vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+	}
+	stats.parallelDrawTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+}
+
+void vkglTF::Model::buildBVH()
+{
+	auto tStart = std::chrono::high_resolution_clock::now();
+	bvhItems.clear();
+	std::vector<vks::AABB> bounds;
+	for (Node* node : linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		const glm::mat4 matrix = node->getMatrix();
+		for (Primitive* primitive : node->mesh->primitives) {
+			bvhItems.push_back({ node, primitive });
+			bounds.push_back(vks::AABB{ primitive->dimensions.min, primitive->dimensions.max }.transform(matrix));
+		}
+	}
+	bvh.build(bounds);
+	stats.bvhBuildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+}
+
+void vkglTF::Model::refitBVH()
+{
+	if (bvh.empty()) {
+		return;
+	}
+	auto tStart = std::chrono::high_resolution_clock::now();
+	// Primitives are stored in node order, so each node's matrix only needs to be calculated once
+	Node* node = nullptr;
+	glm::mat4 matrix;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(bvhItems.size()); i++) {
+		if (bvhItems[i].node != node) {
+			node = bvhItems[i].node;
+			matrix = node->getMatrix();
+		}
+		const vks::AABB bounds = vks::AABB{ bvhItems[i].primitive->dimensions.min, bvhItems[i].primitive->dimensions.max }.transform(matrix);
+		const vks::AABB& current = bvh.itemBounds[i];
+		if (bounds.min != current.min || bounds.max != current.max) {
+			bvh.update(i, bounds);
+		}
+	}
+	bvh.refit();
+	// Refitting keeps the topology, once nodes have moved far from where they were at build time a rebuild is cheaper than traversing the degraded tree
+	if (bvh.cost() > bvhRebuildFactor * bvh.buildCost) {
+		bvh.build(bvh.itemBounds);
+		stats.bvhRebuilds++;
+	}
+	stats.bvhRefitTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+}
+
+void vkglTF::Model::cullNodes(const vks::Frustum& frustum)
+{
+	auto tStart = std::chrono::high_resolution_clock::now();
+	std::vector<uint32_t> visibleItems;
+	visibleItems.reserve(bvhItems.size());
+	bvh.queryFrustum(frustum, visibleItems);
+	for (BVHItem& item : bvhItems) {
+		item.node->visible = false;
+	}
+	for (uint32_t index : visibleItems) {
+		bvhItems[index].node->visible = true;
+	}
+	stats.bvhQueryTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+}
+
+vkglTF::Node* vkglTF::Model::pickNode(const glm::vec3& origin, const glm::vec3& direction, float* distance)
+{
+	float hitDistance;
+	const uint32_t item = bvh.queryRay(origin, direction, hitDistance);
+	if (distance) {
+		*distance = hitDistance;
+	}
+	return (item != UINT32_MAX) ? bvhItems[item].node : nullptr;
+}
+
 void vkglTF::Model::updateAnimation(uint32_t index, float time)
 {
 	if (index > static_cast<uint32_t>(animations.size()) - 1) {
@@ -1552,6 +2318,7 @@ void vkglTF::Model::updateAnimation(uint32_t index, float time)
 		for (auto &node : nodes) {
 			node->update();
 		}
+		refitBVH();
 	}
 }
 
@@ -1593,26 +2360,87 @@ vkglTF::Node* vkglTF::Model::nodeFromName(const std::string name) {
 	return nullptr;
 }
 
-void vkglTF::Model::prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout) {
-	if (node->mesh) {
-		VkDescriptorSetAllocateInfo descriptorSetAllocInfo{
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-			.descriptorPool = descriptorPool,
-			.descriptorSetCount = 1,
-			.pSetLayouts = &descriptorSetLayout
-		};
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &node->mesh->uniformBuffer.descriptorSet));
-		VkWriteDescriptorSet writeDescriptorSet{
-			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = node->mesh->uniformBuffer.descriptorSet,
-			.dstBinding = 0,
-			.descriptorCount = 1,
-			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			.pBufferInfo = &node->mesh->uniformBuffer.descriptor
-		};
-		vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+void vkglTF::Model::prepareNodeBuffer(uint32_t frameCount)
+{
+	meshNodes.clear();
+	bool skinned = false;
+	for (auto node : linearNodes) {
+		if (node->mesh) {
+			node->mesh->nodeDataIndex = static_cast<uint32_t>(meshNodes.size());
+			meshNodes.push_back(node);
+			skinned |= (node->skin != nullptr);
+		}
 	}
-	for (auto& child : node->children) {
-		prepareNodeDescriptor(child, descriptorSetLayout);
+	// Only skinned models need the joint matrices, for all others a node's slot just holds the matrix
+	nodeBuffer.dataSize = skinned ? sizeof(Mesh::UniformBlock) : sizeof(glm::mat4);
+	const VkDeviceSize alignment = device->properties.limits.minUniformBufferOffsetAlignment;
+	nodeBuffer.stride = (alignment > 0) ? (nodeBuffer.dataSize + alignment - 1) & ~(alignment - 1) : nodeBuffer.dataSize;
+	nodeBuffer.frameCount = frameCount;
+	nodeBuffer.buffer.destroy();
+	const VkDeviceSize bufferSize = std::max(static_cast<VkDeviceSize>(meshNodes.size()), VkDeviceSize(1)) * nodeBuffer.stride * frameCount;
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &nodeBuffer.buffer, bufferSize));
+	VK_CHECK_RESULT(nodeBuffer.buffer.map());
+	for (uint32_t i = 0; i < frameCount; i++) {
+		updateNodeBuffer(i);
+	}
+
+	// The descriptor covers a single node, the node and frame are selected with the dynamic offset at bind time
+	if (nodeBuffer.descriptorSet == VK_NULL_HANDLE) {
+		nodeBuffer.descriptorSet = descriptorAllocator.allocate(descriptorSetLayoutUbo);
+	}
+	VkDescriptorBufferInfo bufferInfo{ nodeBuffer.buffer.buffer, 0, nodeBuffer.dataSize };
+	VkWriteDescriptorSet writeDescriptorSet{
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = nodeBuffer.descriptorSet,
+		.dstBinding = 0,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		.pBufferInfo = &bufferInfo
+	};
+	vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+}
+
+void vkglTF::Model::updateNodeBuffer(uint32_t frameIndex)
+{
+	assert(frameIndex < nodeBuffer.frameCount);
+	uint8_t* dst = static_cast<uint8_t*>(nodeBuffer.buffer.mapped) + frameIndex * meshNodes.size() * nodeBuffer.stride;
+	for (auto node : meshNodes) {
+		memcpy(dst, &node->mesh->uniformBlock, nodeBuffer.dataSize);
+		dst += nodeBuffer.stride;
+	}
+}
+
+uint32_t vkglTF::Model::getNodeDataOffset(const Node* node, uint32_t frameIndex) const
+{
+	return static_cast<uint32_t>((frameIndex * meshNodes.size() + node->mesh->nodeDataIndex) * nodeBuffer.stride);
+}
+
+void vkglTF::Model::prepareInstances(uint32_t frameCount)
+{
+	assert(!(fileLoadingFlags & FileLoadingFlags::PreTransformVertices));
+	for (auto& buffer : instanceBuffers) {
+		buffer.destroy();
+	}
+	instanceBuffers.resize(frameCount);
+	const VkDeviceSize bufferSize = std::max(stats.meshNodes, 1u) * sizeof(glm::mat4);
+	for (auto& buffer : instanceBuffers) {
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer, bufferSize));
+		VK_CHECK_RESULT(buffer.map());
+	}
+}
+
+void vkglTF::Model::updateInstances(uint32_t frameIndex)
+{
+	// Visible nodes of a group are written back to back, so each group's primitives can be drawn with a single instanced draw
+	glm::mat4* instanceMatrices = static_cast<glm::mat4*>(instanceBuffers[frameIndex].mapped);
+	uint32_t instanceIndex = 0;
+	for (auto& group : instanceGroups) {
+		group.firstInstance = instanceIndex;
+		for (Node* node : group.nodes) {
+			if (node->visible) {
+				instanceMatrices[instanceIndex++] = node->getMatrix();
+			}
+		}
+		group.instanceCount = instanceIndex - group.firstInstance;
 	}
 }
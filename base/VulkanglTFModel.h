@@ -19,9 +19,19 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
 
 #include "vulkan/vulkan.h"
+#include "VulkanBindlessTable.h"
+#include "VulkanBVH.h"
+#include "VulkanDrawList.h"
+#include "VulkanDescriptorAllocator.h"
 #include "VulkanDevice.h"
+#include "VulkanTextureProcessor.h"
+#include "threadpool.hpp"
 
 #include <ktx.h>
 #include <ktxvulkan.h>
@@ -53,6 +63,23 @@ namespace vkglTF
 	extern VkDescriptorSetLayout descriptorSetLayoutUbo;
 	extern VkMemoryPropertyFlags memoryPropertyFlags;
 	extern uint32_t descriptorBindingFlags;
+	// Number of frames in flight the node buffers are created for, matches maxConcurrentFrames of the example base class
+	extern uint32_t nodeBufferFrameCount;
+	// Number of threads used to decode, extract and simplify the geometry of glTF primitives, zero uses all hardware threads and one runs everything on the calling thread
+	extern uint32_t extractionThreadCount;
+	// Shader directory of the selected shading language (set from VulkanExampleBase::getShadersPath, GLSL if empty), used for the compute shaders of the texture processor
+	extern std::string shadersPath;
+
+	// Settings for generating LOD chains with FileLoadingFlags::GenerateLODs
+	struct LODSettings {
+		// Maximum number of levels including the full detail level
+		uint32_t levelCount{ 4 };
+		// Target triangle count of each level relative to the previous one
+		float reduction{ 0.5f };
+		// Maximum error of a single level relative to the radius of the primitive
+		float maxError{ 0.05f };
+	};
+	extern LODSettings lodSettings;
 
 	struct Node;
 
@@ -71,11 +98,65 @@ namespace vkglTF
 		VkDescriptorImageInfo descriptor;
 		VkSampler sampler;
 		uint32_t index;
+		// Key of the shared resource cache entry that owns the image, zero if the texture owns its resources
+		uint64_t cacheKey = 0;
+		// Index into the bindless table, only valid if the table was active when the descriptor was updated
+		uint32_t bindlessIndex = vks::BindlessTable::invalidIndex;
 		void updateDescriptor();
 		void destroy();
-		void fromglTfImage(tinygltf::Image& gltfimage, std::string path, vks::VulkanDevice* device, VkQueue copyQueue);
+		void fromglTfImage(tinygltf::Image& gltfimage, std::string path, vks::VulkanDevice* device, VkQueue copyQueue, vks::TextureProcessor* textureProcessor = nullptr, vks::TextureProcessor::Compression compression = vks::TextureProcessor::Compression::None);
+	};
+
+	/*
+		Process-wide cache for images and samplers shared by all glTF models
+		Images are keyed by a hash of their encoded contents, samplers by a hash of their create info
+		Entries are reference counted and destroyed once the last texture referencing them has been destroyed
+	*/
+	class ResourceCache {
+	public:
+		struct Statistics {
+			uint32_t imageRequests = 0;
+			uint32_t imageHits = 0;
+			uint32_t samplerRequests = 0;
+			uint32_t samplerHits = 0;
+			// Device memory that didn't have to be allocated thanks to cache hits
+			VkDeviceSize bytesSaved = 0;
+		} stats;
+
+		/** @brief FNV-1a hash, can be chained by passing the previous hash as the seed */
+		static uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+		/** @brief Returns true if an image with the given key is cached */
+		bool containsImage(uint64_t key);
+		/** @brief Fills the texture with the cached image and sampler for the given key and increments their reference counts, returns false on a cache miss */
+		bool acquireImage(uint64_t key, Texture& texture);
+		/** @brief Hands ownership of the texture's image and sampler to the cache */
+		void addImage(uint64_t key, Texture& texture);
+		/** @brief Returns a sampler matching the create info, creating it if required */
+		VkSampler acquireSampler(VkDevice device, const VkSamplerCreateInfo& createInfo);
+		void release(VkDevice device, Texture& texture);
+		void releaseSampler(VkDevice device, VkSampler sampler);
+	private:
+		struct ImageEntry {
+			VkImage image;
+			VkDeviceMemory memory;
+			VkImageView view;
+			VkImageLayout layout;
+			VkSampler sampler;
+			uint32_t width, height, mipLevels;
+			VkDeviceSize size;
+			uint32_t refCount;
+		};
+		struct SamplerEntry {
+			VkSampler sampler;
+			uint32_t refCount;
+		};
+		std::unordered_map<uint64_t, ImageEntry> images;
+		std::unordered_map<uint64_t, SamplerEntry> samplers;
+		std::mutex mutex;
 	};
 
+	extern ResourceCache resourceCache;
+
 	/*
 		glTF material class
 	*/
@@ -99,7 +180,7 @@ namespace vkglTF
 		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
 
 		Material(vks::VulkanDevice* device) : device(device) {};
-		void createDescriptorSet(VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags);
+		void createDescriptorSet(vks::DescriptorAllocator& descriptorAllocator, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags);
 	};
 
 	/*
@@ -120,7 +201,18 @@ namespace vkglTF
 			float radius;
 		} dimensions;
 
+		// Level of detail chain stored in the model's index buffer, lods[0] is the full detail primitive, only filled for models loaded with GenerateLODs
+		struct LOD {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			// Deviation from the full detail primitive in the units of the vertex positions
+			float error;
+		};
+		std::vector<LOD> lods;
+
 		void setDimensions(glm::vec3 min, glm::vec3 max);
+		/** @brief Returns the coarsest level whose error projects to at most maxPixelError pixels, projectionScale is viewportHeight / (2 * tan(fovY / 2)) */
+		uint32_t selectLOD(float distance, float projectionScale, float maxPixelError) const;
 		Primitive(uint32_t firstIndex, uint32_t indexCount, Material& material) : firstIndex(firstIndex), indexCount(indexCount), material(material) {};
 	};
 
@@ -132,20 +224,17 @@ namespace vkglTF
 
 		std::vector<Primitive*> primitives;
 		std::string name;
+		// Index of the glTF mesh, nodes referencing the same glTF mesh share its vertices and indices (unless vertices are pre-transformed)
+		int32_t index{ -1 };
 
-		struct UniformBuffer {
-			VkBuffer buffer;
-			VkDeviceMemory memory;
-			VkDescriptorBufferInfo descriptor;
-			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-			void* mapped;
-		} uniformBuffer;
-
+		// Layout of a node's slot in the model's node buffer, nodes without a skin only use the matrix
 		struct UniformBlock {
 			glm::mat4 matrix;
 			glm::mat4 jointMatrix[64]{};
 			float jointcount{ 0 };
 		} uniformBlock;
+		// Slot of the node in the model's node buffer
+		uint32_t nodeDataIndex{ 0 };
 
 		Mesh(vks::VulkanDevice* device, glm::mat4 matrix);
 		~Mesh();
@@ -176,6 +265,8 @@ namespace vkglTF
 		glm::vec3 translation{};
 		glm::vec3 scale{ 1.0f };
 		glm::quat rotation{};
+		// Only visible nodes are written to the instance buffers
+		bool visible{ true };
 		glm::mat4 localMatrix();
 		glm::mat4 getMatrix();
 		void update();
@@ -232,6 +323,10 @@ namespace vkglTF
 		static VkVertexInputBindingDescription inputBindingDescription(uint32_t binding);
 		static VkVertexInputAttributeDescription inputAttributeDescription(uint32_t binding, uint32_t location, VertexComponent component);
 		static std::vector<VkVertexInputAttributeDescription> inputAttributeDescriptions(uint32_t binding, const std::vector<VertexComponent> components);
+		/** @brief Per-instance binding for the model's instance buffers */
+		static VkVertexInputBindingDescription instanceInputBindingDescription(uint32_t binding);
+		/** @brief Attributes for the instance matrix, which takes up four consecutive locations starting at firstLocation */
+		static std::vector<VkVertexInputAttributeDescription> instanceInputAttributeDescriptions(uint32_t binding, uint32_t firstLocation);
 		/** @brief Returns the default pipeline vertex input state create info structure for the requested vertex components */
 		static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const std::vector<VertexComponent> components);
 	};
@@ -242,7 +337,15 @@ namespace vkglTF
 		PreMultiplyVertexColors = 0x00000002,
 		FlipY = 0x00000004,
 		DontLoadImages = 0x00000008,
-		FlipUV = 0x00000010
+		FlipUV = 0x00000010,
+		// Generate mip chains for PNG/JPEG images with a single compute dispatch instead of image blits
+		GenerateMipsCompute = 0x00000020,
+		// Compress PNG/JPEG images to BC1 (opaque) or BC7 (with alpha) at load time, implies GenerateMipsCompute
+		CompressTextures = 0x00000040,
+		// Generate a simplified LOD chain for every primitive (see lodSettings and Primitive::lods)
+		GenerateLODs = 0x00000080,
+		// Keep the vertex and index data on the host after uploading (see Model::vertexData and Model::indexData)
+		KeepGeometry = 0x00000100
 	};
 
 	enum RenderFlags {
@@ -252,6 +355,27 @@ namespace vkglTF
 		RenderAlphaBlendedNodes = 0x00000008
 	};
 
+	/*
+		Parameters for recording a model's draws into secondary command buffers with Model::drawParallel
+	*/
+	struct ParallelDrawInfo {
+		uint32_t frameIndex{ 0 };
+		// Render pass the secondary command buffers are executed in, chain a VkCommandBufferInheritanceRenderingInfo for dynamic rendering
+		// Leave the framebuffer at VK_NULL_HANDLE, so recorded command buffers can be reused with any framebuffer (e.g. all swapchain images) compatible with the render pass
+		VkCommandBufferInheritanceInfo inheritanceInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+		// Called at the start of each secondary command buffer, state isn't inherited from the primary so this has to set the pipeline, viewport, scissor, descriptor sets and vertex/index buffers
+		std::function<void(VkCommandBuffer commandBuffer)> beginCommands;
+		// Records the commands for a single visible mesh node, if not set the node's primitives are drawn the same way as with Model::draw
+		// Called from the worker threads, so this must not modify shared state
+		std::function<void(VkCommandBuffer commandBuffer, Node* node)> nodeCommands;
+		uint32_t renderFlags{ 0 };
+		VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
+		uint32_t bindImageSet{ 1 };
+		// Command buffers recorded earlier for the same frame index are reused if node visibility and all of the above stayed the same
+		// Anything else that changes the recorded commands (e.g. the viewport size or pipeline used in beginCommands) has to change this key
+		uint64_t stateKey{ 0 };
+	};
+
 	/*
 		glTF model loading and rendering class
 	*/
@@ -260,9 +384,31 @@ namespace vkglTF
 		vkglTF::Texture* getTexture(uint32_t index);
 		vkglTF::Texture emptyTexture;
 		void createEmptyTexture(VkQueue transferQueue);
+		// First mesh created for each glTF mesh while loading, other nodes referencing the same glTF mesh reuse its primitives
+		std::unordered_map<int32_t, Mesh*> loadedMeshes;
+		// Primitives whose geometry still needs to be extracted from the glTF buffers, the offsets are assigned while loading the nodes
+		struct PrimitiveExtraction {
+			const tinygltf::Primitive* source;
+			const Primitive* target;
+		};
+		std::vector<PrimitiveExtraction> primitiveExtractions;
+		uint32_t extractedVertexCount{ 0 };
+		uint32_t extractedIndexCount{ 0 };
+		/** @brief Creates the primitives of a glTF mesh loaded for the first time and queues their geometry for extraction */
+		void loadPrimitives(const tinygltf::Mesh& mesh, Mesh* newMesh, const tinygltf::Model& model);
+		/** @brief Decodes all buffer views compressed with EXT_meshopt_compression in place, so they can be read like uncompressed views */
+		void decodeMeshoptBuffers(tinygltf::Model& gltfModel);
+		/** @brief Simplifies every primitive into a chain of LODs that are appended to the index buffer */
+		void generateLODs(const std::vector<Vertex>& vertexBuffer, std::vector<uint32_t>& indexBuffer);
+		/** @brief Sizes the vertex and index buffers for all pending primitives and extracts their geometry on multiple threads */
+		void extractPrimitives(const tinygltf::Model& model, std::vector<Vertex>& vertexBuffer, std::vector<uint32_t>& indexBuffer);
+		/** @brief Draws the primitives of a single node without descending into its children */
+		void drawNodePrimitives(Node* node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet);
+		void destroyParallelDraw();
 	public:
 		vks::VulkanDevice* device;
-		VkDescriptorPool descriptorPool;
+		// Pools grow on demand, so they don't need to be sized for the model's nodes and materials
+		vks::DescriptorAllocator descriptorAllocator;
 
 		struct Vertices {
 			int count;
@@ -274,10 +420,108 @@ namespace vkglTF
 			VkBuffer buffer;
 			VkDeviceMemory memory;
 		} indices;
+		// Host copies of the vertex and index buffers, only filled for models loaded with FileLoadingFlags::KeepGeometry
+		std::vector<Vertex> vertexData;
+		std::vector<uint32_t> indexData;
 
 		std::vector<Node*> nodes;
 		std::vector<Node*> linearNodes;
 
+		// All mesh nodes that reference the same glTF mesh, these can be drawn with a single instanced draw per primitive
+		struct InstanceGroup {
+			Mesh* mesh{ nullptr };
+			std::vector<Node*> nodes;
+			// Range of the group's visible nodes in the instance buffer, set by updateInstances
+			uint32_t firstInstance{ 0 };
+			uint32_t instanceCount{ 0 };
+		};
+		std::vector<InstanceGroup> instanceGroups;
+		// World matrices of the visible mesh nodes ordered by instance group, one buffer per frame in flight
+		std::vector<vks::Buffer> instanceBuffers;
+
+		// Matrices (and joint matrices for skinned models) of all mesh nodes in a single buffer, with one region per frame in flight
+		// Nodes are selected with a dynamic offset into the model's single node descriptor set (see getNodeDataOffset)
+		struct NodeBuffer {
+			vks::Buffer buffer;
+			VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+			// Size of the data written for each node, the full uniform block for skinned models and just the matrix otherwise
+			VkDeviceSize dataSize{ 0 };
+			// Size of a node's slot, aligned to the device's minimum uniform buffer offset alignment
+			VkDeviceSize stride{ 0 };
+			uint32_t frameCount{ 0 };
+		} nodeBuffer;
+		std::vector<Node*> meshNodes;
+
+		// Bounding volume hierarchy over the world space bounds of all primitives of mesh nodes, see buildBVH
+		// Skinned primitives use their bind pose bounds
+		struct BVHItem {
+			Node* node;
+			Primitive* primitive;
+		};
+		std::vector<BVHItem> bvhItems;
+		vks::BVH bvh;
+
+		// Primitives of all visible mesh nodes, the sorted draw list refers to them by index, see buildDrawList
+		struct DrawItem {
+			Node* node;
+			Primitive* primitive;
+		};
+		std::vector<DrawItem> drawItems;
+		vks::DrawList drawList;
+
+		// Mesh nodes split into one partition per worker thread for drawParallel, see prepareParallelDraw
+		struct ParallelDraw {
+			struct Partition {
+				std::vector<Node*> nodes;
+				// Command pools can only be used by one thread at a time, so every partition has its own
+				VkCommandPool commandPool{ VK_NULL_HANDLE };
+				// One secondary command buffer per frame in flight and the state it was last recorded with (zero if it hasn't been recorded yet)
+				std::vector<VkCommandBuffer> commandBuffers;
+				std::vector<uint64_t> recordedKeys;
+				// Set if the last recording contained no visible nodes
+				std::vector<bool> empty;
+			};
+			std::vector<Partition> partitions;
+			// Shared so the model stays copyable, one thread per partition
+			std::shared_ptr<vks::ThreadPool> threadPool;
+		} parallelDraw;
+
+		struct Statistics {
+			uint32_t meshNodes{ 0 };
+			uint32_t uniqueMeshes{ 0 };
+			VkDeviceSize vertexBufferSize{ 0 };
+			VkDeviceSize indexBufferSize{ 0 };
+			// Buffer sizes if the geometry had been extracted for every node
+			VkDeviceSize unsharedVertexBufferSize{ 0 };
+			VkDeviceSize unsharedIndexBufferSize{ 0 };
+			// Time spent in loadFromFile and in the parallel geometry extraction in milliseconds
+			double loadTime{ 0.0 };
+			double extractionTime{ 0.0 };
+			uint32_t extractionThreads{ 0 };
+			// Size of the glTF file and its external buffers
+			size_t fileSize{ 0 };
+			// Buffer views compressed with EXT_meshopt_compression, sizes before and after decoding
+			size_t compressedSize{ 0 };
+			size_t decodedSize{ 0 };
+			double decodeTime{ 0.0 };
+			// Indices added for generated LODs, time spent generating them and primitives whose chain was already cached
+			uint32_t lodIndexCount{ 0 };
+			double lodTime{ 0.0 };
+			uint32_t lodCacheHits{ 0 };
+			// Time spent in the last BVH build, refit and frustum query in milliseconds, refits that had to rebuild the tree
+			double bvhBuildTime{ 0.0 };
+			double bvhRefitTime{ 0.0 };
+			double bvhQueryTime{ 0.0 };
+			uint32_t bvhRebuilds{ 0 };
+			// Time spent in the last drawParallel call in milliseconds and how many partitions had to be re-recorded
+			double parallelDrawTime{ 0.0 };
+			uint32_t parallelDrawRecorded{ 0 };
+			// Time spent gathering and sorting the draw list in milliseconds, draws and descriptor set binds issued by the last drawSorted call
+			double drawListTime{ 0.0 };
+			uint32_t drawListDraws{ 0 };
+			uint32_t drawListBinds{ 0 };
+		} stats;
+
 		std::vector<Skin*> skins;
 
 		std::vector<Texture> textures;
@@ -292,15 +536,19 @@ namespace vkglTF
 			float radius;
 		} dimensions;
 
+		// Resource cache keys for the images of the glTF file being loaded, filled by the image loader
+		std::vector<uint64_t> imageCacheKeys;
+		uint32_t fileLoadingFlags = 0;
+
 		bool metallicRoughnessWorkflow = true;
 		bool buffersBound = false;
 		std::string path;
 
 		Model() {};
 		~Model();
-		void loadNode(vkglTF::Node* parent, const tinygltf::Node& node, uint32_t nodeIndex, const tinygltf::Model& model, std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer, float globalscale);
+		void loadNode(vkglTF::Node* parent, const tinygltf::Node& node, uint32_t nodeIndex, const tinygltf::Model& model, float globalscale);
 		void loadSkins(tinygltf::Model& gltfModel);
-		void loadImages(tinygltf::Model& gltfModel, vks::VulkanDevice* device, VkQueue transferQueue);
+		void loadImages(tinygltf::Model& gltfModel, vks::VulkanDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags = vkglTF::FileLoadingFlags::None);
 		void loadMaterials(tinygltf::Model& gltfModel);
 		void loadAnimations(tinygltf::Model& gltfModel);
 		void loadFromFile(std::string filename, vks::VulkanDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags = vkglTF::FileLoadingFlags::None, float scale = 1.0f);
@@ -313,6 +561,42 @@ namespace vkglTF
 		Node* findNode(Node* parent, uint32_t index);
 		Node* nodeFromIndex(uint32_t index);
 		Node* nodeFromName(const std::string name);
-		void prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout);
+		/** @brief Creates the model's node buffer and its descriptor set, every frame's region is initialized with the current node matrices */
+		void prepareNodeBuffer(uint32_t frameCount);
+		/** @brief Writes the matrices of all mesh nodes to the frame's region of the node buffer in a single pass */
+		void updateNodeBuffer(uint32_t frameIndex);
+		/** @brief Dynamic offset for binding the node's data from the node descriptor set */
+		uint32_t getNodeDataOffset(const Node* node, uint32_t frameIndex) const;
+		/** @brief Creates the per-frame instance buffers, instancing is not available for models loaded with PreTransformVertices */
+		void prepareInstances(uint32_t frameCount);
+		/** @brief Writes the world matrices of all visible mesh nodes to the frame's instance buffer and updates the instance ranges of the groups */
+		void updateInstances(uint32_t frameIndex);
+		/**
+		* @brief Creates the per-thread command pools and secondary command buffers for drawParallel
+		* @param threadCount Number of partitions and worker threads, 0 uses one per hardware thread
+		* @note Must not be called while command buffers of an earlier preparation are still in use
+		*/
+		void prepareParallelDraw(uint32_t threadCount, uint32_t frameCount, uint32_t queueFamilyIndex);
+		/**
+		* @brief Records the draws of all visible mesh nodes on the worker threads and executes them in the given primary command buffer
+		* @note The primary command buffer's render pass (or rendering) has to be started with secondary command buffer contents
+		*/
+		void drawParallel(VkCommandBuffer commandBuffer, const ParallelDrawInfo& info);
+		/** @brief Gathers the primitives of all visible mesh nodes in a single traversal and sorts them by alpha mode, material and distance to viewPos */
+		void buildDrawList(const glm::vec3& viewPos);
+		/**
+		* @brief Draws the sorted draw list, material descriptor sets are only bound when they change
+		* @param renderFlags Selects the buckets to draw (all if none of the Render*Nodes flags are set), these are drawn in the order opaque, alpha masked, alpha blended
+		* @param bindBucket Optional, called before the first draw of each bucket, e.g. to bind the pipeline for that bucket
+		*/
+		void drawSorted(VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1, const std::function<void(VkCommandBuffer commandBuffer, vks::DrawList::Bucket bucket)>& bindBucket = nullptr);
+		/** @brief Builds the BVH over all primitives of mesh nodes, once built it's refit by updateAnimation */
+		void buildBVH();
+		/** @brief Updates the bounds of all BVH items from the current node matrices, the tree is rebuilt if refitting degraded it too much */
+		void refitBVH();
+		/** @brief Sets the visibility of all mesh nodes with a BVH frustum query, a node is visible if the bounds of one of its primitives are */
+		void cullNodes(const vks::Frustum& frustum);
+		/** @brief Returns the node with the closest primitive bounds hit by the ray or nullptr, requires the BVH */
+		Node* pickNode(const glm::vec3& origin, const glm::vec3& direction, float* distance = nullptr);
 	};
 }
\ No newline at end of file
@@ -27,7 +27,17 @@ namespace vks
 		uint32_t warmup = 1;   // Default to 1 sec of warm-up
 		uint32_t duration = 10;
 		std::vector<double> frameTimes;
+		// Input to present latencies (only collected if latency measurement is enabled)
+		std::vector<double> latencies;
+		std::string latencySource = "";
+		// Sample specific results measured while benchmarking (e.g. comparisons between techniques), written after the frame times
+		struct SampleResults {
+			std::string header;
+			std::vector<std::string> rows;
+		};
+		std::vector<SampleResults> sampleResults;
 		std::string filename = "";
+		bool measuring = false;
 
 		double runtime = 0.0;
 		uint32_t frameCount = 0;
@@ -58,6 +68,7 @@ namespace vks
 
 			// Benchmark phase
 			{
+				measuring = true;
 				while (runtime < (duration * 1000.0)) {
 					auto tStart = std::chrono::high_resolution_clock::now();
 					renderFunc();
@@ -73,9 +84,42 @@ namespace vks
 				std::cout << "runtime: " << (runtime / 1000.0) << "\n";
 				std::cout << "frames : " << frameCount << "\n";
 				std::cout << "fps    : " << frameCount / (runtime / 1000.0) << "\n";
+				if (!latencies.empty()) {
+					std::cout << "latency: " << latencyAverage() << " ms avg, " << latencyPercentile(0.99) << " ms 99th percentile (" << latencySource << ")" << "\n";
+				}
+				measuring = false;
 			}
 		}
 
+		/** @brief Adds an input to present latency sample, samples taken during warmup are ignored */
+		void addLatency(double latency) {
+			if (measuring) {
+				latencies.push_back(latency);
+			}
+		}
+
+		/** @brief Adds a row of comma separated values to the sample results table with the given header */
+		void addResult(const std::string& header, const std::string& row) {
+			auto it = std::find_if(sampleResults.begin(), sampleResults.end(), [&header](const SampleResults& results) { return results.header == header; });
+			if (it == sampleResults.end()) {
+				it = sampleResults.insert(sampleResults.end(), { header, {} });
+			}
+			it->rows.push_back(row);
+		}
+
+		double latencyAverage() const {
+			return latencies.empty() ? 0.0 : std::accumulate(latencies.begin(), latencies.end(), 0.0) / (double)latencies.size();
+		}
+
+		double latencyPercentile(double percentile) const {
+			if (latencies.empty()) {
+				return 0.0;
+			}
+			std::vector<double> sorted(latencies);
+			std::sort(sorted.begin(), sorted.end());
+			return sorted[std::min(sorted.size() - 1, (size_t)(percentile * (double)sorted.size()))];
+		}
+
 		void saveResults() {
 			std::ofstream result(filename, std::ios::out);
 			if (result.is_open()) {
@@ -84,6 +128,11 @@ namespace vks
 				result << "device,driverversion,duration (ms),frames,fps" << "\n";
 				result << deviceProps.deviceName << "," << deviceProps.driverVersion << "," << runtime << "," << frameCount << "," << frameCount / (runtime / 1000.0) << "\n";
 
+				if (!latencies.empty()) {
+					result << "\n" << "latency source,samples,avg (ms),min (ms),max (ms),99th percentile (ms)" << "\n";
+					result << latencySource << "," << latencies.size() << "," << latencyAverage() << "," << *std::min_element(latencies.begin(), latencies.end()) << "," << *std::max_element(latencies.begin(), latencies.end()) << "," << latencyPercentile(0.99) << "\n";
+				}
+
 				if (outputFrameTimes) {
 					result << "\n" << "frame,ms" << "\n";
 					for (size_t i = 0; i < frameTimes.size(); i++) {
@@ -98,6 +147,13 @@ namespace vks
 					std::cout << "\n";
 				}
 
+				for (auto& sampleResult : sampleResults) {
+					result << "\n" << sampleResult.header << "\n";
+					for (auto& row : sampleResult.rows) {
+						result << row << "\n";
+					}
+				}
+
 				result.flush();
 #if defined(_WIN32)
 				FreeConsole();
@@ -0,0 +1,53 @@
+/*
+* Simple parallel for loop used by the CPU side asset processing (mesh extraction, BVH builds, KTX2 transcoding)
+*
+* Copyright (C) 2026 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace vks
+{
+	/**
+	* @brief Runs func(index) for all indices in [0, count) distributed over a number of threads, the calling thread is one of them
+	* @param threadCount Maximum number of threads to use, 0 uses the hardware concurrency
+	* @return Number of threads used
+	*/
+	template<typename F>
+	uint32_t parallelFor(size_t count, uint32_t threadCount, F&& func)
+	{
+		if (threadCount == 0) {
+			threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+		threadCount = static_cast<uint32_t>(std::clamp<size_t>(count, 1, threadCount));
+		if (threadCount == 1) {
+			for (size_t i = 0; i < count; i++) {
+				func(i);
+			}
+			return 1;
+		}
+		std::atomic<size_t> next{ 0 };
+		auto worker = [&]() {
+			for (size_t i = next++; i < count; i = next++) {
+				func(i);
+			}
+		};
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for (uint32_t i = 1; i < threadCount; i++) {
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		return threadCount;
+	}
+}
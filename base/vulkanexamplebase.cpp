@@ -7,6 +7,7 @@
 */
 
 #include "vulkanexamplebase.h"
+#include "VulkanglTFModel.h"
 
 #if defined(VK_EXAMPLE_XCODE_GENERATED)
 #if (defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT))
@@ -25,32 +26,35 @@ std::vector<const char*> VulkanExampleBase::args;
 
 VkResult VulkanExampleBase::createInstance()
 {
-	std::vector<const char*> instanceExtensions = { VK_KHR_SURFACE_EXTENSION_NAME };
+	std::vector<const char*> instanceExtensions{};
 
-	// Enable surface extensions depending on os
+	// Enable surface extensions depending on os (not required when rendering offscreen)
+	if (!settings.offscreen) {
+		instanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 #if defined(_WIN32)
-	instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_ANDROID_KHR)
-	instanceExtensions.push_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
 #elif defined(_DIRECT2DISPLAY)
-	instanceExtensions.push_back(VK_KHR_DISPLAY_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_DISPLAY_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_DIRECTFB_EXT)
-	instanceExtensions.push_back(VK_EXT_DIRECTFB_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_EXT_DIRECTFB_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
-	instanceExtensions.push_back(VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
-	instanceExtensions.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_IOS_MVK)
-	instanceExtensions.push_back(VK_MVK_IOS_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_MVK_IOS_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_MACOS_MVK)
-	instanceExtensions.push_back(VK_MVK_MACOS_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_MVK_MACOS_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_METAL_EXT)
-	instanceExtensions.push_back(VK_EXT_METAL_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_EXT_METAL_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_HEADLESS_EXT)
-	instanceExtensions.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_SCREEN_QNX)
-	instanceExtensions.push_back(VK_QNX_SCREEN_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_QNX_SCREEN_SURFACE_EXTENSION_NAME);
 #endif
+	}
 
 	// Get extensions supported by the instance and store for later use
 	uint32_t extCount = 0;
@@ -67,6 +71,12 @@ VkResult VulkanExampleBase::createInstance()
 		}
 	}
 
+	// Offscreen rendering doesn't present, but samples still use the present layout for their color images
+	// That layout is part of VK_KHR_swapchain, so we enable it (and the surface extension it depends on) if available
+	if (settings.offscreen && (std::find(supportedInstanceExtensions.begin(), supportedInstanceExtensions.end(), VK_KHR_SURFACE_EXTENSION_NAME) != supportedInstanceExtensions.end())) {
+		instanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+	}
+
 #if (defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT))
 	// SRS - When running on iOS/macOS with MoltenVK, enable VK_KHR_get_physical_device_properties2 if not already enabled by the example (required by VK_KHR_portability_subset)
 	if (std::find(enabledInstanceExtensions.begin(), enabledInstanceExtensions.end(), VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == enabledInstanceExtensions.end())
@@ -89,6 +99,11 @@ VkResult VulkanExampleBase::createInstance()
 		}
 	}
 
+	// Querying and enabling the present id/wait features used for latency measurement requires Vulkan 1.1
+	if (settings.measureLatency && (apiVersion < VK_API_VERSION_1_1)) {
+		apiVersion = VK_API_VERSION_1_1;
+	}
+
 	// Shaders generated by Slang require a certain SPIR-V environment that can't be satisfied by Vulkan 1.0, so we need to expliclity up that to at least 1.1 and enable some required extensions
 	if (shaderDir == "slang") {
 		if (apiVersion < VK_API_VERSION_1_1) {
@@ -234,6 +249,7 @@ void VulkanExampleBase::prepare()
 	setupRenderPass();
 	createPipelineCache();
 	setupFrameBuffer();
+	vkglTF::shadersPath = getShadersPath();
 	settings.overlay = settings.overlay && (!benchmark.active);
 	if (settings.overlay) {
 		ui.maxConcurrentFrames = maxConcurrentFrames;
@@ -257,19 +273,22 @@ VkPipelineShaderStageCreateInfo VulkanExampleBase::loadShader(std::string fileNa
 		.stage = stage,
 		.pName = "main"
 	};
-#if defined(VK_USE_PLATFORM_ANDROID_KHR)
-	shaderStage.module = vks::tools::loadShader(androidApp->activity->assetManager, fileName.c_str(), device);
-#else
-	shaderStage.module = vks::tools::loadShader(fileName.c_str(), device);
-#endif
+	// Pipelines loading the same file (or a file with the same contents) share a single module
+	bool created{ false };
+	shaderStage.module = shaderModuleCache.load(fileName, &created);
 	assert(shaderStage.module != VK_NULL_HANDLE);
-	shaderModules.push_back(shaderStage.module);
+	if (created) {
+		shaderModules.push_back(shaderStage.module);
+	}
 	return shaderStage;
 }
 
 void VulkanExampleBase::nextFrame()
 {
 	auto tStart = std::chrono::high_resolution_clock::now();
+	if (startupTime == 0.0) {
+		startupTime = std::chrono::duration<double, std::milli>(tStart - tStartup).count();
+	}
 	render();
 	frameCounter++;
 	auto tEnd = std::chrono::high_resolution_clock::now();
@@ -313,26 +332,35 @@ void VulkanExampleBase::renderLoop()
 #if !(defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT))
 	if (benchmark.active) {
 #if defined(VK_USE_PLATFORM_WAYLAND_KHR)
-		while (!configured)
+		while (!configured && !settings.offscreen)
 		{
 			if (wl_display_dispatch(display) == -1)
 				break;
 		}
-		while (wl_display_prepare_read(display) != 0)
+		while (!settings.offscreen && (wl_display_prepare_read(display) != 0))
 		{
 			if (wl_display_dispatch_pending(display) == -1)
 				break;
 		}
-		wl_display_flush(display);
-		wl_display_read_events(display);
-		if (wl_display_dispatch_pending(display) == -1)
-			return;
+		if (!settings.offscreen) {
+			wl_display_flush(display);
+			wl_display_read_events(display);
+			if (wl_display_dispatch_pending(display) == -1)
+				return;
+		}
 #endif
 		benchmark.run([=, this] { render(); }, vulkanDevice->properties);
 		vkDeviceWaitIdle(device);
 		if (!benchmark.filename.empty()) {
 			benchmark.saveResults();
 		}
+		if (settings.offscreen && !settings.offscreenReadbackFile.empty()) {
+			if (swapChain.saveOffscreenImage(settings.offscreenReadbackFile)) {
+				std::cout << "Last offscreen frame saved to \"" << settings.offscreenReadbackFile << "\"\n";
+			} else {
+				std::cerr << "Could not save offscreen frame to \"" << settings.offscreenReadbackFile << "\"\n";
+			}
+		}
 		return;
 	}
 #endif
@@ -667,11 +695,33 @@ void VulkanExampleBase::updateOverlay()
 	ImGui::TextUnformatted(deviceProperties.deviceName);
 	ImGui::Text("Shading language: %s", shaderDir.c_str());
 	ImGui::Text("%.2f ms/frame (%.1d fps)", (1000.0f / lastFPS), lastFPS);
+	if (settings.measureLatency) {
+		ImGui::Text("Latency: %.2f ms (%s)", latency.average, latency.presentWait ? "present wait" : "cpu");
+	}
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 	ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0.0f, 5.0f * ui.scale));
 #endif
 	ImGui::PushItemWidth(110.0f * ui.scale);
 	OnUpdateUIOverlay(&ui);
+	// Statistics for the resource cache shared by all glTF models, only shown if a sample actually uses it
+	const vkglTF::ResourceCache::Statistics& cacheStats = vkglTF::resourceCache.stats;
+	if ((cacheStats.imageRequests + cacheStats.samplerRequests > 0) && ui.header("glTF resource cache")) {
+		ImGui::Text("Images: %d/%d hits (%.0f%%)", cacheStats.imageHits, cacheStats.imageRequests, cacheStats.imageRequests > 0 ? 100.0f * cacheStats.imageHits / cacheStats.imageRequests : 0.0f);
+		ImGui::Text("Samplers: %d/%d hits (%.0f%%)", cacheStats.samplerHits, cacheStats.samplerRequests, cacheStats.samplerRequests > 0 ? 100.0f * cacheStats.samplerHits / cacheStats.samplerRequests : 0.0f);
+		ImGui::Text("Memory saved: %.2f MB", cacheStats.bytesSaved / (1024.0f * 1024.0f));
+	}
+	// Only shown if pipelines actually shared shader modules
+	const vks::ShaderModuleCache::Statistics& shaderStats = shaderModuleCache.stats;
+	if ((shaderStats.fileHits + shaderStats.contentHits > 0) && ui.header("Shader modules")) {
+		ImGui::Text("Modules: %d for %d requests", shaderStats.modules, shaderStats.requests);
+		ImGui::Text("Shared: %d by file, %d by contents", shaderStats.fileHits, shaderStats.contentHits);
+		ImGui::Text("Load time: %.2f ms", shaderStats.loadTime);
+		ImGui::Text("Startup time: %.0f ms", startupTime);
+	}
+	if (vks::bindlessTable.active() && ui.header("Bindless table")) {
+		ImGui::Text("Descriptors: %d/%d", vks::bindlessTable.stats.descriptors, vks::bindlessTable.stats.capacity);
+		ImGui::Text("Textures: %d", vks::bindlessTable.stats.references);
+	}
 	ImGui::PopItemWidth();
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 	ImGui::PopStyleVar();
@@ -707,6 +757,11 @@ void VulkanExampleBase::prepareFrame(bool waitForFence)
 		VK_CHECK_RESULT(vkWaitForFences(device, 1, &waitFences[currentBuffer], VK_TRUE, UINT64_MAX));
 		VK_CHECK_RESULT(vkResetFences(device, 1, &waitFences[currentBuffer]));
 	}
+	paceFrame();
+	if (settings.measureLatency) {
+		// This is the last point before the sample reads input (camera, ui) and updates its per-frame data for this frame
+		latency.inputTime = std::chrono::high_resolution_clock::now();
+	}
 	updateOverlay();
 	// Acquire the next image from the swap chain
 	VkResult result = swapChain.acquireNextImage(presentCompleteSemaphores[currentBuffer], currentImageIndex);
@@ -740,6 +795,16 @@ void VulkanExampleBase::submitFrame(bool skipQueueSubmit)
 		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, waitFences[currentBuffer]));
 	}
 
+	if (settings.offscreen) {
+		// There is no presentation engine, the offscreen ring consumes the render complete semaphore instead
+		VK_CHECK_RESULT(swapChain.submitOffscreen(currentImageIndex, renderCompleteSemaphores[currentImageIndex]));
+		if (settings.measureLatency) {
+			addLatencySample(latency.inputTime);
+		}
+		currentBuffer = (currentBuffer + 1) % maxConcurrentFrames;
+		return;
+	}
+
 	VkPresentInfoKHR presentInfo{
 		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
 		.waitSemaphoreCount = 1,
@@ -748,7 +813,22 @@ void VulkanExampleBase::submitFrame(bool skipQueueSubmit)
 		.pSwapchains = &swapChain.swapChain,
 		.pImageIndices = &currentImageIndex
 	};
+	// With present id we can wait for the image to be actually displayed
+	VkPresentIdKHR presentId{ .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR, .swapchainCount = 1 };
+	if (latency.presentWait) {
+		latency.presentId++;
+		presentId.pPresentIds = &latency.presentId;
+		presentInfo.pNext = &presentId;
+	}
 	VkResult result = vkQueuePresentKHR(queue, &presentInfo);
+	if (settings.measureLatency) {
+		if (latency.presentWait) {
+			waitForPresentLatency(result);
+		} else {
+			// Fallback: Latency up to the point where the image has been handed to the presentation engine
+			addLatencySample(latency.inputTime);
+		}
+	}
 	// Recreate the swapchain if it's no longer compatible with the surface (OUT_OF_DATE) or no longer optimal for presentation (SUBOPTIMAL)
 	if ((result == VK_ERROR_OUT_OF_DATE_KHR) || (result == VK_SUBOPTIMAL_KHR)) {
 		windowResize();
@@ -782,6 +862,15 @@ VulkanExampleBase::VulkanExampleBase()
 	commandLineParser.add("benchmarkresultfile", { "-bf", "--benchfilename" }, 1, "Set file name for benchmark results");
 	commandLineParser.add("benchmarkresultframes", { "-bt", "--benchframetimes" }, 0, "Save frame times to benchmark results file");
 	commandLineParser.add("benchmarkframes", { "-bfs", "--benchmarkframes" }, 1, "Only render the given number of frames");
+#if !(defined(VK_USE_PLATFORM_ANDROID_KHR) || defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT))
+	commandLineParser.add("offscreen", { "-os", "--offscreen" }, 0, "Render to offscreen images instead of a window (no swapchain), runs in benchmark mode");
+	commandLineParser.add("offscreenreadback", { "-osr", "--offscreenreadback" }, 1, "Read back offscreen frames and save the last one to the given file (ppm)");
+#endif
+	commandLineParser.add("framesinflight", { "-fif", "--framesinflight" }, 1, "Set max. number of frames in flight (1.." + std::to_string(maxConcurrentFrames) + ")");
+	commandLineParser.add("swapchainimages", { "-si", "--swapchainimages" }, 1, "Set number of swapchain images to request");
+	commandLineParser.add("presentmode", { "-pm", "--presentmode" }, 1, "Select present mode (fifo, fiforelaxed, mailbox or immediate)");
+	commandLineParser.add("fpslimit", { "-fl", "--fpslimit" }, 1, "Limit frame rate to the given value");
+	commandLineParser.add("latency", { "-lt", "--latency" }, 0, "Measure input to present latency (uses VK_KHR_present_wait if available)");
 #if (!(defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT)))
 	commandLineParser.add("resourcepath", { "-rp", "--resourcepath" }, 1, "Set path for dir where assets and shaders folder is present");
 #endif
@@ -840,6 +929,38 @@ VulkanExampleBase::VulkanExampleBase()
 	if (commandLineParser.isSet("benchmarkframes")) {
 		benchmark.outputFrames = commandLineParser.getValueAsInt("benchmarkframes", benchmark.outputFrames);
 	}
+#if !(defined(VK_USE_PLATFORM_ANDROID_KHR) || defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT))
+	if (commandLineParser.isSet("offscreen")) {
+		// Without a window there is no way to interact with the sample, so offscreen rendering always runs the benchmark loop
+		settings.offscreen = true;
+		benchmark.active = true;
+		vks::tools::errorModeSilent = true;
+	}
+	if (commandLineParser.isSet("offscreenreadback")) {
+		settings.offscreenReadbackFile = commandLineParser.getValueAsString("offscreenreadback", "offscreen.ppm");
+	}
+#endif
+	if (commandLineParser.isSet("framesinflight")) {
+		settings.framesInFlight = std::clamp((uint32_t)commandLineParser.getValueAsInt("framesinflight", settings.framesInFlight), 1u, maxConcurrentFrames);
+	}
+	if (commandLineParser.isSet("swapchainimages")) {
+		settings.swapchainImages = commandLineParser.getValueAsInt("swapchainimages", 0);
+	}
+	if (commandLineParser.isSet("presentmode")) {
+		std::string value = commandLineParser.getValueAsString("presentmode", "");
+		if ((value != "fifo") && (value != "fiforelaxed") && (value != "mailbox") && (value != "immediate")) {
+			std::cerr << "Present mode must be one of 'fifo', 'fiforelaxed', 'mailbox' or 'immediate'\n";
+		}
+		else {
+			settings.presentMode = value;
+		}
+	}
+	if (commandLineParser.isSet("fpslimit")) {
+		settings.frameRateLimit = commandLineParser.getValueAsInt("fpslimit", 0);
+	}
+	if (commandLineParser.isSet("latency")) {
+		settings.measureLatency = true;
+	}
 #if (!(defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT)))
 	if(commandLineParser.isSet("resourcepath")) {
 		vks::tools::resourcePath = commandLineParser.getValueAsString("resourcepath", "");
@@ -906,9 +1027,13 @@ VulkanExampleBase::VulkanExampleBase()
 #elif defined(_DIRECT2DISPLAY)
 
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
-	initWaylandConnection();
+	if (!settings.offscreen) {
+		initWaylandConnection();
+	}
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
-	initxcbConnection();
+	if (!settings.offscreen) {
+		initxcbConnection();
+	}
 #endif
 
 #if defined(_WIN32)
@@ -955,6 +1080,8 @@ VulkanExampleBase::~VulkanExampleBase()
 	if (settings.overlay) {
 		ui.freeResources();
 	}
+	vks::bindlessTable.destroy();
+	vks::descriptorLayoutCache.destroy();
 	delete vulkanDevice;
 	if (settings.validation) {
 		vks::debug::freeDebugCallback(instance);
@@ -974,6 +1101,9 @@ VulkanExampleBase::~VulkanExampleBase()
 	if (dfb)
 		dfb->Release(dfb);
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
+	if (settings.offscreen) {
+		return;
+	}
 	xdg_toplevel_destroy(xdg_toplevel);
 	xdg_surface_destroy(xdg_surface);
 	wl_surface_destroy(surface);
@@ -988,8 +1118,10 @@ VulkanExampleBase::~VulkanExampleBase()
 	wl_registry_destroy(registry);
 	wl_display_disconnect(display);
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
-	xcb_destroy_window(connection, window);
-	xcb_disconnect(connection);
+	if (!settings.offscreen) {
+		xcb_destroy_window(connection, window);
+		xcb_disconnect(connection);
+	}
 #elif defined(VK_USE_PLATFORM_SCREEN_QNX)
 	screen_destroy_event(screen_event);
 	screen_destroy_window(screen_window);
@@ -999,6 +1131,13 @@ VulkanExampleBase::~VulkanExampleBase()
 
 bool VulkanExampleBase::initVulkan()
 {
+	tStartup = std::chrono::high_resolution_clock::now();
+
+	if (settings.offscreen && requiresSwapChain) {
+		vks::tools::exitFatal("\"" + title + "\" acquires and presents swapchain images itself and can't be run in offscreen mode", -1);
+		return false;
+	}
+
 	// Instead of checking for the command line switch, validation can be forced via a define
 #if defined(_VALIDATION)
 	this->settings.validation = true;
@@ -1088,13 +1227,28 @@ bool VulkanExampleBase::initVulkan()
 	// Derived examples can enable extensions based on the list of supported extensions read from the physical device
 	getEnabledExtensions();
 
-	result = vulkanDevice->createLogicalDevice(enabledFeatures, enabledDeviceExtensions, deviceCreatepNextChain);
+	if (settings.measureLatency) {
+		enableLatencyMeasurement();
+	}
+
+	const bool useSwapChain = !settings.offscreen || vulkanDevice->extensionSupported(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	result = vulkanDevice->createLogicalDevice(enabledFeatures, enabledDeviceExtensions, deviceCreatepNextChain, useSwapChain);
 	if (result != VK_SUCCESS) {
 		vks::tools::exitFatal("Could not create Vulkan device: \n" + vks::tools::errorString(result), result);
 		return false;
 	}
 	device = vulkanDevice->logicalDevice;
 
+	if (latency.presentWait) {
+		latency.vkWaitForPresentKHR = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+		latency.presentWait = (latency.vkWaitForPresentKHR != nullptr);
+	}
+	if (settings.measureLatency) {
+		benchmark.latencySource = latency.presentWait ? "present wait" : "cpu";
+	}
+
+	shaderModuleCache.create(device);
+
 	// Get a graphics queue from the device
 	vkGetDeviceQueue(device, vulkanDevice->queueFamilyIndices.graphics, 0, &queue);
 
@@ -1154,6 +1308,9 @@ void VulkanExampleBase::setupDPIAwareness()
 HWND VulkanExampleBase::setupWindow(HINSTANCE hinstance, WNDPROC wndproc)
 {
 	this->windowInstance = hinstance;
+	if (settings.offscreen) {
+		return nullptr;
+	}
 
 	WNDCLASSEX wndClass{
 		.cbSize = sizeof(WNDCLASSEX),
@@ -2423,6 +2580,9 @@ static const struct xdg_toplevel_listener xdg_toplevel_listener = {
 
 struct xdg_surface *VulkanExampleBase::setupWindow()
 {
+	if (settings.offscreen) {
+		return nullptr;
+	}
 	surface = wl_compositor_create_surface(compositor);
 	xdg_surface = xdg_wm_base_get_xdg_surface(shell, surface);
 
@@ -2453,6 +2613,9 @@ static inline xcb_intern_atom_reply_t* intern_atom_helper(xcb_connection_t *conn
 // Set up a window using XCB and request event types
 xcb_window_t VulkanExampleBase::setupWindow()
 {
+	if (settings.offscreen) {
+		return 0;
+	}
 	uint32_t value_mask, value_list[32];
 
 	window = xcb_generate_id(connection);
@@ -3064,7 +3227,7 @@ void VulkanExampleBase::setupRenderPass()
 			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+			.finalLayout = swapChain.presentLayout
 		},
 		// Depth attachment
 		VkAttachmentDescription{
@@ -3185,7 +3348,7 @@ void VulkanExampleBase::endDynamicRendering(VkCommandBuffer cmdBuffer)
 		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
 		0,
 		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		swapChain.presentLayout,
 		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
 		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
 		VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
@@ -3280,6 +3443,9 @@ void VulkanExampleBase::windowResized() {}
 
 void VulkanExampleBase::createSurface()
 {
+	if (settings.offscreen) {
+		return;
+	}
 #if defined(_WIN32)
 	swapChain.initSurface(windowInstance, window);
 #elif defined(VK_USE_PLATFORM_ANDROID_KHR)
@@ -3303,9 +3469,100 @@ void VulkanExampleBase::createSurface()
 
 void VulkanExampleBase::createSwapChain()
 {
+	if (settings.offscreen) {
+		swapChain.createOffscreen(width, height, vulkanDevice->queueFamilyIndices.graphics, queue, maxConcurrentFrames + 1, !settings.offscreenReadbackFile.empty());
+		return;
+	}
+	swapChain.desiredImageCount = settings.swapchainImages;
+	const std::unordered_map<std::string, VkPresentModeKHR> presentModes = {
+		{ "fifo", VK_PRESENT_MODE_FIFO_KHR },
+		{ "fiforelaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR },
+		{ "mailbox", VK_PRESENT_MODE_MAILBOX_KHR },
+		{ "immediate", VK_PRESENT_MODE_IMMEDIATE_KHR },
+	};
+	swapChain.desiredPresentMode = presentModes.contains(settings.presentMode) ? presentModes.at(settings.presentMode) : VK_PRESENT_MODE_MAX_ENUM_KHR;
 	swapChain.create(width, height, settings.vsync, settings.fullscreen);
 }
 
+void VulkanExampleBase::paceFrame()
+{
+	// Limit the number of frames queued on the GPU by waiting for the frame that was started framesInFlight frames ago
+	// Per-frame resources are still cycled through all maxConcurrentFrames slots, so samples don't need to be aware of this
+	if (settings.framesInFlight < maxConcurrentFrames) {
+		const uint32_t pacingFrame = (currentBuffer + maxConcurrentFrames - settings.framesInFlight) % maxConcurrentFrames;
+		VK_CHECK_RESULT(vkWaitForFences(device, 1, &waitFences[pacingFrame], VK_TRUE, UINT64_MAX));
+	}
+	if (settings.frameRateLimit == 0) {
+		return;
+	}
+	// Frame limiter: Sleep for the bulk of the remaining frame time and yield for the rest, as sleeping alone isn't precise enough on most platforms
+	const auto frameDuration = std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(1.0 / settings.frameRateLimit));
+	const auto target = frameLimiterTimestamp + frameDuration;
+	auto now = std::chrono::high_resolution_clock::now();
+	while (now < target) {
+		if (target - now > std::chrono::milliseconds(2)) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		} else {
+			std::this_thread::yield();
+		}
+		now = std::chrono::high_resolution_clock::now();
+	}
+	// Don't try to catch up if we fell behind by more than a frame
+	frameLimiterTimestamp = (now - target > frameDuration) ? now : target;
+}
+
+void VulkanExampleBase::enableLatencyMeasurement()
+{
+	if (settings.offscreen || !vulkanDevice->extensionSupported(VK_KHR_PRESENT_ID_EXTENSION_NAME) || !vulkanDevice->extensionSupported(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+		return;
+	}
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR };
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR, .pNext = &presentWaitFeatures };
+	VkPhysicalDeviceFeatures2 deviceFeatures2{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &presentIdFeatures };
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures2);
+	if (!presentIdFeatures.presentId || !presentWaitFeatures.presentWait) {
+		return;
+	}
+	// Prepend the feature structures to the (optional) chain set up by the sample
+	latency.presentIdFeatures.presentId = VK_TRUE;
+	latency.presentIdFeatures.pNext = &latency.presentWaitFeatures;
+	latency.presentWaitFeatures.presentWait = VK_TRUE;
+	latency.presentWaitFeatures.pNext = deviceCreatepNextChain;
+	deviceCreatepNextChain = &latency.presentIdFeatures;
+	enabledDeviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+	enabledDeviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+	latency.presentWait = true;
+}
+
+void VulkanExampleBase::waitForPresentLatency(VkResult presentResult)
+{
+	if ((presentResult != VK_SUCCESS) && (presentResult != VK_SUBOPTIMAL_KHR)) {
+		return;
+	}
+	// Wait right after queuing the present, so the sample is taken when the image is displayed
+	// Checking for completion later on (e.g. in the next frame) would add up to a frame of CPU time to the measured latency
+	// The timeout keeps a window that isn't being displayed (e.g. occluded) from stalling the render loop, such presents are not sampled
+	const uint64_t timeout{ 100 * 1000 * 1000 };
+	VkResult result = latency.vkWaitForPresentKHR(device, swapChain.swapChain, latency.presentId, timeout);
+	if ((result == VK_SUCCESS) || (result == VK_SUBOPTIMAL_KHR)) {
+		addLatencySample(latency.inputTime);
+	}
+}
+
+void VulkanExampleBase::addLatencySample(std::chrono::high_resolution_clock::time_point inputTime)
+{
+	const double value = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - inputTime).count();
+	benchmark.addLatency(value);
+	// Averaged over a few frames for display
+	latency.accumulated += value;
+	latency.sampleCount++;
+	if (latency.sampleCount >= 30) {
+		latency.average = (float)(latency.accumulated / latency.sampleCount);
+		latency.accumulated = 0.0;
+		latency.sampleCount = 0;
+	}
+}
+
 void VulkanExampleBase::OnUpdateUIOverlay(vks::UIOverlay *overlay) {}
 
 #if defined(_WIN32)
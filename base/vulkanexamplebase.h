@@ -44,6 +44,7 @@
 #include <ctime>
 #include <iostream>
 #include <chrono>
+#include <thread>
 #include <random>
 #include <algorithm>
 #include <sys/stat.h>
@@ -68,12 +69,15 @@
 #include "VulkanBuffer.h"
 #include "VulkanDevice.h"
 #include "VulkanTexture.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanShaderModuleCache.h"
 
 #include "VulkanInitializers.hpp"
 #include "camera.hpp"
 #include "benchmark.hpp"
 
-constexpr uint32_t maxConcurrentFrames{ 2 };
+// Number of per-frame resource sets (command buffers, uniform buffers, etc.), the number of frames actually in flight can be lowered at runtime (see Settings::framesInFlight)
+constexpr uint32_t maxConcurrentFrames{ 3 };
 
 class VulkanExampleBase
 {
@@ -92,7 +96,25 @@ private:
 	void createSwapChain();
 	void createCommandBuffers();
 	void destroyCommandBuffers();
+	void enableLatencyMeasurement();
+	void waitForPresentLatency(VkResult presentResult);
+	void addLatencySample(std::chrono::high_resolution_clock::time_point inputTime);
+	void paceFrame();
 	std::string shaderDir = "glsl";
+	// Input to present latency measurement, uses VK_KHR_present_id/VK_KHR_present_wait if available, CPU timestamps otherwise
+	struct {
+		bool presentWait{ false };
+		PFN_vkWaitForPresentKHR vkWaitForPresentKHR{ nullptr };
+		VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR };
+		VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR };
+		uint64_t presentId{ 0 };
+		std::chrono::high_resolution_clock::time_point inputTime{};
+		double accumulated{ 0.0 };
+		uint32_t sampleCount{ 0 };
+		float average{ 0.0f };
+	} latency;
+	// Start of the last frame, used by the frame limiter
+	std::chrono::high_resolution_clock::time_point frameLimiterTimestamp{};
 protected:
 	// Returns the path to the root of the glsl, hlsl or slang shader directory.
 	std::string getShadersPath() const;
@@ -101,6 +123,9 @@ protected:
 	uint32_t frameCounter = 0;
 	uint32_t lastFPS = 0;
 	std::chrono::time_point<std::chrono::high_resolution_clock> lastTimestamp, tPrevEnd;
+	// Time from the start of Vulkan initialization to the first frame, which includes loading assets and creating pipelines
+	std::chrono::time_point<std::chrono::high_resolution_clock> tStartup;
+	double startupTime{ 0.0 };
 	// Vulkan instance, stores all per-application states
 	VkInstance instance{ VK_NULL_HANDLE };
 	std::vector<std::string> supportedInstanceExtensions;
@@ -140,6 +165,8 @@ protected:
 	VkDescriptorPool descriptorPool{ VK_NULL_HANDLE };
 	// List of shader modules created (stored for cleanup)
 	std::vector<VkShaderModule> shaderModules;
+	// Files loaded via loadShader are mapped into memory and deduplicated, each module is only created once
+	vks::ShaderModuleCache shaderModuleCache;
 	// Pipeline cache object
 	VkPipelineCache pipelineCache{ VK_NULL_HANDLE };
 	// Wraps the swap chain to present images (framebuffers) to the windowing system
@@ -154,6 +181,8 @@ protected:
 	std::array<VkFence, maxConcurrentFrames> waitFences;
 
 	bool requiresStencil{ false };
+	// Set by samples that acquire and present swapchain images themselves, these can't be run in offscreen mode
+	bool requiresSwapChain{ false };
 public:
 	bool prepared = false;
 	bool resized = false;
@@ -181,6 +210,20 @@ public:
 		bool vsync = false;
 		/** @brief Enable UI overlay */
 		bool overlay = true;
+		/** @brief Render into an offscreen image ring instead of a swapchain (no window, no acquire/present), implies benchmark mode */
+		bool offscreen = false;
+		/** @brief If set, offscreen frames are read back to the host and the last one is stored to this file (PPM) */
+		std::string offscreenReadbackFile{};
+		/** @brief Max. number of frames the CPU may record ahead of the GPU (1..maxConcurrentFrames), lower values reduce latency at the cost of throughput */
+		uint32_t framesInFlight = 2;
+		/** @brief Number of swapchain images to request, 0 uses the default (minimum image count + 1) */
+		uint32_t swapchainImages = 0;
+		/** @brief Present mode (fifo, fiforelaxed, mailbox or immediate), empty to select based on v-sync */
+		std::string presentMode{};
+		/** @brief Limits the frame rate to the given value (0 = unlimited) */
+		uint32_t frameRateLimit = 0;
+		/** @brief Measure the latency from sampling input to presentation */
+		bool measureLatency = false;
 	} settings;
 
 	/** @brief State of gamepad input (only used on Android) */
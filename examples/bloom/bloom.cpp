@@ -8,6 +8,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanRenderGraph.h"
 
 
 // Offscreen frame buffer properties
@@ -89,14 +90,21 @@ public:
 	};
 	struct OffscreenPass {
 		int32_t width, height;
+		VkFormat depthFormat;
 		VkRenderPass renderPass;
 		VkSampler sampler;
 		std::array<FrameBuffer, 2> framebuffers;
 	} offscreenPass{};
 
+	// The passes are declared in a render graph that takes care of barriers and layout transitions and culls the offscreen passes if bloom is disabled
+	vks::RenderGraph renderGraph;
+	VkPhysicalDeviceVulkan13Features enabledFeatures13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
+
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Bloom (offscreen rendering)";
+		// The render graph uses synchronization2 if available
+		apiVersion = VK_API_VERSION_1_3;
 		timerSpeed *= 0.5f;
 		camera.type = Camera::CameraType::lookat;
 		camera.setPosition(glm::vec3(0.0f, 0.0f, -10.25f));
@@ -136,6 +144,20 @@ public:
 		}
 	}
 
+	virtual void getEnabledFeatures()
+	{
+		if (deviceProperties.apiVersion >= VK_API_VERSION_1_3) {
+			VkPhysicalDeviceVulkan13Features features13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
+			VkPhysicalDeviceFeatures2 deviceFeatures2{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &features13 };
+			vkGetPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures2);
+			if (features13.synchronization2) {
+				enabledFeatures13.synchronization2 = VK_TRUE;
+				deviceCreatepNextChain = &enabledFeatures13;
+				renderGraph.synchronization2 = true;
+			}
+		}
+	}
+
 	// Setup the offscreen framebuffer for rendering the mirrored scene
 	// The color attachment of this framebuffer will then be sampled from
 	void prepareOffscreenFramebuffer(FrameBuffer *frameBuf, VkFormat colorFormat, VkFormat depthFormat)
@@ -237,6 +259,7 @@ public:
 		VkFormat fbDepthFormat;
 		VkBool32 validDepthFormat = vks::tools::getSupportedDepthFormat(physicalDevice, &fbDepthFormat);
 		assert(validDepthFormat);
+		offscreenPass.depthFormat = fbDepthFormat;
 
 		// Create a separate render pass for the offscreen rendering as it may differ from the one used for scene rendering
 
@@ -248,8 +271,9 @@ public:
 		attchmentDescriptions[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		attchmentDescriptions[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		attchmentDescriptions[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attchmentDescriptions[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attchmentDescriptions[0].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		// Layout transitions are done by the render graph, so the attachments stay in their attachment layout for the whole render pass
+		attchmentDescriptions[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		attchmentDescriptions[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 		// Depth attachment
 		attchmentDescriptions[1].format = fbDepthFormat;
 		attchmentDescriptions[1].samples = VK_SAMPLE_COUNT_1_BIT;
@@ -257,7 +281,7 @@ public:
 		attchmentDescriptions[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		attchmentDescriptions[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		attchmentDescriptions[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attchmentDescriptions[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attchmentDescriptions[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 		attchmentDescriptions[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 		VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
@@ -269,42 +293,13 @@ public:
 		subpassDescription.pColorAttachments = &colorReference;
 		subpassDescription.pDepthStencilAttachment = &depthReference;
 
-		// Use subpass dependencies for layout transitions
-		std::array<VkSubpassDependency, 3> dependencies{};
-
-		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-		dependencies[0].dependencyFlags = 0;
-
-		dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[1].dstSubpass = 0;
-		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-		dependencies[2].srcSubpass = 0;
-		dependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[2].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[2].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-		// Create the actual renderpass
+		// No subpass dependencies, synchronization with the other passes is done with the barriers generated by the render graph
 		VkRenderPassCreateInfo renderPassInfo = {};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 		renderPassInfo.attachmentCount = static_cast<uint32_t>(attchmentDescriptions.size());
 		renderPassInfo.pAttachments = attchmentDescriptions.data();
 		renderPassInfo.subpassCount = 1;
 		renderPassInfo.pSubpasses = &subpassDescription;
-		renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
-		renderPassInfo.pDependencies = dependencies.data();
 
 		VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &offscreenPass.renderPass));
 
@@ -544,6 +539,30 @@ public:
 		prepared = true;
 	}
 
+	// Records one of the offscreen passes, both use the same render pass and only differ in the framebuffer and what's drawn
+	void drawOffscreenPass(VkCommandBuffer cmdBuffer, const FrameBuffer& frameBuffer, const std::function<void()>& draw)
+	{
+		VkClearValue clearValues[2]{};
+		clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderPass = offscreenPass.renderPass;
+		renderPassBeginInfo.framebuffer = frameBuffer.framebuffer;
+		renderPassBeginInfo.renderArea.extent.width = offscreenPass.width;
+		renderPassBeginInfo.renderArea.extent.height = offscreenPass.height;
+		renderPassBeginInfo.clearValueCount = 2;
+		renderPassBeginInfo.pClearValues = clearValues;
+
+		vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		VkViewport viewport = vks::initializers::viewport((float)offscreenPass.width, (float)offscreenPass.height, 0.0f, 1.0f);
+		vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+		VkRect2D scissor = vks::initializers::rect2D(offscreenPass.width, offscreenPass.height, 0, 0);
+		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+		draw();
+		vkCmdEndRenderPass(cmdBuffer);
+	}
+
 	void buildCommandBuffer()
 	{
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
@@ -556,66 +575,61 @@ public:
 		*/
 		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
 
-		if (bloom) {
-			VkClearValue clearValues[2]{};
-			clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
-			clearValues[1].depthStencil = { 1.0f, 0 };
-
-			VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
-			renderPassBeginInfo.renderPass = offscreenPass.renderPass;
-			renderPassBeginInfo.framebuffer = offscreenPass.framebuffers[0].framebuffer;
-			renderPassBeginInfo.renderArea.extent.width = offscreenPass.width;
-			renderPassBeginInfo.renderArea.extent.height = offscreenPass.height;
-			renderPassBeginInfo.clearValueCount = 2;
-			renderPassBeginInfo.pClearValues = clearValues;
-
-			VkViewport viewport = vks::initializers::viewport((float)offscreenPass.width, (float)offscreenPass.height, 0.0f, 1.0f);
-			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-			VkRect2D scissor = vks::initializers::rect2D(offscreenPass.width, offscreenPass.height, 0, 0);
-			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
-
-			/*
-				First render pass: Render glow parts of the model (separate mesh) to an offscreen frame buffer
-			*/
-
-			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.scene, 0, 1, &descriptorSets[currentBuffer].scene, 0, nullptr);
-			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.glowPass);
-
-			models.ufoGlow.draw(cmdBuffer);
-
-			vkCmdEndRenderPass(cmdBuffer);
-
-			/*
-				Second render pass: Vertical blur
-
-				Render contents of the first pass into a second framebuffer and apply a vertical blur
-				This is the first blur pass, the horizontal blur is applied when rendering on top of the scene
-			*/
-
-			renderPassBeginInfo.framebuffer = offscreenPass.framebuffers[1].framebuffer;
-
-			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.blur, 0, 1, &descriptorSets[currentBuffer].blurVert, 0, nullptr);
-			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.blurVert);
-			vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+		/*
+			The passes and the resources they access are declared in a render graph, which is rebuilt every frame
+			The graph derives the barriers and image layout transitions between the passes from these declarations
+			If bloom is disabled, the final pass doesn't read the blurred image and the two offscreen passes are culled
+		*/
+		renderGraph.reset();
 
-			vkCmdEndRenderPass(cmdBuffer);
+		VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VkImageSubresourceRange depthRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+		if (vks::tools::formatHasStencil(offscreenPass.depthFormat)) {
+			depthRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		std::array<vks::RenderGraph::Resource, 2> glowColor{}, glowDepth{};
+		for (size_t i = 0; i < offscreenPass.framebuffers.size(); i++) {
+			glowColor[i] = renderGraph.importImage("Glow color " + std::to_string(i), offscreenPass.framebuffers[i].color.image, colorRange);
+			glowDepth[i] = renderGraph.importImage("Glow depth " + std::to_string(i), offscreenPass.framebuffers[i].depth.image, depthRange);
 		}
 
 		/*
-			Note: Explicit synchronization is not required between the render pass, as this is done implicit via sub pass dependencies
+			First pass: Render glow parts of the model (separate mesh) to an offscreen frame buffer
 		*/
+		renderGraph.addPass("Glow", [this](VkCommandBuffer cmdBuffer) {
+			drawOffscreenPass(cmdBuffer, offscreenPass.framebuffers[0], [&]() {
+				vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.scene, 0, 1, &descriptorSets[currentBuffer].scene, 0, nullptr);
+				vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.glowPass);
+				models.ufoGlow.draw(cmdBuffer);
+			});
+		})
+			.write(glowColor[0], vks::RenderGraph::colorAttachment)
+			.write(glowDepth[0], vks::RenderGraph::depthStencilAttachment);
 
 		/*
-			Third render pass: Scene rendering with applied vertical blur
+			Second pass: Vertical blur
 
-			Renders the scene and the (vertically blurred) contents of the second framebuffer and apply a horizontal blur
+			Render contents of the first pass into a second framebuffer and apply a vertical blur
+			This is the first blur pass, the horizontal blur is applied when rendering on top of the scene
+		*/
+		renderGraph.addPass("Vertical blur", [this](VkCommandBuffer cmdBuffer) {
+			drawOffscreenPass(cmdBuffer, offscreenPass.framebuffers[1], [&]() {
+				vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.blur, 0, 1, &descriptorSets[currentBuffer].blurVert, 0, nullptr);
+				vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.blurVert);
+				vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+			});
+		})
+			.read(glowColor[0], vks::RenderGraph::sampledFragment)
+			.write(glowColor[1], vks::RenderGraph::colorAttachment)
+			.write(glowDepth[1], vks::RenderGraph::depthStencilAttachment);
+
+		/*
+			Third pass: Scene rendering with applied vertical blur
 
+			Renders the scene and the (vertically blurred) contents of the second framebuffer and apply a horizontal blur
+			This pass renders to the swapchain, so it's external to the graph and never culled
 		*/
-		{
+		vks::RenderGraph::Pass& scenePass = renderGraph.addPass("Scene", [this](VkCommandBuffer cmdBuffer) {
 			VkClearValue clearValues[2]{};
 			clearValues[0].color = defaultClearColor;
 			clearValues[1].depthStencil = { 1.0f, 0 };
@@ -654,9 +668,14 @@ public:
 			drawUI(cmdBuffer);
 
 			vkCmdEndRenderPass(cmdBuffer);
-
+		}).external();
+		if (bloom) {
+			scenePass.read(glowColor[1], vks::RenderGraph::sampledFragment);
 		}
 
+		renderGraph.compile();
+		renderGraph.execute(cmdBuffer);
+
 		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
 	}
 
@@ -676,6 +695,11 @@ public:
 			overlay->checkBox("Bloom", &bloom);
 			overlay->inputFloat("Scale", &ubos.blurParams.blurScale, 0.1f, 2);
 		}
+		if (overlay->header("Render graph")) {
+			overlay->text("Synchronization2: %s", renderGraph.synchronization2 ? "yes" : "no");
+			overlay->text("Passes: %d (%d culled)", renderGraph.stats.passes, renderGraph.stats.culledPasses);
+			overlay->text("Barriers: %d (%d image, %d buffer)", renderGraph.stats.barrierBatches, renderGraph.stats.imageBarriers, renderGraph.stats.bufferBarriers);
+		}
 	}
 };
 
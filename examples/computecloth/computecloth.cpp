@@ -3,6 +3,7 @@
 *
 * A compute shader updates a shader storage buffer that contains particles held together by springs and also does basic
 * collision detection against a sphere. This storage buffer is then used as the vertex input for the graphics part of the sample
+* The simulation runs on the compute queue via vks::AsyncCompute, so the step for the next frame can overlap with rendering the current frame
 *
 * Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
 *
@@ -11,6 +12,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanAsyncCompute.h"
 
 
 class VulkanExample : public VulkanExampleBase
@@ -19,10 +21,10 @@ public:
 	uint32_t readSet{ 0 };
 	uint32_t indexCount{ 0 };
 	bool simulateWind{ false };
-	// This will be set to true, if the device has a dedicated queue from a compute only queue family
-	// With such a queue graphics and compute workloads can run in parallel, but this also requires additional barriers (often called "async compute")
-	// These barriers will release and acquire the resources used in graphics and compute between the different queue families
-	bool dedicatedComputeQueue{ false };
+	// Submits the simulation steps on the compute queue (from a compute only queue family, if available)
+	// With such a queue graphics and compute workloads can run in parallel (often called "async compute"), the scheduler then also adds the barriers
+	// required to transfer the resources used in graphics and compute between the different queue families
+	vks::AsyncCompute asyncCompute;
 
 	vks::Texture2D textureCloth;
 	vkglTF::Model modelSphere;
@@ -44,7 +46,7 @@ public:
 	// We put the resource "types" into structs to make this sample easier to understand
 
 	// We use two buffers for our cloth simulation: One with the input cloth data and one for outputting updated values
-	// The compute pipeline will update the output buffer, and the graphics pipeline will it as a vertex buffer
+	// The compute pipeline will update the output buffer, the async compute scheduler copies it to the buffers the graphics pipeline uses as a vertex buffer
 	struct StorageBuffers {
 		vks::Buffer input;
 		vks::Buffer output;
@@ -72,15 +74,6 @@ public:
 	// Resources for the compute part of the example
 	// Number of compute command buffers: set to 1 for serialized processing or 2 for in-parallel with graphics queue
 	struct Compute {
-		struct ComputeSemaphores {
-			VkSemaphore ready{ VK_NULL_HANDLE };
-			VkSemaphore complete{ VK_NULL_HANDLE };
-		};
-		std::array<ComputeSemaphores, maxConcurrentFrames> semaphores{};
-		std::array<VkFence, maxConcurrentFrames> fences{};
-		VkQueue queue{ VK_NULL_HANDLE };
-		VkCommandPool commandPool{ VK_NULL_HANDLE };
-		std::array<VkCommandBuffer, maxConcurrentFrames> commandBuffers{};
 		VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
 		std::array<VkDescriptorSet, maxConcurrentFrames> descriptorSets{ VK_NULL_HANDLE };
 		VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
@@ -132,14 +125,7 @@ public:
 			vkDestroyPipelineLayout(device, compute.pipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(device, compute.descriptorSetLayout, nullptr);
 			vkDestroyPipeline(device, compute.pipeline, nullptr);
-			for (auto& fence : compute.fences) {
-				vkDestroyFence(device, fence, nullptr);
-			}
-			for (auto& semaphore : compute.semaphores) {
-				vkDestroySemaphore(device, semaphore.ready, nullptr);
-				vkDestroySemaphore(device, semaphore.complete, nullptr);
-			}
-			vkDestroyCommandPool(device, compute.commandPool, nullptr);
+			asyncCompute.destroy();
 
 			// SSBOs
 			storageBuffers.input.destroy();
@@ -162,31 +148,6 @@ public:
 		textureCloth.loadFromFile(getAssetPath() + "textures/vulkan_cloth_rgba.ktx", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, queue);
 	}
 
-	void addGraphicsToComputeBarriers(VkCommandBuffer commandBuffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask)
-	{
-		if (dedicatedComputeQueue) {
-			VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
-			bufferBarrier.srcAccessMask = srcAccessMask;
-			bufferBarrier.dstAccessMask = dstAccessMask;
-			bufferBarrier.srcQueueFamilyIndex = vulkanDevice->queueFamilyIndices.graphics;
-			bufferBarrier.dstQueueFamilyIndex = vulkanDevice->queueFamilyIndices.compute;
-			bufferBarrier.size = VK_WHOLE_SIZE;
-
-			std::vector<VkBufferMemoryBarrier> bufferBarriers;
-			bufferBarrier.buffer = storageBuffers.input.buffer;
-			bufferBarriers.push_back(bufferBarrier);
-			bufferBarrier.buffer = storageBuffers.output.buffer;
-			bufferBarriers.push_back(bufferBarrier);
-			vkCmdPipelineBarrier(commandBuffer,
-				srcStageMask,
-				dstStageMask,
-				VK_FLAGS_NONE,
-				0, nullptr,
-				static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
-				0, nullptr);
-		}
-	}
-
 	void addComputeToComputeBarriers(VkCommandBuffer commandBuffer, uint32_t readSet)
 	{
 		VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
@@ -220,31 +181,6 @@ public:
 			0, nullptr);
 	}
 
-	void addComputeToGraphicsBarriers(VkCommandBuffer commandBuffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask)
-	{
-		if (dedicatedComputeQueue) {
-			VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
-			bufferBarrier.srcAccessMask = srcAccessMask;
-			bufferBarrier.dstAccessMask = dstAccessMask;
-			bufferBarrier.srcQueueFamilyIndex = vulkanDevice->queueFamilyIndices.compute;
-			bufferBarrier.dstQueueFamilyIndex = vulkanDevice->queueFamilyIndices.graphics;
-			bufferBarrier.size = VK_WHOLE_SIZE;
-			std::vector<VkBufferMemoryBarrier> bufferBarriers;
-			bufferBarrier.buffer = storageBuffers.input.buffer;
-			bufferBarriers.push_back(bufferBarrier);
-			bufferBarrier.buffer = storageBuffers.output.buffer;
-			bufferBarriers.push_back(bufferBarrier);
-			vkCmdPipelineBarrier(
-				commandBuffer,
-				srcStageMask,
-				dstStageMask,
-				VK_FLAGS_NONE,
-				0, nullptr,
-				static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
-				0, nullptr);
-		}
-	}
-
 	// Setup and fill the shader storage buffers containing the particles
 	// These buffers are used as shader storage buffers in the compute shader (to update them) and as vertex input in the vertex shader (to display them)
 	void prepareStorageBuffers()
@@ -280,32 +216,32 @@ public:
 			storageBufferSize,
 			particleBuffer.data());
 
-		// SSBOs will be used both as storage buffers (compute) and vertex buffers (graphics)
+		// SSBOs are only accessed by the compute queue, graphics reads the copies made by the async compute scheduler
 		vulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			&storageBuffers.input,
 			storageBufferSize);
 
 		vulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			&storageBuffers.output,
 			storageBufferSize);
 
 		// Copy from staging buffer
-		VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		// This is done on the compute queue, so the storage buffers are owned by the compute queue family from the start and no ownership transfer is required
+		VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, asyncCompute.commandPool, true);
 		VkBufferCopy copyRegion = {};
 		copyRegion.size = storageBufferSize;
 		vkCmdCopyBuffer(copyCmd, stagingBuffer.buffer, storageBuffers.output.buffer, 1, &copyRegion);
-		// Add an initial release barrier to the graphics queue,
-		// so that when the compute command buffer executes for the first time
-		// it doesn't complain about a lack of a corresponding "release" to its "acquire"
-		addGraphicsToComputeBarriers(copyCmd, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
-		vulkanDevice->flushCommandBuffer(copyCmd, queue, true);
+		vulkanDevice->flushCommandBuffer(copyCmd, asyncCompute.queue, asyncCompute.commandPool, true);
 
 		stagingBuffer.destroy();
 
+		// With an even number of iterations per step the final results are always written to the output buffer
+		asyncCompute.addOutput(storageBuffers.output.buffer, storageBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+
 		// Indices
 		std::vector<uint32_t> indices;
 		for (uint32_t y = 0; y < cloth.gridsize.y - 1; y++) {
@@ -452,9 +388,6 @@ public:
 	// Prepare the resources used for the compute part of the sample
 	void prepareCompute()
 	{
-		// Create a compute capable device queue
-		vkGetDeviceQueue(device, vulkanDevice->queueFamilyIndices.compute, 0, &compute.queue);
-
 		// Uniform buffer for passing data to the compute shader
 		vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &compute.uniformBuffer, sizeof(Compute::UniformData));
 		VK_CHECK_RESULT(compute.uniformBuffer.map());
@@ -508,35 +441,6 @@ public:
 		VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(compute.pipelineLayout, 0);
 		computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computecloth/cloth.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
 		VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipeline));
-
-		// Separate command pool as queue family for compute may be different than graphics
-		VkCommandPoolCreateInfo cmdPoolInfo = {};
-		cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		cmdPoolInfo.queueFamilyIndex = vulkanDevice->queueFamilyIndices.compute;
-		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-		VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolInfo, nullptr, &compute.commandPool));
-
-		// Create command buffers for compute operations
-		VkCommandBufferAllocateInfo cmdBufAllocateInfo = vks::initializers::commandBufferAllocateInfo(compute.commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, static_cast<uint32_t>(compute.commandBuffers.size()));
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &compute.commandBuffers[0]));
-
-		// Fences to check for command buffer completion
-		for (auto& fence : compute.fences) {
-			VkFenceCreateInfo fenceCreateInfo = vks::initializers::fenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
-			VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &fence));
-		}
-
-		// Semaphores for graphics / compute synchronization
-		VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::semaphoreCreateInfo();
-		for (uint32_t i = 0; i < compute.semaphores.size(); i++) {
-			VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &compute.semaphores[i].ready));
-			VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &compute.semaphores[i].complete));
-		}
-		// Signal first used ready semaphore
-		VkSubmitInfo computeSubmitInfo = vks::initializers::submitInfo();
-		computeSubmitInfo.signalSemaphoreCount = 1;
-		computeSubmitInfo.pSignalSemaphores = &compute.semaphores[maxConcurrentFrames - 1].ready;
-		VK_CHECK_RESULT(vkQueueSubmit(compute.queue, 1, &computeSubmitInfo, VK_NULL_HANDLE));
 	}
 
 	void updateComputeUBO()
@@ -569,13 +473,17 @@ public:
 	void prepare()
 	{
 		VulkanExampleBase::prepare();
-		// Check whether the compute queue family is distinct from the graphics queue family
-		dedicatedComputeQueue = vulkanDevice->queueFamilyIndices.graphics != vulkanDevice->queueFamilyIndices.compute;
+		asyncCompute.create(vulkanDevice);
 		loadAssets();
 		prepareStorageBuffers();
 		prepareDescriptorPool();
 		prepareGraphics();
 		prepareCompute();
+		// In benchmark mode simulation throughput is compared with and without overlapping compute and graphics
+		// The overlay is disabled while benchmarking, so the results are added to the benchmark results instead
+		if (benchmark.active) {
+			asyncCompute.startComparison([this](const std::string& result) { benchmark.addResult(vks::AsyncCompute::comparisonHeader, result); });
+		}
 		prepared = true;
 	}
 
@@ -601,8 +509,8 @@ public:
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
 
-		// Acquire storage buffers from compute queue
-		addComputeToGraphicsBarriers(cmdBuffer, 0, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+		// Acquire the cloth buffer copy written by the compute queue (if the queue families differ)
+		asyncCompute.recordGraphicsAcquire(cmdBuffer);
 
 		// Draw the particle system using the update vertex buffer
 
@@ -625,30 +533,21 @@ public:
 		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics.pipelines.cloth);
 		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics.pipelineLayout, 0, 1, &graphics.descriptorSets[currentBuffer], 0, nullptr);
 		vkCmdBindIndexBuffer(cmdBuffer, graphics.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &storageBuffers.output.buffer, offsets);
+		// With overlap enabled this is the result of the previous simulation step, as the current one may still be running
+		VkBuffer clothBuffer = asyncCompute.graphicsBuffer(0);
+		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &clothBuffer, offsets);
 		vkCmdDrawIndexed(cmdBuffer, indexCount, 1, 0, 0, 0);
 
 		drawUI(cmdBuffer);
 
 		vkCmdEndRenderPass(cmdBuffer);
 
-		// release the storage buffers to the compute queue
-		addGraphicsToComputeBarriers(cmdBuffer, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
-
 		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
 	}
 
-	void buildComputeCommandBuffer()
+	// Records one simulation step, the scheduler adds the copy to the output buffer and the ownership transfer
+	void recordComputeStep(VkCommandBuffer cmdBuffer)
 	{
-		VkCommandBuffer cmdBuffer = compute.commandBuffers[currentBuffer];
-		
-		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
-
-		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
-
-		// Acquire the storage buffers from the graphics queue
-		addGraphicsToComputeBarriers(cmdBuffer, 0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
 		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipeline);
 
 		uint32_t calculateNormals = 0;
@@ -664,16 +563,11 @@ public:
 				vkCmdPushConstants(cmdBuffer, compute.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &calculateNormals);
 			}
 			vkCmdDispatch(cmdBuffer, cloth.gridsize.x / 10, cloth.gridsize.y / 10, 1);
-			// Don't add a barrier on the last iteration of the loop, since we'll have an explicit release to the graphics queue
+			// Don't add a barrier on the last iteration of the loop, since the scheduler adds a barrier before copying the results
 			if (j != iterations - 1) {
 				addComputeToComputeBarriers(cmdBuffer, readSet);
 			}
 		}
-
-		// Release the storage buffers back to the graphics queue
-		addComputeToGraphicsBarriers(cmdBuffer, VK_ACCESS_SHADER_WRITE_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
-
-		vkEndCommandBuffer(cmdBuffer);
 	}
 
 	virtual void render()
@@ -681,52 +575,35 @@ public:
 		if (!prepared)
 			return;
 
-		// Submit compute commands
-		{
-			VK_CHECK_RESULT(vkWaitForFences(device, 1, &compute.fences[currentBuffer], VK_TRUE, UINT64_MAX));
-			VK_CHECK_RESULT(vkResetFences(device, 1, &compute.fences[currentBuffer]));
-
-			updateComputeUBO();
-			buildComputeCommandBuffer();
-
-			VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-			VkSubmitInfo submitInfo = vks::initializers::submitInfo();
-			submitInfo.waitSemaphoreCount = 1;
-			submitInfo.pWaitSemaphores = &compute.semaphores[((int)currentBuffer - 1) % maxConcurrentFrames].ready;
-			submitInfo.pWaitDstStageMask = &waitDstStageMask;
-			submitInfo.signalSemaphoreCount = 1;
-			submitInfo.pSignalSemaphores = &compute.semaphores[currentBuffer].complete;
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &compute.commandBuffers[currentBuffer];
-			VK_CHECK_RESULT(vkQueueSubmit(compute.queue, 1, &submitInfo, compute.fences[currentBuffer]));
-		}
+		// Submit the simulation step on the compute queue
+		updateComputeUBO();
+		asyncCompute.submit([this](VkCommandBuffer cmdBuffer) { recordComputeStep(cmdBuffer); });
 
 		// Submit graphics commands
-		{
-			VK_CHECK_RESULT(vkWaitForFences(device, 1, &waitFences[currentBuffer], VK_TRUE, UINT64_MAX));
-			VK_CHECK_RESULT(vkResetFences(device, 1, &waitFences[currentBuffer]));
-
-			VulkanExampleBase::prepareFrame(false);
-
-			updateGraphicsUBO();
-			buildGraphicsCommandBuffer();
-
-			VkPipelineStageFlags waitDstStageMask[2] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT };
-			VkSemaphore waitSemaphores[2] = { presentCompleteSemaphores[currentBuffer], compute.semaphores[currentBuffer].complete };
-			VkSemaphore signalSemaphores[2] = { renderCompleteSemaphores[currentImageIndex], compute.semaphores[currentBuffer].ready };
-
-			VkSubmitInfo submitInfo = vks::initializers::submitInfo();
-			submitInfo.waitSemaphoreCount = 2;
-			submitInfo.pWaitSemaphores = waitSemaphores;
-			submitInfo.pWaitDstStageMask = waitDstStageMask;
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
-			submitInfo.signalSemaphoreCount = 2;
-			submitInfo.pSignalSemaphores = signalSemaphores;
-			VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, waitFences[currentBuffer]));
-
-			VulkanExampleBase::submitFrame(true);
-		}
+		VK_CHECK_RESULT(vkWaitForFences(device, 1, &waitFences[currentBuffer], VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(device, 1, &waitFences[currentBuffer]));
+
+		VulkanExampleBase::prepareFrame(false);
+
+		updateGraphicsUBO();
+		buildGraphicsCommandBuffer();
+
+		std::vector<VkSemaphore> waitSemaphores = { presentCompleteSemaphores[currentBuffer] };
+		std::vector<VkPipelineStageFlags> waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		std::vector<VkSemaphore> signalSemaphores = { renderCompleteSemaphores[currentImageIndex] };
+		asyncCompute.addGraphicsSemaphores(waitSemaphores, waitStages, signalSemaphores);
+
+		VkSubmitInfo submitInfo = vks::initializers::submitInfo();
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
+		submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+		submitInfo.pSignalSemaphores = signalSemaphores.data();
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, waitFences[currentBuffer]));
+
+		VulkanExampleBase::submitFrame(true);
 	}
 
 	virtual void OnUpdateUIOverlay(vks::UIOverlay* overlay)
@@ -734,6 +611,25 @@ public:
 		if (overlay->header("Settings")) {
 			overlay->checkBox("Simulate wind", &simulateWind);
 		}
+		if (overlay->header("Async compute")) {
+			overlay->text(asyncCompute.dedicatedQueue() ? "Dedicated compute queue family" : "Shared graphics and compute queue family");
+			overlay->checkBox("Overlap with graphics", &asyncCompute.overlap);
+			overlay->text("Simulation: %.0f steps/s", asyncCompute.stats.stepsPerSecond);
+			if (asyncCompute.stats.timestampsSupported) {
+				overlay->text("Step time: %.3f ms", asyncCompute.stats.stepTime);
+			}
+			if (asyncCompute.comparing()) {
+				overlay->text("Measuring...");
+			} else if (overlay->button("Compare overlap")) {
+				asyncCompute.startComparison();
+			}
+			if (!asyncCompute.comparisonResults.empty()) {
+				overlay->text("%s", vks::AsyncCompute::comparisonHeader);
+			}
+			for (auto& result : asyncCompute.comparisonResults) {
+				overlay->text("%s", result.c_str());
+			}
+		}
 	}
 };
 
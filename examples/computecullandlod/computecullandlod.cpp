@@ -10,6 +10,7 @@
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
 #include "frustum.hpp"
+#include "VulkanBVH.h"
 
 
 // Total number of objects (^3) in the scene
@@ -20,6 +21,10 @@ constexpr auto OBJECT_COUNT = 64;
 #endif
 
 constexpr auto MAX_LOD_LEVEL = 5;
+// Scale of the object instances
+constexpr auto INSTANCE_SCALE = 2.0f;
+// A generated LOD is used once its error projects to less than this many pixels on screen
+constexpr auto LOD_PIXEL_ERROR = 1.0f;
 
 class VulkanExample : public VulkanExampleBase
 {
@@ -27,7 +32,9 @@ public:
 	bool fixedFrustum = false;
 
 	// The model contains multiple versions of a single object with different levels of detail
+	// The loader also generates a LOD chain from the full detail version, which is used instead of the hand-made versions
 	vkglTF::Model lodModel;
+	uint32_t lodLevelCount{ 0 };
 
 	// Per-instance data block
 	struct InstanceData {
@@ -60,8 +67,13 @@ public:
 
 	VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
 	VkPipeline pipeline{ VK_NULL_HANDLE };
+	// Owned by the layout cache
 	VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
-	std::array<VkDescriptorSet, maxConcurrentFrames> descriptorSets{};
+
+	// Static sets (compute) are allocated from pools that grow on demand, so there's no need to size a pool up front
+	vks::DescriptorAllocator descriptorAllocator;
+	// The graphics set is transient and allocated anew each frame, the frame's pools are reset once its fence has been signalled
+	vks::FrameDescriptorAllocator frameDescriptorAllocator;
 
 	// Resources for the compute part of the example
 	struct Compute {
@@ -87,6 +99,21 @@ public:
 
 	uint32_t objectCount = 0;
 
+	// Optionally culls a subset of the instances on the CPU as well, once with a linear sweep and once with a BVH query, to compare their cost
+	// Both use the same bounding sphere as the compute shader, the BVH stores the sphere's bounding box
+	struct CPUCulling {
+		bool enabled{ false };
+		int32_t objectCount{ 10000 };
+		std::vector<glm::vec3> positions;
+		vks::BVH bvh;
+		uint32_t bvhObjectCount{ 0 };
+		double buildTime{ 0.0 };
+		double linearTime{ 0.0 };
+		double bvhTime{ 0.0 };
+		uint32_t linearVisible{ 0 };
+		uint32_t bvhVisible{ 0 };
+	} cpuCulling;
+
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Compute cull and lod";
@@ -101,7 +128,8 @@ public:
 		if (device) {
 			vkDestroyPipeline(device, pipeline, nullptr);
 			vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-			vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+			descriptorAllocator.destroy();
+			frameDescriptorAllocator.destroy();
 			instanceBuffer.destroy();
 			for (auto& buffer : uniformBuffers) {
 				buffer.destroy();
@@ -114,7 +142,6 @@ public:
 			}
 			compute.lodLevelsBuffers.destroy();
 			vkDestroyPipelineLayout(device, compute.pipelineLayout, nullptr);
-			vkDestroyDescriptorSetLayout(device, compute.descriptorSetLayout, nullptr);
 			vkDestroyPipeline(device, compute.pipeline, nullptr);
 			vkDestroyCommandPool(device, compute.commandPool, nullptr);
 			for (auto& fence : compute.fences) {
@@ -141,19 +168,17 @@ public:
 
 	void loadAssets()
 	{
-		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
+		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY | vkglTF::FileLoadingFlags::GenerateLODs;
+		vkglTF::lodSettings.levelCount = MAX_LOD_LEVEL + 1;
 		lodModel.loadFromFile(getAssetPath() + "models/suzanne_lods.gltf", vulkanDevice, queue, glTFLoadingFlags);
 	}
 
-	void prepareDescriptorPool()
+	void prepareDescriptorAllocators()
 	{
-		// This is shared between graphics and compute
-		std::vector<VkDescriptorPoolSize> poolSizes = {
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxConcurrentFrames * 2),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxConcurrentFrames * 4)
-		};
-		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, maxConcurrentFrames * 2);
-		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
+		// This is shared between graphics and compute, pools are sized for the layouts of the sets allocated from them
+		descriptorAllocator.create(device, maxConcurrentFrames);
+		// Only a single set per frame, but the pools grow if more sets are allocated
+		frameDescriptorAllocator.create(device, maxConcurrentFrames, 4);
 	}
 
 	void prepareGraphics()
@@ -163,19 +188,8 @@ public:
 			// Binding 0: Vertex shader uniform buffer
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT,0),
 		};
-		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
-		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorLayout, nullptr, &descriptorSetLayout));
-
-		// Sets per frame, just like the buffers themselves
-		for (auto i = 0; i < uniformBuffers.size(); i++) {
-			VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
-			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSets[i]));
-			std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
-				// Binding 0: Vertex shader uniform buffer
-				vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffers[i].descriptor),
-			};
-			vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
-		}
+		descriptorSetLayout = vks::descriptorLayoutCache.get(device, setLayoutBindings);
+		// The descriptor set itself is allocated per frame while building the command buffer
 
 		// Pipeline layout
 		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&descriptorSetLayout, 1);
@@ -240,6 +254,64 @@ public:
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline));
 	}
 
+	// Fills the LOD levels buffer with the index ranges and switch distances of the LODs
+	// Distances for generated LODs depend on the viewport height, so this is also called on resize
+	void uploadLODLevels()
+	{
+		struct LOD
+		{
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			float distance;
+			float _pad0;
+		};
+		std::vector<LOD> LODLevels;
+		uint32_t n = 0;
+		const vkglTF::Primitive* fullDetail = lodModel.nodes[0]->mesh->primitives[0];
+		if (fullDetail->lods.size() > 1) {
+			// Generated LODs: a level is used up to the distance at which the error of the next level projects to less than LOD_PIXEL_ERROR pixels
+			const float projectionScale = (float)height * fabsf(camera.matrices.perspective[1][1]) / 2.0f;
+			for (size_t i = 0; i < fullDetail->lods.size(); i++) {
+				LOD lod{};
+				lod.firstIndex = fullDetail->lods[i].firstIndex;
+				lod.indexCount = fullDetail->lods[i].indexCount;
+				lod.distance = (i + 1 < fullDetail->lods.size()) ? fullDetail->lods[i + 1].error * INSTANCE_SCALE * projectionScale / LOD_PIXEL_ERROR : FLT_MAX;
+				LODLevels.push_back(lod);
+			}
+		} else {
+			for (auto node : lodModel.nodes)
+			{
+				LOD lod{};
+				lod.firstIndex = node->mesh->primitives[0]->firstIndex;	// First index for this LOD
+				lod.indexCount = node->mesh->primitives[0]->indexCount;	// Index count for this LOD
+				lod.distance = 5.0f + n * 5.0f;							// Starting distance (to viewer) for this LOD
+				n++;
+				LODLevels.push_back(lod);
+			}
+		}
+		lodLevelCount = static_cast<uint32_t>(LODLevels.size());
+
+		vks::Buffer stagingBuffer;
+		VK_CHECK_RESULT(vulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&stagingBuffer,
+			LODLevels.size() * sizeof(LOD),
+			LODLevels.data()));
+
+		if (compute.lodLevelsBuffers.buffer == VK_NULL_HANDLE) {
+			VK_CHECK_RESULT(vulkanDevice->createBuffer(
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&compute.lodLevelsBuffers,
+				stagingBuffer.size));
+		}
+
+		vulkanDevice->copyBuffer(&stagingBuffer, &compute.lodLevelsBuffers, queue);
+
+		stagingBuffer.destroy();
+	}
+
 	void prepareBuffers()
 	{
 		objectCount = OBJECT_COUNT * OBJECT_COUNT * OBJECT_COUNT;
@@ -320,11 +392,16 @@ public:
 				for (uint32_t z = 0; z < OBJECT_COUNT; z++) {
 					uint32_t index = x + y * OBJECT_COUNT + z * OBJECT_COUNT * OBJECT_COUNT;
 					instanceData[index].pos = glm::vec3((float)x, (float)y, (float)z) - glm::vec3((float)OBJECT_COUNT / 2.0f);
-					instanceData[index].scale = 2.0f;
+					instanceData[index].scale = INSTANCE_SCALE;
 				}
 			}
 		}
 
+		cpuCulling.positions.resize(objectCount);
+		for (uint32_t i = 0; i < objectCount; i++) {
+			cpuCulling.positions[i] = instanceData[i].pos;
+		}
+
 		VK_CHECK_RESULT(vulkanDevice->createBuffer(
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
@@ -357,41 +434,7 @@ public:
 
 
 		// Shader storage buffer containing index offsets and counts for the LODs
-		struct LOD
-		{
-			uint32_t firstIndex;
-			uint32_t indexCount;
-			float distance;
-			float _pad0;
-		};
-		std::vector<LOD> LODLevels;
-		uint32_t n = 0;
-		for (auto node : lodModel.nodes)
-		{
-			LOD lod{};
-			lod.firstIndex = node->mesh->primitives[0]->firstIndex;	// First index for this LOD
-			lod.indexCount = node->mesh->primitives[0]->indexCount;	// Index count for this LOD
-			lod.distance = 5.0f + n * 5.0f;							// Starting distance (to viewer) for this LOD
-			n++;
-			LODLevels.push_back(lod);
-		}
-
-		VK_CHECK_RESULT(vulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&stagingBuffer,
-			LODLevels.size() * sizeof(LOD),
-			LODLevels.data()));
-
-		VK_CHECK_RESULT(vulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			&compute.lodLevelsBuffers,
-			stagingBuffer.size));
-
-		vulkanDevice->copyBuffer(&stagingBuffer, &compute.lodLevelsBuffers, queue);
-
-		stagingBuffer.destroy();
+		uploadLODLevels();
 
 		// Scene uniform buffer
 		for (auto& buffer : uniformBuffers) {
@@ -420,15 +463,13 @@ public:
 			// Binding 4: LOD info (input)
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT,4),
 		};
-		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
-		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorLayout, nullptr, &compute.descriptorSetLayout));
+		compute.descriptorSetLayout = vks::descriptorLayoutCache.get(device, setLayoutBindings);
 
 		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&compute.descriptorSetLayout, 1);
 		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &compute.pipelineLayout));
 
 		for (auto i = 0; i < uniformBuffers.size(); i++) {
-			VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &compute.descriptorSetLayout, 1);
-			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &compute.descriptorSets[i]));
+			compute.descriptorSets[i] = descriptorAllocator.allocate(compute.descriptorSetLayout);
 			std::vector<VkWriteDescriptorSet> computeWriteDescriptorSets = {
 				// Binding 0: Instance input data buffer
 				vks::initializers::writeDescriptorSet(compute.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &instanceBuffer.descriptor),
@@ -454,7 +495,7 @@ public:
 		specializationEntry.offset = 0;
 		specializationEntry.size = sizeof(uint32_t);
 
-		uint32_t specializationData = static_cast<uint32_t>(lodModel.nodes.size()) - 1;
+		uint32_t specializationData = lodLevelCount - 1;
 
 		VkSpecializationInfo specializationInfo{};
 		specializationInfo.mapEntryCount = 1;
@@ -509,12 +550,44 @@ public:
 		memcpy(uniformBuffers[currentBuffer].mapped, &uniformData, sizeof(UniformData));
 	}
 
+	void updateCPUCulling()
+	{
+		const uint32_t count = std::min(static_cast<uint32_t>(cpuCulling.objectCount), objectCount);
+		if (cpuCulling.bvhObjectCount != count) {
+			auto tStart = std::chrono::high_resolution_clock::now();
+			std::vector<vks::AABB> bounds(count);
+			for (uint32_t i = 0; i < count; i++) {
+				bounds[i].min = cpuCulling.positions[i] - glm::vec3(1.0f);
+				bounds[i].max = cpuCulling.positions[i] + glm::vec3(1.0f);
+			}
+			cpuCulling.bvh.build(bounds);
+			cpuCulling.bvhObjectCount = count;
+			cpuCulling.buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+		}
+
+		auto tStart = std::chrono::high_resolution_clock::now();
+		cpuCulling.linearVisible = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			if (frustum.checkSphere(cpuCulling.positions[i], 1.0f)) {
+				cpuCulling.linearVisible++;
+			}
+		}
+		cpuCulling.linearTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - tStart).count();
+
+		tStart = std::chrono::high_resolution_clock::now();
+		std::vector<uint32_t> visible;
+		visible.reserve(count);
+		cpuCulling.bvh.queryFrustum(frustum, visible);
+		cpuCulling.bvhVisible = static_cast<uint32_t>(visible.size());
+		cpuCulling.bvhTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - tStart).count();
+	}
+
 	void prepare()
 	{
 		VulkanExampleBase::prepare();
 		loadAssets();
 		prepareBuffers();
-		prepareDescriptorPool();
+		prepareDescriptorAllocators();
 		prepareGraphics();
 		prepareCompute();
 		prepared = true;
@@ -574,8 +647,15 @@ public:
 		VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
 		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
+		// POI: Allocate a transient descriptor set from the current frame's pools, no need to keep one set per frame around
+		// The frame's fence has been waited on, so the sets previously allocated for this frame are no longer in use
+		frameDescriptorAllocator.beginFrame(currentBuffer);
+		VkDescriptorSet descriptorSet = frameDescriptorAllocator.allocate(descriptorSetLayout);
+		VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffers[currentBuffer].descriptor);
+		vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+
 		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentBuffer], 0, nullptr);
+		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
 
 		// Mesh containing the LODs
 		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
@@ -739,7 +819,7 @@ public:
 			VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
 			VkSubmitInfo submitInfo = vks::initializers::submitInfo();
 			submitInfo.waitSemaphoreCount = 1;
-			submitInfo.pWaitSemaphores = &compute.semaphores[((int)currentBuffer - 1) % maxConcurrentFrames].ready;
+			submitInfo.pWaitSemaphores = &compute.semaphores[(currentBuffer + maxConcurrentFrames - 1) % maxConcurrentFrames].ready;
 			submitInfo.pWaitDstStageMask = &waitDstStageMask;
 			submitInfo.signalSemaphoreCount = 1;
 			submitInfo.pSignalSemaphores = &compute.semaphores[currentBuffer].complete;
@@ -756,6 +836,9 @@ public:
 			VulkanExampleBase::prepareFrame(false);
 
 			updateUniformBuffer();
+			if (cpuCulling.enabled) {
+				updateCPUCulling();
+			}
 			buildGraphicsCommandBuffer();
 
 			VkPipelineStageFlags waitDstStageMask[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT };
@@ -777,16 +860,40 @@ public:
 		}
 	}
 
+	// The device is idle at this point, so the LOD levels buffer can be updated in place
+	void windowResized() override
+	{
+		uploadLODLevels();
+	}
+
 	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
 	{
 		if (overlay->header("Settings")) {
 			overlay->checkBox("Freeze frustum", &fixedFrustum);
+			overlay->checkBox("CPU culling benchmark", &cpuCulling.enabled);
+			if (cpuCulling.enabled) {
+				overlay->sliderInt("CPU culled objects", &cpuCulling.objectCount, 1000, static_cast<int32_t>(objectCount));
+			}
 		}
 		if (overlay->header("Statistics")) {
 			overlay->text("Visible objects: %d", indirectStats.drawCount);
-			for (uint32_t i = 0; i < MAX_LOD_LEVEL + 1; i++) {
+			for (uint32_t i = 0; i < lodLevelCount; i++) {
 				overlay->text("LOD %d: %d", i, indirectStats.lodCount[i]);
 			}
+			overlay->text("LOD generation: %.1f ms", lodModel.stats.lodTime);
+		}
+		if (cpuCulling.enabled && overlay->header("CPU culling")) {
+			overlay->text("Objects: %d", cpuCulling.bvhObjectCount);
+			overlay->text("Linear: %.1f us (%d visible)", cpuCulling.linearTime, cpuCulling.linearVisible);
+			overlay->text("BVH: %.1f us (%d visible)", cpuCulling.bvhTime, cpuCulling.bvhVisible);
+			overlay->text("BVH build: %.2f ms", cpuCulling.buildTime);
+		}
+		if (overlay->header("Descriptor allocation")) {
+			const vks::DescriptorAllocator::Statistics& frameStats = frameDescriptorAllocator.stats();
+			overlay->text("Static: %d sets in %d pools", descriptorAllocator.stats.sets, descriptorAllocator.stats.pools);
+			overlay->text("Per frame: %d sets in %d pools", frameStats.sets, frameStats.pools);
+			overlay->text("Pool exhaustions: %d", descriptorAllocator.stats.exhausted + frameStats.exhausted);
+			overlay->text("Cached layouts: %d", static_cast<int>(vks::descriptorLayoutCache.size()));
 		}
 	}
 };
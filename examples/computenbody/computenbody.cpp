@@ -5,6 +5,7 @@
 * It calculates the particle system movement using two separate compute passes: calculating particle positions and integrating particles
 * For that a shader storage buffer is used which is then used as a vertex buffer for drawing the particle system with a graphics pipeline
 * To optimize performance, the compute shaders use shared memory
+* The simulation runs on the compute queue via vks::AsyncCompute, so the step for the next frame can overlap with rendering the current frame
 *
 * Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
 *
@@ -12,6 +13,7 @@
 */
 
 #include "vulkanexamplebase.h"
+#include "VulkanAsyncCompute.h"
 
 #if defined(__ANDROID__)
 // Lower particle count on Android for performance reasons
@@ -36,12 +38,14 @@ public:
 	uint32_t numParticles{ 0 };
 
 	// We use a shader storage buffer object to store the particlces
-	// This is updated by the compute pipeline and displayed as a vertex buffer by the graphics pipeline
+	// This is updated by the compute pipeline, after each step the async compute scheduler copies it to the buffers that are displayed as a vertex buffer by the graphics pipeline
 	vks::Buffer storageBuffer;
 
+	// Submits the simulation steps on the compute queue and handles synchronization and ownership transfers with graphics
+	vks::AsyncCompute asyncCompute;
+
 	// Resources for the graphics part of the example
 	struct Graphics {
-		uint32_t queueFamilyIndex;											// Used to check if compute and graphics queue families differ and require additional barriers
 		VkDescriptorSetLayout descriptorSetLayout;							// Particle system rendering shader binding layout
 		std::array<VkDescriptorSet, maxConcurrentFrames> descriptorSets;	// Particle system rendering shader bindings
 		VkPipelineLayout pipelineLayout;									// Layout of the graphics pipeline
@@ -56,18 +60,8 @@ public:
 
 	// Resources for the compute part of the example
 	struct Compute {
-		uint32_t queueFamilyIndex;											// Used to check if compute and graphics queue families differ and require additional barriers
-		VkQueue queue;														// Separate queue for compute commands (queue family may differ from the one used for graphics)
-		VkCommandPool commandPool;											// Use a separate command pool (queue family may differ from the one used for graphics)
-		std::array<VkCommandBuffer, maxConcurrentFrames> commandBuffers;	// Command buffer storing the dispatch commands and barriers
 		VkDescriptorSetLayout descriptorSetLayout;							// Compute shader binding layout
 		std::array<VkDescriptorSet, maxConcurrentFrames> descriptorSets;	// Compute shader bindings
-		std::array<VkFence, maxConcurrentFrames> fences{};					// Fences to make sure command buffers are done
-		struct ComputeSemaphores {
-			VkSemaphore ready{ VK_NULL_HANDLE };
-			VkSemaphore complete{ VK_NULL_HANDLE };
-		};
-		std::array<ComputeSemaphores, maxConcurrentFrames> semaphores{};	// Semaphores for submission ordering
 		VkPipelineLayout pipelineLayout;									// Layout of the compute pipeline
 		VkPipeline pipelineCalculate;										// Compute pipeline for N-Body velocity calculation (1st pass)
 		VkPipeline pipelineIntegrate;										// Compute pipeline for euler integration (2nd pass)
@@ -108,18 +102,11 @@ public:
 			vkDestroyDescriptorSetLayout(device, compute.descriptorSetLayout, nullptr);
 			vkDestroyPipeline(device, compute.pipelineCalculate, nullptr);
 			vkDestroyPipeline(device, compute.pipelineIntegrate, nullptr);
-			vkDestroyCommandPool(device, compute.commandPool, nullptr);
 			for (auto& buffer : compute.uniformBuffers) {
 				buffer.destroy();
 			}
-			for (auto& fence : compute.fences) {
-				vkDestroyFence(device, fence, nullptr);
-			}
-			for (auto& semaphore : compute.semaphores) {
-				vkDestroySemaphore(device, semaphore.ready, nullptr);
-				vkDestroySemaphore(device, semaphore.complete, nullptr);
-			}
 
+			asyncCompute.destroy();
 			storageBuffer.destroy();
 
 			textures.particle.destroy();
@@ -197,42 +184,21 @@ public:
 		vks::Buffer stagingBuffer;
 
 		vulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, storageBufferSize, particleBuffer.data());
-		// The SSBO will be used as a storage buffer for the compute pipeline and as a vertex buffer in the graphics pipeline
-		vulkanDevice->createBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &storageBuffer, storageBufferSize);
+		// The SSBO is only accessed by the compute queue, graphics reads the copies made by the async compute scheduler
+		vulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &storageBuffer, storageBufferSize);
 
 		// Copy from staging buffer to storage buffer
-		VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		// This is done on the compute queue, so the storage buffer is owned by the compute queue family from the start and no ownership transfer is required
+		VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, asyncCompute.commandPool, true);
 		VkBufferCopy copyRegion = {};
 		copyRegion.size = storageBufferSize;
 		vkCmdCopyBuffer(copyCmd, stagingBuffer.buffer, storageBuffer.buffer, 1, &copyRegion);
-		// Execute a transfer barrier to the compute queue, if necessary
-		if (graphics.queueFamilyIndex != compute.queueFamilyIndex)
-		{
-			VkBufferMemoryBarrier buffer_barrier =
-			{
-				VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-				nullptr,
-				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-				0,
-				graphics.queueFamilyIndex,
-				compute.queueFamilyIndex,
-				storageBuffer.buffer,
-				0,
-				storageBuffer.size
-			};
-
-			vkCmdPipelineBarrier(
-				copyCmd,
-				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-				0,
-				0, nullptr,
-				1, &buffer_barrier,
-				0, nullptr);
-		}
-		vulkanDevice->flushCommandBuffer(copyCmd, queue, true);
+		vulkanDevice->flushCommandBuffer(copyCmd, asyncCompute.queue, asyncCompute.commandPool, true);
 
 		stagingBuffer.destroy();
+
+		// The particles are displayed as a vertex buffer
+		asyncCompute.addOutput(storageBuffer.buffer, storageBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
 	}
 
 	void prepareDescriptorPool()
@@ -342,12 +308,6 @@ public:
 
 	void prepareCompute()
 	{
-		// Create a compute capable device queue
-		// The VulkanDevice::createLogicalDevice functions finds a compute capable queue and prefers queue families that only support compute
-		// Depending on the implementation this may result in different queue family indices for graphics and computes,
-		// requiring proper synchronization (see the memory barriers in buildComputeCommandBuffer)
-		vkGetDeviceQueue(device, compute.queueFamilyIndex, 0, &compute.queue);
-
 		// Compute shader uniform buffer block
 		for (auto& buffer : compute.uniformBuffers) {
 			vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer, sizeof(Compute::UniformData));
@@ -398,35 +358,6 @@ public:
 		// 2nd pass
 		computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computenbody/particle_integrate.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
 		VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipelineIntegrate));
-
-		// Separate command pool as queue family for compute may be different than graphics
-		VkCommandPoolCreateInfo cmdPoolInfo = vks::initializers::commandPoolCreateInfo();
-		cmdPoolInfo.queueFamilyIndex = compute.queueFamilyIndex;
-		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-		VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolInfo, nullptr, &compute.commandPool));
-
-		// Create command buffers for compute operations
-		for (auto& cmdBuffer : compute.commandBuffers) {
-			cmdBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, compute.commandPool);
-		}
-
-		// Fences to check for command buffer completion
-		for (auto& fence : compute.fences) {
-			VkFenceCreateInfo fenceCreateInfo = vks::initializers::fenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
-			VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &fence));
-		}
-
-		// Semaphores to order compute and graphics submissions
-		for (auto& semaphore : compute.semaphores) {
-			VkSemaphoreCreateInfo semaphoreInfo{ .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
-			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore.ready);
-			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore.complete);
-		}
-		// Signal first used ready semaphore
-		VkSubmitInfo computeSubmitInfo = vks::initializers::submitInfo();
-		computeSubmitInfo.signalSemaphoreCount = 1;
-		computeSubmitInfo.pSignalSemaphores = &compute.semaphores[maxConcurrentFrames - 1].ready;
-		VK_CHECK_RESULT(vkQueueSubmit(compute.queue, 1, &computeSubmitInfo, VK_NULL_HANDLE));
 	}
 
 	void updateComputeUniformBuffers()
@@ -446,15 +377,19 @@ public:
 	void prepare()
 	{
 		VulkanExampleBase::prepare();
-		// We will be using the queue family indices to check if graphics and compute queue families differ
-		// If that's the case, we need additional barriers for acquiring and releasing resources
-		graphics.queueFamilyIndex = vulkanDevice->queueFamilyIndices.graphics;
-		compute.queueFamilyIndex = vulkanDevice->queueFamilyIndices.compute;
+		// The VulkanDevice::createLogicalDevice functions finds a compute capable queue and prefers queue families that only support compute
+		// Depending on the implementation this may result in different queue family indices for graphics and compute, the scheduler adds the required ownership transfers in that case
+		asyncCompute.create(vulkanDevice);
 		loadAssets();
 		prepareDescriptorPool();
 		prepareStorageBuffers();
 		prepareGraphics();
 		prepareCompute();
+		// In benchmark mode simulation throughput is compared with and without overlapping compute and graphics
+		// The overlay is disabled while benchmarking, so the results are added to the benchmark results instead
+		if (benchmark.active) {
+			asyncCompute.startComparison([this](const std::string& result) { benchmark.addResult(vks::AsyncCompute::comparisonHeader, result); });
+		}
 		prepared = true;
 	}
 
@@ -480,31 +415,8 @@ public:
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
 
-		// Acquire barrier
-		if (graphics.queueFamilyIndex != compute.queueFamilyIndex)
-		{
-			VkBufferMemoryBarrier buffer_barrier =
-			{
-				VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-				nullptr,
-				0,
-				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-				compute.queueFamilyIndex,
-				graphics.queueFamilyIndex,
-				storageBuffer.buffer,
-				0,
-				storageBuffer.size
-			};
-
-			vkCmdPipelineBarrier(
-				cmdBuffer,
-				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-				0,
-				0, nullptr,
-				1, &buffer_barrier,
-				0, nullptr);
-		}
+		// Acquire the particle buffer copy written by the compute queue (if the queue families differ)
+		asyncCompute.recordGraphicsAcquire(cmdBuffer);
 
 		// Draw the particle system using the update vertex buffer
 		vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
@@ -518,77 +430,22 @@ public:
 		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics.pipeline);
 		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics.pipelineLayout, 0, 1, &graphics.descriptorSets[currentBuffer], 0, nullptr);
 
+		// With overlap enabled this is the result of the previous simulation step, as the current one may still be running
 		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &storageBuffer.buffer, offsets);
+		VkBuffer particleBuffer = asyncCompute.graphicsBuffer(0);
+		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &particleBuffer, offsets);
 		vkCmdDraw(cmdBuffer, numParticles, 1, 0, 0);
 
 		drawUI(cmdBuffer);
 
 		vkCmdEndRenderPass(cmdBuffer);
 
-		// Release barrier
-		if (graphics.queueFamilyIndex != compute.queueFamilyIndex)
-		{
-			VkBufferMemoryBarrier buffer_barrier =
-			{
-				VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-				nullptr,
-				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-				0,
-				graphics.queueFamilyIndex,
-				compute.queueFamilyIndex,
-				storageBuffer.buffer,
-				0,
-				storageBuffer.size
-			};
-
-			vkCmdPipelineBarrier(
-				cmdBuffer,
-				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-				0,
-				0, nullptr,
-				1, &buffer_barrier,
-				0, nullptr);
-		}
-
 		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
 	}
 
-	void buildComputeCommandBuffer()
+	// Records one simulation step, the scheduler adds the copy to the output buffer and the ownership transfer
+	void recordComputeStep(VkCommandBuffer cmdBuffer)
 	{
-		VkCommandBuffer cmdBuffer = compute.commandBuffers[currentBuffer];
-		
-		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
-
-		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
-
-		// Acquire barrier
-		if (graphics.queueFamilyIndex != compute.queueFamilyIndex)
-		{
-			VkBufferMemoryBarrier buffer_barrier =
-			{
-				VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-				nullptr,
-				0,
-				VK_ACCESS_SHADER_WRITE_BIT,
-				graphics.queueFamilyIndex,
-				compute.queueFamilyIndex,
-				storageBuffer.buffer,
-				0,
-				storageBuffer.size
-			};
-
-			vkCmdPipelineBarrier(
-				cmdBuffer,
-				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-				0,
-				0, nullptr,
-				1, &buffer_barrier,
-				0, nullptr);
-		}
-
 		// First pass: Calculate particle movement
 		// -------------------------------------------------------------------------------------------------------
 		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineCalculate);
@@ -601,7 +458,6 @@ public:
 		bufferBarrier.size = storageBuffer.descriptor.range;
 		bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
 		bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		// Transfer ownership if compute and graphics queue family indices differ
 		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 
@@ -618,34 +474,6 @@ public:
 		// -------------------------------------------------------------------------------------------------------
 		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineIntegrate);
 		vkCmdDispatch(cmdBuffer, numParticles / 256, 1, 1);
-
-		// Release barrier
-		if (graphics.queueFamilyIndex != compute.queueFamilyIndex)
-		{
-			VkBufferMemoryBarrier buffer_barrier =
-			{
-				VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-				nullptr,
-				VK_ACCESS_SHADER_WRITE_BIT,
-				0,
-				compute.queueFamilyIndex,
-				graphics.queueFamilyIndex,
-				storageBuffer.buffer,
-				0,
-				storageBuffer.size
-			};
-
-			vkCmdPipelineBarrier(
-				cmdBuffer,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-				0,
-				0, nullptr,
-				1, &buffer_barrier,
-				0, nullptr);
-		}
-
-		vkEndCommandBuffer(cmdBuffer);
 	}
 
 	virtual void render()
@@ -653,52 +481,57 @@ public:
 		if (!prepared)
 			return;
 
-		// Submit compute commands
-		{
-			VK_CHECK_RESULT(vkWaitForFences(device, 1, &compute.fences[currentBuffer], VK_TRUE, UINT64_MAX));
-			VK_CHECK_RESULT(vkResetFences(device, 1, &compute.fences[currentBuffer]));
-
-			updateComputeUniformBuffers();
-			buildComputeCommandBuffer();
-
-			// Wait for rendering finished
-			VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-			VkSubmitInfo submitInfo = vks::initializers::submitInfo();
-			submitInfo.waitSemaphoreCount = 1;
-			submitInfo.pWaitSemaphores = &compute.semaphores[((int)currentBuffer - 1) % maxConcurrentFrames].ready;
-			submitInfo.pWaitDstStageMask = &waitDstStageMask;
-			submitInfo.signalSemaphoreCount = 1;
-			submitInfo.pSignalSemaphores = &compute.semaphores[currentBuffer].complete;
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &compute.commandBuffers[currentBuffer];
-			VK_CHECK_RESULT(vkQueueSubmit(compute.queue, 1, &submitInfo, compute.fences[currentBuffer]));
-		}
+		// Submit the simulation step on the compute queue
+		updateComputeUniformBuffers();
+		asyncCompute.submit([this](VkCommandBuffer cmdBuffer) { recordComputeStep(cmdBuffer); });
 
 		// Submit graphics commands
-		{
-			VK_CHECK_RESULT(vkWaitForFences(device, 1, &waitFences[currentBuffer], VK_TRUE, UINT64_MAX));
-			VK_CHECK_RESULT(vkResetFences(device, 1, &waitFences[currentBuffer]));
-
-			VulkanExampleBase::prepareFrame(false);
-
-			updateGraphicsUniformBuffers();
-			buildGraphicsCommandBuffer();
-
-			VkPipelineStageFlags waitDstStageMask[2] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT };
-			VkSemaphore waitSemaphores[2] = { presentCompleteSemaphores[currentBuffer], compute.semaphores[currentBuffer].complete };
-			VkSemaphore signalSemaphores[2] = { renderCompleteSemaphores[currentImageIndex], compute.semaphores[currentBuffer].ready };
-
-			VkSubmitInfo submitInfo = vks::initializers::submitInfo();
-			submitInfo.waitSemaphoreCount = 2;
-			submitInfo.pWaitSemaphores = waitSemaphores;
-			submitInfo.pWaitDstStageMask = waitDstStageMask;
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
-			submitInfo.signalSemaphoreCount = 2;
-			submitInfo.pSignalSemaphores = signalSemaphores;
-			VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, waitFences[currentBuffer]));
+		VK_CHECK_RESULT(vkWaitForFences(device, 1, &waitFences[currentBuffer], VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(device, 1, &waitFences[currentBuffer]));
+
+		VulkanExampleBase::prepareFrame(false);
+
+		updateGraphicsUniformBuffers();
+		buildGraphicsCommandBuffer();
+
+		std::vector<VkSemaphore> waitSemaphores = { presentCompleteSemaphores[currentBuffer] };
+		std::vector<VkPipelineStageFlags> waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		std::vector<VkSemaphore> signalSemaphores = { renderCompleteSemaphores[currentImageIndex] };
+		asyncCompute.addGraphicsSemaphores(waitSemaphores, waitStages, signalSemaphores);
+
+		VkSubmitInfo submitInfo = vks::initializers::submitInfo();
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
+		submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+		submitInfo.pSignalSemaphores = signalSemaphores.data();
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, waitFences[currentBuffer]));
+
+		VulkanExampleBase::submitFrame(true);
+	}
 
-			VulkanExampleBase::submitFrame(true);
+	virtual void OnUpdateUIOverlay(vks::UIOverlay* overlay)
+	{
+		if (overlay->header("Async compute")) {
+			overlay->text(asyncCompute.dedicatedQueue() ? "Dedicated compute queue family" : "Shared graphics and compute queue family");
+			overlay->checkBox("Overlap with graphics", &asyncCompute.overlap);
+			overlay->text("Simulation: %.0f steps/s", asyncCompute.stats.stepsPerSecond);
+			if (asyncCompute.stats.timestampsSupported) {
+				overlay->text("Step time: %.3f ms", asyncCompute.stats.stepTime);
+			}
+			if (asyncCompute.comparing()) {
+				overlay->text("Measuring...");
+			} else if (overlay->button("Compare overlap")) {
+				asyncCompute.startComparison();
+			}
+			if (!asyncCompute.comparisonResults.empty()) {
+				overlay->text("%s", vks::AsyncCompute::comparisonHeader);
+			}
+			for (auto& result : asyncCompute.comparisonResults) {
+				overlay->text("%s", result.c_str());
+			}
 		}
 	}
 };
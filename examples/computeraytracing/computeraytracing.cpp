@@ -5,6 +5,7 @@
 * Shader storage buffers are used to pass geometry information for spheres and planes to the computer shader
 * The compute shader then uses these as the scene geometry for ray tracing and outputs the results to a storage image
 * The graphics part of the sample then displays that image full screen
+* Triangle meshes loaded from glTF files are traced through a bounding volume hierarchy (BVH) that is built on the CPU
 * Not to be confused with actual hardware accelerated ray tracing
 *
 * Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
@@ -12,7 +13,10 @@
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
+#include <unordered_set>
 #include "vulkanexamplebase.h"
+#include "VulkanglTFModel.h"
+#include "VulkanBVH.h"
 
 class VulkanExample : public VulkanExampleBase
 {
@@ -51,6 +55,9 @@ public:
 		// Object properties for planes and spheres are passed via a shade storage buffer
 		// There is no vertex data, the compute shader calculates the primitives on the fly
 		vks::Buffer objectStorageBuffer;
+		// BVH nodes and the triangles they reference for the mesh scene
+		vks::Buffer bvhNodeBuffer;
+		vks::Buffer triangleBuffer;
 		// Uniform buffer object containing scene parameters
 		// These need to be per frames in flight, as CPU writes to while GPU reads from
 		std::array<vks::Buffer, maxConcurrentFrames> uniformBuffers;
@@ -76,6 +83,59 @@ public:
 		glm::ivec2 _pad;
 	};
 
+	// Triangle meshes that can be added to the scene, these are traced through a BVH built on the CPU
+	struct MeshScene {
+		std::string name;
+		std::string file;
+	};
+	const std::vector<MeshScene> meshScenes{
+		{ "None", "" },
+		{ "Venus", "models/venus.gltf" },
+		{ "Chinese dragon", "models/chinesedragon.gltf" },
+		{ "Sponza", "models/sponza/sponza.gltf" }
+	};
+	int32_t meshSceneIndex{ 2 };
+	// Number of threads used to build the BVH, the mesh scene is rebuilt if this or the selected mesh changes
+	int32_t bvhBuildThreads{ 0 };
+	bool meshSceneChanged{ false };
+	// Largest extent of a mesh after scaling it to fit into the room
+	const float meshSceneSize{ 5.0f };
+
+	// Compact BVH node layout read by the compute shader (32 bytes per node)
+	// Inner nodes store the index of their first child (the second child directly follows it) and a triangle count of zero
+	// Leaves store the range of their triangles, which are reordered so that each leaf's triangles are contiguous
+	struct BVHNode {
+		glm::vec3 min;
+		uint32_t childOrFirstTriangle;
+		glm::vec3 max;
+		uint32_t triangleCount;
+	};
+	// Vertex positions, the octahedral encoded vertex normals are stored in the fourth components (48 bytes per triangle)
+	struct Triangle {
+		glm::vec3 v0;
+		uint32_t n0;
+		glm::vec3 v1;
+		uint32_t n1;
+		glm::vec3 v2;
+		uint32_t n2;
+	};
+	struct MeshStats {
+		uint32_t triangleCount{ 0 };
+		uint32_t nodeCount{ 0 };
+		uint32_t depth{ 0 };
+		float sahCost{ 0.0f };
+		double buildTime{ 0.0 };
+	} meshStats;
+
+	// Timestamps around the ray tracing dispatch, one pair per frame in flight
+	struct Timing {
+		bool supported{ false };
+		VkQueryPool queryPool{ VK_NULL_HANDLE };
+		std::array<bool, maxConcurrentFrames> written{};
+		// GPU time of the last dispatch in milliseconds
+		float dispatchTime{ 0.0f };
+	} timing;
+
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Compute shader ray tracing";
@@ -86,6 +146,7 @@ public:
 		camera.setTranslation(glm::vec3(0.0f, 0.0f, -4.0f));
 		camera.rotationSpeed = 0.0f;
 		camera.movementSpeed = 2.5f;
+		bvhBuildThreads = static_cast<int32_t>(std::max(std::thread::hardware_concurrency(), 1u));
 	}
 
 	~VulkanExample()
@@ -107,6 +168,9 @@ public:
 				buffer.destroy();
 			}
 			compute.objectStorageBuffer.destroy();
+			compute.bvhNodeBuffer.destroy();
+			compute.triangleBuffer.destroy();
+			vkDestroyQueryPool(device, timing.queryPool, nullptr);
 			storageImage.destroy();
 		}
 	}
@@ -216,6 +280,19 @@ public:
 		storageImage.device = vulkanDevice;
 	}
 
+	// Creates a device local storage buffer and fills it with the given data
+	void createStorageBuffer(vks::Buffer& buffer, const void* data, VkDeviceSize size)
+	{
+		vks::Buffer stagingBuffer;
+		vulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, size, const_cast<void*>(data));
+		vulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &buffer, size);
+		VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		VkBufferCopy copyRegion = { 0, 0, size };
+		vkCmdCopyBuffer(copyCmd, stagingBuffer.buffer, buffer.buffer, 1, &copyRegion);
+		vulkanDevice->flushCommandBuffer(copyCmd, queue, true);
+		stagingBuffer.destroy();
+	}
+
 	// Setup and fill the compute shader storage buffes containing object definitions for the raytraced scene
 	void prepareStorageBuffers()
 	{
@@ -247,9 +324,12 @@ public:
 			sceneObjects.push_back(plane);
 			};
 
-		addSphere(glm::vec3(1.75f, -0.5f, 0.0f), 1.0f, glm::vec3(0.0f, 1.0f, 0.0f), 32.0f);
-		addSphere(glm::vec3(0.0f, 1.0f, -0.5f), 1.0f, glm::vec3(0.65f, 0.77f, 0.97f), 32.0f);
-		addSphere(glm::vec3(-1.75f, -0.75f, -0.5f), 1.25f, glm::vec3(0.9f, 0.76f, 0.46f), 32.0f);
+		// The spheres would intersect the mesh, so they're only added if no mesh is displayed
+		if (meshScenes[meshSceneIndex].file.empty()) {
+			addSphere(glm::vec3(1.75f, -0.5f, 0.0f), 1.0f, glm::vec3(0.0f, 1.0f, 0.0f), 32.0f);
+			addSphere(glm::vec3(0.0f, 1.0f, -0.5f), 1.0f, glm::vec3(0.65f, 0.77f, 0.97f), 32.0f);
+			addSphere(glm::vec3(-1.75f, -0.75f, -0.5f), 1.25f, glm::vec3(0.9f, 0.76f, 0.46f), 32.0f);
+		}
 
 		const float roomDim = 4.0f;
 		addPlane(glm::vec3(0.0f, 1.0f, 0.0f), roomDim, glm::vec3(1.0f), 32.0f);
@@ -259,18 +339,114 @@ public:
 		addPlane(glm::vec3(-1.0f, 0.0f, 0.0f), roomDim, glm::vec3(1.0f, 0.0f, 0.0f), 32.0f);
 		addPlane(glm::vec3(1.0f, 0.0f, 0.0f), roomDim, glm::vec3(0.0f, 1.0f, 0.0f), 32.0f);
 
-		VkDeviceSize storageBufferSize = sceneObjects.size() * sizeof(SceneObject);
-
 		// Copy the data to the device
-		vks::Buffer stagingBuffer;
-		vulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, storageBufferSize, sceneObjects.data());
-		vulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &compute.objectStorageBuffer, storageBufferSize);
-		VkCommandBuffer copyCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		VkBufferCopy copyRegion = { 0, 0, storageBufferSize};
-		vkCmdCopyBuffer(copyCmd, stagingBuffer.buffer, compute.objectStorageBuffer.buffer, 1, &copyRegion);
-		vulkanDevice->flushCommandBuffer(copyCmd, queue, true);
+		createStorageBuffer(compute.objectStorageBuffer, sceneObjects.data(), sceneObjects.size() * sizeof(SceneObject));
+	}
 
-		stagingBuffer.destroy();
+	// Octahedral encoding of a unit vector, stored as two 16 bit signed normalized values
+	uint32_t packNormal(glm::vec3 normal)
+	{
+		normal /= (fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z));
+		glm::vec2 encoded = glm::vec2(normal.x, normal.y);
+		if (normal.z < 0.0f) {
+			encoded.x = (1.0f - fabsf(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+			encoded.y = (1.0f - fabsf(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		const int16_t x = static_cast<int16_t>(roundf(std::clamp(encoded.x, -1.0f, 1.0f) * 32767.0f));
+		const int16_t y = static_cast<int16_t>(roundf(std::clamp(encoded.y, -1.0f, 1.0f) * 32767.0f));
+		return static_cast<uint32_t>(static_cast<uint16_t>(x)) | (static_cast<uint32_t>(static_cast<uint16_t>(y)) << 16);
+	}
+
+	// Loads the selected mesh, builds a BVH over its triangles and uploads the nodes and triangles for the compute shader
+	void prepareMeshScene()
+	{
+		std::vector<BVHNode> nodes;
+		std::vector<Triangle> triangles;
+		meshStats = {};
+
+		const MeshScene& meshScene = meshScenes[meshSceneIndex];
+		if (!meshScene.file.empty()) {
+			// Only the geometry is used, it's pre-transformed into a single space and flipped to match the ray tracer's y axis
+			vkglTF::Model model;
+			model.loadFromFile(getAssetPath() + meshScene.file, vulkanDevice, queue, vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::FlipY | vkglTF::FileLoadingFlags::DontLoadImages | vkglTF::FileLoadingFlags::KeepGeometry);
+
+			// Gather the triangles of all mesh primitives and fit them into the room
+			std::vector<Triangle> sourceTriangles;
+			std::unordered_set<uint32_t> gatheredPrimitives;
+			vks::AABB sceneBounds;
+			for (vkglTF::Node* node : model.linearNodes) {
+				if (!node->mesh) {
+					continue;
+				}
+				for (vkglTF::Primitive* primitive : node->mesh->primitives) {
+					if (!gatheredPrimitives.insert(primitive->firstIndex).second) {
+						continue;
+					}
+					for (uint32_t i = 0; i + 2 < primitive->indexCount; i += 3) {
+						const vkglTF::Vertex& v0 = model.vertexData[model.indexData[primitive->firstIndex + i + 0]];
+						const vkglTF::Vertex& v1 = model.vertexData[model.indexData[primitive->firstIndex + i + 1]];
+						const vkglTF::Vertex& v2 = model.vertexData[model.indexData[primitive->firstIndex + i + 2]];
+						sourceTriangles.push_back({ v0.pos, packNormal(v0.normal), v1.pos, packNormal(v1.normal), v2.pos, packNormal(v2.normal) });
+						sceneBounds.extend(v0.pos);
+						sceneBounds.extend(v1.pos);
+						sceneBounds.extend(v2.pos);
+					}
+				}
+			}
+
+			if (!sourceTriangles.empty()) {
+				const glm::vec3 extent = sceneBounds.max - sceneBounds.min;
+				const float scale = meshSceneSize / std::max(std::max(extent.x, extent.y), std::max(extent.z, FLT_MIN));
+				const glm::vec3 center = sceneBounds.center();
+				std::vector<vks::AABB> triangleBounds(sourceTriangles.size());
+				for (size_t i = 0; i < sourceTriangles.size(); i++) {
+					Triangle& triangle = sourceTriangles[i];
+					triangle.v0 = (triangle.v0 - center) * scale;
+					triangle.v1 = (triangle.v1 - center) * scale;
+					triangle.v2 = (triangle.v2 - center) * scale;
+					triangleBounds[i].extend(triangle.v0);
+					triangleBounds[i].extend(triangle.v1);
+					triangleBounds[i].extend(triangle.v2);
+				}
+
+				// POI: Build the BVH with a binned SAH on multiple threads
+				vks::BVH bvh;
+				bvh.threadCount = static_cast<uint32_t>(bvhBuildThreads);
+				const auto tStart = std::chrono::high_resolution_clock::now();
+				bvh.build(triangleBounds);
+				meshStats.buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+
+				// Convert to the compact GPU layout and store the triangles in leaf order
+				triangles.resize(sourceTriangles.size());
+				for (size_t i = 0; i < bvh.itemIndices.size(); i++) {
+					triangles[i] = sourceTriangles[bvh.itemIndices[i]];
+				}
+				nodes.resize(bvh.nodes.size());
+				std::vector<uint32_t> depths(bvh.nodes.size(), 1);
+				for (size_t i = 0; i < bvh.nodes.size(); i++) {
+					const vks::BVH::Node& node = bvh.nodes[i];
+					nodes[i] = { node.bounds.min, node.isLeaf() ? node.firstItem : node.child, node.bounds.max, node.isLeaf() ? node.itemCount : 0 };
+					// Children are always stored after their parent
+					if (!node.isLeaf()) {
+						depths[node.child] = depths[node.child + 1] = depths[i] + 1;
+					}
+					meshStats.depth = std::max(meshStats.depth, depths[i]);
+				}
+				meshStats.triangleCount = static_cast<uint32_t>(triangles.size());
+				meshStats.nodeCount = static_cast<uint32_t>(nodes.size());
+				meshStats.sahCost = bvh.buildCost;
+			}
+		}
+
+		// Storage buffers can't be empty, a root with inverted bounds is never hit by any ray
+		if (nodes.empty()) {
+			nodes.push_back({ glm::vec3(FLT_MAX), 0, glm::vec3(-FLT_MAX), 0 });
+		}
+		if (triangles.empty()) {
+			triangles.push_back({});
+		}
+		createStorageBuffer(compute.bvhNodeBuffer, nodes.data(), nodes.size() * sizeof(BVHNode));
+		createStorageBuffer(compute.triangleBuffer, triangles.data(), triangles.size() * sizeof(Triangle));
 	}
 
 	// The descriptor pool will be shared between graphics and compute
@@ -280,7 +456,7 @@ public:
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxConcurrentFrames * 2),
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxConcurrentFrames * 4),
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxConcurrentFrames * 1),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxConcurrentFrames * 2),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxConcurrentFrames * 3),
 		};
 		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, maxConcurrentFrames * 3);
 		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
@@ -387,15 +563,19 @@ public:
 
 		// Setup descriptors
 
-		// The compute pipeline uses one set and four bindings
+		// The compute pipeline uses one set and five bindings
 		// Binding 0: Storage image for raytraced output
 		// Binding 1: Uniform buffer with parameters
 		// Binding 2: Shader storage buffer with scene object definitions
+		// Binding 3: Shader storage buffer with the BVH nodes of the mesh scene
+		// Binding 4: Shader storage buffer with the triangles of the mesh scene
 
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 0),
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4),
 		};
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorLayout, nullptr,	&compute.descriptorSetLayout));
@@ -405,12 +585,16 @@ public:
 		for (auto i = 0; i < compute.uniformBuffers.size(); i++) {
 			VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &compute.descriptorSetLayout, 1);
 			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &compute.descriptorSets[i]));
-			std::vector<VkWriteDescriptorSet> computeWriteDescriptorSets = {
-				vks::initializers::writeDescriptorSet(compute.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &storageImage.descriptor),
-				vks::initializers::writeDescriptorSet(compute.descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, &compute.uniformBuffers[i].descriptor),
-				vks::initializers::writeDescriptorSet(compute.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &compute.objectStorageBuffer.descriptor),
-			};
-			vkUpdateDescriptorSets(device, static_cast<uint32_t>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, nullptr);
+		}
+		updateComputeDescriptorSets();
+
+		// Timestamps for measuring the ray tracing dispatch
+		timing.supported = vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.compute].timestampValidBits > 0;
+		if (timing.supported) {
+			VkQueryPoolCreateInfo queryPoolCI{ .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+			queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolCI.queryCount = maxConcurrentFrames * 2;
+			VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &timing.queryPool));
 		}
 
 		// Create the compute shader pipeline
@@ -422,6 +606,47 @@ public:
 		VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipeline));
 	}
 
+	// The scene buffers are recreated if the mesh scene changes, so the descriptors are written separately from allocating the sets
+	void updateComputeDescriptorSets()
+	{
+		for (auto i = 0; i < compute.uniformBuffers.size(); i++) {
+			std::vector<VkWriteDescriptorSet> computeWriteDescriptorSets = {
+				vks::initializers::writeDescriptorSet(compute.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &storageImage.descriptor),
+				vks::initializers::writeDescriptorSet(compute.descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, &compute.uniformBuffers[i].descriptor),
+				vks::initializers::writeDescriptorSet(compute.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &compute.objectStorageBuffer.descriptor),
+				vks::initializers::writeDescriptorSet(compute.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &compute.bvhNodeBuffer.descriptor),
+				vks::initializers::writeDescriptorSet(compute.descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &compute.triangleBuffer.descriptor),
+			};
+			vkUpdateDescriptorSets(device, static_cast<uint32_t>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, nullptr);
+		}
+	}
+
+	// Recreates the scene buffers after the mesh selection or the number of build threads changed
+	void rebuildMeshScene()
+	{
+		vkDeviceWaitIdle(device);
+		compute.objectStorageBuffer.destroy();
+		compute.bvhNodeBuffer.destroy();
+		compute.triangleBuffer.destroy();
+		prepareStorageBuffers();
+		prepareMeshScene();
+		updateComputeDescriptorSets();
+		timing.written.fill(false);
+		meshSceneChanged = false;
+	}
+
+	// Reads the timestamps written by the last dispatch for the current frame, the frame's fence must have been signaled
+	void readTimestamps()
+	{
+		if (!timing.supported || !timing.written[currentBuffer]) {
+			return;
+		}
+		std::array<uint64_t, 2> timestamps{};
+		if (vkGetQueryPoolResults(device, timing.queryPool, currentBuffer * 2, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+			timing.dispatchTime = (float)(timestamps[1] - timestamps[0]) * vulkanDevice->properties.limits.timestampPeriod / 1000000.0f;
+		}
+	}
+
 	void updateUniformBuffers()
 	{
 		compute.uniformData.aspectRatio = (float)width / (float)height;
@@ -437,6 +662,7 @@ public:
 		VulkanExampleBase::prepare();
 		prepareStorageImage();
 		prepareStorageBuffers();
+		prepareMeshScene();
 		setupDescriptorPool();
 		prepareGraphics();
 		prepareCompute();
@@ -574,11 +800,21 @@ public:
 				1, &imageMemoryBarrier);
 		}
 
+		if (timing.supported) {
+			vkCmdResetQueryPool(cmdBuffer, timing.queryPool, currentBuffer * 2, 2);
+			vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timing.queryPool, currentBuffer * 2);
+		}
+
 		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipeline);
 		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineLayout, 0, 1, &compute.descriptorSets[currentBuffer], 0, nullptr);
 
 		vkCmdDispatch(cmdBuffer, storageImage.width / 16, storageImage.height / 16, 1);
 
+		if (timing.supported) {
+			vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timing.queryPool, currentBuffer * 2 + 1);
+			timing.written[currentBuffer] = true;
+		}
+
 		if (vulkanDevice->queueFamilyIndices.graphics != vulkanDevice->queueFamilyIndices.compute)
 		{
 			// Release barrier from compute queue
@@ -604,9 +840,14 @@ public:
 		if (!prepared)
 			return;
 
+		if (meshSceneChanged) {
+			rebuildMeshScene();
+		}
+
 		// Use a fence to ensure that compute command buffer has finished executing before using it again
 		vkWaitForFences(device, 1, &compute.fences[currentBuffer], VK_TRUE, UINT64_MAX);
 		vkResetFences(device, 1, &compute.fences[currentBuffer]);
+		readTimestamps();
 
 		updateUniformBuffers();
 		buildComputeCommandBuffer();
@@ -620,6 +861,34 @@ public:
 		buildGraphicsCommandBuffer();
 		VulkanExampleBase::submitFrame();
 	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay* overlay)
+	{
+		if (overlay->header("Mesh scene")) {
+			std::vector<std::string> names;
+			for (const MeshScene& meshScene : meshScenes) {
+				names.push_back(meshScene.name);
+			}
+			if (overlay->comboBox("Mesh", &meshSceneIndex, names)) {
+				meshSceneChanged = true;
+			}
+			if (overlay->sliderInt("Build threads", &bvhBuildThreads, 1, static_cast<int32_t>(std::max(std::thread::hardware_concurrency(), 1u)))) {
+				meshSceneChanged = true;
+			}
+			overlay->text("Triangles: %d", meshStats.triangleCount);
+			overlay->text("BVH nodes: %d (depth %d)", meshStats.nodeCount, meshStats.depth);
+			overlay->text("SAH cost: %.1f", meshStats.sahCost);
+			overlay->text("Build time: %.2f ms", meshStats.buildTime);
+		}
+		if (timing.supported && overlay->header("Performance")) {
+			// Only primary rays are counted, shadow rays and reflections add up to five more rays per pixel
+			const float primaryRays = static_cast<float>(storageImage.width * storageImage.height);
+			overlay->text("Dispatch: %.2f ms", timing.dispatchTime);
+			if (timing.dispatchTime > 0.0f) {
+				overlay->text("Primary rays: %.1f M/s", primaryRays / (timing.dispatchTime * 1000.0f));
+			}
+		}
+	}
 };
 
 VULKAN_EXAMPLE_MAIN()
@@ -5,6 +5,8 @@
 *
 * With conditional rendering it's possible to execute certain rendering commands based on a buffer value instead of having to rebuild the command buffers.
 * This example sets up a conditional buffer with one value per glTF part, that is used to toggle visibility of single model parts.
+* For comparison, the visible parts can also be drawn with instanced draws, nodes that share a glTF mesh are then drawn with a single draw per primitive.
+* The per-node draws can also be recorded into secondary command buffers on multiple threads, as visibility is evaluated on the GPU these are recorded once per frame in flight and reused afterwards.
 *
 * Copyright (C) 2018-2025 by Sascha Willems - www.saschawillems.de
 *
@@ -34,6 +36,18 @@ public:
 
 	VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
 	VkPipeline pipeline{ VK_NULL_HANDLE };
+	// Takes the node matrices from the model's instance buffer instead of the per-node uniform buffers
+	VkPipeline instancedPipeline{ VK_NULL_HANDLE };
+
+	bool instancedDraws{ false };
+	// Record the per-node draws on multiple threads with the model's parallel draw, optionally re-recording every frame to measure the recording cost
+	bool parallelRecording{ false };
+	bool rerecordEveryFrame{ false };
+	int32_t recordingThreads{ 1 };
+	uint32_t preparedRecordingThreads{ 0 };
+	// The UI has to be drawn from a secondary command buffer too, if the render pass contents are secondary command buffers
+	std::array<VkCommandBuffer, maxConcurrentFrames> uiCommandBuffers{};
+	uint32_t drawCalls{ 0 };
 	VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
 	std::array<VkDescriptorSet, maxConcurrentFrames> descriptorSets{};
 
@@ -45,6 +59,7 @@ public:
 		camera.setRotation(glm::vec3(-2.25f, -52.0f, 0.0f));
 		camera.setTranslation(glm::vec3(1.9f, -2.05f, -18.0f));
 		camera.rotationSpeed *= 0.25f;
+		recordingThreads = static_cast<int32_t>(std::max(std::thread::hardware_concurrency(), 1u));
 
 		/*
 			[POI] Enable extension required for conditional rendering
@@ -57,6 +72,7 @@ public:
 	{
 		if (device) {
 			vkDestroyPipeline(device, pipeline, nullptr);
+			vkDestroyPipeline(device, instancedPipeline, nullptr);
 			vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 			for (auto& buffer : uniformBuffers) {
@@ -68,15 +84,12 @@ public:
 		}
 	}
 
-	void renderNode(vkglTF::Node *node, VkCommandBuffer commandBuffer) {
+	void renderNodePrimitives(vkglTF::Node* node, VkCommandBuffer commandBuffer) {
 		if (node->mesh) {
+			// All nodes share the model's node descriptor set, the node's matrix is selected with a dynamic offset into the node buffer
+			const uint32_t dynamicOffset = scene.getNodeDataOffset(node, currentBuffer);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &scene.nodeBuffer.descriptorSet, 1, &dynamicOffset);
 			for (vkglTF::Primitive * primitive : node->mesh->primitives) {
-				const std::vector<VkDescriptorSet> descriptorsets = {
-					descriptorSets[currentBuffer],
-					node->mesh->uniformBuffer.descriptorSet
-				};
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, static_cast<uint32_t>(descriptorsets.size()), descriptorsets.data(), 0, NULL);
-
 				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(primitive->material.baseColorFactor), &primitive->material.baseColorFactor);
 
 				/*
@@ -100,14 +113,118 @@ public:
 			}
 
 		};
+	}
+
+	void renderNode(vkglTF::Node *node, VkCommandBuffer commandBuffer) {
+		renderNodePrimitives(node, commandBuffer);
+		if (node->mesh) {
+			drawCalls += static_cast<uint32_t>(node->mesh->primitives.size());
+		}
 		for (auto child : node->children) {
 			renderNode(child, commandBuffer);
 		}
 	}
 
-		void loadAssets()
+	/*
+		[POI] Instanced alternative
+
+		Visibility is evaluated on the host, the world matrices of all visible nodes are written to the model's instance buffer grouped by glTF mesh
+		Nodes referencing the same glTF mesh share the same geometry, so every primitive of a group is drawn once with all of the group's visible nodes as instances
+	*/
+	void renderInstanced(VkCommandBuffer commandBuffer)
+	{
+		for (auto node : scene.linearNodes) {
+			node->visible = conditionalVisibility[node->index] != 0;
+		}
+		scene.updateInstances(currentBuffer);
+		const VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, &scene.instanceBuffers[currentBuffer].buffer, offsets);
+		for (auto& group : scene.instanceGroups) {
+			if (group.instanceCount == 0) {
+				continue;
+			}
+			for (vkglTF::Primitive* primitive : group.mesh->primitives) {
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(primitive->material.baseColorFactor), &primitive->material.baseColorFactor);
+				vkCmdDrawIndexed(commandBuffer, primitive->indexCount, group.instanceCount, primitive->firstIndex, 0, group.firstInstance);
+				drawCalls++;
+			}
+		}
+	}
+
+	/*
+		[POI] Parallel recording
+
+		The model splits its mesh nodes into one partition per thread, each partition is recorded into its own secondary command buffer
+		Secondary command buffers don't inherit any state from the primary command buffer, so pipeline, viewport, descriptors and buffers are set at the start of each of them
+		Visibility is toggled with the conditional buffer and not by changing node visibility, so the recorded command buffers can be reused until the key changes
+	*/
+	void renderParallel(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo& renderPassBeginInfo)
 	{
+		if (preparedRecordingThreads != static_cast<uint32_t>(recordingThreads)) {
+			// Secondary command buffers of the old partitions may still be in use by frames in flight
+			vkDeviceWaitIdle(device);
+			scene.prepareParallelDraw(static_cast<uint32_t>(recordingThreads), maxConcurrentFrames, swapChain.queueNodeIndex);
+			preparedRecordingThreads = static_cast<uint32_t>(recordingThreads);
+		}
+		scene.updateNodeBuffer(currentBuffer);
+
+		vkglTF::ParallelDrawInfo drawInfo{};
+		drawInfo.frameIndex = currentBuffer;
+		drawInfo.inheritanceInfo = vks::initializers::commandBufferInheritanceInfo();
+		drawInfo.inheritanceInfo.renderPass = renderPassBeginInfo.renderPass;
+		drawInfo.beginCommands = [this](VkCommandBuffer secondary) {
+			VkViewport viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
+			vkCmdSetViewport(secondary, 0, 1, &viewport);
+			VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
+			vkCmdSetScissor(secondary, 0, 1, &scissor);
+			vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentBuffer], 0, nullptr);
+			vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			const VkDeviceSize offsets[1] = { 0 };
+			vkCmdBindVertexBuffers(secondary, 0, 1, &scene.vertices.buffer, offsets);
+			vkCmdBindIndexBuffer(secondary, scene.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		};
+		drawInfo.nodeCommands = [this](VkCommandBuffer secondary, vkglTF::Node* node) {
+			renderNodePrimitives(node, secondary);
+		};
+		// The viewport and all handles bound by the recorded commands are part of the key, so recreating any of them (e.g. on resize) invalidates the recorded command buffers
+		const uint64_t state[10] = {
+			width,
+			height,
+			rerecordEveryFrame ? frameCounter : 0,
+			(uint64_t)pipeline,
+			(uint64_t)pipelineLayout,
+			(uint64_t)descriptorSets[currentBuffer],
+			(uint64_t)scene.nodeBuffer.descriptorSet,
+			(uint64_t)scene.vertices.buffer,
+			(uint64_t)scene.indices.buffer,
+			(uint64_t)conditionalBuffers[currentBuffer].buffer
+		};
+		drawInfo.stateKey = vkglTF::ResourceCache::hash(state, sizeof(state));
+		scene.drawParallel(commandBuffer, drawInfo);
+
+		drawCalls = 0;
+		for (auto node : scene.meshNodes) {
+			drawCalls += static_cast<uint32_t>(node->mesh->primitives.size());
+		}
+
+		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::commandBufferBeginInfo();
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		commandBufferBeginInfo.pInheritanceInfo = &drawInfo.inheritanceInfo;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(uiCommandBuffers[currentBuffer], &commandBufferBeginInfo));
+		VkViewport viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
+		vkCmdSetViewport(uiCommandBuffers[currentBuffer], 0, 1, &viewport);
+		VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
+		vkCmdSetScissor(uiCommandBuffers[currentBuffer], 0, 1, &scissor);
+		drawUI(uiCommandBuffers[currentBuffer]);
+		VK_CHECK_RESULT(vkEndCommandBuffer(uiCommandBuffers[currentBuffer]));
+		vkCmdExecuteCommands(commandBuffer, 1, &uiCommandBuffers[currentBuffer]);
+	}
+
+	void loadAssets()
+	{
+		vkglTF::nodeBufferFrameCount = maxConcurrentFrames;
 		scene.loadFromFile(getAssetPath() + "models/gltf/glTF-Embedded/Buggy.gltf", vulkanDevice, queue);
+		scene.prepareInstances(maxConcurrentFrames);
 	}
 
 	void setupDescriptors()
@@ -182,6 +299,23 @@ public:
 		pipelineCI.pStages = shaderStages.data();
 
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipeline));
+
+		// Instanced pipeline: The node matrix is read from a second vertex buffer that advances per instance
+		const std::vector<VkVertexInputBindingDescription> vertexInputBindings = {
+			vkglTF::Vertex::inputBindingDescription(0),
+			vkglTF::Vertex::instanceInputBindingDescription(1),
+		};
+		std::vector<VkVertexInputAttributeDescription> vertexInputAttributes = vkglTF::Vertex::inputAttributeDescriptions(0, { vkglTF::VertexComponent::Position, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::UV });
+		const std::vector<VkVertexInputAttributeDescription> instanceAttributes = vkglTF::Vertex::instanceInputAttributeDescriptions(1, 3);
+		vertexInputAttributes.insert(vertexInputAttributes.end(), instanceAttributes.begin(), instanceAttributes.end());
+		VkPipelineVertexInputStateCreateInfo vertexInputStateCI = vks::initializers::pipelineVertexInputStateCreateInfo(vertexInputBindings, vertexInputAttributes);
+		pipelineCI.pVertexInputState = &vertexInputStateCI;
+		const std::array<VkPipelineShaderStageCreateInfo, 2> instancedShaderStages = {
+			loadShader(getShadersPath() + "conditionalrender/modelinstanced.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
+			loadShader(getShadersPath() + "conditionalrender/model.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+		};
+		pipelineCI.pStages = instancedShaderStages.data();
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &instancedPipeline));
 	}
 
 	void prepareUniformBuffers()
@@ -260,6 +394,8 @@ public:
 		loadAssets();
 		prepareConditionalRendering();
 		prepareUniformBuffers();
+		VkCommandBufferAllocateInfo commandBufferAI = vks::initializers::commandBufferAllocateInfo(cmdPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, maxConcurrentFrames);
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAI, uiCommandBuffers.data()));
 		setupDescriptors();
 		preparePipelines();
 		prepared = true;
@@ -286,18 +422,31 @@ public:
 		renderPassBeginInfo.framebuffer = frameBuffers[currentImageIndex];
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
+		if (parallelRecording && !instancedDraws) {
+			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			renderParallel(cmdBuffer, renderPassBeginInfo);
+			vkCmdEndRenderPass(cmdBuffer);
+			VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+			return;
+		}
 		vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 		VkViewport viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
 		vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
 		VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
 		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentBuffer], 0, nullptr);
-		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instancedDraws ? instancedPipeline : pipeline);
 		const VkDeviceSize offsets[1] = { 0 };
 		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &scene.vertices.buffer, offsets);
 		vkCmdBindIndexBuffer(cmdBuffer, scene.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-		for (auto node : scene.nodes) {
-			renderNode(node, cmdBuffer);
+		drawCalls = 0;
+		if (instancedDraws) {
+			renderInstanced(cmdBuffer);
+		} else {
+			scene.updateNodeBuffer(currentBuffer);
+			for (auto node : scene.nodes) {
+				renderNode(node, cmdBuffer);
+			}
 		}
 		drawUI(cmdBuffer);
 		vkCmdEndRenderPass(cmdBuffer);
@@ -317,6 +466,30 @@ public:
 
 	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
 	{
+		if (overlay->header("Settings")) {
+			overlay->checkBox("Instanced draws", &instancedDraws);
+			if (!instancedDraws) {
+				overlay->checkBox("Parallel recording", &parallelRecording);
+				if (parallelRecording) {
+					overlay->sliderInt("Recording threads", &recordingThreads, 1, static_cast<int32_t>(std::max(std::thread::hardware_concurrency(), 1u)));
+					overlay->checkBox("Re-record every frame", &rerecordEveryFrame);
+				}
+			}
+		}
+		if (overlay->header("Statistics")) {
+			overlay->text("Mesh nodes: %d (%d unique meshes)", scene.stats.meshNodes, scene.stats.uniqueMeshes);
+			overlay->text("Vertex buffer: %.1f KB (%.1f KB unshared)", scene.stats.vertexBufferSize / 1024.0f, scene.stats.unsharedVertexBufferSize / 1024.0f);
+			overlay->text("Index buffer: %.1f KB (%.1f KB unshared)", scene.stats.indexBufferSize / 1024.0f, scene.stats.unsharedIndexBufferSize / 1024.0f);
+			overlay->text("Load time: %.1f ms (geometry %.1f ms on %d threads)", scene.stats.loadTime, scene.stats.extractionTime, scene.stats.extractionThreads);
+			overlay->text("File size: %.1f KB", scene.stats.fileSize / 1024.0f);
+			if (scene.stats.compressedSize > 0) {
+				overlay->text("Meshopt: %.1f KB -> %.1f KB in %.1f ms (%.0f MB/s)", scene.stats.compressedSize / 1024.0f, scene.stats.decodedSize / 1024.0f, scene.stats.decodeTime, scene.stats.decodedSize / (1024.0 * 1024.0) / std::max(scene.stats.decodeTime / 1000.0, 1e-6));
+			}
+			overlay->text("Draw calls: %d", drawCalls);
+			if (parallelRecording && !instancedDraws) {
+				overlay->text("Recording: %.3f ms (%d of %d partitions)", scene.stats.parallelDrawTime, scene.stats.parallelDrawRecorded, static_cast<int32_t>(scene.parallelDraw.partitions.size()));
+			}
+		}
 		if (overlay->header("Visibility")) {
 
 			if (overlay->button("All")) {
@@ -5,15 +5,28 @@
 * albedo, normals, world positions are rendered to offscreen images which are then put together and lit
 * in a composition pass
 * Use the dropdown in the ui to switch between the final composition pass or the separate components
-* 
-* 
-* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* Lighting uses clustered light culling: A compute pass bins thousands of point and spot lights into view space
+* clusters (froxels), so the composition pass only needs to evaluate the lights affecting a fragment's cluster
+* This can be toggled against a brute force loop over all lights, and GPU times for both are measured with timestamp queries
+*
+* Copyright (C) 2016-2026 by Sascha Willems - www.saschawillems.de
 *
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanRenderGraph.h"
+#include "VulkanTransientAllocator.h"
+
+// Must match the defines in the composition and light culling shaders
+constexpr uint32_t clusterCountX{ 16 };
+constexpr uint32_t clusterCountY{ 9 };
+constexpr uint32_t clusterCountZ{ 24 };
+constexpr uint32_t clusterCount{ clusterCountX * clusterCountY * clusterCountZ };
+constexpr uint32_t maxLightsPerCluster{ 256 };
+constexpr uint32_t maxLightCount{ 10240 };
 
 class VulkanExample : public VulkanExampleBase
 {
@@ -44,20 +57,40 @@ public:
 	} uniformDataOffscreen;
 
 	struct Light {
+		// xyz = position, w = range
 		glm::vec4 position;
-		glm::vec3 color;
-		float radius;
+		// rgb = color, a = intensity
+		glm::vec4 color;
+		// xyz = spot direction, w = cosine of the spot cone angle (-1 for point lights)
+		glm::vec4 direction;
 	};
+	// Initial light setup and per-light animation parameters (x = orbit radius, y = speed, z = phase)
+	std::vector<Light> lights;
+	std::vector<glm::vec3> lightAnimation;
+	int32_t lightCount{ 1024 };
+	bool clusteredLighting{ true };
 
 	struct UniformDataComposition {
-		Light lights[6];
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 inverseProjection;
 		glm::vec4 viewPos;
 		int debugDisplayTarget = 0;
+		uint32_t lightCount{ 0 };
+		uint32_t clustered{ 1 };
+		float zNear{ 0.0f };
+		float zFar{ 0.0f };
 	} uniformDataComposition;
 
 	struct UniformBuffers {
 		vks::Buffer offscreen;
 		vks::Buffer composition;
+		// Lights are written by the CPU to a staging buffer and copied to device local memory
+		vks::Buffer lightsStaging;
+		vks::Buffer lights;
+		// Per-cluster light counts and index lists written by the light culling compute pass
+		vks::Buffer lightGrid;
+		vks::Buffer lightIndices;
 	};
 	std::array<UniformBuffers, maxConcurrentFrames> uniformBuffers;
 
@@ -65,8 +98,36 @@ public:
 	struct {
 		VkPipeline offscreen{ VK_NULL_HANDLE };
 		VkPipeline composition{ VK_NULL_HANDLE };
+		VkPipeline lightCulling{ VK_NULL_HANDLE };
 	} pipelines;
 
+	// GPU times for light culling and composition, measured with timestamp queries (four per frame in flight)
+	struct {
+		bool supported{ false };
+		VkQueryPool queryPool{ VK_NULL_HANDLE };
+		std::array<bool, maxConcurrentFrames> written{};
+		float culling{ 0.0f };
+		float composition{ 0.0f };
+	} gpuTimes;
+
+	// Measures GPU times for a range of light counts with and without clustering
+	struct {
+		bool active{ false };
+		const std::vector<int32_t> lightCounts{ 1024, 2048, 4096, 8192, 10240 };
+		uint32_t step{ 0 };
+		uint32_t frame{ 0 };
+		double accumulated{ 0.0 };
+		double bruteForce{ 0.0 };
+		struct Result {
+			int32_t lightCount;
+			double bruteForce;
+			double clustered;
+		};
+		std::vector<Result> results;
+		int32_t previousLightCount{ 0 };
+		bool previousClusteredLighting{ true };
+	} lightSweep;
+
 	VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
 	struct DescriptorSets {
 		VkDescriptorSet model{ VK_NULL_HANDLE };
@@ -78,7 +139,6 @@ public:
 	// Framebuffers holding the deferred attachments
 	struct FrameBufferAttachment {
 		VkImage image;
-		VkDeviceMemory mem;
 		VkImageView view;
 		VkFormat format;
 	};
@@ -93,10 +153,18 @@ public:
 
 	// One sampler for the frame buffer color attachments
 	VkSampler colorSampler{ VK_NULL_HANDLE };
+	// Owns the memory of the G-Buffer attachments
+	vks::TransientAllocator transientAllocator;
+
+	// The passes are declared in a render graph that takes care of barriers and layout transitions
+	vks::RenderGraph renderGraph;
+	VkPhysicalDeviceVulkan13Features enabledFeatures13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
 
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Deferred shading";
+		// The render graph uses synchronization2 if available
+		apiVersion = VK_API_VERSION_1_3;
 		camera.type = Camera::CameraType::firstperson;
 		camera.movementSpeed = 5.0f;
 #ifndef __ANDROID__
@@ -112,20 +180,17 @@ public:
 		if (device) {
 			vkDestroySampler(device, colorSampler, nullptr);
 			vkDestroyImageView(device, offScreenFrameBuf.position.view, nullptr);
-			vkDestroyImage(device, offScreenFrameBuf.position.image, nullptr);
-			vkFreeMemory(device, offScreenFrameBuf.position.mem, nullptr);
 			vkDestroyImageView(device, offScreenFrameBuf.normal.view, nullptr);
-			vkDestroyImage(device, offScreenFrameBuf.normal.image, nullptr);
-			vkFreeMemory(device, offScreenFrameBuf.normal.mem, nullptr);
 			vkDestroyImageView(device, offScreenFrameBuf.albedo.view, nullptr);
-			vkDestroyImage(device, offScreenFrameBuf.albedo.image, nullptr);
-			vkFreeMemory(device, offScreenFrameBuf.albedo.mem, nullptr);
 			vkDestroyImageView(device, offScreenFrameBuf.depth.view, nullptr);
-			vkDestroyImage(device, offScreenFrameBuf.depth.image, nullptr);
-			vkFreeMemory(device, offScreenFrameBuf.depth.mem, nullptr);
+			transientAllocator.destroy();
 			vkDestroyFramebuffer(device, offScreenFrameBuf.frameBuffer, nullptr);
 			vkDestroyPipeline(device, pipelines.composition, nullptr);
 			vkDestroyPipeline(device, pipelines.offscreen, nullptr);
+			vkDestroyPipeline(device, pipelines.lightCulling, nullptr);
+			if (gpuTimes.queryPool != VK_NULL_HANDLE) {
+				vkDestroyQueryPool(device, gpuTimes.queryPool, nullptr);
+			}
 			vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 			vkDestroyRenderPass(device, offScreenFrameBuf.renderPass, nullptr);
@@ -136,6 +201,10 @@ public:
 			for (auto& buffer : uniformBuffers) {
 				buffer.offscreen.destroy();
 				buffer.composition.destroy();
+				buffer.lightsStaging.destroy();
+				buffer.lights.destroy();
+				buffer.lightGrid.destroy();
+				buffer.lightIndices.destroy();
 			}
 		}
 	}
@@ -147,34 +216,29 @@ public:
 		if (deviceFeatures.samplerAnisotropy) {
 			enabledFeatures.samplerAnisotropy = VK_TRUE;
 		}
+		if (deviceProperties.apiVersion >= VK_API_VERSION_1_3) {
+			VkPhysicalDeviceVulkan13Features features13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
+			VkPhysicalDeviceFeatures2 deviceFeatures2{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &features13 };
+			vkGetPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures2);
+			if (features13.synchronization2) {
+				enabledFeatures13.synchronization2 = VK_TRUE;
+				deviceCreatepNextChain = &enabledFeatures13;
+				renderGraph.synchronization2 = true;
+			}
+		}
 	};
 
-	// Create a frame buffer attachment
+	// Create the image of a frame buffer attachment, memory is allocated for all attachments at once by the transient allocator
+	// firstPass and lastPass are the indices of the first and last pass of the render graph using the attachment
 	void createAttachment(
 		VkFormat format,
-		VkImageUsageFlagBits usage,
-		FrameBufferAttachment *attachment)
+		VkImageUsageFlags usage,
+		FrameBufferAttachment *attachment,
+		uint32_t firstPass,
+		uint32_t lastPass)
 	{
-		VkImageAspectFlags aspectMask = 0;
-		VkImageLayout imageLayout;
-
 		attachment->format = format;
 
-		if (usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
-		{
-			aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		}
-		if (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
-		{
-			aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-			if (format >= VK_FORMAT_D16_UNORM_S8_UINT)
-				aspectMask |=VK_IMAGE_ASPECT_STENCIL_BIT;
-			imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		}
-
-		assert(aspectMask > 0);
-
 		VkImageCreateInfo image = vks::initializers::imageCreateInfo();
 		image.imageType = VK_IMAGE_TYPE_2D;
 		image.format = format;
@@ -185,21 +249,16 @@ public:
 		image.arrayLayers = 1;
 		image.samples = VK_SAMPLE_COUNT_1_BIT;
 		image.tiling = VK_IMAGE_TILING_OPTIMAL;
-		image.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
-
-		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
-
-		VK_CHECK_RESULT(vkCreateImage(device, &image, nullptr, &attachment->image));
-		vkGetImageMemoryRequirements(device, attachment->image, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-		memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &attachment->mem));
-		VK_CHECK_RESULT(vkBindImageMemory(device, attachment->image, attachment->mem, 0));
+		image.usage = usage;
+		attachment->image = transientAllocator.createImage(image, firstPass, lastPass);
+	}
 
+	// Create the view of a frame buffer attachment, this can only be done once memory has been bound to the image
+	void createAttachmentView(FrameBufferAttachment *attachment, VkImageAspectFlags aspectMask)
+	{
 		VkImageViewCreateInfo imageView = vks::initializers::imageViewCreateInfo();
 		imageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		imageView.format = format;
+		imageView.format = attachment->format;
 		imageView.subresourceRange = {};
 		imageView.subresourceRange.aspectMask = aspectMask;
 		imageView.subresourceRange.baseMipLevel = 0;
@@ -217,25 +276,27 @@ public:
 		offScreenFrameBuf.width = 2048;
 		offScreenFrameBuf.height = 2048;
 
-		// Color attachments
+		transientAllocator.create(vulkanDevice);
+
+		// Color attachments, written by the G-Buffer pass (2) and sampled by the composition pass (3)
 
 		// (World space) Positions
 		createAttachment(
 			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-			&offScreenFrameBuf.position);
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			&offScreenFrameBuf.position, 2, 3);
 
 		// (World space) Normals
 		createAttachment(
 			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-			&offScreenFrameBuf.normal);
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			&offScreenFrameBuf.normal, 2, 3);
 
 		// Albedo (color)
 		createAttachment(
 			VK_FORMAT_R8G8B8A8_UNORM,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-			&offScreenFrameBuf.albedo);
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			&offScreenFrameBuf.albedo, 2, 3);
 
 		// Depth attachment
 
@@ -244,10 +305,21 @@ public:
 		VkBool32 validDepthFormat = vks::tools::getSupportedDepthFormat(physicalDevice, &attDepthFormat);
 		assert(validDepthFormat);
 
+		// Depth is only used within the G-Buffer pass, so it's a transient attachment that may never be backed by physical memory
 		createAttachment(
 			attDepthFormat,
 			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-			&offScreenFrameBuf.depth);
+			&offScreenFrameBuf.depth, 2, 2);
+
+		transientAllocator.allocate();
+		VkImageAspectFlags depthAspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (vks::tools::formatHasStencil(attDepthFormat)) {
+			depthAspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		createAttachmentView(&offScreenFrameBuf.position, VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&offScreenFrameBuf.normal, VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&offScreenFrameBuf.albedo, VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&offScreenFrameBuf.depth, depthAspectMask);
 
 		// Set up separate renderpass with references to the color and depth attachments
 		std::array<VkAttachmentDescription, 4> attachmentDescs = {};
@@ -257,19 +329,13 @@ public:
 		{
 			attachmentDescs[i].samples = VK_SAMPLE_COUNT_1_BIT;
 			attachmentDescs[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			attachmentDescs[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			// Depth isn't needed after the pass
+			attachmentDescs[i].storeOp = (i == 3) ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
 			attachmentDescs[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 			attachmentDescs[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			if (i == 3)
-			{
-				attachmentDescs[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-				attachmentDescs[i].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-			}
-			else
-			{
-				attachmentDescs[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-				attachmentDescs[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			}
+			// Layout transitions are done by the render graph, so the attachments stay in their attachment layout for the whole render pass
+			attachmentDescs[i].initialLayout = (i == 3) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachmentDescs[i].finalLayout = attachmentDescs[i].initialLayout;
 		}
 
 		// Formats
@@ -293,40 +359,13 @@ public:
 		subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
 		subpass.pDepthStencilAttachment = &depthReference;
 
-		// Use subpass dependencies for attachment layout transitions
-		std::array<VkSubpassDependency, 3> dependencies{};
-
-		// Depth
-		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-		// Color
-		dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[1].dstSubpass = 0;
-		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[1].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-		// Color
-		dependencies[2].srcSubpass = 0;
-		dependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[2].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[2].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-
+		// No subpass dependencies, synchronization with the other passes is done with the barriers generated by the render graph
 		VkRenderPassCreateInfo renderPassInfo = {};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 		renderPassInfo.pAttachments = attachmentDescs.data();
 		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescs.size());
 		renderPassInfo.subpassCount = 1;
 		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 3;
-		renderPassInfo.pDependencies = dependencies.data();
 
 		VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &offScreenFrameBuf.renderPass));
 
@@ -374,12 +413,145 @@ public:
 		textures.floor.normalMap.loadFromFile(getAssetPath() + "textures/stonefloor01_normal_rgba.ktx", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, queue);
 	}
 
+	// Range at which a light's attenuated intensity becomes negligible, used as the cut-off for culling
+	float lightRange(float intensity)
+	{
+		return sqrt(intensity / 0.005f);
+	}
+
+	void generateLights()
+	{
+		lights.resize(maxLightCount);
+		lightAnimation.resize(maxLightCount);
+		// The first lights are the larger animated lights of the original scene (intensity used to be stored as radius)
+		const std::array<std::pair<glm::vec3, glm::vec4>, 6> sceneLights = { {
+			{ glm::vec3(0.0f, 0.0f, 1.0f), glm::vec4(1.5f, 1.5f, 1.5f, 15.0f * 0.25f) },
+			{ glm::vec3(-2.0f, 0.0f, 0.0f), glm::vec4(1.0f, 0.0f, 0.0f, 15.0f) },
+			{ glm::vec3(2.0f, -1.0f, 0.0f), glm::vec4(0.0f, 0.0f, 2.5f, 5.0f) },
+			{ glm::vec3(0.0f, -0.9f, 0.5f), glm::vec4(1.0f, 1.0f, 0.0f, 2.0f) },
+			{ glm::vec3(0.0f, -0.5f, 0.0f), glm::vec4(0.0f, 1.0f, 0.2f, 5.0f) },
+			{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec4(1.0f, 0.7f, 0.3f, 25.0f) },
+		} };
+		for (size_t i = 0; i < sceneLights.size(); i++) {
+			lights[i] = { glm::vec4(sceneLights[i].first, lightRange(sceneLights[i].second.a)), sceneLights[i].second, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f) };
+			lightAnimation[i] = glm::vec3(0.0f);
+		}
+		// The remaining lights are small point and spot lights scattered across the floor
+		std::default_random_engine rndEngine(benchmark.active ? 0 : (unsigned)time(nullptr));
+		std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
+		for (size_t i = sceneLights.size(); i < lights.size(); i++) {
+			const glm::vec3 position(rndDist(rndEngine) * 40.0f - 20.0f, -0.2f - rndDist(rndEngine) * 1.3f, rndDist(rndEngine) * 40.0f - 20.0f);
+			const glm::vec3 color = glm::normalize(glm::vec3(rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine)) + glm::vec3(0.1f));
+			const float range = 0.5f + rndDist(rndEngine);
+			// Every fourth light is a spot light pointing at the floor
+			const bool spot = (i % 4 == 0);
+			lights[i] = {
+				glm::vec4(position, range),
+				glm::vec4(color, spot ? 2.0f : 0.5f),
+				glm::vec4(0.0f, 1.0f, 0.0f, spot ? cos(glm::radians(25.0f + rndDist(rndEngine) * 20.0f)) : -1.0f)
+			};
+			lightAnimation[i] = glm::vec3(0.25f + rndDist(rndEngine) * 0.75f, 0.5f + rndDist(rndEngine), rndDist(rndEngine) * 2.0f * glm::pi<float>());
+		}
+	}
+
+	void prepareGpuTimes()
+	{
+		// Timestamps need to be supported on the graphics queue and in both graphics and compute stages
+		gpuTimes.supported = (vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.graphics].timestampValidBits > 0) && (deviceProperties.limits.timestampComputeAndGraphics);
+		if (!gpuTimes.supported) {
+			return;
+		}
+		VkQueryPoolCreateInfo queryPoolCI{};
+		queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCI.queryCount = 4 * maxConcurrentFrames;
+		VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &gpuTimes.queryPool));
+	}
+
+	// Reads the timestamps written by the last submission of the current frame slot (which has finished, as its fence has been waited on)
+	void updateGpuTimes()
+	{
+		if (!gpuTimes.supported || !gpuTimes.written[currentBuffer]) {
+			return;
+		}
+		std::array<uint64_t, 4> timestamps{};
+		VkResult result = vkGetQueryPoolResults(device, gpuTimes.queryPool, currentBuffer * 4, 4, sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result != VK_SUCCESS) {
+			return;
+		}
+		const float period = deviceProperties.limits.timestampPeriod / 1000000.0f;
+		const float culling = (float)(timestamps[1] - timestamps[0]) * period;
+		const float composition = (float)(timestamps[3] - timestamps[2]) * period;
+		// Smooth values for display
+		gpuTimes.culling = glm::mix(gpuTimes.culling, culling, 0.1f);
+		gpuTimes.composition = glm::mix(gpuTimes.composition, composition, 0.1f);
+		if (lightSweep.active) {
+			updateLightSweep(culling + composition);
+		}
+	}
+
+	void startLightSweep()
+	{
+		if (!gpuTimes.supported) {
+			return;
+		}
+		lightSweep.active = true;
+		lightSweep.step = 0;
+		lightSweep.frame = 0;
+		lightSweep.accumulated = 0.0;
+		lightSweep.results.clear();
+		lightSweep.previousLightCount = lightCount;
+		lightSweep.previousClusteredLighting = clusteredLighting;
+		lightCount = lightSweep.lightCounts[0];
+		clusteredLighting = false;
+	}
+
+	// Every light count is measured without and with clustering, the first frames of each step are skipped as timestamps lag behind by maxConcurrentFrames frames
+	void updateLightSweep(float gpuTime)
+	{
+		const uint32_t skipFrames = 10;
+		const uint32_t measureFrames = 60;
+		lightSweep.frame++;
+		if (lightSweep.frame <= skipFrames) {
+			return;
+		}
+		lightSweep.accumulated += gpuTime;
+		if (lightSweep.frame < skipFrames + measureFrames) {
+			return;
+		}
+		const double average = lightSweep.accumulated / measureFrames;
+		lightSweep.frame = 0;
+		lightSweep.accumulated = 0.0;
+		if (!clusteredLighting) {
+			lightSweep.bruteForce = average;
+			clusteredLighting = true;
+			return;
+		}
+		lightSweep.results.push_back({ lightCount, lightSweep.bruteForce, average });
+		// The overlay is disabled in benchmark mode, so the comparison is added to the benchmark results instead
+		if (benchmark.active) {
+			std::stringstream result;
+			result << std::fixed << std::setprecision(3) << lightCount << "," << lightSweep.bruteForce << "," << average;
+			benchmark.addResult("lights,brute force (ms),clustered (ms)", result.str());
+		}
+		lightSweep.step++;
+		if (lightSweep.step < lightSweep.lightCounts.size()) {
+			lightCount = lightSweep.lightCounts[lightSweep.step];
+			clusteredLighting = false;
+		} else {
+			lightSweep.active = false;
+			lightCount = lightSweep.previousLightCount;
+			clusteredLighting = lightSweep.previousClusteredLighting;
+		}
+	}
+
 	void setupDescriptors()
 	{
 		// Pool
 		std::vector<VkDescriptorPoolSize> poolSizes = {
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxConcurrentFrames * 8),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxConcurrentFrames * 9)
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxConcurrentFrames * 9),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxConcurrentFrames * 3)
 		};
 		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, maxConcurrentFrames * 3);
 		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
@@ -394,8 +566,14 @@ public:
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
 			// Binding 3 : Albedo texture target
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
-			// Binding 4 : Fragment shader uniform buffer
-			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
+			// Binding 4 : Composition and light culling uniform buffer
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 4),
+			// Binding 5 : Lights
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 5),
+			// Binding 6 : Light count per cluster
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 6),
+			// Binding 7 : Light index lists per cluster
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 7),
 		};
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorLayout, nullptr, &descriptorSetLayout));
@@ -418,8 +596,14 @@ public:
 				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &descriptorNormal),
 				// Binding 3 : Albedo texture target
 				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &descriptorAlbedo),
-				// Binding 4 : Fragment shader uniform buffer
+				// Binding 4 : Composition and light culling uniform buffer
 				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 4, &uniformBuffers[i].composition.descriptor),
+				// Binding 5 : Lights
+				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &uniformBuffers[i].lights.descriptor),
+				// Binding 6 : Light count per cluster
+				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6, &uniformBuffers[i].lightGrid.descriptor),
+				// Binding 7 : Light index lists per cluster
+				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7, &uniformBuffers[i].lightIndices.descriptor),
 			};
 			vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 
@@ -513,6 +697,11 @@ public:
 		colorBlendState.pAttachments = blendAttachmentStates.data();
 
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.offscreen));
+
+		// Light culling compute pipeline, uses the same layout as the composition pass
+		VkComputePipelineCreateInfo computePipelineCI = vks::initializers::computePipelineCreateInfo(pipelineLayout, 0);
+		computePipelineCI.stage = loadShader(getShadersPath() + "deferred/lightculling.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+		VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCI, nullptr, &pipelines.lightCulling));
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -524,6 +713,13 @@ public:
 			// Composition
 			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer.composition, sizeof(UniformDataComposition)));
 			VK_CHECK_RESULT(buffer.composition.map());
+			// Lights
+			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer.lightsStaging, maxLightCount * sizeof(Light)));
+			VK_CHECK_RESULT(buffer.lightsStaging.map());
+			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &buffer.lights, maxLightCount * sizeof(Light)));
+			// Clusters
+			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &buffer.lightGrid, clusterCount * sizeof(uint32_t)));
+			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &buffer.lightIndices, clusterCount * maxLightsPerCluster * sizeof(uint32_t)));
 		}
 
 		// Setup instanced model positions
@@ -541,52 +737,45 @@ public:
 		memcpy(uniformBuffers[currentBuffer].offscreen.mapped, &uniformDataOffscreen, sizeof(UniformDataOffscreen));
 	}
 
-	// Update lights and parameters passed to the composition shaders
+	// Update lights and parameters passed to the composition and light culling shaders
 	void updateUniformBufferComposition()
 	{
-		// White
-		uniformDataComposition.lights[0].position = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
-		uniformDataComposition.lights[0].color = glm::vec3(1.5f);
-		uniformDataComposition.lights[0].radius = 15.0f * 0.25f;
-		// Red
-		uniformDataComposition.lights[1].position = glm::vec4(-2.0f, 0.0f, 0.0f, 0.0f);
-		uniformDataComposition.lights[1].color = glm::vec3(1.0f, 0.0f, 0.0f);
-		uniformDataComposition.lights[1].radius = 15.0f;
-		// Blue
-		uniformDataComposition.lights[2].position = glm::vec4(2.0f, -1.0f, 0.0f, 0.0f);
-		uniformDataComposition.lights[2].color = glm::vec3(0.0f, 0.0f, 2.5f);
-		uniformDataComposition.lights[2].radius = 5.0f;
-		// Yellow
-		uniformDataComposition.lights[3].position = glm::vec4(0.0f, -0.9f, 0.5f, 0.0f);
-		uniformDataComposition.lights[3].color = glm::vec3(1.0f, 1.0f, 0.0f);
-		uniformDataComposition.lights[3].radius = 2.0f;
-		// Green
-		uniformDataComposition.lights[4].position = glm::vec4(0.0f, -0.5f, 0.0f, 0.0f);
-		uniformDataComposition.lights[4].color = glm::vec3(0.0f, 1.0f, 0.2f);
-		uniformDataComposition.lights[4].radius = 5.0f;
-		// Yellow
-		uniformDataComposition.lights[5].position = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f);
-		uniformDataComposition.lights[5].color = glm::vec3(1.0f, 0.7f, 0.3f);
-		uniformDataComposition.lights[5].radius = 25.0f;
-
 		// Animate the lights
+		Light* lightData = (Light*)uniformBuffers[currentBuffer].lightsStaging.mapped;
+		memcpy(lightData, lights.data(), lightCount * sizeof(Light));
 		if (!paused) {
-			uniformDataComposition.lights[0].position.x = sin(glm::radians(360.0f * timer)) * 5.0f;
-			uniformDataComposition.lights[0].position.z = cos(glm::radians(360.0f * timer)) * 5.0f;
+			const float angle = glm::radians(360.0f * timer);
+			lightData[0].position.x = sin(angle) * 5.0f;
+			lightData[0].position.z = cos(angle) * 5.0f;
+
+			lightData[1].position.x = -4.0f + sin(angle + 45.0f) * 2.0f;
+			lightData[1].position.z = 0.0f + cos(angle + 45.0f) * 2.0f;
 
-			uniformDataComposition.lights[1].position.x = -4.0f + sin(glm::radians(360.0f * timer) + 45.0f) * 2.0f;
-			uniformDataComposition.lights[1].position.z = 0.0f + cos(glm::radians(360.0f * timer) + 45.0f) * 2.0f;
+			lightData[2].position.x = 4.0f + sin(angle) * 2.0f;
+			lightData[2].position.z = 0.0f + cos(angle) * 2.0f;
 
-			uniformDataComposition.lights[2].position.x = 4.0f + sin(glm::radians(360.0f * timer)) * 2.0f;
-			uniformDataComposition.lights[2].position.z = 0.0f + cos(glm::radians(360.0f * timer)) * 2.0f;
+			lightData[4].position.x = 0.0f + sin(glm::radians(360.0f * timer + 90.0f)) * 5.0f;
+			lightData[4].position.z = 0.0f - cos(glm::radians(360.0f * timer + 45.0f)) * 5.0f;
 
-			uniformDataComposition.lights[4].position.x = 0.0f + sin(glm::radians(360.0f * timer + 90.0f)) * 5.0f;
-			uniformDataComposition.lights[4].position.z = 0.0f - cos(glm::radians(360.0f * timer + 45.0f)) * 5.0f;
+			lightData[5].position.x = 0.0f + sin(glm::radians(-360.0f * timer + 135.0f)) * 10.0f;
+			lightData[5].position.z = 0.0f - cos(glm::radians(-360.0f * timer - 45.0f)) * 10.0f;
 
-			uniformDataComposition.lights[5].position.x = 0.0f + sin(glm::radians(-360.0f * timer + 135.0f)) * 10.0f;
-			uniformDataComposition.lights[5].position.z = 0.0f - cos(glm::radians(-360.0f * timer - 45.0f)) * 10.0f;
+			// The small lights orbit around their initial position
+			for (int32_t i = 6; i < lightCount; i++) {
+				const glm::vec3& animation = lightAnimation[i];
+				lightData[i].position.x += sin(angle * animation.y + animation.z) * animation.x;
+				lightData[i].position.z += cos(angle * animation.y + animation.z) * animation.x;
+			}
 		}
 
+		uniformDataComposition.view = camera.matrices.view;
+		uniformDataComposition.projection = camera.matrices.perspective;
+		uniformDataComposition.inverseProjection = glm::inverse(camera.matrices.perspective);
+		uniformDataComposition.zNear = camera.getNearClip();
+		uniformDataComposition.zFar = camera.getFarClip();
+		uniformDataComposition.lightCount = lightCount;
+		uniformDataComposition.clustered = clusteredLighting ? 1 : 0;
+
 		// Current view position
 		uniformDataComposition.viewPos = glm::vec4(camera.position, 0.0f) * glm::vec4(-1.0f, 1.0f, -1.0f, 1.0f);
 
@@ -599,10 +788,16 @@ public:
 	{
 		VulkanExampleBase::prepare();
 		loadAssets();
+		generateLights();
 		prepareOffscreenFramebuffer();
 		prepareUniformBuffers();
+		prepareGpuTimes();
 		setupDescriptors();
 		preparePipelines();
+		// In benchmark mode GPU times are measured for different light counts
+		if (benchmark.active) {
+			startLightSweep();
+		}
 		prepared = true;
 	}
 
@@ -614,8 +809,57 @@ public:
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
 
-		// First render pass : Offscreen pass to fill deferred attachments
-		{
+		const uint32_t queryOffset = currentBuffer * 4;
+		if (gpuTimes.supported) {
+			vkCmdResetQueryPool(cmdBuffer, gpuTimes.queryPool, queryOffset, 4);
+		}
+
+		/*
+			The passes and the resources they access are declared in a render graph, which is rebuilt every frame
+			The graph derives the barriers and image layout transitions between the passes from these declarations
+			The light culling pass is culled if the composition doesn't read the cluster data
+		*/
+		renderGraph.reset();
+
+		UniformBuffers& frameUniformBuffers = uniformBuffers[currentBuffer];
+		const vks::RenderGraph::Resource lightsBuffer = renderGraph.importBuffer("Lights", frameUniformBuffers.lights.buffer);
+		const vks::RenderGraph::Resource lightGrid = renderGraph.importBuffer("Light grid", frameUniformBuffers.lightGrid.buffer);
+		const vks::RenderGraph::Resource lightIndices = renderGraph.importBuffer("Light indices", frameUniformBuffers.lightIndices.buffer);
+		VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VkImageSubresourceRange depthRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+		if (vks::tools::formatHasStencil(offScreenFrameBuf.depth.format)) {
+			depthRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		const vks::RenderGraph::Resource position = renderGraph.importImage("G-Buffer position", offScreenFrameBuf.position.image, colorRange);
+		const vks::RenderGraph::Resource normal = renderGraph.importImage("G-Buffer normal", offScreenFrameBuf.normal.image, colorRange);
+		const vks::RenderGraph::Resource albedo = renderGraph.importImage("G-Buffer albedo", offScreenFrameBuf.albedo.image, colorRange);
+		const vks::RenderGraph::Resource depth = renderGraph.importImage("G-Buffer depth", offScreenFrameBuf.depth.image, depthRange);
+
+		// Upload this frame's lights
+		renderGraph.addPass("Light upload", [this](VkCommandBuffer cmdBuffer) {
+			VkBufferCopy copyRegion{ 0, 0, lightCount * sizeof(Light) };
+			vkCmdCopyBuffer(cmdBuffer, uniformBuffers[currentBuffer].lightsStaging.buffer, uniformBuffers[currentBuffer].lights.buffer, 1, &copyRegion);
+		})
+			.write(lightsBuffer, vks::RenderGraph::transferWrite);
+
+		// Light culling: Bin lights into clusters
+		vks::RenderGraph::Pass& cullingPass = renderGraph.addPass("Light culling", [this, queryOffset](VkCommandBuffer cmdBuffer) {
+			if (gpuTimes.supported) {
+				vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpuTimes.queryPool, queryOffset);
+			}
+			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.lightCulling);
+			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[currentBuffer].composition, 0, nullptr);
+			vkCmdDispatch(cmdBuffer, (clusterCount + 63) / 64, 1, 1);
+			if (gpuTimes.supported) {
+				vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, gpuTimes.queryPool, queryOffset + 1);
+			}
+		})
+			.read(lightsBuffer, vks::RenderGraph::storageReadCompute)
+			.write(lightGrid, vks::RenderGraph::storageWriteCompute)
+			.write(lightIndices, vks::RenderGraph::storageWriteCompute);
+
+		// Offscreen pass to fill deferred attachments
+		renderGraph.addPass("G-Buffer", [this](VkCommandBuffer cmdBuffer) {
 			// Clear values for all attachments written in the fragment shader
 			VkClearValue clearValues[4]{};
 			clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
@@ -645,12 +889,14 @@ public:
 			models.model.bindBuffers(cmdBuffer);
 			vkCmdDrawIndexed(cmdBuffer, models.model.indices.count, 3, 0, 0, 0);
 			vkCmdEndRenderPass(cmdBuffer);
-		}
-
-		// Second render pass: Composition
-		// Note: Explicit synchronization is not required between the render pass, as this is done implicit via sub pass dependencies
-
-		{
+		})
+			.write(position, vks::RenderGraph::colorAttachment)
+			.write(normal, vks::RenderGraph::colorAttachment)
+			.write(albedo, vks::RenderGraph::colorAttachment)
+			.write(depth, vks::RenderGraph::depthStencilAttachment);
+
+		// Composition, renders to the swapchain so it's external to the graph and never culled
+		vks::RenderGraph::Pass& compositionPass = renderGraph.addPass("Composition", [this, queryOffset](VkCommandBuffer cmdBuffer) {
 			VkClearValue clearValues[2]{};
 			clearValues[0].color = { { 0.0f, 0.0f, 0.2f, 0.0f } };
 			clearValues[1].depthStencil = { 1.0f, 0 };
@@ -665,6 +911,9 @@ public:
 			renderPassBeginInfo.pClearValues = clearValues;
 			renderPassBeginInfo.framebuffer = frameBuffers[currentImageIndex];
 
+			if (gpuTimes.supported) {
+				vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpuTimes.queryPool, queryOffset + 2);
+			}
 			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 			VkViewport viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
 			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
@@ -677,10 +926,32 @@ public:
 			// The fragment shader then combines the deferred attachments into the final image
 			// Note: Also used for debug display if debugDisplayTarget > 0
 			vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+			if (gpuTimes.supported) {
+				vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, gpuTimes.queryPool, queryOffset + 3);
+				gpuTimes.written[currentBuffer] = true;
+			}
 			drawUI(cmdBuffer);
 			vkCmdEndRenderPass(cmdBuffer);
+		})
+			.external()
+			.read(position, vks::RenderGraph::sampledFragment)
+			.read(normal, vks::RenderGraph::sampledFragment)
+			.read(albedo, vks::RenderGraph::sampledFragment)
+			.read(lightsBuffer, vks::RenderGraph::storageReadFragment);
+		// The cluster data is only read for clustered lighting and the lights per cluster debug display
+		if (clusteredLighting || (debugDisplayTarget == 5)) {
+			compositionPass
+				.read(lightGrid, vks::RenderGraph::storageReadFragment)
+				.read(lightIndices, vks::RenderGraph::storageReadFragment);
 		}
 
+		renderGraph.compile();
+		// Keep the timestamps valid if the light culling pass has been culled
+		if (cullingPass.culled() && gpuTimes.supported) {
+			vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpuTimes.queryPool, queryOffset);
+			vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpuTimes.queryPool, queryOffset + 1);
+		}
+		renderGraph.execute(cmdBuffer);
 
 		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
 	}
@@ -690,6 +961,7 @@ public:
 		if (!prepared)
 			return;
 		VulkanExampleBase::prepareFrame();
+		updateGpuTimes();
 		updateUniformBufferComposition();
 		updateUniformBufferOffscreen();
 		buildCommandBuffer();
@@ -699,7 +971,35 @@ public:
 	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
 	{
 		if (overlay->header("Settings")) {
-			overlay->comboBox("Display", &debugDisplayTarget, { "Final composition", "Position", "Normals", "Albedo", "Specular" });
+			overlay->comboBox("Display", &debugDisplayTarget, { "Final composition", "Position", "Normals", "Albedo", "Specular", "Lights per cluster" });
+		}
+		if (overlay->header("Lights")) {
+			overlay->sliderInt("Count", &lightCount, 6, maxLightCount);
+			overlay->checkBox("Clustered", &clusteredLighting);
+			if (gpuTimes.supported) {
+				overlay->text("Light culling: %.3f ms", gpuTimes.culling);
+				overlay->text("Composition: %.3f ms", gpuTimes.composition);
+				if (lightSweep.active) {
+					overlay->text("Measuring...");
+				} else if (overlay->button("Compare with brute force")) {
+					startLightSweep();
+				}
+				for (auto& result : lightSweep.results) {
+					overlay->text("%d lights: %.3f ms brute force, %.3f ms clustered", result.lightCount, result.bruteForce, result.clustered);
+				}
+			}
+		}
+		if (overlay->header("Render graph")) {
+			overlay->text("Synchronization2: %s", renderGraph.synchronization2 ? "yes" : "no");
+			overlay->text("Passes: %d (%d culled)", renderGraph.stats.passes, renderGraph.stats.culledPasses);
+			overlay->text("Barriers: %d (%d image, %d buffer)", renderGraph.stats.barrierBatches, renderGraph.stats.imageBarriers, renderGraph.stats.bufferBarriers);
+		}
+		if (overlay->header("Attachment memory")) {
+			transientAllocator.updateCommitment();
+			const vks::TransientAllocator::Stats& stats = transientAllocator.stats;
+			overlay->text("Images: %d in %d allocations", stats.images, stats.allocations);
+			overlay->text("Allocated: %.2f MiB (%.2f MiB without aliasing)", stats.allocatedSize / (1024.0f * 1024.0f), stats.unaliasedSize / (1024.0f * 1024.0f));
+			overlay->text("Lazy: %d images, %.2f MiB (%.2f MiB committed)", stats.lazyImages, stats.lazySize / (1024.0f * 1024.0f), stats.lazyCommittedSize / (1024.0f * 1024.0f));
 		}
 	}
 };
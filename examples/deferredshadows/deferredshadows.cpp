@@ -259,6 +259,7 @@ public:
 		VkBool32 validDepthFormat = vks::tools::getSupportedDepthFormat(physicalDevice, &attDepthFormat);
 		assert(validDepthFormat);
 
+		// Depth is only used within the G-Buffer pass, so the framebuffer creates it as a transient (and if possible lazily allocated) attachment
 		attachmentInfo.format = attDepthFormat;
 		attachmentInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
 		offscreenframeBuffers.deferred->addAttachment(attachmentInfo);
@@ -679,6 +680,18 @@ public:
 				uniformDataComposition.useShadows = shadows;
 			}
 		}
+		if (overlay->header("Attachment memory")) {
+			VkDeviceSize allocatedSize = 0;
+			VkDeviceSize lazySize = 0;
+			for (auto framebuffer : { offscreenframeBuffers.shadow, offscreenframeBuffers.deferred }) {
+				for (auto& attachment : framebuffer->attachments) {
+					allocatedSize += attachment.memorySize;
+					lazySize += attachment.lazilyAllocated ? attachment.memorySize : 0;
+				}
+			}
+			overlay->text("Allocated: %.2f MiB", allocatedSize / (1024.0f * 1024.0f));
+			overlay->text("Lazily allocated: %.2f MiB", lazySize / (1024.0f * 1024.0f));
+		}
 	}
 };
 
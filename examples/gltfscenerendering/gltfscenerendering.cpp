@@ -1,7 +1,7 @@
 /*
 * Vulkan Example - Scene rendering
 *
-* Copyright (C) 2020-2025 by Sascha Willems - www.saschawillems.de
+* Copyright (C) 2020-2026 by Sascha Willems - www.saschawillems.de
 *
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 *
@@ -28,15 +28,11 @@ VulkanglTFScene::~VulkanglTFScene()
 	vkFreeMemory(vulkanDevice->logicalDevice, vertices.memory, nullptr);
 	vkDestroyBuffer(vulkanDevice->logicalDevice, indices.buffer, nullptr);
 	vkFreeMemory(vulkanDevice->logicalDevice, indices.memory, nullptr);
-	for (Image image : images) {
-		vkDestroyImageView(vulkanDevice->logicalDevice, image.texture.view, nullptr);
-		vkDestroyImage(vulkanDevice->logicalDevice, image.texture.image, nullptr);
-		vkDestroySampler(vulkanDevice->logicalDevice, image.texture.sampler, nullptr);
-		vkFreeMemory(vulkanDevice->logicalDevice, image.texture.deviceMemory, nullptr);
-	}
-	for (Material material : materials) {
-		vkDestroyPipeline(vulkanDevice->logicalDevice, material.pipeline, nullptr);
+	// Destroying the textures also releases their bindless table indices
+	for (Image& image : images) {
+		image.texture.destroy();
 	}
+	// Material pipelines are owned by the pipeline compiler
 }
 
 /*
@@ -48,13 +44,89 @@ VulkanglTFScene::~VulkanglTFScene()
 void VulkanglTFScene::loadImages(tinygltf::Model& input)
 {
 	// POI: The textures for the glTF file used in this sample are stored as external ktx files, so we can directly load them from disk without the need for conversion
+	// Other images (e.g. PNG or JPEG) need to have their mip chain generated at runtime, which is done in compute with optional compression to BC formats
 	images.resize(input.images.size());
 	for (size_t i = 0; i < input.images.size(); i++) {
 		tinygltf::Image& glTFImage = input.images[i];
-		images[i].texture.loadFromFile(path + "/" + glTFImage.uri, VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, copyQueue);
+		const std::string filename = path + "/" + glTFImage.uri;
+		const std::string extension = filename.substr(filename.find_last_of('.') + 1);
+		if ((extension != "ktx") && (extension != "ktx2") && textureProcessor && textureProcessor->supported()) {
+			loadImageWithProcessor(filename, images[i].texture);
+		} else {
+			images[i].texture.loadFromFile(filename, VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, copyQueue);
+		}
+	}
+
+	// POI: Gather image memory statistics so the effect of texture compression can be compared
+	textureMemory = {};
+	for (auto& image : images) {
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(vulkanDevice->logicalDevice, image.texture.image, &memReqs);
+		textureMemory.allocated += memReqs.size;
+		// A full RGBA8 mip chain adds roughly one third to the size of the base level
+		textureMemory.uncompressed += VkDeviceSize(image.texture.width) * image.texture.height * 4 * 4 / 3;
 	}
 }
 
+void VulkanglTFScene::loadImageWithProcessor(const std::string& filename, vks::Texture2D& texture)
+{
+	int width, height, components;
+#if defined(__ANDROID__)
+	AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
+	if (!asset) {
+		vks::tools::exitFatal("Could not load texture from " + filename + "\n\nMake sure the assets submodule has been checked out and is up-to-date.", -1);
+	}
+	std::vector<stbi_uc> fileData(AAsset_getLength(asset));
+	AAsset_read(asset, fileData.data(), fileData.size());
+	AAsset_close(asset);
+	stbi_uc* rgba = stbi_load_from_memory(fileData.data(), static_cast<int>(fileData.size()), &width, &height, &components, STBI_rgb_alpha);
+#else
+	stbi_uc* rgba = stbi_load(filename.c_str(), &width, &height, &components, STBI_rgb_alpha);
+#endif
+	if (!rgba) {
+		vks::tools::exitFatal("Could not load texture from " + filename + "\n\nMake sure the assets submodule has been checked out and is up-to-date.", -1);
+	}
+
+	vks::TextureProcessor::Result result;
+	textureProcessor->upload(rgba, width, height, copyQueue, textureCompression, result);
+	stbi_image_free(rgba);
+
+	texture.device = vulkanDevice;
+	texture.image = result.image;
+	texture.deviceMemory = result.memory;
+	texture.format = result.format;
+	texture.width = width;
+	texture.height = height;
+	texture.mipLevels = result.mipLevels;
+	texture.layerCount = 1;
+	texture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkSamplerCreateInfo samplerCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_LINEAR,
+		.minFilter = VK_FILTER_LINEAR,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.anisotropyEnable = vulkanDevice->enabledFeatures.samplerAnisotropy,
+		.maxAnisotropy = vulkanDevice->enabledFeatures.samplerAnisotropy ? vulkanDevice->properties.limits.maxSamplerAnisotropy : 1.0f,
+		.compareOp = VK_COMPARE_OP_NEVER,
+		.maxLod = (float)texture.mipLevels,
+		.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE
+	};
+	VK_CHECK_RESULT(vkCreateSampler(vulkanDevice->logicalDevice, &samplerCreateInfo, nullptr, &texture.sampler));
+	VkImageViewCreateInfo viewCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = texture.image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = texture.format,
+		.subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = texture.mipLevels, .baseArrayLayer = 0, .layerCount = 1 },
+	};
+	VK_CHECK_RESULT(vkCreateImageView(vulkanDevice->logicalDevice, &viewCreateInfo, nullptr, &texture.view));
+	texture.updateDescriptor();
+}
+
 void VulkanglTFScene::loadTextures(tinygltf::Model& input)
 {
 	textures.resize(input.textures.size());
@@ -128,6 +200,7 @@ void VulkanglTFScene::loadNode(const tinygltf::Node& inputNode, const tinygltf::
 			uint32_t firstIndex = static_cast<uint32_t>(indexBuffer.size());
 			uint32_t vertexStart = static_cast<uint32_t>(vertexBuffer.size());
 			uint32_t indexCount = 0;
+			glm::vec3 primitiveCenter{ 0.0f };
 			// Vertices
 			{
 				const float* positionBuffer = nullptr;
@@ -142,6 +215,9 @@ void VulkanglTFScene::loadNode(const tinygltf::Node& inputNode, const tinygltf::
 					const tinygltf::BufferView& view = input.bufferViews[accessor.bufferView];
 					positionBuffer = reinterpret_cast<const float*>(&(input.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
 					vertexCount = accessor.count;
+					if (accessor.minValues.size() == 3 && accessor.maxValues.size() == 3) {
+						primitiveCenter = (glm::make_vec3(accessor.minValues.data()) + glm::make_vec3(accessor.maxValues.data())) * 0.5f;
+					}
 				}
 				// Get buffer data for vertex normals
 				if (glTFPrimitive.attributes.find("NORMAL") != glTFPrimitive.attributes.end()) {
@@ -214,6 +290,7 @@ void VulkanglTFScene::loadNode(const tinygltf::Node& inputNode, const tinygltf::
 			primitive.firstIndex = firstIndex;
 			primitive.indexCount = indexCount;
 			primitive.materialIndex = glTFPrimitive.material;
+			primitive.center = primitiveCenter;
 			node->mesh.primitives.push_back(primitive);
 		}
 	}
@@ -251,13 +328,25 @@ void VulkanglTFScene::drawNode(VkCommandBuffer commandBuffer, VkPipelineLayout p
 			currentParent = currentParent->parent;
 		}
 		// Pass the final matrix to the vertex shader using push constants
-		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &nodeMatrix);
+		// The bindless pipeline layout's push constant range also covers the fragment shader's material index
+		const VkShaderStageFlags pushConstantStages = bindless ? VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT : VK_SHADER_STAGE_VERTEX_BIT;
+		vkCmdPushConstants(commandBuffer, pipelineLayout, pushConstantStages, 0, sizeof(glm::mat4), &nodeMatrix);
 		for (VulkanglTFScene::Primitive& primitive : node->mesh.primitives) {
 			if (primitive.indexCount > 0) {
 				VulkanglTFScene::Material& material = materials[primitive.materialIndex];
-				// POI: Bind the pipeline for the node's material
-				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material.pipeline);
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &material.descriptorSet, 0, nullptr);
+				if (bindless) {
+					// POI: With bindless textures, selecting the material's textures is a single push constant
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material.bindlessPipeline.get());
+					pipelineBinds++;
+					const uint32_t materialIndex = static_cast<uint32_t>(primitive.materialIndex);
+					vkCmdPushConstants(commandBuffer, pipelineLayout, pushConstantStages, sizeof(glm::mat4), sizeof(uint32_t), &materialIndex);
+				} else {
+					// POI: Bind the pipeline for the node's material
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material.pipeline.get());
+					pipelineBinds++;
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &material.descriptorSet, 0, nullptr);
+					descriptorBinds++;
+				}
 				vkCmdDrawIndexed(commandBuffer, primitive.indexCount, 1, primitive.firstIndex, 0, 0);
 			}
 		}
@@ -274,12 +363,105 @@ void VulkanglTFScene::draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipel
 	VkDeviceSize offsets[1] = { 0 };
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
 	vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+	descriptorBinds = 0;
+	pipelineBinds = 0;
+	// The bindless table contains all textures, so it only needs to be bound once
+	if (bindless) {
+		vks::bindlessTable.bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1);
+		descriptorBinds++;
+	}
 	// Render all nodes at top-level
 	for (auto& node : nodes) {
 		drawNode(commandBuffer, pipelineLayout, node);
 	}
 }
 
+// Adds the primitives of a visible node and its children to the draw list
+void VulkanglTFScene::gatherNode(const VulkanglTFScene::Node* node, const glm::mat4& parentMatrix, const glm::vec3& viewPos, std::unordered_map<VkPipeline, uint32_t>& pipelineIds)
+{
+	if (!node->visible) {
+		return;
+	}
+	// The matrix is accumulated while descending, instead of walking up the hierarchy for every node
+	const glm::mat4 nodeMatrix = parentMatrix * node->matrix;
+	for (const VulkanglTFScene::Primitive& primitive : node->mesh.primitives) {
+		if (primitive.indexCount == 0) {
+			continue;
+		}
+		VulkanglTFScene::Material& material = materials[primitive.materialIndex];
+		vks::DrawList::Bucket bucket = vks::DrawList::Bucket::Opaque;
+		if (material.alphaMode == "MASK") {
+			bucket = vks::DrawList::Bucket::AlphaMask;
+		} else if (material.alphaMode == "BLEND") {
+			bucket = vks::DrawList::Bucket::AlphaBlend;
+		}
+		// Materials with identical state share a pipeline, so pipelines get their own small ids for sorting
+		const VkPipeline pipeline = bindless ? material.bindlessPipeline.get() : material.pipeline.get();
+		const uint32_t pipelineId = pipelineIds.emplace(pipeline, static_cast<uint32_t>(pipelineIds.size())).first->second;
+		const float depth = glm::distance(viewPos, glm::vec3(nodeMatrix * glm::vec4(primitive.center, 1.0f)));
+		drawList.add(vks::DrawList::makeKey(bucket, pipelineId, static_cast<uint32_t>(primitive.materialIndex), depth), static_cast<uint32_t>(drawItems.size()));
+		drawItems.push_back({ &primitive, nodeMatrix });
+	}
+	for (auto& child : node->children) {
+		gatherNode(child, nodeMatrix, viewPos, pipelineIds);
+	}
+}
+
+// Gathers the primitives of all visible nodes in a single traversal and sorts them
+void VulkanglTFScene::buildDrawList(const glm::vec3& viewPos)
+{
+	drawItems.clear();
+	drawList.clear();
+	std::unordered_map<VkPipeline, uint32_t> pipelineIds;
+	for (auto& node : nodes) {
+		gatherNode(node, glm::mat4(1.0f), viewPos, pipelineIds);
+	}
+	drawList.sort();
+}
+
+// Draws the sorted draw list, pipelines, descriptor sets and push constants are only changed if they differ from the previous draw
+void VulkanglTFScene::drawSorted(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout)
+{
+	VkDeviceSize offsets[1] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+	descriptorBinds = 0;
+	pipelineBinds = 0;
+	if (bindless) {
+		vks::bindlessTable.bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1);
+		descriptorBinds++;
+	}
+	const VkShaderStageFlags pushConstantStages = bindless ? VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT : VK_SHADER_STAGE_VERTEX_BIT;
+	VkPipeline boundPipeline{ VK_NULL_HANDLE };
+	int32_t boundMaterial{ -1 };
+	const glm::mat4* pushedMatrix{ nullptr };
+	for (const vks::DrawList::Entry& entry : drawList.entries) {
+		const DrawItem& item = drawItems[entry.item];
+		VulkanglTFScene::Material& material = materials[item.primitive->materialIndex];
+		const VkPipeline pipeline = bindless ? material.bindlessPipeline.get() : material.pipeline.get();
+		if (pipeline != boundPipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundPipeline = pipeline;
+			pipelineBinds++;
+		}
+		if (item.primitive->materialIndex != boundMaterial) {
+			boundMaterial = item.primitive->materialIndex;
+			if (bindless) {
+				const uint32_t materialIndex = static_cast<uint32_t>(boundMaterial);
+				vkCmdPushConstants(commandBuffer, pipelineLayout, pushConstantStages, sizeof(glm::mat4), sizeof(uint32_t), &materialIndex);
+			} else {
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &material.descriptorSet, 0, nullptr);
+				descriptorBinds++;
+			}
+		}
+		if (!pushedMatrix || *pushedMatrix != item.matrix) {
+			vkCmdPushConstants(commandBuffer, pipelineLayout, pushConstantStages, 0, sizeof(glm::mat4), &item.matrix);
+			pushedMatrix = &item.matrix;
+		}
+		vkCmdDrawIndexed(commandBuffer, item.primitive->indexCount, 1, item.primitive->firstIndex, 0, 0);
+	}
+}
+
 /*
 	Vulkan Example class
 */
@@ -292,23 +474,44 @@ VulkanExample::VulkanExample() : VulkanExampleBase()
 	camera.setPosition(glm::vec3(0.0f, 1.0f, 0.0f));
 	camera.setRotation(glm::vec3(0.0f, -90.0f, 0.0f));
 	camera.setPerspective(60.0f, (float)width / (float)height, 0.1f, 256.0f);
+	// Bindless textures require descriptor indexing, which is core with Vulkan 1.2
+	apiVersion = VK_API_VERSION_1_2;
 }
 
 VulkanExample::~VulkanExample()
 {
 	if (device) {
+		// Waits for pending compilations and destroys all material pipelines
+		pipelineCompiler.destroy();
 		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		if (bindlessPipelineLayout != VK_NULL_HANDLE) {
+			vkDestroyPipelineLayout(device, bindlessPipelineLayout, nullptr);
+		}
 		vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.matrices, nullptr);
 		vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.textures, nullptr);
 		for (auto& buffer : uniformBuffers) {
 			buffer.destroy();
 		}
+		materialBuffer.destroy();
 	}
 }
 
 void VulkanExample::getEnabledFeatures()
 {
 	enabledFeatures.samplerAnisotropy = deviceFeatures.samplerAnisotropy;
+	// Required for runtime texture compression
+	enabledFeatures.textureCompressionBC = deviceFeatures.textureCompressionBC;
+	// Enable the bindless table if the device supports the required descriptor indexing features
+	if (deviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+		VkPhysicalDeviceVulkan12Features features12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+		VkPhysicalDeviceFeatures2 features2{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &features12 };
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+		if (vks::BindlessTable::supported(deviceFeatures, features12)) {
+			vks::BindlessTable::enableFeatures(enabledFeatures, enabledFeatures12);
+			deviceCreatepNextChain = &enabledFeatures12;
+			bindlessSupported = true;
+		}
+	}
 }
 
 void VulkanExample::loadglTFFile(std::string filename)
@@ -330,6 +533,14 @@ void VulkanExample::loadglTFFile(std::string filename)
 	glTFScene.vulkanDevice = vulkanDevice;
 	glTFScene.copyQueue    = queue;
 
+	// The texture processor is only required during loading
+	vks::TextureProcessor textureProcessor;
+	if (computeMipGeneration) {
+		textureProcessor.create(vulkanDevice, getShadersPath() + "base/", pipelineCache);
+		glTFScene.textureProcessor = &textureProcessor;
+		glTFScene.textureCompression = compressTextures ? vks::TextureProcessor::Compression::BC1 : vks::TextureProcessor::Compression::None;
+	}
+
 	size_t pos = filename.find_last_of('/');
 	glTFScene.path = filename.substr(0, pos);
 
@@ -350,6 +561,8 @@ void VulkanExample::loadglTFFile(std::string filename)
 		vks::tools::exitFatal("Could not open the glTF file.\n\nMake sure the assets submodule has been checked out and is up-to-date.", -1);
 		return;
 	}
+	textureProcessor.destroy();
+	glTFScene.textureProcessor = nullptr;
 
 	// Create and upload vertex and index buffer
 	// We will be using one single vertex buffer and one single index buffer for the whole glTF scene
@@ -431,6 +644,7 @@ void VulkanExample::setupDescriptors()
 	// Two combined image samplers per material as each material uses color and normal maps
 	std::vector<VkDescriptorPoolSize> poolSizes = {
 		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxConcurrentFrames),
+		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxConcurrentFrames),
 		vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<uint32_t>(glTFScene.materials.size()) * 2 * maxConcurrentFrames),
 	};
 	// One set for matrices and one per model image/texture
@@ -438,9 +652,10 @@ void VulkanExample::setupDescriptors()
 	VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, maxSetCount);
 	VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
 
-	// Descriptor set layout for passing matrices
+	// Descriptor set layout for passing matrices and the material data used by the bindless path
 	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
-		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0)
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1)
 	};
 	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings.data(), static_cast<uint32_t>(setLayoutBindings.size()));
 
@@ -461,8 +676,11 @@ void VulkanExample::setupDescriptors()
 	for (auto i = 0; i < uniformBuffers.size(); i++) {
 		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayouts.matrices, 1);
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSets[i]));
-		VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffers[i].descriptor);
-		vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffers[i].descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &materialBuffer.descriptor),
+		};
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 	}
 
 	// Descriptor sets for materials, since they only use static images, no need to duplicate them per frame		
@@ -531,29 +749,52 @@ void VulkanExample::preparePipelines()
 	shaderStages[0] = loadShader(getShadersPath() + "gltfscenerendering/scene.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 	shaderStages[1] = loadShader(getShadersPath() + "gltfscenerendering/scene.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 
-	// POI: Instead if using a few fixed pipelines, we create one pipeline for each material using the properties of that material
-	for (auto &material : glTFScene.materials) {
+	// POI: Pipelines are compiled on worker threads, the compiler copies the create info so it can be changed right after submitting
+	pipelineCompiler.create(device, pipelineCache);
 
-		struct MaterialSpecializationData {
-			VkBool32 alphaMask;
-			float alphaMaskCutoff;
-		} materialSpecializationData{};
+	struct MaterialSpecializationData {
+		VkBool32 alphaMask;
+		float alphaMaskCutoff;
+	} materialSpecializationData{};
 
-		materialSpecializationData.alphaMask = material.alphaMode == "MASK";
-		materialSpecializationData.alphaMaskCutoff = material.alphaCutOff;
-
-		// POI: Constant fragment shader material parameters will be set using specialization constants
-		std::vector<VkSpecializationMapEntry> specializationMapEntries = {
-			vks::initializers::specializationMapEntry(0, offsetof(MaterialSpecializationData, alphaMask), sizeof(MaterialSpecializationData::alphaMask)),
-			vks::initializers::specializationMapEntry(1, offsetof(MaterialSpecializationData, alphaMaskCutoff), sizeof(MaterialSpecializationData::alphaMaskCutoff)),
-		};
-		VkSpecializationInfo specializationInfo = vks::initializers::specializationInfo(specializationMapEntries, sizeof(materialSpecializationData), &materialSpecializationData);
-		shaderStages[1].pSpecializationInfo = &specializationInfo;
-
-		// For double sided materials, culling will be disabled
-		rasterizationStateCI.cullMode = material.doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+	// POI: Constant fragment shader material parameters will be set using specialization constants
+	std::vector<VkSpecializationMapEntry> specializationMapEntries = {
+		vks::initializers::specializationMapEntry(0, offsetof(MaterialSpecializationData, alphaMask), sizeof(MaterialSpecializationData::alphaMask)),
+		vks::initializers::specializationMapEntry(1, offsetof(MaterialSpecializationData, alphaMaskCutoff), sizeof(MaterialSpecializationData::alphaMaskCutoff)),
+	};
+	VkSpecializationInfo specializationInfo = vks::initializers::specializationInfo(specializationMapEntries, sizeof(materialSpecializationData), &materialSpecializationData);
+	shaderStages[1].pSpecializationInfo = &specializationInfo;
 
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &material.pipeline));
+	// POI: Instead if using a few fixed pipelines, we create one pipeline for each material using the properties of that material
+	auto createMaterialPipelines = [&](vks::AsyncPipeline VulkanglTFScene::Material::* target, vks::PipelineCompiler::Priority priority) {
+		// The fallback is double sided and alpha masked, so it can stand in for every material, it's the only pipeline that needs to be ready before the first frame
+		materialSpecializationData = { .alphaMask = VK_TRUE, .alphaMaskCutoff = 0.5f };
+		rasterizationStateCI.cullMode = VK_CULL_MODE_NONE;
+		const VkPipeline fallback = pipelineCompiler.compile(pipelineCI, vks::PipelineCompiler::Priority::High).get();
+
+		for (auto &material : glTFScene.materials) {
+			materialSpecializationData.alphaMask = material.alphaMode == "MASK";
+			materialSpecializationData.alphaMaskCutoff = material.alphaCutOff;
+			// For double sided materials, culling will be disabled
+			rasterizationStateCI.cullMode = material.doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+			// Materials with the same state end up with the same pipeline
+			material.*target = vks::AsyncPipeline(pipelineCompiler.compile(pipelineCI, priority), fallback);
+		}
+	};
+	// The pipelines for the path that's active at startup are compiled first
+	createMaterialPipelines(&VulkanglTFScene::Material::pipeline, bindlessSupported ? vks::PipelineCompiler::Priority::Low : vks::PipelineCompiler::Priority::Normal);
+
+	// POI: The bindless variant uses the table's layout for set 1 and also passes the material index via push constants
+	if (bindlessSupported) {
+		std::array<VkDescriptorSetLayout, 2> bindlessSetLayouts = { descriptorSetLayouts.matrices, vks::bindlessTable.descriptorSetLayout };
+		VkPipelineLayoutCreateInfo bindlessPipelineLayoutCI = vks::initializers::pipelineLayoutCreateInfo(bindlessSetLayouts.data(), static_cast<uint32_t>(bindlessSetLayouts.size()));
+		VkPushConstantRange bindlessPushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(glm::mat4) + sizeof(uint32_t), 0);
+		bindlessPipelineLayoutCI.pushConstantRangeCount = 1;
+		bindlessPipelineLayoutCI.pPushConstantRanges = &bindlessPushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &bindlessPipelineLayoutCI, nullptr, &bindlessPipelineLayout));
+		pipelineCI.layout = bindlessPipelineLayout;
+		shaderStages[1] = loadShader(getShadersPath() + "gltfscenerendering/scenebindless.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		createMaterialPipelines(&VulkanglTFScene::Material::bindlessPipeline, vks::PipelineCompiler::Priority::Normal);
 	}
 }
 
@@ -565,6 +806,18 @@ void VulkanExample::prepareUniformBuffers()
 	}
 }
 
+void VulkanExample::prepareMaterialBuffer()
+{
+	// Material texture indices into the bindless table, shaders look these up using the material index passed via push constants
+	std::vector<MaterialData> materialData(glTFScene.materials.size());
+	for (size_t i = 0; i < glTFScene.materials.size(); i++) {
+		const VulkanglTFScene::Material& material = glTFScene.materials[i];
+		materialData[i].baseColorTextureIndex = glTFScene.images[material.baseColorTextureIndex].texture.bindlessIndex;
+		materialData[i].normalTextureIndex = glTFScene.images[material.normalTextureIndex].texture.bindlessIndex;
+	}
+	VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &materialBuffer, materialData.size() * sizeof(MaterialData), materialData.data()));
+}
+
 void VulkanExample::updateUniformBuffers()
 {
 	uniformData.projection = camera.matrices.perspective;
@@ -576,8 +829,14 @@ void VulkanExample::updateUniformBuffers()
 void VulkanExample::prepare()
 {
 	VulkanExampleBase::prepare();
+	// The table needs to be created before loading, so all textures register with it
+	if (bindlessSupported) {
+		vks::bindlessTable.create(vulkanDevice);
+		glTFScene.bindless = true;
+	}
 	loadAssets();
 	prepareUniformBuffers();
+	prepareMaterialBuffer();
 	setupDescriptors();
 	preparePipelines();
 	prepared = true;
@@ -609,11 +868,22 @@ void VulkanExample::buildCommandBuffer()
 	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
 	const VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
 	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+	// Both pipeline layouts share the same layout for set 0
+	const VkPipelineLayout scenePipelineLayout = glTFScene.bindless ? bindlessPipelineLayout : pipelineLayout;
 	// Bind scene matrices descriptor to set 0
-	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentBuffer], 0, nullptr);
-
-	// POI: Draw the glTF scene
-	glTFScene.draw(cmdBuffer, pipelineLayout);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scenePipelineLayout, 0, 1, &descriptorSets[currentBuffer], 0, nullptr);
+
+	// POI: Draw the glTF scene and measure the CPU time it takes to record the draw commands
+	const auto recordStart = std::chrono::high_resolution_clock::now();
+	if (glTFScene.sortedDraws) {
+		// Gathering and sorting is part of the measured time
+		glTFScene.buildDrawList(glm::vec3(glm::inverse(camera.matrices.view)[3]));
+		glTFScene.drawSorted(cmdBuffer, scenePipelineLayout);
+	} else {
+		glTFScene.draw(cmdBuffer, scenePipelineLayout);
+	}
+	const float recordDelta = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+	recordTime = (recordTime == 0.0f) ? recordDelta : recordTime * 0.95f + recordDelta * 0.05f;
 
 	drawUI(cmdBuffer);
 	vkCmdEndRenderPass(cmdBuffer);
@@ -626,10 +896,33 @@ void VulkanExample::render()
 	updateUniformBuffers();
 	buildCommandBuffer();
 	VulkanExampleBase::submitFrame();
+	// Pipelines compiled by the workers end up in the sample's pipeline cache
+	pipelineCompiler.mergeCaches();
 }
 
 void VulkanExample::OnUpdateUIOverlay(vks::UIOverlay* overlay)
 {
+	if (overlay->header("Texture memory")) {
+		ImGui::Text("Allocated: %.2f MB", glTFScene.textureMemory.allocated / (1024.0f * 1024.0f));
+		ImGui::Text("Uncompressed RGBA8: %.2f MB", glTFScene.textureMemory.uncompressed / (1024.0f * 1024.0f));
+	}
+	if (overlay->header("Descriptor binding")) {
+		if (bindlessSupported) {
+			overlay->checkBox("Bindless textures", &glTFScene.bindless);
+		} else {
+			ImGui::Text("Bindless textures not supported");
+		}
+		overlay->checkBox("Sorted draw list", &glTFScene.sortedDraws);
+		ImGui::Text("Descriptor set binds: %d", glTFScene.descriptorBinds);
+		ImGui::Text("Pipeline binds: %d", glTFScene.pipelineBinds);
+		ImGui::Text("Record time: %.3f ms", recordTime);
+	}
+	if (overlay->header("Pipeline compiler")) {
+		const vks::PipelineCompiler::Statistics stats = pipelineCompiler.stats();
+		ImGui::Text("Requests: %d (%d deduplicated)", stats.requests, stats.deduplicated);
+		ImGui::Text("Compiled: %d (%d pending)", stats.compiled, pipelineCompiler.pending());
+		ImGui::Text("Compile time: %.2f ms", stats.compileTime);
+	}
 	if (overlay->header("Visibility")) {
 
 		if (overlay->button("All")) {
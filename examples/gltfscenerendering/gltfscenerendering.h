@@ -1,7 +1,7 @@
 /*
 * Vulkan Example - Scene rendering
 *
-* Copyright (C) 2020-2025 by Sascha Willems - www.saschawillems.de
+* Copyright (C) 2020-2026 by Sascha Willems - www.saschawillems.de
 *
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 *
@@ -21,8 +21,14 @@
 #define TINYGLTF_ANDROID_LOAD_FROM_ASSETS
 #endif
 #include "tiny_gltf.h"
+// stb_image is compiled into the base library (as part of tinyglTF), so only the declarations are required for loading PNG/JPEG images
+#undef STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
 
 #include "vulkanexamplebase.h"
+#include "VulkanTextureProcessor.h"
+#include "VulkanPipelineCompiler.h"
+#include "VulkanDrawList.h"
 
 
  // Contains everything required to render a basic glTF scene in Vulkan
@@ -33,6 +39,9 @@ public:
 	// The class requires some Vulkan objects so it can create it's own resources
 	vks::VulkanDevice* vulkanDevice;
 	VkQueue copyQueue;
+	// Optional compute based mip generation and compression for images that aren't stored as ktx files
+	vks::TextureProcessor* textureProcessor{ nullptr };
+	vks::TextureProcessor::Compression textureCompression{ vks::TextureProcessor::Compression::None };
 
 	// The vertex layout for the samples' model
 	struct Vertex {
@@ -65,6 +74,8 @@ public:
 		uint32_t firstIndex;
 		uint32_t indexCount;
 		int32_t materialIndex;
+		// Center of the primitive's bounds in node space, used to sort draws by depth
+		glm::vec3 center{ 0.0f };
 	};
 
 	// Contains the node's (optional) geometry and can be made up of an arbitrary number of primitives
@@ -96,7 +107,10 @@ public:
 		float alphaCutOff;
 		bool doubleSided = false;
 		VkDescriptorSet descriptorSet;
-		VkPipeline pipeline;
+		// Material pipelines are compiled in the background, until they're ready a generic fallback pipeline is used
+		vks::AsyncPipeline pipeline;
+		// Variant of the pipeline that samples from the bindless table
+		vks::AsyncPipeline bindlessPipeline;
 	};
 
 	// Contains the texture for a single glTF image
@@ -121,14 +135,39 @@ public:
 
 	std::string path;
 
+	// Device memory used by all images, and what the same images would take as uncompressed RGBA8 with full mip chains
+	struct TextureMemory {
+		VkDeviceSize allocated{ 0 };
+		VkDeviceSize uncompressed{ 0 };
+	} textureMemory;
+
+	// POI: If enabled, textures are selected via bindless table indices, so draws only need to push a material index instead of binding a descriptor set
+	bool bindless{ false };
+	// Number of descriptor set and pipeline binds recorded by the last call to draw
+	uint32_t descriptorBinds{ 0 };
+	uint32_t pipelineBinds{ 0 };
+
+	// POI: If enabled, all visible primitives are gathered into a draw list that's sorted by alpha mode, pipeline, material and depth before drawing
+	bool sortedDraws{ false };
+	struct DrawItem {
+		const Primitive* primitive;
+		glm::mat4 matrix;
+	};
+	std::vector<DrawItem> drawItems;
+	vks::DrawList drawList;
+
 	~VulkanglTFScene();
 	VkDescriptorImageInfo getTextureDescriptor(const size_t index);
 	void loadImages(tinygltf::Model& input);
+	void loadImageWithProcessor(const std::string& filename, vks::Texture2D& texture);
 	void loadTextures(tinygltf::Model& input);
 	void loadMaterials(tinygltf::Model& input);
 	void loadNode(const tinygltf::Node& inputNode, const tinygltf::Model& input, VulkanglTFScene::Node* parent, std::vector<uint32_t>& indexBuffer, std::vector<VulkanglTFScene::Vertex>& vertexBuffer);
 	void drawNode(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VulkanglTFScene::Node* node);
 	void draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+	void gatherNode(const VulkanglTFScene::Node* node, const glm::mat4& parentMatrix, const glm::vec3& viewPos, std::unordered_map<VkPipeline, uint32_t>& pipelineIds);
+	void buildDrawList(const glm::vec3& viewPos);
+	void drawSorted(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
 };
 
 class VulkanExample : public VulkanExampleBase
@@ -152,6 +191,26 @@ public:
 	} descriptorSetLayouts;
 	std::array<VkDescriptorSet, maxConcurrentFrames> descriptorSets{};
 
+	// Bindless path: Each material's texture indices in the bindless table, the shader looks them up via the material index passed as a push constant
+	struct MaterialData {
+		uint32_t baseColorTextureIndex;
+		uint32_t normalTextureIndex;
+	};
+	vks::Buffer materialBuffer;
+	VkPipelineLayout bindlessPipelineLayout{ VK_NULL_HANDLE };
+	VkPhysicalDeviceVulkan12Features enabledFeatures12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+	bool bindlessSupported{ false };
+
+	// CPU time spent recording the scene's draw commands, averaged over a few frames
+	float recordTime{ 0.0f };
+
+	// Compiles the material pipelines on worker threads, materials with identical state share a pipeline
+	vks::PipelineCompiler pipelineCompiler;
+
+	// Used for PNG/JPEG images, compression requires BC support
+	bool computeMipGeneration = true;
+	bool compressTextures = true;
+
 	VulkanExample();
 	~VulkanExample();
 	virtual void getEnabledFeatures();
@@ -161,6 +220,7 @@ public:
 	void setupDescriptors();
 	void preparePipelines();
 	void prepareUniformBuffers();
+	void prepareMaterialBuffer();
 	void updateUniformBuffers();
 	void prepare();
 	virtual void render();
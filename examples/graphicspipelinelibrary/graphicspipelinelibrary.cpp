@@ -8,8 +8,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
-#include <thread>
-#include <mutex>
+#include "VulkanPipelineCompiler.h"
 
 class VulkanExample: public VulkanExampleBase
 {
@@ -35,21 +34,21 @@ public:
 		VkPipeline vertexInputInterface;
 		VkPipeline preRasterizationShaders;
 		VkPipeline fragmentOutputInterface;
-		std::vector<VkPipeline> fragmentShaders;
 	} pipelineLibrary;
 
-	std::vector<VkPipeline> pipelines{};
+	// Pipelines are compiled in the background, each cell of the grid uses the fast linked pipeline until the link time optimized one is ready
+	struct PipelineCell {
+		vks::AsyncPipeline fastLinked;
+		vks::AsyncPipeline optimized;
+	};
+	std::vector<PipelineCell> pipelines{};
+	vks::PipelineCompiler pipelineCompiler;
 
 	struct ShaderInfo {
 		uint32_t* code;
 		size_t size;
 	};
 
-	std::mutex mutex;
-	VkPipelineCache threadPipelineCache{ VK_NULL_HANDLE };
-
-	bool  newPipelineCreated = false;
-
 	uint32_t splitX{ 2 };
 	uint32_t splitY{ 2 };
 
@@ -78,16 +77,11 @@ public:
 	~VulkanExample()
 	{
 		if (device) {
-			for (auto pipeline : pipelines) {
-				vkDestroyPipeline(device, pipeline, nullptr);
-			}
-			for (auto pipeline : pipelineLibrary.fragmentShaders) {
-				vkDestroyPipeline(device, pipeline, nullptr);
-			}
+			// Waits for running compilations and destroys all fragment shader libraries and linked pipelines
+			pipelineCompiler.destroy();
 			vkDestroyPipeline(device, pipelineLibrary.fragmentOutputInterface, nullptr);
 			vkDestroyPipeline(device, pipelineLibrary.preRasterizationShaders, nullptr);
 			vkDestroyPipeline(device, pipelineLibrary.vertexInputInterface, nullptr);
-			vkDestroyPipelineCache(device, threadPipelineCache, nullptr);
 			vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 			for (auto& buffer : uniformBuffers) {
@@ -273,30 +267,10 @@ public:
 		}
 	}
 
-	void threadFn()
+	// Create the fragment shader part of the pipeline library for the given lighting model
+	// Called by the pipeline compiler's worker threads
+	VkPipeline createFragmentShaderLibrary(VkPipelineCache cache, uint32_t lightingModel)
 	{
-		const std::lock_guard<std::mutex> lock(mutex);
-
-		auto start = std::chrono::steady_clock::now();
-
-		prepareNewPipeline();
-		newPipelineCreated = true;
-
-		// Change viewport/draw count
-		if (pipelines.size() > splitX * splitY) {
-			splitX++;
-			splitY++;
-		}
-
-		auto delta = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
-		std::cout << "Pipeline created in " << delta.count() << " microseconds\n";
-	}
-
-	// Create a new pipeline using the pipeline library and a customized fragment shader
-	// Used from a thread
-	void prepareNewPipeline()
-	{
-		// Create the fragment shader part of the pipeline library with some random options
 		VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{
 			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
 			.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT
@@ -323,9 +297,6 @@ public:
 		};
 
 		// Select lighting model using a specialization constant
-		srand(benchmark.active ? 0 : ((unsigned int)time(NULL)));
-		uint32_t lighting_model = (int)(rand() % 4);
-
 		// Each shader constant of a shader stage corresponds to one map entry
 		VkSpecializationMapEntry specializationMapEntry{
 			.constantID = 0,
@@ -336,7 +307,7 @@ public:
 		.mapEntryCount = 1,
 		.pMapEntries = &specializationMapEntry,
 		.dataSize = sizeof(uint32_t),
-		.pData = &lighting_model
+		.pData = &lightingModel
 		};
 
 		shaderStageCI.pSpecializationInfo = &specializationInfo;
@@ -353,47 +324,80 @@ public:
 			.renderPass = renderPass,
 		};
 		VkPipeline fragmentShader = VK_NULL_HANDLE;
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, threadPipelineCache, 1, &pipelineCI, nullptr, &fragmentShader));
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, cache, 1, &pipelineCI, nullptr, &fragmentShader));
 
-		// Create the pipeline using the pre-built pipeline library parts
-		// Except for above fragment shader part all parts have been pre-built and will be re-used
+		delete[] shaderInfo.code;
+		return fragmentShader;
+	}
+
+	// Link the pre-built pipeline library parts and the given fragment shader part into an executable pipeline
+	// Called by the pipeline compiler's worker threads
+	VkPipeline linkPipeline(VkPipelineCache cache, VkPipeline fragmentShader, bool optimized)
+	{
+		// The fragment shader part is null if the compiler was shut down before it was created
+		if (fragmentShader == VK_NULL_HANDLE) {
+			return VK_NULL_HANDLE;
+		}
+		// Except for the fragment shader part all parts have been pre-built and will be re-used
 		std::vector<VkPipeline> libraries = {
 			pipelineLibrary.vertexInputInterface,
 			pipelineLibrary.preRasterizationShaders,
 			fragmentShader,
 			pipelineLibrary.fragmentOutputInterface };
 
-		// Link the library parts into a graphics pipeline
 		VkPipelineLibraryCreateInfoKHR pipelineLibraryCI{
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
 			.libraryCount = static_cast<uint32_t>(libraries.size()),
 			.pLibraries = libraries.data()
 		};
 
-		// If set to true, we pass VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT which will let the implementation do additional optimizations at link time
-		// This trades in pipeline creation time for run-time performance
-		bool optimized = true;
-
 		VkGraphicsPipelineCreateInfo executablePipelineCI{
 			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
 			.pNext = &pipelineLibraryCI,
 			.layout = pipelineLayout
 		};
-		if (linkTimeOptimization)
+		if (optimized)
 		{
-			// If link time optimization is activated in the UI, we set the VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT flag which will let the implementation do additional optimizations at link time
+			// VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT lets the implementation do additional optimizations at link time
 			// This trades in pipeline creation time for run-time performance
 			executablePipelineCI.flags = VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT;
 		}
 
 		VkPipeline executable = VK_NULL_HANDLE;
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, threadPipelineCache, 1, &executablePipelineCI, nullptr, &executable));
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, cache, 1, &executablePipelineCI, nullptr, &executable));
+		return executable;
+	}
 
-		pipelines.push_back(executable);
-		// Push fragment shader to list for deletion in the sample's destructor
-		pipelineLibrary.fragmentShaders.push_back(fragmentShader);
+	// Request a new pipeline with a random lighting model from the background compiler
+	// The fast linked pipeline is requested with a higher priority, so something can be displayed as early as possible
+	void requestNewPipeline()
+	{
+		const uint32_t lightingModel = (uint32_t)(rand() % 4);
+
+		// Only the fragment shader part is shared between cells with the same lighting model, so it's deduplicated by the compiler
+		// Each cell links its own executable pipelines, so the link jobs are keyed by the cell index
+		// Link jobs wait on the fragment shader job, which is always submitted first with at least the same priority, so it's never queued behind them
+		std::shared_future<VkPipeline> fragmentShader = pipelineCompiler.compile(lightingModel, [this, lightingModel](VkPipelineCache cache) {
+			return createFragmentShaderLibrary(cache, lightingModel);
+		}, vks::PipelineCompiler::Priority::High);
+
+		const uint64_t cellKey = static_cast<uint64_t>(pipelines.size() + 1) << 34;
+		PipelineCell cell{};
+		cell.fastLinked.future = pipelineCompiler.compile(cellKey | (1ull << 32) | lightingModel, [this, fragmentShader](VkPipelineCache cache) {
+			return linkPipeline(cache, fragmentShader.get(), false);
+		}, vks::PipelineCompiler::Priority::High);
+		if (linkTimeOptimization) {
+			cell.optimized.future = pipelineCompiler.compile(cellKey | (2ull << 32) | lightingModel, [this, fragmentShader](VkPipelineCache cache) {
+				return linkPipeline(cache, fragmentShader.get(), true);
+			}, vks::PipelineCompiler::Priority::Normal);
+		}
+		pipelines.push_back(cell);
 
-		delete[] shaderInfo.code;
+		// Change viewport/draw count
+		if (pipelines.size() > splitX * splitY) {
+			splitX++;
+			splitY++;
+		}
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -424,19 +428,16 @@ public:
 		setupDescriptors();
 		preparePipelineLibrary();
 
-		// Create a separate pipeline cache for the pipeline creation thread
-		VkPipelineCacheCreateInfo pipelineCachCI = {};
-		pipelineCachCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-		vkCreatePipelineCache(device, &pipelineCachCI, nullptr, &threadPipelineCache);
+		// Pipelines are compiled on worker threads with their own pipeline caches, which are merged into the sample's pipeline cache
+		pipelineCompiler.create(device, pipelineCache);
+		srand(benchmark.active ? 0 : ((unsigned int)time(NULL)));
 
-		// Create first pipeline using a background thread
-		std::thread pipelineGenerationThread(&VulkanExample::threadFn, this);
+		// Request the first pipeline
+		requestNewPipeline();
 
 		// Stall in benchmark mode until pipeline creation is finished to measure work more consistently
 		if (benchmark.active) {
-			pipelineGenerationThread.join();
-		} else {
-			pipelineGenerationThread.detach();
+			pipelineCompiler.wait();
 		}
 
 		prepared = true;
@@ -491,8 +492,15 @@ public:
 				vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
 				if (pipelines.size() > idx) {
-					vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[idx]);
-					scene.draw(cmdBuffer);
+					VkPipeline pipeline = pipelines[idx].optimized.get();
+					if (pipeline == VK_NULL_HANDLE) {
+						pipeline = pipelines[idx].fastLinked.get();
+					}
+					// Cells whose pipeline hasn't been compiled yet stay empty
+					if (pipeline != VK_NULL_HANDLE) {
+						vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+						scene.draw(cmdBuffer);
+					}
 				}
 
 				idx++;
@@ -513,12 +521,9 @@ public:
 			return;
 		VulkanExampleBase::prepareFrame();
 		updateUniformBuffers();
-		if (newPipelineCreated) {
-			// Make sure no work is pending before using the newly created pipeline
-			vkQueueWaitIdle(queue);
-			newPipelineCreated = false;
-		}
+		// Pipelines only become visible to the command buffer once they have been fully created, so no additional synchronization is required
 		buildCommandBuffer();
+		pipelineCompiler.mergeCaches();
 		VulkanExampleBase::submitFrame();
 	}
 
@@ -526,9 +531,14 @@ public:
 	{
 		overlay->checkBox("Link time optimization", &linkTimeOptimization);
 		if (overlay->button("New pipeline")) {
-			// Spawn a thread to create a new pipeline in the background
-			std::thread pipelineGenerationThread(&VulkanExample::threadFn, this);
-			pipelineGenerationThread.detach();
+			requestNewPipeline();
+		}
+		if (overlay->header("Pipeline compiler")) {
+			const vks::PipelineCompiler::Statistics stats = pipelineCompiler.stats();
+			overlay->text("Requests: %d (%d deduplicated)", stats.requests, stats.deduplicated);
+			overlay->text("Compiled: %d (%d pending)", stats.compiled, pipelineCompiler.pending());
+			overlay->text("Compile time: %.2f ms", stats.compileTime);
+			overlay->text("Cache merges: %d", stats.cacheMerges);
 		}
 	}
 };
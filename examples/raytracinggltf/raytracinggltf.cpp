@@ -754,7 +754,7 @@ public:
 			cmdBuffer,
 			swapChain.images[currentImageIndex],
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			swapChain.presentLayout,
 			subresourceRange);
 
 		// Transition ray tracing output image back to general layout
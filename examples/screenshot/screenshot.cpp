@@ -35,6 +35,8 @@ public:
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Saving framebuffer to screenshot";
+		// Screenshots are taken from the presented swapchain image
+		requiresSwapChain = true;
 		camera.type = Camera::CameraType::lookat;
 		camera.setPerspective(60.0f, (float)width / (float)height, 0.1f, 512.0f);
 		camera.setRotation(glm::vec3(-25.0f, 23.75f, 0.0f));
@@ -1,6 +1,6 @@
 /*
 	Vulkan Example - Cascaded shadow mapping for directional light sources
-	Copyright (c) 2016-2025 by Sascha Willems - www.saschawillems.de
+	Copyright (c) 2016-2026 by Sascha Willems - www.saschawillems.de
 	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 
 	This example implements projective cascaded shadow mapping. This technique splits up the camera frustum into
@@ -13,10 +13,16 @@
 
 	A further optimization could be done using a geometry shader to do a single-pass render for the depth map
 	cascades instead of multiple passes (geometry shaders are not supported on all target devices).
+
+	To reduce the cost of the depth passes, cascades are stabilized by snapping them to shadow map texels and cached:
+	Static geometry is rendered into a separate cache layer only when a cascade moves, and is then copied to the
+	cascade's layer before drawing dynamic objects on top. Distant cascades are only updated every few frames,
+	with updates staggered across frames.
 */
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "frustum.hpp"
 
 #if defined(__ANDROID__)
 #define SHADOWMAP_DIM 2048
@@ -36,6 +42,21 @@ public:
 
 	float cascadeSplitLambda = 0.95f;
 
+	// Snap cascades to shadow map texels so they only move in full texel increments
+	bool stableCascades = true;
+	// Keep static geometry in per-cascade caches and only redraw it if a cascade has moved
+	bool cacheCascades = true;
+	// Cascades other than the first one are only updated every n frames
+	int32_t cascadeUpdateInterval = 4;
+	uint32_t cascadeFrameIndex = 0;
+	// A moving light changes all cascade matrices each frame, which invalidates the static caches, so the light is static by default
+	bool animateLight = false;
+	bool animateObject = true;
+	float objectAngle = 0.0f;
+
+	// Selects the objects drawn by renderScene
+	enum SceneObjects { Static = 0x1, Dynamic = 0x2, All = Static | Dynamic };
+
 	float zNear = 0.5f;
 	float zFar = 48.0f;
 
@@ -88,12 +109,16 @@ public:
 	// Resources of the depth map generation pass
 	struct DepthPass {
 		VkRenderPass renderPass;
+		// Same as above, but keeps the contents of the cascade layer (copied from the static cache)
+		VkRenderPass renderPassLoad;
 		VkPipelineLayout pipelineLayout;
 		VkPipeline pipeline;
 	} depthPass;
 
 	// Layered depth image containing the shadow cascade depths
+	// The first SHADOW_MAP_CASCADE_COUNT layers are sampled by the scene, the remaining layers cache static geometry of each cascade
 	struct DepthImage {
+		VkFormat format;
 		VkImage image;
 		VkDeviceMemory mem;
 		VkImageView view;
@@ -110,15 +135,36 @@ public:
 	struct Cascade {
 		VkFramebuffer frameBuffer;
 		VkImageView view;
+		VkFramebuffer staticFrameBuffer;
+		VkImageView staticView;
 		float splitDepth;
+		// Matrix the cascade's current contents have been rendered with, this is also the one passed to the shaders
 		glm::mat4 viewProjMatrix;
+		// True if the cascade is updated in the current frame
+		bool scheduled{ true };
+		// True if the static cache layer matches the current matrix
+		bool staticValid{ false };
+		// True if the cascade layer contains dynamic objects from the last update
+		bool containsDynamic{ false };
 		void destroy(VkDevice device) const {
 			vkDestroyImageView(device, view, nullptr);
 			vkDestroyFramebuffer(device, frameBuffer, nullptr);
+			vkDestroyImageView(device, staticView, nullptr);
+			vkDestroyFramebuffer(device, staticFrameBuffer, nullptr);
 		}
 	};
 	std::array<Cascade, SHADOW_MAP_CASCADE_COUNT> cascades;
 
+	// GPU time of the shadow passes measured with timestamp queries, and number of cascade layers rendered last frame
+	struct {
+		bool supported{ false };
+		VkQueryPool queryPool{ VK_NULL_HANDLE };
+		std::array<bool, maxConcurrentFrames> written{};
+		float gpu{ 0.0f };
+		uint32_t staticUpdates{ 0 };
+		uint32_t dynamicUpdates{ 0 };
+	} shadowStats;
+
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Cascaded shadow mapping";
@@ -138,6 +184,10 @@ public:
 		}
 		depth.destroy(device);
 		vkDestroyRenderPass(device, depthPass.renderPass, nullptr);
+		vkDestroyRenderPass(device, depthPass.renderPassLoad, nullptr);
+		if (shadowStats.queryPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(device, shadowStats.queryPool, nullptr);
+		}
 		vkDestroyPipeline(device, pipelines.debugShadowMap, nullptr);
 		vkDestroyPipeline(device, depthPass.pipeline, nullptr);
 		vkDestroyPipeline(device, pipelines.sceneShadow, nullptr);
@@ -163,34 +213,56 @@ public:
 		Render the example scene to acommand buffer using the supplied pipeline layout and for the selected shadow cascade index
 		Used by the scene rendering and depth pass generation command buffer
 	*/
-	void renderScene(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t cascadeIndex = 0) {
+	void renderScene(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t cascadeIndex = 0, uint32_t sceneObjects = SceneObjects::All) {
 		// We use push constants for passing shadow cascade info to the shaders
 		PushConstBlock pushConstBlock = { glm::vec4(0.0f), cascadeIndex };
 
 		// Set 0 contains the vertex and fragment shader uniform buffers, set 1 for images will be set by the glTF model class at draw time
 		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentBuffer], 0, nullptr);
 
-		// Floor
-		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstBlock), &pushConstBlock);
-		models.terrain.draw(commandBuffer, vkglTF::RenderFlags::BindImages, pipelineLayout);
-
-		// Trees
-		const std::vector<glm::vec3> positions = {
-			glm::vec3(0.0f, 0.0f, 0.0f),
-			glm::vec3(1.25f, 0.25f, 1.25f),
-			glm::vec3(-1.25f, -0.2f, 1.25f),
-			glm::vec3(1.25f, 0.1f, -1.25f),
-			glm::vec3(-1.25f, -0.25f, -1.25f),
-		};
+		if (sceneObjects & SceneObjects::Static) {
+			// Floor
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstBlock), &pushConstBlock);
+			models.terrain.draw(commandBuffer, vkglTF::RenderFlags::BindImages, pipelineLayout);
+
+			// Trees
+			const std::vector<glm::vec3> positions = {
+				glm::vec3(0.0f, 0.0f, 0.0f),
+				glm::vec3(1.25f, 0.25f, 1.25f),
+				glm::vec3(-1.25f, -0.2f, 1.25f),
+				glm::vec3(1.25f, 0.1f, -1.25f),
+				glm::vec3(-1.25f, -0.25f, -1.25f),
+			};
 
-		for (auto& position : positions) {
-			pushConstBlock.position = glm::vec4(position, 0.0f);
+			for (auto& position : positions) {
+				pushConstBlock.position = glm::vec4(position, 0.0f);
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstBlock), &pushConstBlock);
+				// This will also bind the texture images to set 1
+				models.tree.draw(commandBuffer, vkglTF::RenderFlags::BindImages, pipelineLayout);
+			}
+		}
+
+		if (sceneObjects & SceneObjects::Dynamic) {
+			// A moving tree
+			pushConstBlock.position = glm::vec4(dynamicObjectPosition(), 0.0f);
 			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstBlock), &pushConstBlock);
-			// This will also bind the texture images to set 1
 			models.tree.draw(commandBuffer, vkglTF::RenderFlags::BindImages, pipelineLayout);
 		}
 	}
 
+	glm::vec3 dynamicObjectPosition()
+	{
+		return glm::vec3(sin(objectAngle) * 2.5f, 0.0f, cos(objectAngle) * 2.5f);
+	}
+
+	// Checks if the dynamic object is inside of a cascade's orthographic projection
+	bool dynamicObjectInCascade(const Cascade& cascade)
+	{
+		vks::Frustum frustum;
+		frustum.update(cascade.viewProjMatrix);
+		return frustum.checkSphere(dynamicObjectPosition() + models.tree.dimensions.center, models.tree.dimensions.radius);
+	}
+
 	/*
 		Setup resources used by the depth pass
 		The depth image is layered with each layer storing one shadow map cascade
@@ -198,6 +270,7 @@ public:
 	void prepareDepthPass()
 	{
 		VkFormat depthFormat = vulkanDevice->getSupportedDepthFormat(true);
+		depth.format = depthFormat;
 
 		/*
 			Depth map renderpass
@@ -251,6 +324,15 @@ public:
 
 		VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &depthPass.renderPass));
 
+		// Render pass for drawing dynamic objects on top of the static geometry copied from the cache layer
+		attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &depthPass.renderPassLoad));
+
 		/*
 			Layered depth image and views
 		*/
@@ -261,11 +343,12 @@ public:
 		imageInfo.extent.height = SHADOWMAP_DIM;
 		imageInfo.extent.depth = 1;
 		imageInfo.mipLevels = 1;
-		imageInfo.arrayLayers = SHADOW_MAP_CASCADE_COUNT;
+		// Cascade layers plus static cache layers
+		imageInfo.arrayLayers = SHADOW_MAP_CASCADE_COUNT * 2;
 		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 		imageInfo.format = depthFormat;
-		imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 		VK_CHECK_RESULT(vkCreateImage(device, &imageInfo, nullptr, &depth.image));
 		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
 		VkMemoryRequirements memReqs;
@@ -274,6 +357,14 @@ public:
 		memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &depth.mem));
 		VK_CHECK_RESULT(vkBindImageMemory(device, depth.image, depth.mem, 0));
+		// All layers start in the layout the depth passes leave them in, as cached cascade layers are not always cleared by a render pass
+		VkCommandBuffer layoutCmd = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, SHADOW_MAP_CASCADE_COUNT * 2 };
+		if (vks::tools::formatHasStencil(depthFormat)) {
+			subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		vks::tools::setImageLayout(layoutCmd, depth.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, subresourceRange);
+		vulkanDevice->flushCommandBuffer(layoutCmd, queue, true);
 		// Full depth map view (all layers)
 		VkImageViewCreateInfo viewInfo = vks::initializers::imageViewCreateInfo();
 		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
@@ -311,6 +402,11 @@ public:
 			framebufferInfo.height = SHADOWMAP_DIM;
 			framebufferInfo.layers = 1;
 			VK_CHECK_RESULT(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &cascades[i].frameBuffer));
+			// Image view and framebuffer for this cascade's static cache layer
+			viewInfo.subresourceRange.baseArrayLayer = SHADOW_MAP_CASCADE_COUNT + i;
+			VK_CHECK_RESULT(vkCreateImageView(device, &viewInfo, nullptr, &cascades[i].staticView));
+			framebufferInfo.pAttachments = &cascades[i].staticView;
+			VK_CHECK_RESULT(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &cascades[i].staticFrameBuffer));
 		}
 
 		// Shared sampler for cascade depth reads
@@ -529,6 +625,15 @@ public:
 		float lastSplitDist = 0.0;
 		for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
 			float splitDist = cascadeSplits[i];
+			cascades[i].splitDepth = (camera.getNearClip() + splitDist * clipRange) * -1.0f;
+
+			// With caching enabled, the first cascade is updated every frame, all others are updated every cascadeUpdateInterval frames
+			// The updates are staggered, so that only few cascades are updated in a single frame
+			cascades[i].scheduled = !cacheCascades || (i == 0) || !cascades[i].staticValid || ((cascadeFrameIndex + i) % cascadeUpdateInterval == 0);
+			if (!cascades[i].scheduled) {
+				lastSplitDist = cascadeSplits[i];
+				continue;
+			}
 
 			glm::vec3 frustumCorners[8] = {
 				glm::vec3(-1.0f,  1.0f, 0.0f),
@@ -572,17 +677,66 @@ public:
 			glm::vec3 minExtents = -maxExtents;
 
 			glm::vec3 lightDir = normalize(-lightPos);
+
+			// Move the cascade's center in light space in full texel increments only
+			// As the extents of the cascade are constant (the radius doesn't depend on the camera's position and rotation), this stops shadow edges from shimmering when the camera moves
+			// It also means that the cascade's matrix stays the same for small camera movements, so cached contents can be reused
+			if (stableCascades) {
+				const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), lightDir, glm::vec3(0.0f, 1.0f, 0.0f));
+				const float texelSize = (maxExtents.x - minExtents.x) / static_cast<float>(SHADOWMAP_DIM);
+				glm::vec3 centerLightSpace = glm::vec3(lightRotation * glm::vec4(frustumCenter, 1.0f));
+				centerLightSpace = glm::floor(centerLightSpace / texelSize) * texelSize;
+				frustumCenter = glm::vec3(glm::inverse(lightRotation) * glm::vec4(centerLightSpace, 1.0f));
+			}
+
 			glm::mat4 lightViewMatrix = glm::lookAt(frustumCenter - lightDir * -minExtents.z, frustumCenter, glm::vec3(0.0f, 1.0f, 0.0f));
 			glm::mat4 lightOrthoMatrix = glm::ortho(minExtents.x, maxExtents.x, minExtents.y, maxExtents.y, 0.0f, maxExtents.z - minExtents.z);
 
-			// Store split distance and matrix in cascade
-			cascades[i].splitDepth = (camera.getNearClip() + splitDist * clipRange) * -1.0f;
-			cascades[i].viewProjMatrix = lightOrthoMatrix * lightViewMatrix;
+			// Static geometry needs to be redrawn if the cascade has moved
+			glm::mat4 viewProjMatrix = lightOrthoMatrix * lightViewMatrix;
+			if (viewProjMatrix != cascades[i].viewProjMatrix) {
+				cascades[i].viewProjMatrix = viewProjMatrix;
+				cascades[i].staticValid = false;
+			}
 
 			lastSplitDist = cascadeSplits[i];
 		}
 	}
 
+	// Forces all cascades to be fully redrawn with the next update
+	void invalidateCascades()
+	{
+		for (auto& cascade : cascades) {
+			cascade.staticValid = false;
+		}
+	}
+
+	void prepareShadowStats()
+	{
+		shadowStats.supported = (vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.graphics].timestampValidBits > 0);
+		if (!shadowStats.supported) {
+			return;
+		}
+		VkQueryPoolCreateInfo queryPoolCI{};
+		queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCI.queryCount = 2 * maxConcurrentFrames;
+		VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &shadowStats.queryPool));
+	}
+
+	// Reads the timestamps written by the last submission of the current frame slot (which has finished, as its fence has been waited on)
+	void updateShadowStats()
+	{
+		if (!shadowStats.supported || !shadowStats.written[currentBuffer]) {
+			return;
+		}
+		std::array<uint64_t, 2> timestamps{};
+		if (vkGetQueryPoolResults(device, shadowStats.queryPool, currentBuffer * 2, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+			const float gpuTime = (float)(timestamps[1] - timestamps[0]) * deviceProperties.limits.timestampPeriod / 1000000.0f;
+			shadowStats.gpu = glm::mix(shadowStats.gpu, gpuTime, 0.1f);
+		}
+	}
+
 	void updateLight()
 	{
 		float angle = glm::radians(timer * 360.0f);
@@ -625,12 +779,124 @@ public:
 		updateLight();
 		updateCascades();
 		prepareDepthPass();
+		prepareShadowStats();
 		prepareUniformBuffers();
 		setupLayoutsAndDescriptors();
 		preparePipelines();
 		prepared = true;
 	}
 
+	// Copies the static cache layer of a cascade to the layer sampled by the scene
+	void copyStaticCascade(VkCommandBuffer cmdBuffer, uint32_t cascadeIndex)
+	{
+		VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (vks::tools::formatHasStencil(depth.format)) {
+			aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		const VkImageSubresourceRange cascadeRange = { aspectMask, 0, 1, cascadeIndex, 1 };
+		const VkImageSubresourceRange staticRange = { aspectMask, 0, 1, SHADOW_MAP_CASCADE_COUNT + cascadeIndex, 1 };
+
+		vks::tools::insertImageMemoryBarrier(cmdBuffer, depth.image, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, staticRange);
+		vks::tools::insertImageMemoryBarrier(cmdBuffer, depth.image, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, cascadeRange);
+
+		VkImageCopy copyRegion{};
+		copyRegion.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, SHADOW_MAP_CASCADE_COUNT + cascadeIndex, 1 };
+		copyRegion.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, cascadeIndex, 1 };
+		copyRegion.extent = { SHADOWMAP_DIM, SHADOWMAP_DIM, 1 };
+		vkCmdCopyImage(cmdBuffer, depth.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, depth.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+		// The cache layer may be redrawn in a later frame, so depth writes must wait for the copy
+		vks::tools::insertImageMemoryBarrier(cmdBuffer, depth.image, 0, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, staticRange);
+	}
+
+	/*
+		Update the depth map cascades
+		Without caching, all cascades are cleared and the whole scene is redrawn
+		With caching, static geometry is only redrawn into a cascade's cache layer if the cascade has moved
+		The cache layer is then copied to the cascade's layer and dynamic objects are drawn on top, which is only required if dynamic objects are (or were) inside the cascade
+	*/
+	void renderCascades(VkCommandBuffer cmdBuffer)
+	{
+		VkClearValue clearValues[1]{};
+		clearValues[0].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderArea.offset.x = 0;
+		renderPassBeginInfo.renderArea.offset.y = 0;
+		renderPassBeginInfo.renderArea.extent.width = SHADOWMAP_DIM;
+		renderPassBeginInfo.renderArea.extent.height = SHADOWMAP_DIM;
+
+		VkViewport viewport = vks::initializers::viewport((float)SHADOWMAP_DIM, (float)SHADOWMAP_DIM, 0.0f, 1.0f);
+		vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor = vks::initializers::rect2D(SHADOWMAP_DIM, SHADOWMAP_DIM, 0, 0);
+		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+		shadowStats.staticUpdates = 0;
+		shadowStats.dynamicUpdates = 0;
+
+		// One pass per cascade
+		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
+			Cascade& cascade = cascades[j];
+
+			if (!cacheCascades) {
+				renderPassBeginInfo.renderPass = depthPass.renderPass;
+				renderPassBeginInfo.framebuffer = cascade.frameBuffer;
+				renderPassBeginInfo.clearValueCount = 1;
+				renderPassBeginInfo.pClearValues = clearValues;
+				vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+				vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPass.pipeline);
+				renderScene(cmdBuffer, depthPass.pipelineLayout, j);
+				vkCmdEndRenderPass(cmdBuffer);
+				// Cached contents are no longer in sync
+				cascade.staticValid = false;
+				shadowStats.staticUpdates++;
+				continue;
+			}
+
+			if (!cascade.scheduled) {
+				continue;
+			}
+
+			bool refresh = false;
+			if (!cascade.staticValid) {
+				// The cascade has moved, redraw static geometry into the cache layer
+				renderPassBeginInfo.renderPass = depthPass.renderPass;
+				renderPassBeginInfo.framebuffer = cascade.staticFrameBuffer;
+				renderPassBeginInfo.clearValueCount = 1;
+				renderPassBeginInfo.pClearValues = clearValues;
+				vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+				vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPass.pipeline);
+				renderScene(cmdBuffer, depthPass.pipelineLayout, j, SceneObjects::Static);
+				vkCmdEndRenderPass(cmdBuffer);
+				cascade.staticValid = true;
+				refresh = true;
+				shadowStats.staticUpdates++;
+			}
+
+			// Dynamic objects need to be redrawn if they are inside the cascade, or removed if they were inside the cascade at the last update
+			const bool containsDynamic = dynamicObjectInCascade(cascade);
+			refresh |= (containsDynamic || cascade.containsDynamic);
+			if (!refresh) {
+				continue;
+			}
+
+			copyStaticCascade(cmdBuffer, j);
+			renderPassBeginInfo.renderPass = depthPass.renderPassLoad;
+			renderPassBeginInfo.framebuffer = cascade.frameBuffer;
+			renderPassBeginInfo.clearValueCount = 0;
+			renderPassBeginInfo.pClearValues = nullptr;
+			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			if (containsDynamic) {
+				vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPass.pipeline);
+				renderScene(cmdBuffer, depthPass.pipelineLayout, j, SceneObjects::Dynamic);
+				shadowStats.dynamicUpdates++;
+			}
+			vkCmdEndRenderPass(cmdBuffer);
+			cascade.containsDynamic = containsDynamic;
+		}
+	}
+
 	void buildCommandBuffer()
 	{
 		VkCommandBuffer cmdBuffer = drawCmdBuffers[currentBuffer];
@@ -645,33 +911,14 @@ public:
 			Uses multiple passes with each pass rendering the scene to the cascade's depth image layer
 			Could be optimized using a geometry shader (and layered frame buffer) on devices that support geometry shaders
 		*/
-		{
-			VkClearValue clearValues[1]{};
-			clearValues[0].depthStencil = { 1.0f, 0 };
-
-			VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
-			renderPassBeginInfo.renderPass = depthPass.renderPass;
-			renderPassBeginInfo.renderArea.offset.x = 0;
-			renderPassBeginInfo.renderArea.offset.y = 0;
-			renderPassBeginInfo.renderArea.extent.width = SHADOWMAP_DIM;
-			renderPassBeginInfo.renderArea.extent.height = SHADOWMAP_DIM;
-			renderPassBeginInfo.clearValueCount = 1;
-			renderPassBeginInfo.pClearValues = clearValues;
-
-			VkViewport viewport = vks::initializers::viewport((float)SHADOWMAP_DIM, (float)SHADOWMAP_DIM, 0.0f, 1.0f);
-			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-
-			VkRect2D scissor = vks::initializers::rect2D(SHADOWMAP_DIM, SHADOWMAP_DIM, 0, 0);
-			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
-
-			// One pass per cascade
-			for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
-				renderPassBeginInfo.framebuffer = cascades[j].frameBuffer;
-				vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-				vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPass.pipeline);
-				renderScene(cmdBuffer, depthPass.pipelineLayout, j);
-				vkCmdEndRenderPass(cmdBuffer);
-			}
+		if (shadowStats.supported) {
+			vkCmdResetQueryPool(cmdBuffer, shadowStats.queryPool, currentBuffer * 2, 2);
+			vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, shadowStats.queryPool, currentBuffer * 2);
+		}
+		renderCascades(cmdBuffer);
+		if (shadowStats.supported) {
+			vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, shadowStats.queryPool, currentBuffer * 2 + 1);
+			shadowStats.written[currentBuffer] = true;
 		}
 
 		/*
@@ -732,9 +979,14 @@ public:
 		if (!prepared)
 			return;
 		VulkanExampleBase::prepareFrame();
-		if (!paused || camera.updated) {
+		updateShadowStats();
+		if (animateLight && (!paused || camera.updated)) {
 			updateLight();
 		}
+		if (animateObject && !paused) {
+			objectAngle += frameTimer * 0.5f;
+		}
+		cascadeFrameIndex++;
 		updateCascades();
 		updateUniformBuffers();
 		buildCommandBuffer();
@@ -745,6 +997,7 @@ public:
 	{
 		if (overlay->header("Settings")) {
 			if (overlay->sliderFloat("Split lambda", &cascadeSplitLambda, 0.1f, 1.0f)) {
+				invalidateCascades();
 				updateCascades();
 			}
 			overlay->checkBox("Color cascades", &colorCascades);
@@ -753,6 +1006,23 @@ public:
 				overlay->sliderInt("Cascade", &displayDepthMapCascadeIndex, 0, SHADOW_MAP_CASCADE_COUNT - 1);
 			}
 			overlay->checkBox("PCF filtering", &filterPCF);
+			overlay->checkBox("Animate light", &animateLight);
+			overlay->checkBox("Animate object", &animateObject);
+		}
+		if (overlay->header("Cascade updates")) {
+			if (overlay->checkBox("Stable cascades", &stableCascades)) {
+				invalidateCascades();
+			}
+			if (overlay->checkBox("Cache cascades", &cacheCascades)) {
+				invalidateCascades();
+			}
+			if (cacheCascades) {
+				overlay->sliderInt("Update interval", &cascadeUpdateInterval, 1, 8);
+			}
+			overlay->text("Static redraws: %d, dynamic redraws: %d", shadowStats.staticUpdates, shadowStats.dynamicUpdates);
+			if (shadowStats.supported) {
+				overlay->text("Shadow pass GPU time: %.3f ms", shadowStats.gpu);
+			}
 		}
 	}
 };
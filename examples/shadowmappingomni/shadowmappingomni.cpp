@@ -1,18 +1,29 @@
 /*
 * Vulkan Example - Omni directional shadows using a dynamic cube map
 *
-* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+* The cube map can either be rendered with one render pass per face, or in a single layered pass
+* The single pass path draws each object once, instanced for all faces it's visible in, and selects the target cube map layer in the vertex shader
+* This requires VK_EXT_shader_viewport_index_layer
+*
+* Copyright (C) 2016-2026 by Sascha Willems - www.saschawillems.de
 *
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
+#include <bit>
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "frustum.hpp"
 
 class VulkanExample : public VulkanExampleBase
 {
 public:
 	bool displayCubeMap{ false };
+	// Render all cube map faces in a single layered render pass instead of six separate passes
+	bool singlePass{ false };
+	bool singlePassSupported{ false };
+	// Skip objects that are outside of a cube map face's frustum
+	bool faceCulling{ true };
 
 	// Defines the depth range used for the shadow maps
 	// This should be kept as small as possible for precision
@@ -32,7 +43,27 @@ public:
 		glm::mat4 model;
 		glm::vec4 lightPos;
 	};
-	UniformData uniformDataScene, uniformDataOffscreen;
+	UniformData uniformDataScene;
+
+	// The offscreen uniform block also contains the view matrices for all cube map faces, used by the single pass path
+	struct UniformDataOffscreen {
+		glm::mat4 projection;
+		glm::mat4 view;
+		glm::mat4 model;
+		glm::vec4 lightPos;
+		glm::mat4 faceViews[6];
+	} uniformDataOffscreen;
+
+	// Shadow casting primitives of the scene with their world space bounding spheres for per-face culling
+	struct ShadowCaster {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		glm::vec3 center;
+		float radius;
+		// Bit mask of the cube map faces this primitive is visible in, updated every frame
+		uint32_t faceMask;
+	};
+	std::vector<ShadowCaster> shadowCasters;
 
 	struct UniformBuffers {
 		vks::Buffer scene;
@@ -43,6 +74,7 @@ public:
 	struct {
 		VkPipeline scene{ VK_NULL_HANDLE };
 		VkPipeline offscreen{ VK_NULL_HANDLE };
+		VkPipeline offscreenLayered{ VK_NULL_HANDLE };
 		VkPipeline cubemapDisplay{ VK_NULL_HANDLE };
 	} pipelines;
 
@@ -61,6 +93,8 @@ public:
 
 	vks::Texture shadowCubeMap;
 	std::array<VkImageView, 6> shadowCubeMapFaceImageViews{};
+	// Array view of all cube map faces for layered rendering
+	VkImageView shadowCubeMapLayeredImageView{ VK_NULL_HANDLE };
 
 	// Framebuffer for offscreen rendering
 	struct FrameBufferAttachment {
@@ -71,7 +105,9 @@ public:
 	struct OffscreenPass {
 		int32_t width, height;
 		std::array<VkFramebuffer, 6> frameBuffers;
+		VkFramebuffer layeredFrameBuffer{ VK_NULL_HANDLE };
 		FrameBufferAttachment depth;
+		VkImageView depthLayeredView{ VK_NULL_HANDLE };
 		VkRenderPass renderPass;
 		VkSampler sampler;
 		VkDescriptorImageInfo descriptor;
@@ -84,6 +120,15 @@ public:
 	// The depth format is selected at runtime
 	VkFormat offscreenDepthFormat{ VK_FORMAT_UNDEFINED };
 
+	// CPU command buffer recording time and GPU time for the shadow cube map passes
+	struct {
+		bool gpuSupported{ false };
+		VkQueryPool queryPool{ VK_NULL_HANDLE };
+		std::array<bool, maxConcurrentFrames> written{};
+		float cpu{ 0.0f };
+		float gpu{ 0.0f };
+	} shadowTimes;
+
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Point light shadows (cubemap)";
@@ -94,6 +139,16 @@ public:
 		timerSpeed *= 0.5f;
 	}
 
+	void getEnabledExtensions()
+	{
+		// Writing the layer from the vertex shader is required for single pass cube map rendering
+		singlePassSupported = vulkanDevice->extensionSupported(VK_EXT_SHADER_VIEWPORT_INDEX_LAYER_EXTENSION_NAME);
+		if (singlePassSupported) {
+			enabledDeviceExtensions.push_back(VK_EXT_SHADER_VIEWPORT_INDEX_LAYER_EXTENSION_NAME);
+			singlePass = true;
+		}
+	}
+
 	~VulkanExample()
 	{
 		if (device) {
@@ -101,24 +156,31 @@ public:
 			for (uint32_t i = 0; i < 6; i++) {
 				vkDestroyImageView(device, shadowCubeMapFaceImageViews[i], nullptr);
 			}
+			vkDestroyImageView(device, shadowCubeMapLayeredImageView, nullptr);
 			vkDestroyImageView(device, shadowCubeMap.view, nullptr);
 			vkDestroyImage(device, shadowCubeMap.image, nullptr);
 			vkDestroySampler(device, shadowCubeMap.sampler, nullptr);
 			vkFreeMemory(device, shadowCubeMap.deviceMemory, nullptr);
 			vkDestroyImageView(device, offscreenPass.depth.view, nullptr);
+			vkDestroyImageView(device, offscreenPass.depthLayeredView, nullptr);
 			vkDestroyImage(device, offscreenPass.depth.image, nullptr);
 			vkFreeMemory(device, offscreenPass.depth.mem, nullptr);
 			for (uint32_t i = 0; i < 6; i++)
 			{
 				vkDestroyFramebuffer(device, offscreenPass.frameBuffers[i], nullptr);
 			}
+			vkDestroyFramebuffer(device, offscreenPass.layeredFrameBuffer, nullptr);
 			vkDestroyRenderPass(device, offscreenPass.renderPass, nullptr);
 			vkDestroyPipeline(device, pipelines.scene, nullptr);
 			vkDestroyPipeline(device, pipelines.offscreen, nullptr);
+			vkDestroyPipeline(device, pipelines.offscreenLayered, nullptr);
 			vkDestroyPipeline(device, pipelines.cubemapDisplay, nullptr);
 			vkDestroyPipelineLayout(device, pipelineLayouts.scene, nullptr);
 			vkDestroyPipelineLayout(device, pipelineLayouts.offscreen, nullptr);
 			vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+			if (shadowTimes.queryPool != VK_NULL_HANDLE) {
+				vkDestroyQueryPool(device, shadowTimes.queryPool, nullptr);
+			}
 			for (auto& buffer : uniformBuffers) {
 				buffer.offscreen.destroy();
 				buffer.scene.destroy();
@@ -211,6 +273,11 @@ public:
 			view.subresourceRange.baseArrayLayer = i;
 			VK_CHECK_RESULT(vkCreateImageView(device, &view, nullptr, &shadowCubeMapFaceImageViews[i]));
 		}
+
+		view.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		view.subresourceRange.baseArrayLayer = 0;
+		view.subresourceRange.layerCount = 6;
+		VK_CHECK_RESULT(vkCreateImageView(device, &view, nullptr, &shadowCubeMapLayeredImageView));
 	}
 
 	// Set up a separate render pass for the offscreen frame buffer
@@ -307,6 +374,8 @@ public:
 		// Depth stencil attachment
 		imageCreateInfo.format = offscreenDepthFormat;
 		imageCreateInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		// One layer per cube map face for single pass rendering, the six pass path only uses the first layer
+		imageCreateInfo.arrayLayers = 6;
 
 		VkImageViewCreateInfo depthStencilView = vks::initializers::imageViewCreateInfo();
 		depthStencilView.viewType = VK_IMAGE_VIEW_TYPE_2D;
@@ -333,17 +402,22 @@ public:
 		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &offscreenPass.depth.mem));
 		VK_CHECK_RESULT(vkBindImageMemory(device, offscreenPass.depth.image, offscreenPass.depth.mem, 0));
 
+		VkImageSubresourceRange depthSubresourceRange = depthStencilView.subresourceRange;
+		depthSubresourceRange.layerCount = 6;
 		vks::tools::setImageLayout(
 			layoutCmd,
 			offscreenPass.depth.image,
-			VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT,
 			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			depthSubresourceRange);
 
 		vulkanDevice->flushCommandBuffer(layoutCmd, queue, true);
 
 		depthStencilView.image = offscreenPass.depth.image;
 		VK_CHECK_RESULT(vkCreateImageView(device, &depthStencilView, nullptr, &offscreenPass.depth.view));
+		depthStencilView.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		depthStencilView.subresourceRange.layerCount = 6;
+		VK_CHECK_RESULT(vkCreateImageView(device, &depthStencilView, nullptr, &offscreenPass.depthLayeredView));
 
 		VkImageView attachments[2];
 		attachments[1] = offscreenPass.depth.view;
@@ -361,6 +435,12 @@ public:
 			attachments[0] = shadowCubeMapFaceImageViews[i];
 			VK_CHECK_RESULT(vkCreateFramebuffer(device, &fbufCreateInfo, nullptr, &offscreenPass.frameBuffers[i]));
 		}
+
+		// Layered framebuffer with all cube map faces for single pass rendering
+		attachments[0] = shadowCubeMapLayeredImageView;
+		attachments[1] = offscreenPass.depthLayeredView;
+		fbufCreateInfo.layers = 6;
+		VK_CHECK_RESULT(vkCreateFramebuffer(device, &fbufCreateInfo, nullptr, &offscreenPass.layeredFrameBuffer));
 	}
 
 	void loadAssets()
@@ -368,6 +448,26 @@ public:
 		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
 		models.debugcube.loadFromFile(getAssetPath() + "models/cube.gltf", vulkanDevice, queue, glTFLoadingFlags);
 		models.scene.loadFromFile(getAssetPath() + "models/shadowscene_fire.gltf", vulkanDevice, queue, glTFLoadingFlags);
+
+		// Get the world space bounds of all primitives for per-face culling
+		// Vertices have been pre-transformed and flipped at load time, so the same needs to be applied to the primitive bounds
+		for (vkglTF::Node* node : models.scene.linearNodes) {
+			if (!node->mesh) {
+				continue;
+			}
+			const glm::mat4 nodeMatrix = node->getMatrix();
+			for (vkglTF::Primitive* primitive : node->mesh->primitives) {
+				glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+				for (uint32_t i = 0; i < 8; i++) {
+					glm::vec3 corner((i & 1) ? primitive->dimensions.max.x : primitive->dimensions.min.x, (i & 2) ? primitive->dimensions.max.y : primitive->dimensions.min.y, (i & 4) ? primitive->dimensions.max.z : primitive->dimensions.min.z);
+					corner = glm::vec3(nodeMatrix * glm::vec4(corner, 1.0f));
+					corner.y *= -1.0f;
+					min = glm::min(min, corner);
+					max = glm::max(max, corner);
+				}
+				shadowCasters.push_back({ primitive->firstIndex, primitive->indexCount, (min + max) * 0.5f, glm::length(max - min) * 0.5f, 0x3f });
+			}
+		}
 	}
 
 	void setupDescriptors()
@@ -470,6 +570,12 @@ public:
 		pipelineCI.renderPass = offscreenPass.renderPass;
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.offscreen));
 
+		// Single pass offscreen pipeline, selects the cube map face layer in the vertex shader
+		if (singlePassSupported) {
+			shaderStages[0] = loadShader(getShadersPath() + "shadowmappingomni/offscreenlayered.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.offscreenLayered));
+		}
+
 		// Cube map display pipeline
 		shaderStages[0] = loadShader(getShadersPath() + "shadowmappingomni/cubemapdisplay.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = loadShader(getShadersPath() + "shadowmappingomni/cubemapdisplay.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
@@ -486,7 +592,7 @@ public:
 	{
 		for (auto& buffer : uniformBuffers) {
 			// Offscreen uniform buffer
-			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer.offscreen, sizeof(UniformData)));
+			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer.offscreen, sizeof(UniformDataOffscreen)));
 			// Scene uniform buffer
 			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer.scene, sizeof(UniformData)));
 			// Map persistent
@@ -506,7 +612,24 @@ public:
 		uniformDataOffscreen.view = glm::mat4(1.0f);
 		uniformDataOffscreen.model = glm::translate(glm::mat4(1.0f), glm::vec3(-lightPos.x, -lightPos.y, -lightPos.z));
 		uniformDataOffscreen.lightPos = lightPos;
-		memcpy(uniformBuffers[currentBuffer].offscreen.mapped, &uniformDataOffscreen, sizeof(UniformData));
+		for (uint32_t face = 0; face < 6; face++) {
+			uniformDataOffscreen.faceViews[face] = cubeFaceViewMatrix(face);
+		}
+		memcpy(uniformBuffers[currentBuffer].offscreen.mapped, &uniformDataOffscreen, sizeof(UniformDataOffscreen));
+
+		// Determine the cube map faces each shadow caster is visible in
+		std::array<vks::Frustum, 6> faceFrustums;
+		for (uint32_t face = 0; face < 6; face++) {
+			faceFrustums[face].update(uniformDataOffscreen.projection * uniformDataOffscreen.faceViews[face] * uniformDataOffscreen.model);
+		}
+		for (ShadowCaster& shadowCaster : shadowCasters) {
+			shadowCaster.faceMask = 0;
+			for (uint32_t face = 0; face < 6; face++) {
+				if (!faceCulling || faceFrustums[face].checkSphere(shadowCaster.center, shadowCaster.radius)) {
+					shadowCaster.faceMask |= (1 << face);
+				}
+			}
+		}
 
 		// Scene rendering
 		uniformDataScene.projection = camera.matrices.perspective;
@@ -526,29 +649,38 @@ public:
 		prepareOffscreenRenderpass();
 		preparePipelines();
 		prepareOffscreenFramebuffer();
+		prepareShadowTimes();
 		prepared = true;
 	}
 
-	// Updates a single cube map face
-	// Renders the scene with face's view directly to the cubemap layer `faceIndex`
-	// Uses push constants for quick update of view matrix for the current cube map face
-	void updateCubeFace(uint32_t faceIndex, VkCommandBuffer commandBuffer)
+	void prepareShadowTimes()
 	{
-		VkClearValue clearValues[2];
-		clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
-		clearValues[1].depthStencil = { 1.0f, 0 };
-
-		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
-		// Reuse render pass from example pass
-		renderPassBeginInfo.renderPass = offscreenPass.renderPass;
-		renderPassBeginInfo.framebuffer = offscreenPass.frameBuffers[faceIndex];
-		renderPassBeginInfo.renderArea.extent.width = offscreenPass.width;
-		renderPassBeginInfo.renderArea.extent.height = offscreenPass.height;
-		renderPassBeginInfo.clearValueCount = 2;
-		renderPassBeginInfo.pClearValues = clearValues;
+		shadowTimes.gpuSupported = (vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.graphics].timestampValidBits > 0);
+		if (!shadowTimes.gpuSupported) {
+			return;
+		}
+		VkQueryPoolCreateInfo queryPoolCI{};
+		queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCI.queryCount = 2 * maxConcurrentFrames;
+		VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &shadowTimes.queryPool));
+	}
 
-		// Update view matrix via push constant
+	// Reads the timestamps written by the last submission of the current frame slot (which has finished, as its fence has been waited on)
+	void updateShadowTimes()
+	{
+		if (!shadowTimes.gpuSupported || !shadowTimes.written[currentBuffer]) {
+			return;
+		}
+		std::array<uint64_t, 2> timestamps{};
+		if (vkGetQueryPoolResults(device, shadowTimes.queryPool, currentBuffer * 2, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+			const float gpuTime = (float)(timestamps[1] - timestamps[0]) * deviceProperties.limits.timestampPeriod / 1000000.0f;
+			shadowTimes.gpu = glm::mix(shadowTimes.gpu, gpuTime, 0.1f);
+		}
+	}
 
+	glm::mat4 cubeFaceViewMatrix(uint32_t faceIndex)
+	{
 		glm::mat4 viewMatrix = glm::mat4(1.0f);
 		switch (faceIndex)
 		{
@@ -573,6 +705,29 @@ public:
 			viewMatrix = glm::rotate(viewMatrix, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 			break;
 		}
+		return viewMatrix;
+	}
+
+	// Updates a single cube map face
+	// Renders the scene with face's view directly to the cubemap layer `faceIndex`
+	// Uses push constants for quick update of view matrix for the current cube map face
+	void updateCubeFace(uint32_t faceIndex, VkCommandBuffer commandBuffer)
+	{
+		VkClearValue clearValues[2];
+		clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+		// Reuse render pass from example pass
+		renderPassBeginInfo.renderPass = offscreenPass.renderPass;
+		renderPassBeginInfo.framebuffer = offscreenPass.frameBuffers[faceIndex];
+		renderPassBeginInfo.renderArea.extent.width = offscreenPass.width;
+		renderPassBeginInfo.renderArea.extent.height = offscreenPass.height;
+		renderPassBeginInfo.clearValueCount = 2;
+		renderPassBeginInfo.pClearValues = clearValues;
+
+		// Update view matrix via push constant
+		glm::mat4 viewMatrix = cubeFaceViewMatrix(faceIndex);
 
 		// Render scene from cube face's point of view
 		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
@@ -589,7 +744,51 @@ public:
 
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.offscreen);
 		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.offscreen, 0, 1, &descriptorSets[currentBuffer].offscreen, 0, nullptr);
-		models.scene.draw(commandBuffer);
+		// Buffers are bound manually, as the model's draw function is not used for the individually culled primitives
+		const VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &models.scene.vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, models.scene.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		for (const ShadowCaster& shadowCaster : shadowCasters) {
+			if (shadowCaster.faceMask & (1 << faceIndex)) {
+				vkCmdDrawIndexed(commandBuffer, shadowCaster.indexCount, 1, shadowCaster.firstIndex, 0, 0);
+			}
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	// Updates all cube map faces in a single layered render pass
+	// Each shadow caster is drawn once with one instance per face it's visible in
+	// The vertex shader maps the instance index to the face using the face mask passed via push constant and writes the target layer
+	void updateCubeFacesLayered(VkCommandBuffer commandBuffer)
+	{
+		VkClearValue clearValues[2];
+		clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderPass = offscreenPass.renderPass;
+		renderPassBeginInfo.framebuffer = offscreenPass.layeredFrameBuffer;
+		renderPassBeginInfo.renderArea.extent.width = offscreenPass.width;
+		renderPassBeginInfo.renderArea.extent.height = offscreenPass.height;
+		renderPassBeginInfo.clearValueCount = 2;
+		renderPassBeginInfo.pClearValues = clearValues;
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.offscreenLayered);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.offscreen, 0, 1, &descriptorSets[currentBuffer].offscreen, 0, nullptr);
+		// Buffers are bound manually, as the model's draw function is not used for the individually culled primitives
+		const VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &models.scene.vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, models.scene.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		for (const ShadowCaster& shadowCaster : shadowCasters) {
+			if (shadowCaster.faceMask == 0) {
+				continue;
+			}
+			vkCmdPushConstants(commandBuffer, pipelineLayouts.offscreen, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &shadowCaster.faceMask);
+			vkCmdDrawIndexed(commandBuffer, shadowCaster.indexCount, std::popcount(shadowCaster.faceMask), shadowCaster.firstIndex, 0, 0);
+		}
 
 		vkCmdEndRenderPass(commandBuffer);
 	}
@@ -603,18 +802,38 @@ public:
 		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
 
 		/*
-			Generate shadow cube maps using one render pass per face
+			Generate shadow cube maps using either one render pass per face or a single layered render pass
 		*/
 		{
+			auto tStart = std::chrono::high_resolution_clock::now();
+
+			if (shadowTimes.gpuSupported) {
+				vkCmdResetQueryPool(cmdBuffer, shadowTimes.queryPool, currentBuffer * 2, 2);
+				vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, shadowTimes.queryPool, currentBuffer * 2);
+			}
+
 			VkViewport viewport = vks::initializers::viewport((float)offscreenPass.width, (float)offscreenPass.height, 0.0f, 1.0f);
 			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
 
 			VkRect2D scissor = vks::initializers::rect2D(offscreenPass.width, offscreenPass.height, 0, 0);
 			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
-			for (uint32_t face = 0; face < 6; face++) {
-				updateCubeFace(face, cmdBuffer);
+			if (singlePass) {
+				updateCubeFacesLayered(cmdBuffer);
+			} else {
+				for (uint32_t face = 0; face < 6; face++) {
+					updateCubeFace(face, cmdBuffer);
+				}
 			}
+
+			if (shadowTimes.gpuSupported) {
+				vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, shadowTimes.queryPool, currentBuffer * 2 + 1);
+				shadowTimes.written[currentBuffer] = true;
+			}
+
+			auto tEnd = std::chrono::high_resolution_clock::now();
+			const float cpuTime = std::chrono::duration<float, std::milli>(tEnd - tStart).count();
+			shadowTimes.cpu = glm::mix(shadowTimes.cpu, cpuTime, 0.1f);
 		}
 
 		/*
@@ -673,6 +892,7 @@ public:
 		if (!prepared)
 			return;
 		VulkanExampleBase::prepareFrame();
+		updateShadowTimes();
 		updateUniformBuffers();
 		buildCommandBuffer();
 		VulkanExampleBase::submitFrame();
@@ -683,6 +903,16 @@ public:
 		if (overlay->header("Settings")) {
 			overlay->checkBox("Display shadow cube render target", &displayCubeMap);
 		}
+		if (overlay->header("Shadow cube map")) {
+			if (singlePassSupported) {
+				overlay->checkBox("Single pass", &singlePass);
+			}
+			overlay->checkBox("Per face culling", &faceCulling);
+			overlay->text("CPU recording: %.3f ms", shadowTimes.cpu);
+			if (shadowTimes.gpuSupported) {
+				overlay->text("GPU: %.3f ms", shadowTimes.gpu);
+			}
+		}
 	}
 };
 
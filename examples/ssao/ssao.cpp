@@ -8,6 +8,8 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanRenderGraph.h"
+#include "VulkanTransientAllocator.h"
 
 #define SSAO_KERNEL_SIZE 64
 #define SSAO_RADIUS 0.3f
@@ -38,12 +40,88 @@ public:
 		int32_t ssao = true;
 		int32_t ssaoOnly = false;
 		int32_t ssaoBlur = true;
+		int32_t errorView = false;
 	} uboSSAOParams;
 
+	// Parameters that differ between the SSAO passes of the current settings and the full resolution reference are passed as push constants
+	struct SSAOPushConstants {
+		int32_t sampleCount;
+		int32_t frameIndex;
+	};
+	struct BlurPushConstants {
+		glm::vec2 ssaoSize;
+		int32_t bilateral;
+	};
+	struct TemporalPushConstants {
+		glm::mat4 reprojection;
+		glm::vec2 ssaoScale;
+		float historyWeight;
+		int32_t ssaoBlur;
+	};
+
+	/*
+		The ambient occlusion can be computed at a lower resolution and with fewer samples than the full resolution reference
+		- The blur pass then does a depth and normal aware (bilateral) upsampling to full resolution
+		- With temporal accumulation, every frame uses a different subset of the kernel and a rotated noise, and the results are blended with the reprojected history
+	*/
+	struct AOPreset {
+		std::string name;
+		// Index into the resolution and sample count lists of the settings
+		int32_t resolution;
+		int32_t sampleCount;
+		bool temporal;
+	};
+	const std::vector<AOPreset> aoPresets = {
+		{ "Quality", 0, 3, false },
+		{ "Balanced", 1, 1, true },
+		{ "Performance", 2, 0, true },
+	};
+	struct AOSettings {
+		int32_t preset{ 0 };
+		// The SSAO pass renders at 1 / (1 << resolution) of the frame buffer size
+		int32_t resolution{ 0 };
+		// The SSAO pass takes 8 << sampleCount samples per fragment
+		int32_t sampleCount{ 3 };
+		bool temporal{ false };
+		float historyWeight{ 0.9f };
+		// Also renders the ambient occlusion like the full resolution path and measures the difference
+		bool compareReference{ false };
+		bool showError{ false };
+	} aoSettings;
+
+	// The temporal pass writes one of the history images and reads the other one, which contains the previous frame's result
+	uint32_t historyIndex{ 0 };
+	bool historyValid{ false };
+	uint32_t temporalFrame{ 0 };
+	glm::mat4 previousViewProjection{ 1.0f };
+	glm::mat4 reprojection{ 1.0f };
+
+	// Timestamps around the ambient occlusion passes, one pair per pass and frame in flight
+	struct Timing {
+		enum Pass { SSAO = 0, Blur, Temporal, ReferenceSSAO, ReferenceBlur, PassCount };
+		bool supported{ false };
+		VkQueryPool queryPool{ VK_NULL_HANDLE };
+		std::array<std::array<bool, PassCount>, maxConcurrentFrames> written{};
+		// GPU time of the passes in milliseconds, zero for passes that didn't run
+		std::array<float, PassCount> passTimes{};
+	} timing;
+
+	// The difference to the reference is copied to the host, one buffer per frame in flight
+	struct ErrorStats {
+		std::array<vks::Buffer, maxConcurrentFrames> readbackBuffers;
+		std::array<bool, maxConcurrentFrames> written{};
+		float meanError{ 0.0f };
+		float rmsError{ 0.0f };
+		float maxError{ 0.0f };
+		float psnr{ 0.0f };
+	} errorStats;
+
 	struct {
 		VkPipelineLayout gBuffer{ VK_NULL_HANDLE };
 		VkPipelineLayout ssao{ VK_NULL_HANDLE };
 		VkPipelineLayout ssaoBlur{ VK_NULL_HANDLE };
+		VkPipelineLayout temporal{ VK_NULL_HANDLE };
+		VkPipelineLayout error{ VK_NULL_HANDLE };
 		VkPipelineLayout composition{ VK_NULL_HANDLE };
 	} pipelineLayouts;
 
@@ -52,20 +130,28 @@ public:
 		VkPipeline composition{ VK_NULL_HANDLE };
 		VkPipeline ssao{ VK_NULL_HANDLE };
 		VkPipeline ssaoBlur{ VK_NULL_HANDLE };
+		VkPipeline temporal{ VK_NULL_HANDLE };
+		VkPipeline error{ VK_NULL_HANDLE };
 	} pipelines;
 
 	struct {
 		VkDescriptorSetLayout gBuffer{ VK_NULL_HANDLE };
 		VkDescriptorSetLayout ssao{ VK_NULL_HANDLE };
 		VkDescriptorSetLayout ssaoBlur{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout temporal{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout error{ VK_NULL_HANDLE };
 		VkDescriptorSetLayout composition{ VK_NULL_HANDLE };
 	} descriptorSetLayouts;
 
+	// Sets that access the history images exist once for each history image being written
 	struct DescriptorSets {
 		VkDescriptorSet gBuffer{ VK_NULL_HANDLE };
 		VkDescriptorSet ssao{ VK_NULL_HANDLE };
 		VkDescriptorSet ssaoBlur{ VK_NULL_HANDLE };
-		VkDescriptorSet composition{ VK_NULL_HANDLE };
+		VkDescriptorSet referenceBlur{ VK_NULL_HANDLE };
+		std::array<VkDescriptorSet, 2> temporal{};
+		std::array<VkDescriptorSet, 2> error{};
+		std::array<VkDescriptorSet, 2> composition{};
 	};
 	std::array<DescriptorSets, maxConcurrentFrames> descriptorSets;
 
@@ -77,16 +163,14 @@ public:
 	std::array<UniformBuffers, maxConcurrentFrames> uniformBuffers;
 
 	// Framebuffer for offscreen rendering
+	// Images and their memory are owned by the transient allocator
 	struct FrameBufferAttachment {
 		VkImage image;
-		VkDeviceMemory mem;
 		VkImageView view;
 		VkFormat format;
 		void destroy(VkDevice device)
 		{
-			vkDestroyImage(device, image, nullptr);
 			vkDestroyImageView(device, view, nullptr);
-			vkFreeMemory(device, mem, nullptr);
 		}
 	};
 	struct FrameBuffer {
@@ -105,21 +189,33 @@ public:
 		}
 	};
 
-	struct {
+	struct FrameBuffers {
 		struct Offscreen : public FrameBuffer {
 			FrameBufferAttachment position, normal, albedo, depth;
 		} offscreen;
 		struct SSAO : public FrameBuffer {
 			FrameBufferAttachment color;
 		} ssao, ssaoBlur;
+		// Accumulated occlusion and linear depth
+		std::array<SSAO, 2> history;
+		// Full resolution reference and the difference of the current settings to it
+		SSAO reference, referenceBlur, error;
 	} frameBuffers{};
 
 	// One sampler for the frame buffer color attachments
 	VkSampler colorSampler;
+	// Owns the memory of all offscreen attachments, attachments that are not used at the same time share memory
+	vks::TransientAllocator transientAllocator;
+
+	// The passes are declared in a render graph that takes care of barriers and layout transitions
+	vks::RenderGraph renderGraph;
+	VkPhysicalDeviceVulkan13Features enabledFeatures13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
 
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Screen space ambient occlusion";
+		// The render graph uses synchronization2 if available
+		apiVersion = VK_API_VERSION_1_3;
 		camera.type = Camera::CameraType::firstperson;
 #ifndef __ANDROID__
 		camera.rotationSpeed = 0.25f;
@@ -127,6 +223,10 @@ public:
 		camera.position = { 1.0f, 0.75f, 0.0f };
 		camera.setRotation(glm::vec3(0.0f, 90.0f, 0.0f));
 		camera.setPerspective(60.0f, (float)width / (float)height, uboSceneParams.nearPlane, uboSceneParams.farPlane);
+#if defined(__ANDROID__)
+		// We use a lower resolution on Android due to lower computational power
+		applyPreset(1);
+#endif
 	}
 
 	~VulkanExample()
@@ -139,26 +239,49 @@ public:
 			frameBuffers.offscreen.depth.destroy(device);
 			frameBuffers.ssao.color.destroy(device);
 			frameBuffers.ssaoBlur.color.destroy(device);
+			for (auto& history : frameBuffers.history) {
+				history.color.destroy(device);
+			}
+			frameBuffers.reference.color.destroy(device);
+			frameBuffers.referenceBlur.color.destroy(device);
+			frameBuffers.error.color.destroy(device);
+			transientAllocator.destroy();
 			frameBuffers.offscreen.destroy(device);
 			frameBuffers.ssao.destroy(device);
 			frameBuffers.ssaoBlur.destroy(device);
+			for (auto& history : frameBuffers.history) {
+				history.destroy(device);
+			}
+			frameBuffers.reference.destroy(device);
+			frameBuffers.referenceBlur.destroy(device);
+			frameBuffers.error.destroy(device);
 			vkDestroyPipeline(device, pipelines.offscreen, nullptr);
 			vkDestroyPipeline(device, pipelines.composition, nullptr);
 			vkDestroyPipeline(device, pipelines.ssao, nullptr);
 			vkDestroyPipeline(device, pipelines.ssaoBlur, nullptr);
+			vkDestroyPipeline(device, pipelines.temporal, nullptr);
+			vkDestroyPipeline(device, pipelines.error, nullptr);
 			vkDestroyPipelineLayout(device, pipelineLayouts.gBuffer, nullptr);
 			vkDestroyPipelineLayout(device, pipelineLayouts.ssao, nullptr);
 			vkDestroyPipelineLayout(device, pipelineLayouts.ssaoBlur, nullptr);
+			vkDestroyPipelineLayout(device, pipelineLayouts.temporal, nullptr);
+			vkDestroyPipelineLayout(device, pipelineLayouts.error, nullptr);
 			vkDestroyPipelineLayout(device, pipelineLayouts.composition, nullptr);
 			vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.gBuffer, nullptr);
 			vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.ssao, nullptr);
 			vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.ssaoBlur, nullptr);
+			vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.temporal, nullptr);
+			vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.error, nullptr);
 			vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.composition, nullptr);
 			for (auto& buffer : uniformBuffers) {
 				buffer.sceneParams.destroy();
 				buffer.ssaoKernel.destroy();
 				buffer.ssaoParams.destroy();
 			}
+			for (auto& buffer : errorStats.readbackBuffers) {
+				buffer.destroy();
+			}
+			vkDestroyQueryPool(device, timing.queryPool, nullptr);
 			ssaoNoise.destroy();
 		}
 	}
@@ -166,33 +289,31 @@ public:
 	void getEnabledFeatures()
 	{
 		enabledFeatures.samplerAnisotropy = deviceFeatures.samplerAnisotropy;
+		if (deviceProperties.apiVersion >= VK_API_VERSION_1_3) {
+			VkPhysicalDeviceVulkan13Features features13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
+			VkPhysicalDeviceFeatures2 deviceFeatures2{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &features13 };
+			vkGetPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures2);
+			if (features13.synchronization2) {
+				enabledFeatures13.synchronization2 = VK_TRUE;
+				deviceCreatepNextChain = &enabledFeatures13;
+				renderGraph.synchronization2 = true;
+			}
+		}
 	}
 
-	// Create a frame buffer attachment
+	// Create the image of a frame buffer attachment, memory is allocated for all attachments at once by the transient allocator
+	// firstPass and lastPass are the indices of the first and last pass of the render graph using the attachment
 	void createAttachment(
 		VkFormat format,
-		VkImageUsageFlagBits usage,
+		VkImageUsageFlags usage,
 		FrameBufferAttachment *attachment,
 		uint32_t width,
-		uint32_t height)
+		uint32_t height,
+		uint32_t firstPass,
+		uint32_t lastPass)
 	{
-		VkImageAspectFlags aspectMask = 0;
-
 		attachment->format = format;
 
-		if (usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
-		{
-			aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		}
-		if (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
-		{
-			aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-			if (format >= VK_FORMAT_D16_UNORM_S8_UINT)
-				aspectMask |=VK_IMAGE_ASPECT_STENCIL_BIT;
-		}
-
-		assert(aspectMask > 0);
-
 		VkImageCreateInfo image = vks::initializers::imageCreateInfo();
 		image.imageType = VK_IMAGE_TYPE_2D;
 		image.format = format;
@@ -203,21 +324,16 @@ public:
 		image.arrayLayers = 1;
 		image.samples = VK_SAMPLE_COUNT_1_BIT;
 		image.tiling = VK_IMAGE_TILING_OPTIMAL;
-		image.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
-
-		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
-
-		VK_CHECK_RESULT(vkCreateImage(device, &image, nullptr, &attachment->image));
-		vkGetImageMemoryRequirements(device, attachment->image, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-		memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &attachment->mem));
-		VK_CHECK_RESULT(vkBindImageMemory(device, attachment->image, attachment->mem, 0));
+		image.usage = usage;
+		attachment->image = transientAllocator.createImage(image, firstPass, lastPass);
+	}
 
+	// Create the view of a frame buffer attachment, this can only be done once memory has been bound to the image
+	void createAttachmentView(FrameBufferAttachment *attachment, VkImageAspectFlags aspectMask)
+	{
 		VkImageViewCreateInfo imageView = vks::initializers::imageViewCreateInfo();
 		imageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		imageView.format = format;
+		imageView.format = attachment->format;
 		imageView.subresourceRange = {};
 		imageView.subresourceRange.aspectMask = aspectMask;
 		imageView.subresourceRange.baseMipLevel = 0;
@@ -228,37 +344,114 @@ public:
 		VK_CHECK_RESULT(vkCreateImageView(device, &imageView, nullptr, &attachment->view));
 	}
 
+	// Creates the render pass and frame buffer for a pass rendering to a single color attachment
+	void prepareColorFrameBuffer(FrameBuffers::SSAO& frameBuffer)
+	{
+		VkAttachmentDescription attachmentDescription{};
+		attachmentDescription.format = frameBuffer.color.format;
+		attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+		attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.pColorAttachments = &colorReference;
+		subpass.colorAttachmentCount = 1;
+
+		// No subpass dependencies, synchronization with the other passes is done with the barriers generated by the render graph
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.pAttachments = &attachmentDescription;
+		renderPassInfo.attachmentCount = 1;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &frameBuffer.renderPass));
+
+		VkFramebufferCreateInfo fbufCreateInfo = vks::initializers::framebufferCreateInfo();
+		fbufCreateInfo.renderPass = frameBuffer.renderPass;
+		fbufCreateInfo.pAttachments = &frameBuffer.color.view;
+		fbufCreateInfo.attachmentCount = 1;
+		fbufCreateInfo.width = frameBuffer.width;
+		fbufCreateInfo.height = frameBuffer.height;
+		fbufCreateInfo.layers = 1;
+		VK_CHECK_RESULT(vkCreateFramebuffer(device, &fbufCreateInfo, nullptr, &frameBuffer.frameBuffer));
+	}
+
 	void prepareOffscreenFramebuffers()
 	{
 		// Attachments
-#if defined(__ANDROID__)
-		const uint32_t ssaoWidth = width / 2;
-		const uint32_t ssaoHeight = height / 2;
-#else
-		const uint32_t ssaoWidth = width;
-		const uint32_t ssaoHeight = height;
-#endif
-
+		// The SSAO image is created at full resolution, lower resolutions only render to a part of it, so the resolution can be changed without recreating any resources
 		frameBuffers.offscreen.setSize(width, height);
-		frameBuffers.ssao.setSize(ssaoWidth, ssaoHeight);
+		frameBuffers.ssao.setSize(width, height);
 		frameBuffers.ssaoBlur.setSize(width, height);
+		for (auto& history : frameBuffers.history) {
+			history.setSize(width, height);
+		}
+		frameBuffers.reference.setSize(width, height);
+		frameBuffers.referenceBlur.setSize(width, height);
+		frameBuffers.error.setSize(width, height);
 
 		// Find a suitable depth format
 		VkFormat attDepthFormat;
 		VkBool32 validDepthFormat = vks::tools::getSupportedDepthFormat(physicalDevice, &attDepthFormat);
 		assert(validDepthFormat);
 
+		// Lifetimes are given as pass indices: G-Buffer (0), SSAO (1), SSAO blur (2), SSAO temporal (3), SSAO reference (4), SSAO reference blur (5), SSAO error (6), error readback (7), composition (8)
+		// Depth is only used by the G-Buffer pass, so it's transient and may either be lazily allocated or share its memory with the SSAO targets
+		// The history needs to persist across frames and the reference passes don't depend on the other SSAO passes (so the render graph may interleave them), so these are used over all passes and never share memory
+		const VkImageUsageFlags sampledColor = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		transientAllocator.create(vulkanDevice);
+
 		// G-Buffer
-		createAttachment(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &frameBuffers.offscreen.position, width, height);	// Position + Depth
-		createAttachment(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &frameBuffers.offscreen.normal, width, height);			// Normals
-		createAttachment(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &frameBuffers.offscreen.albedo, width, height);			// Albedo (color)
-		createAttachment(attDepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, &frameBuffers.offscreen.depth, width, height);			// Depth
+		createAttachment(VK_FORMAT_R32G32B32A32_SFLOAT, sampledColor, &frameBuffers.offscreen.position, width, height, 0, 8);						// Position + Depth
+		createAttachment(VK_FORMAT_R8G8B8A8_UNORM, sampledColor, &frameBuffers.offscreen.normal, width, height, 0, 8);							// Normals
+		createAttachment(VK_FORMAT_R8G8B8A8_UNORM, sampledColor, &frameBuffers.offscreen.albedo, width, height, 0, 8);							// Albedo (color)
+		createAttachment(attDepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, &frameBuffers.offscreen.depth, width, height, 0, 0);		// Depth
 
 		// SSAO
-		createAttachment(VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &frameBuffers.ssao.color, ssaoWidth, ssaoHeight);				// Color
+		createAttachment(VK_FORMAT_R8_UNORM, sampledColor, &frameBuffers.ssao.color, width, height, 1, 3);										// Color
 
 		// SSAO blur
-		createAttachment(VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &frameBuffers.ssaoBlur.color, width, height);					// Color
+		createAttachment(VK_FORMAT_R8_UNORM, sampledColor, &frameBuffers.ssaoBlur.color, width, height, 2, 3);									// Color
+
+		// SSAO temporal accumulation
+		// 8 bits aren't enough for small contributions of the current frame to change the accumulated value
+		for (auto& history : frameBuffers.history) {
+			createAttachment(VK_FORMAT_R16G16_SFLOAT, sampledColor, &history.color, width, height, 0, 8);										// Occlusion + linear depth
+		}
+
+		// Comparison with the full resolution reference
+		createAttachment(VK_FORMAT_R8_UNORM, sampledColor, &frameBuffers.reference.color, width, height, 0, 8);									// Color
+		createAttachment(VK_FORMAT_R8_UNORM, sampledColor, &frameBuffers.referenceBlur.color, width, height, 0, 8);								// Color
+		createAttachment(VK_FORMAT_R8_UNORM, sampledColor | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, &frameBuffers.error.color, width, height, 6, 8);	// Absolute difference
+
+		transientAllocator.allocate();
+		for (auto& group : transientAllocator.aliasGroups()) {
+			renderGraph.addAliases(group);
+		}
+
+		VkImageAspectFlags depthAspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (vks::tools::formatHasStencil(attDepthFormat)) {
+			depthAspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		createAttachmentView(&frameBuffers.offscreen.position, VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&frameBuffers.offscreen.normal, VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&frameBuffers.offscreen.albedo, VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&frameBuffers.offscreen.depth, depthAspectMask);
+		createAttachmentView(&frameBuffers.ssao.color, VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&frameBuffers.ssaoBlur.color, VK_IMAGE_ASPECT_COLOR_BIT);
+		for (auto& history : frameBuffers.history) {
+			createAttachmentView(&history.color, VK_IMAGE_ASPECT_COLOR_BIT);
+		}
+		createAttachmentView(&frameBuffers.reference.color, VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&frameBuffers.referenceBlur.color, VK_IMAGE_ASPECT_COLOR_BIT);
+		createAttachmentView(&frameBuffers.error.color, VK_IMAGE_ASPECT_COLOR_BIT);
 
 		// Render passes
 
@@ -271,10 +464,13 @@ public:
 			{
 				attachmentDescs[i].samples = VK_SAMPLE_COUNT_1_BIT;
 				attachmentDescs[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-				attachmentDescs[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+				// Depth isn't needed after the pass
+				attachmentDescs[i].storeOp = (i == 3) ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
 				attachmentDescs[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 				attachmentDescs[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-				attachmentDescs[i].finalLayout = (i == 3) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				// Layout transitions are done by the render graph, so the attachments stay in their attachment layout for the whole render pass
+				attachmentDescs[i].initialLayout = (i == 3) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				attachmentDescs[i].finalLayout = attachmentDescs[i].initialLayout;
 			}
 
 			// Formats
@@ -298,41 +494,13 @@ public:
 			subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
 			subpass.pDepthStencilAttachment = &depthReference;
 
-			// Use subpass dependencies for attachment layout transitions
-			std::array<VkSubpassDependency, 3> dependencies{};
-
-			dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-			dependencies[0].dstSubpass = 0;
-			dependencies[0].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-			dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-			dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-			dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-			dependencies[0].dependencyFlags = 0;
-
-			dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
-			dependencies[1].dstSubpass = 0;
-			dependencies[1].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-			dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependencies[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-			dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-			dependencies[2].srcSubpass = 0;
-			dependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
-			dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependencies[2].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-			dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			dependencies[2].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-			dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
+			// No subpass dependencies, synchronization with the other passes is done with the barriers generated by the render graph
 			VkRenderPassCreateInfo renderPassInfo = {};
 			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 			renderPassInfo.pAttachments = attachmentDescs.data();
 			renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescs.size());
 			renderPassInfo.subpassCount = 1;
 			renderPassInfo.pSubpasses = &subpass;
-			renderPassInfo.dependencyCount = 2;
-			renderPassInfo.pDependencies = dependencies.data();
 			VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &frameBuffers.offscreen.renderPass));
 
 			std::array<VkImageView, 4> attachments{};
@@ -351,119 +519,15 @@ public:
 			VK_CHECK_RESULT(vkCreateFramebuffer(device, &fbufCreateInfo, nullptr, &frameBuffers.offscreen.frameBuffer));
 		}
 
-		// SSAO
-		{
-			VkAttachmentDescription attachmentDescription{};
-			attachmentDescription.format = frameBuffers.ssao.color.format;
-			attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-			attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-			attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-			attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-			VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
-
-			VkSubpassDescription subpass = {};
-			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-			subpass.pColorAttachments = &colorReference;
-			subpass.colorAttachmentCount = 1;
-
-			std::array<VkSubpassDependency, 2> dependencies{};
-
-			dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-			dependencies[0].dstSubpass = 0;
-			dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-			dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-			dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-			dependencies[1].srcSubpass = 0;
-			dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-			dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-			dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-			dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-			VkRenderPassCreateInfo renderPassInfo = {};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-			renderPassInfo.pAttachments = &attachmentDescription;
-			renderPassInfo.attachmentCount = 1;
-			renderPassInfo.subpassCount = 1;
-			renderPassInfo.pSubpasses = &subpass;
-			renderPassInfo.dependencyCount = 2;
-			renderPassInfo.pDependencies = dependencies.data();
-			VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &frameBuffers.ssao.renderPass));
-
-			VkFramebufferCreateInfo fbufCreateInfo = vks::initializers::framebufferCreateInfo();
-			fbufCreateInfo.renderPass = frameBuffers.ssao.renderPass;
-			fbufCreateInfo.pAttachments = &frameBuffers.ssao.color.view;
-			fbufCreateInfo.attachmentCount = 1;
-			fbufCreateInfo.width = frameBuffers.ssao.width;
-			fbufCreateInfo.height = frameBuffers.ssao.height;
-			fbufCreateInfo.layers = 1;
-			VK_CHECK_RESULT(vkCreateFramebuffer(device, &fbufCreateInfo, nullptr, &frameBuffers.ssao.frameBuffer));
-		}
-
-		// SSAO Blur
-		{
-			VkAttachmentDescription attachmentDescription{};
-			attachmentDescription.format = frameBuffers.ssaoBlur.color.format;
-			attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-			attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-			attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-			attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-			VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
-
-			VkSubpassDescription subpass = {};
-			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-			subpass.pColorAttachments = &colorReference;
-			subpass.colorAttachmentCount = 1;
-
-			std::array<VkSubpassDependency, 2> dependencies{};
-
-			dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-			dependencies[0].dstSubpass = 0;
-			dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-			dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-			dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-			dependencies[1].srcSubpass = 0;
-			dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-			dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-			dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-			dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-			VkRenderPassCreateInfo renderPassInfo = {};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-			renderPassInfo.pAttachments = &attachmentDescription;
-			renderPassInfo.attachmentCount = 1;
-			renderPassInfo.subpassCount = 1;
-			renderPassInfo.pSubpasses = &subpass;
-			renderPassInfo.dependencyCount = 2;
-			renderPassInfo.pDependencies = dependencies.data();
-			VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &frameBuffers.ssaoBlur.renderPass));
-
-			VkFramebufferCreateInfo fbufCreateInfo = vks::initializers::framebufferCreateInfo();
-			fbufCreateInfo.renderPass = frameBuffers.ssaoBlur.renderPass;
-			fbufCreateInfo.pAttachments = &frameBuffers.ssaoBlur.color.view;
-			fbufCreateInfo.attachmentCount = 1;
-			fbufCreateInfo.width = frameBuffers.ssaoBlur.width;
-			fbufCreateInfo.height = frameBuffers.ssaoBlur.height;
-			fbufCreateInfo.layers = 1;
-			VK_CHECK_RESULT(vkCreateFramebuffer(device, &fbufCreateInfo, nullptr, &frameBuffers.ssaoBlur.frameBuffer));
+		// Passes rendering to a single color attachment
+		prepareColorFrameBuffer(frameBuffers.ssao);
+		prepareColorFrameBuffer(frameBuffers.ssaoBlur);
+		for (auto& history : frameBuffers.history) {
+			prepareColorFrameBuffer(history);
 		}
+		prepareColorFrameBuffer(frameBuffers.reference);
+		prepareColorFrameBuffer(frameBuffers.referenceBlur);
+		prepareColorFrameBuffer(frameBuffers.error);
 
 		// Shared sampler used for all color attachments
 		VkSamplerCreateInfo sampler = vks::initializers::samplerCreateInfo();
@@ -492,10 +556,10 @@ public:
 	{
 		// Pool
 		std::vector<VkDescriptorPoolSize> poolSizes = {
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxConcurrentFrames * 4),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxConcurrentFrames * 10)
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxConcurrentFrames * 5),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxConcurrentFrames * 31)
 		};
-		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, maxConcurrentFrames * 4);
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, maxConcurrentFrames * 10);
 		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
 
 		VkDescriptorSetAllocateInfo descriptorAllocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, nullptr, 1);
@@ -524,10 +588,30 @@ public:
 		// SSAO Blur
 		setLayoutBindings = {
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
 		};
 		setLayoutCreateInfo = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings.data(), static_cast<uint32_t>(setLayoutBindings.size()));
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr, &descriptorSetLayouts.ssaoBlur));
 
+		// SSAO temporal accumulation
+		setLayoutBindings = {
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
+		};
+		setLayoutCreateInfo = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings.data(), static_cast<uint32_t>(setLayoutBindings.size()));
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr, &descriptorSetLayouts.temporal));
+
+		// SSAO error
+		setLayoutBindings = {
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+		};
+		setLayoutCreateInfo = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings.data(), static_cast<uint32_t>(setLayoutBindings.size()));
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr, &descriptorSetLayouts.error));
+
 		// Composition
 		setLayoutBindings = {
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
@@ -546,6 +630,13 @@ public:
 		VkDescriptorImageInfo albedoImgDescriptor = vks::initializers::descriptorImageInfo(colorSampler, frameBuffers.offscreen.albedo.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 		VkDescriptorImageInfo ssaoImgDescriptor = vks::initializers::descriptorImageInfo(colorSampler, frameBuffers.ssao.color.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 		VkDescriptorImageInfo ssaoBlurImgDescriptor = vks::initializers::descriptorImageInfo(colorSampler, frameBuffers.ssaoBlur.color.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		std::array<VkDescriptorImageInfo, 2> historyImgDescriptors = {
+			vks::initializers::descriptorImageInfo(colorSampler, frameBuffers.history[0].color.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+			vks::initializers::descriptorImageInfo(colorSampler, frameBuffers.history[1].color.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+		};
+		VkDescriptorImageInfo referenceImgDescriptor = vks::initializers::descriptorImageInfo(colorSampler, frameBuffers.reference.color.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		VkDescriptorImageInfo referenceBlurImgDescriptor = vks::initializers::descriptorImageInfo(colorSampler, frameBuffers.referenceBlur.color.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		VkDescriptorImageInfo errorImgDescriptor = vks::initializers::descriptorImageInfo(colorSampler, frameBuffers.error.color.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		// Sets per frame, just like the buffers themselves
 		// Images do not need to be duplicated per frame, we reuse the same one for each frame
@@ -559,6 +650,7 @@ public:
 			vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 
 			// SSAO Generation
+			// Also used for the reference, which only differs in the push constants
 			descriptorAllocInfo.pSetLayouts = &descriptorSetLayouts.ssao;
 			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorAllocInfo, &descriptorSets[i].ssao));
 			writeDescriptorSets = {
@@ -573,23 +665,52 @@ public:
 			// SSAO Blur
 			descriptorAllocInfo.pSetLayouts = &descriptorSetLayouts.ssaoBlur;
 			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorAllocInfo, &descriptorSets[i].ssaoBlur));
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorAllocInfo, &descriptorSets[i].referenceBlur));
 			writeDescriptorSets = {
 				vks::initializers::writeDescriptorSet(descriptorSets[i].ssaoBlur, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &ssaoImgDescriptor),
+				vks::initializers::writeDescriptorSet(descriptorSets[i].ssaoBlur, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &positionImgDescriptor),
+				vks::initializers::writeDescriptorSet(descriptorSets[i].ssaoBlur, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &normalImgDescriptor),
+				vks::initializers::writeDescriptorSet(descriptorSets[i].referenceBlur, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &referenceImgDescriptor),
+				vks::initializers::writeDescriptorSet(descriptorSets[i].referenceBlur, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &positionImgDescriptor),
+				vks::initializers::writeDescriptorSet(descriptorSets[i].referenceBlur, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &normalImgDescriptor),
 			};
 			vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 
-			// Composition
-			descriptorAllocInfo.pSetLayouts = &descriptorSetLayouts.composition;
-			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorAllocInfo, &descriptorSets[i].composition));
-			writeDescriptorSets = {
-				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &positionImgDescriptor),
-				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &normalImgDescriptor),
-				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &albedoImgDescriptor),
-				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &ssaoImgDescriptor),
-				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, &ssaoBlurImgDescriptor),
-				vks::initializers::writeDescriptorSet(descriptorSets[i].composition, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 5, &uniformBuffers[i].ssaoParams.descriptor),
-			};
-			vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+			// Sets for writing history image h
+			for (uint32_t h = 0; h < 2; h++) {
+				// SSAO temporal accumulation, reads the other history image
+				descriptorAllocInfo.pSetLayouts = &descriptorSetLayouts.temporal;
+				VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorAllocInfo, &descriptorSets[i].temporal[h]));
+				writeDescriptorSets = {
+					vks::initializers::writeDescriptorSet(descriptorSets[i].temporal[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &positionImgDescriptor),
+					vks::initializers::writeDescriptorSet(descriptorSets[i].temporal[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &ssaoImgDescriptor),
+					vks::initializers::writeDescriptorSet(descriptorSets[i].temporal[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &ssaoBlurImgDescriptor),
+					vks::initializers::writeDescriptorSet(descriptorSets[i].temporal[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &historyImgDescriptors[1 - h]),
+				};
+				vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+				// SSAO error
+				descriptorAllocInfo.pSetLayouts = &descriptorSetLayouts.error;
+				VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorAllocInfo, &descriptorSets[i].error[h]));
+				writeDescriptorSets = {
+					vks::initializers::writeDescriptorSet(descriptorSets[i].error[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &historyImgDescriptors[h]),
+					vks::initializers::writeDescriptorSet(descriptorSets[i].error[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &referenceBlurImgDescriptor),
+				};
+				vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+				// Composition
+				descriptorAllocInfo.pSetLayouts = &descriptorSetLayouts.composition;
+				VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorAllocInfo, &descriptorSets[i].composition[h]));
+				writeDescriptorSets = {
+					vks::initializers::writeDescriptorSet(descriptorSets[i].composition[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &positionImgDescriptor),
+					vks::initializers::writeDescriptorSet(descriptorSets[i].composition[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &normalImgDescriptor),
+					vks::initializers::writeDescriptorSet(descriptorSets[i].composition[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &albedoImgDescriptor),
+					vks::initializers::writeDescriptorSet(descriptorSets[i].composition[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &historyImgDescriptors[h]),
+					vks::initializers::writeDescriptorSet(descriptorSets[i].composition[h], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, &errorImgDescriptor),
+					vks::initializers::writeDescriptorSet(descriptorSets[i].composition[h], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 5, &uniformBuffers[i].ssaoParams.descriptor),
+				};
+				vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+			}
 		}
 	}
 
@@ -603,14 +724,29 @@ public:
 		pipelineLayoutCreateInfo.setLayoutCount = 2;
 		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayouts.gBuffer));
 
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(SSAOPushConstants), 0);
 		pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayouts.ssao;
 		pipelineLayoutCreateInfo.setLayoutCount = 1;
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayouts.ssao));
 
+		pushConstantRange.size = sizeof(BlurPushConstants);
 		pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayouts.ssaoBlur;
 		pipelineLayoutCreateInfo.setLayoutCount = 1;
 		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayouts.ssaoBlur));
 
+		pushConstantRange.size = sizeof(TemporalPushConstants);
+		pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayouts.temporal;
+		pipelineLayoutCreateInfo.setLayoutCount = 1;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayouts.temporal));
+
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
+		pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+		pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayouts.error;
+		pipelineLayoutCreateInfo.setLayoutCount = 1;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayouts.error));
+
 		pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayouts.composition;
 		pipelineLayoutCreateInfo.setLayoutCount = 1;
 		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayouts.composition));
@@ -652,6 +788,7 @@ public:
 		pipelineCreateInfo.renderPass = frameBuffers.ssao.renderPass;
 		pipelineCreateInfo.layout = pipelineLayouts.ssao;
 		// SSAO Kernel size and radius are constant for this pipeline, so we set them using specialization constants
+		// The number of samples taken from the kernel is passed as a push constant, so the reference can use the same pipeline
 		struct SpecializationData {
 			uint32_t kernelSize = SSAO_KERNEL_SIZE;
 			float radius = SSAO_RADIUS;
@@ -671,6 +808,18 @@ public:
 		shaderStages[1] = loadShader(getShadersPath() + "ssao/blur.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.ssaoBlur));
 
+		// SSAO temporal accumulation pipeline
+		pipelineCreateInfo.renderPass = frameBuffers.history[0].renderPass;
+		pipelineCreateInfo.layout = pipelineLayouts.temporal;
+		shaderStages[1] = loadShader(getShadersPath() + "ssao/temporal.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.temporal));
+
+		// SSAO error pipeline
+		pipelineCreateInfo.renderPass = frameBuffers.error.renderPass;
+		pipelineCreateInfo.layout = pipelineLayouts.error;
+		shaderStages[1] = loadShader(getShadersPath() + "ssao/error.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.error));
+
 		// Fill G-Buffer pipeline
 		// Vertex input state from glTF model loader
 		pipelineCreateInfo.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({ vkglTF::VertexComponent::Position, vkglTF::VertexComponent::UV, vkglTF::VertexComponent::Color, vkglTF::VertexComponent::Normal });
@@ -732,6 +881,92 @@ public:
 		ssaoNoise.fromBuffer(noiseValues.data(), noiseValues.size() * sizeof(glm::vec4), VK_FORMAT_R32G32B32A32_SFLOAT, SSAO_NOISE_DIM, SSAO_NOISE_DIM, vulkanDevice, queue, VK_FILTER_NEAREST);
 	}
 
+	// Timestamp queries for the GPU times of the ambient occlusion passes and host visible buffers for reading back the error against the reference
+	void prepareMeasurements()
+	{
+		timing.supported = vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.graphics].timestampValidBits > 0;
+		if (timing.supported) {
+			VkQueryPoolCreateInfo queryPoolCI{ .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+			queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolCI.queryCount = maxConcurrentFrames * Timing::PassCount * 2;
+			VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &timing.queryPool));
+		}
+
+		// One byte per pixel of the error image
+		const VkDeviceSize readbackSize = static_cast<VkDeviceSize>(frameBuffers.error.width) * frameBuffers.error.height;
+		for (auto& buffer : errorStats.readbackBuffers) {
+			VK_CHECK_RESULT(vulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer, readbackSize));
+			VK_CHECK_RESULT(buffer.map());
+		}
+	}
+
+	void applyPreset(int32_t index)
+	{
+		const AOPreset& preset = aoPresets[index];
+		aoSettings.preset = index;
+		aoSettings.resolution = preset.resolution;
+		aoSettings.sampleCount = preset.sampleCount;
+		aoSettings.temporal = preset.temporal;
+	}
+
+	// Size of the part of the SSAO image the SSAO pass renders to for the current resolution setting
+	VkExtent2D getSSAOExtent() const
+	{
+		const uint32_t divisor = 1u << aoSettings.resolution;
+		return { std::max(static_cast<uint32_t>(frameBuffers.ssao.width) / divisor, 1u), std::max(static_cast<uint32_t>(frameBuffers.ssao.height) / divisor, 1u) };
+	}
+
+	void writeTimestamp(VkCommandBuffer cmdBuffer, Timing::Pass pass, bool end)
+	{
+		if (!timing.supported) {
+			return;
+		}
+		const uint32_t query = (currentBuffer * Timing::PassCount + pass) * 2 + (end ? 1 : 0);
+		vkCmdWriteTimestamp(cmdBuffer, end ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timing.queryPool, query);
+		timing.written[currentBuffer][pass] = true;
+	}
+
+	// Reads the timestamps written by the passes of the current frame's last submission, the frame's fence must have been signaled
+	void readTimestamps()
+	{
+		if (!timing.supported) {
+			return;
+		}
+		for (uint32_t pass = 0; pass < Timing::PassCount; pass++) {
+			timing.passTimes[pass] = 0.0f;
+			if (!timing.written[currentBuffer][pass]) {
+				continue;
+			}
+			std::array<uint64_t, 2> timestamps{};
+			if (vkGetQueryPoolResults(device, timing.queryPool, (currentBuffer * Timing::PassCount + pass) * 2, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+				timing.passTimes[pass] = (float)(timestamps[1] - timestamps[0]) * vulkanDevice->properties.limits.timestampPeriod / 1000000.0f;
+			}
+		}
+	}
+
+	// Calculates the error statistics from the error image copied by the current frame's last submission, the frame's fence must have been signaled
+	void readErrorStats()
+	{
+		if (!errorStats.written[currentBuffer]) {
+			return;
+		}
+		errorStats.written[currentBuffer] = false;
+		const uint8_t* errors = static_cast<const uint8_t*>(errorStats.readbackBuffers[currentBuffer].mapped);
+		const size_t count = static_cast<size_t>(frameBuffers.error.width) * frameBuffers.error.height;
+		uint64_t sum = 0;
+		uint64_t squaredSum = 0;
+		uint8_t maxError = 0;
+		for (size_t i = 0; i < count; i++) {
+			sum += errors[i];
+			squaredSum += errors[i] * errors[i];
+			maxError = std::max(maxError, errors[i]);
+		}
+		errorStats.meanError = static_cast<float>(static_cast<double>(sum) / count / 255.0);
+		errorStats.rmsError = static_cast<float>(sqrt(static_cast<double>(squaredSum) / count) / 255.0);
+		errorStats.maxError = maxError / 255.0f;
+		errorStats.psnr = (errorStats.rmsError > 0.0f) ? 20.0f * log10f(1.0f / errorStats.rmsError) : INFINITY;
+	}
+
 	void updateUniformBuffers()
 	{
 		// Scene
@@ -742,7 +977,12 @@ public:
 
 		// SSAO parameters
 		uboSSAOParams.projection = camera.matrices.perspective;
+		uboSSAOParams.errorView = aoSettings.compareReference && aoSettings.showError;
 		uniformBuffers[currentBuffer].ssaoParams.copyTo(&uboSSAOParams, sizeof(uboSSAOParams));
+
+		// The G-Buffer stores view space positions, the temporal accumulation transforms them to the clip space of the previous frame to find the history
+		reprojection = previousViewProjection * glm::inverse(camera.matrices.view);
+		previousViewProjection = camera.matrices.perspective * camera.matrices.view;
 	}
 
 	void prepare()
@@ -751,11 +991,34 @@ public:
 		loadAssets();
 		prepareOffscreenFramebuffers();
 		prepareBuffers();
+		prepareMeasurements();
 		setupDescriptors();
 		preparePipelines();
 		prepared = true;
 	}
 
+	// Begins a render pass for one of the offscreen frame buffers and sets viewport and scissor to its size or the given extent
+	void beginOffscreenRenderPass(VkCommandBuffer cmdBuffer, const FrameBuffer& frameBuffer, const std::vector<VkClearValue>& clearValues, VkExtent2D extent = {})
+	{
+		if (extent.width == 0) {
+			extent = { static_cast<uint32_t>(frameBuffer.width), static_cast<uint32_t>(frameBuffer.height) };
+		}
+
+		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderPass = frameBuffer.renderPass;
+		renderPassBeginInfo.framebuffer = frameBuffer.frameBuffer;
+		renderPassBeginInfo.renderArea.extent = extent;
+		renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassBeginInfo.pClearValues = clearValues.data();
+
+		vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport = vks::initializers::viewport((float)extent.width, (float)extent.height, 0.0f, 1.0f);
+		vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+		VkRect2D scissor = vks::initializers::rect2D(extent.width, extent.height, 0, 0);
+		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+	}
+
 	void buildCommandBuffer()
 	{
 		VkCommandBuffer cmdBuffer = drawCmdBuffers[currentBuffer];
@@ -764,102 +1027,218 @@ public:
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
 
+		if (timing.supported) {
+			vkCmdResetQueryPool(cmdBuffer, timing.queryPool, currentBuffer * Timing::PassCount * 2, Timing::PassCount * 2);
+			timing.written[currentBuffer].fill(false);
+		}
+
+		// The history written by the last frame is read by this one
+		historyIndex = 1 - historyIndex;
+		const uint32_t previousHistory = 1 - historyIndex;
+		// The history can only be used if the temporal pass ran in the last frame
+		const bool useHistory = aoSettings.temporal && historyValid;
+		historyValid = false;
+		// Without accumulation the same kernel samples are used every frame, as changing them would only add flickering
+		const int32_t frameIndex = aoSettings.temporal ? static_cast<int32_t>(temporalFrame++) : 0;
+		const VkExtent2D ssaoExtent = getSSAOExtent();
+
 		/*
-			Offscreen SSAO generation
+			The passes and the resources they access are declared in a render graph, which is rebuilt every frame
+			The graph derives the barriers and image layout transitions between the passes from these declarations
+			Passes whose results aren't used by the final composition (SSAO and/or blur disabled) are culled
 		*/
-		{
-			// Clear values for all attachments written in the fragment shader
-			std::array<VkClearValue, 4> clearValues{};
+		renderGraph.reset();
+
+		VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VkImageSubresourceRange depthRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+		if (vks::tools::formatHasStencil(frameBuffers.offscreen.depth.format)) {
+			depthRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		const vks::RenderGraph::Resource position = renderGraph.importImage("G-Buffer position", frameBuffers.offscreen.position.image, colorRange);
+		const vks::RenderGraph::Resource normal = renderGraph.importImage("G-Buffer normal", frameBuffers.offscreen.normal.image, colorRange);
+		const vks::RenderGraph::Resource albedo = renderGraph.importImage("G-Buffer albedo", frameBuffers.offscreen.albedo.image, colorRange);
+		const vks::RenderGraph::Resource depth = renderGraph.importImage("G-Buffer depth", frameBuffers.offscreen.depth.image, depthRange);
+		const vks::RenderGraph::Resource ssao = renderGraph.importImage("SSAO", frameBuffers.ssao.color.image, colorRange);
+		const vks::RenderGraph::Resource ssaoBlur = renderGraph.importImage("SSAO blur", frameBuffers.ssaoBlur.color.image, colorRange);
+		const std::array<vks::RenderGraph::Resource, 2> histories = {
+			renderGraph.importImage("SSAO history 0", frameBuffers.history[0].color.image, colorRange),
+			renderGraph.importImage("SSAO history 1", frameBuffers.history[1].color.image, colorRange),
+		};
+		const vks::RenderGraph::Resource reference = renderGraph.importImage("SSAO reference", frameBuffers.reference.color.image, colorRange);
+		const vks::RenderGraph::Resource referenceBlur = renderGraph.importImage("SSAO reference blur", frameBuffers.referenceBlur.color.image, colorRange);
+		const vks::RenderGraph::Resource error = renderGraph.importImage("SSAO error", frameBuffers.error.color.image, colorRange);
+
+		/*
+			First pass: Fill G-Buffer components (positions+depth, normals, albedo) using MRT
+		*/
+		renderGraph.addPass("G-Buffer", [this](VkCommandBuffer cmdBuffer) {
+			std::vector<VkClearValue> clearValues(4);
 			clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
 			clearValues[1].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
 			clearValues[2].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
 			clearValues[3].depthStencil = { 1.0f, 0 };
-
-			VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
-			renderPassBeginInfo.renderPass = frameBuffers.offscreen.renderPass;
-			renderPassBeginInfo.framebuffer = frameBuffers.offscreen.frameBuffer;
-			renderPassBeginInfo.renderArea.extent.width = frameBuffers.offscreen.width;
-			renderPassBeginInfo.renderArea.extent.height = frameBuffers.offscreen.height;
-			renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-			renderPassBeginInfo.pClearValues = clearValues.data();
-
-			/*
-				First pass: Fill G-Buffer components (positions+depth, normals, albedo) using MRT
-			*/
-
-			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			VkViewport viewport = vks::initializers::viewport((float)frameBuffers.offscreen.width, (float)frameBuffers.offscreen.height, 0.0f, 1.0f);
-			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-
-			VkRect2D scissor = vks::initializers::rect2D(frameBuffers.offscreen.width, frameBuffers.offscreen.height, 0, 0);
-			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
-
+			beginOffscreenRenderPass(cmdBuffer, frameBuffers.offscreen, clearValues);
 			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.offscreen);
-
 			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.gBuffer, 0, 1, &descriptorSets[currentBuffer].gBuffer, 0, nullptr);
 			scene.draw(cmdBuffer, vkglTF::RenderFlags::BindImages, pipelineLayouts.gBuffer);
-
 			vkCmdEndRenderPass(cmdBuffer);
+		})
+			.write(position, vks::RenderGraph::colorAttachment)
+			.write(normal, vks::RenderGraph::colorAttachment)
+			.write(albedo, vks::RenderGraph::colorAttachment)
+			.write(depth, vks::RenderGraph::depthStencilAttachment);
 
-			/*
-				Second pass: SSAO generation
-			*/
-
+		/*
+			Second pass: SSAO generation, possibly at a lower resolution
+		*/
+		renderGraph.addPass("SSAO", [this, ssaoExtent, frameIndex](VkCommandBuffer cmdBuffer) {
+			writeTimestamp(cmdBuffer, Timing::SSAO, false);
+			std::vector<VkClearValue> clearValues(1);
 			clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
-			clearValues[1].depthStencil = { 1.0f, 0 };
-
-			renderPassBeginInfo.framebuffer = frameBuffers.ssao.frameBuffer;
-			renderPassBeginInfo.renderPass = frameBuffers.ssao.renderPass;
-			renderPassBeginInfo.renderArea.extent.width = frameBuffers.ssao.width;
-			renderPassBeginInfo.renderArea.extent.height = frameBuffers.ssao.height;
-			renderPassBeginInfo.clearValueCount = 2;
-			renderPassBeginInfo.pClearValues = clearValues.data();
-
-			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			viewport = vks::initializers::viewport((float)frameBuffers.ssao.width, (float)frameBuffers.ssao.height, 0.0f, 1.0f);
-			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-			scissor = vks::initializers::rect2D(frameBuffers.ssao.width, frameBuffers.ssao.height, 0, 0);
-			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
-
+			beginOffscreenRenderPass(cmdBuffer, frameBuffers.ssao, clearValues, ssaoExtent);
 			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.ssao, 0, 1, &descriptorSets[currentBuffer].ssao, 0, nullptr);
 			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.ssao);
+			const SSAOPushConstants pushConstants{ 8 << aoSettings.sampleCount, frameIndex };
+			vkCmdPushConstants(cmdBuffer, pipelineLayouts.ssao, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
 			vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
-
 			vkCmdEndRenderPass(cmdBuffer);
+			writeTimestamp(cmdBuffer, Timing::SSAO, true);
+		})
+			.read(position, vks::RenderGraph::sampledFragment)
+			.read(normal, vks::RenderGraph::sampledFragment)
+			.write(ssao, vks::RenderGraph::colorAttachment);
 
-			/*
-				Third pass: SSAO blur
-			*/
-
-			renderPassBeginInfo.framebuffer = frameBuffers.ssaoBlur.frameBuffer;
-			renderPassBeginInfo.renderPass = frameBuffers.ssaoBlur.renderPass;
-			renderPassBeginInfo.renderArea.extent.width = frameBuffers.ssaoBlur.width;
-			renderPassBeginInfo.renderArea.extent.height = frameBuffers.ssaoBlur.height;
-
-			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			viewport = vks::initializers::viewport((float)frameBuffers.ssaoBlur.width, (float)frameBuffers.ssaoBlur.height, 0.0f, 1.0f);
-			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-			scissor = vks::initializers::rect2D(frameBuffers.ssaoBlur.width, frameBuffers.ssaoBlur.height, 0, 0);
-			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
-
+		/*
+			Third pass: SSAO blur, which also upsamples lower resolution SSAO to full resolution
+		*/
+		renderGraph.addPass("SSAO blur", [this, ssaoExtent](VkCommandBuffer cmdBuffer) {
+			writeTimestamp(cmdBuffer, Timing::Blur, false);
+			std::vector<VkClearValue> clearValues(1);
+			clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+			beginOffscreenRenderPass(cmdBuffer, frameBuffers.ssaoBlur, clearValues);
 			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.ssaoBlur, 0, 1, &descriptorSets[currentBuffer].ssaoBlur, 0, nullptr);
 			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.ssaoBlur);
+			const BlurPushConstants pushConstants{ glm::vec2((float)ssaoExtent.width, (float)ssaoExtent.height), 1 };
+			vkCmdPushConstants(cmdBuffer, pipelineLayouts.ssaoBlur, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
 			vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+			vkCmdEndRenderPass(cmdBuffer);
+			writeTimestamp(cmdBuffer, Timing::Blur, true);
+		})
+			.read(ssao, vks::RenderGraph::sampledFragment)
+			.read(position, vks::RenderGraph::sampledFragment)
+			.read(normal, vks::RenderGraph::sampledFragment)
+			.write(ssaoBlur, vks::RenderGraph::colorAttachment);
 
+		/*
+			Fourth pass: Temporal accumulation of the (blurred) occlusion with the reprojected result of the last frame
+			With accumulation disabled, this only writes the occlusion and depth to the history, so the following passes always read the same image
+		*/
+		vks::RenderGraph::Pass& temporalPass = renderGraph.addPass("SSAO temporal", [this, ssaoExtent, useHistory](VkCommandBuffer cmdBuffer) {
+			writeTimestamp(cmdBuffer, Timing::Temporal, false);
+			std::vector<VkClearValue> clearValues(1);
+			clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+			beginOffscreenRenderPass(cmdBuffer, frameBuffers.history[historyIndex], clearValues);
+			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.temporal, 0, 1, &descriptorSets[currentBuffer].temporal[historyIndex], 0, nullptr);
+			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.temporal);
+			TemporalPushConstants pushConstants{};
+			pushConstants.reprojection = reprojection;
+			pushConstants.ssaoScale = glm::vec2((float)ssaoExtent.width / (float)frameBuffers.ssao.width, (float)ssaoExtent.height / (float)frameBuffers.ssao.height);
+			pushConstants.historyWeight = useHistory ? aoSettings.historyWeight : 0.0f;
+			pushConstants.ssaoBlur = uboSSAOParams.ssaoBlur;
+			vkCmdPushConstants(cmdBuffer, pipelineLayouts.temporal, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+			vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
 			vkCmdEndRenderPass(cmdBuffer);
+			writeTimestamp(cmdBuffer, Timing::Temporal, true);
+			historyValid = true;
+		})
+			.read(position, vks::RenderGraph::sampledFragment)
+			.write(histories[historyIndex], vks::RenderGraph::colorAttachment);
+		// Like in the composition, images that are bound but not sampled with the current settings are only referenced
+		if (uboSSAOParams.ssaoBlur) {
+			temporalPass.read(ssaoBlur, vks::RenderGraph::sampledFragment).reference(ssao, vks::RenderGraph::sampledFragment);
+		} else {
+			temporalPass.read(ssao, vks::RenderGraph::sampledFragment).reference(ssaoBlur, vks::RenderGraph::sampledFragment);
+		}
+		if (useHistory) {
+			temporalPass.read(histories[previousHistory], vks::RenderGraph::sampledFragment);
+		} else {
+			temporalPass.reference(histories[previousHistory], vks::RenderGraph::sampledFragment);
 		}
 
 		/*
-			Note: Explicit synchronization is not required between the render pass, as this is done implicit via sub pass dependencies
+			Optional passes comparing the result with the full resolution reference (the same passes without the new options: 64 samples, box blur and no accumulation)
+			The error image is copied to the host to calculate statistics
 		*/
+		if (aoSettings.compareReference) {
+			renderGraph.addPass("SSAO reference", [this](VkCommandBuffer cmdBuffer) {
+				writeTimestamp(cmdBuffer, Timing::ReferenceSSAO, false);
+				std::vector<VkClearValue> clearValues(1);
+				clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+				beginOffscreenRenderPass(cmdBuffer, frameBuffers.reference, clearValues);
+				vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.ssao, 0, 1, &descriptorSets[currentBuffer].ssao, 0, nullptr);
+				vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.ssao);
+				const SSAOPushConstants pushConstants{ SSAO_KERNEL_SIZE, 0 };
+				vkCmdPushConstants(cmdBuffer, pipelineLayouts.ssao, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+				vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+				vkCmdEndRenderPass(cmdBuffer);
+				writeTimestamp(cmdBuffer, Timing::ReferenceSSAO, true);
+			})
+				.read(position, vks::RenderGraph::sampledFragment)
+				.read(normal, vks::RenderGraph::sampledFragment)
+				.write(reference, vks::RenderGraph::colorAttachment);
+
+			renderGraph.addPass("SSAO reference blur", [this](VkCommandBuffer cmdBuffer) {
+				writeTimestamp(cmdBuffer, Timing::ReferenceBlur, false);
+				std::vector<VkClearValue> clearValues(1);
+				clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+				beginOffscreenRenderPass(cmdBuffer, frameBuffers.referenceBlur, clearValues);
+				vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.ssaoBlur, 0, 1, &descriptorSets[currentBuffer].referenceBlur, 0, nullptr);
+				vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.ssaoBlur);
+				const BlurPushConstants pushConstants{ glm::vec2((float)frameBuffers.reference.width, (float)frameBuffers.reference.height), 0 };
+				vkCmdPushConstants(cmdBuffer, pipelineLayouts.ssaoBlur, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+				vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+				vkCmdEndRenderPass(cmdBuffer);
+				writeTimestamp(cmdBuffer, Timing::ReferenceBlur, true);
+			})
+				.read(reference, vks::RenderGraph::sampledFragment)
+				.read(position, vks::RenderGraph::sampledFragment)
+				.read(normal, vks::RenderGraph::sampledFragment)
+				.write(referenceBlur, vks::RenderGraph::colorAttachment);
+
+			renderGraph.addPass("SSAO error", [this](VkCommandBuffer cmdBuffer) {
+				std::vector<VkClearValue> clearValues(1);
+				clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+				beginOffscreenRenderPass(cmdBuffer, frameBuffers.error, clearValues);
+				vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.error, 0, 1, &descriptorSets[currentBuffer].error[historyIndex], 0, nullptr);
+				vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.error);
+				vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+				vkCmdEndRenderPass(cmdBuffer);
+			})
+				.read(histories[historyIndex], vks::RenderGraph::sampledFragment)
+				.read(referenceBlur, vks::RenderGraph::sampledFragment)
+				.write(error, vks::RenderGraph::colorAttachment);
+
+			renderGraph.addPass("SSAO error readback", [this](VkCommandBuffer cmdBuffer) {
+				VkBufferImageCopy copyRegion{};
+				copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				copyRegion.imageExtent = { static_cast<uint32_t>(frameBuffers.error.width), static_cast<uint32_t>(frameBuffers.error.height), 1 };
+				vkCmdCopyImageToBuffer(cmdBuffer, frameBuffers.error.color.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, errorStats.readbackBuffers[currentBuffer].buffer, 1, &copyRegion);
+				// Waiting for the frame's fence doesn't make the copied data visible to the host
+				VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+				memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+				vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+				errorStats.written[currentBuffer] = true;
+			})
+				.external()
+				.read(error, vks::RenderGraph::transferRead);
+		}
 
 		/*
-			Final render pass: Scene rendering with applied radial blur
+			Final pass: Composition of the G-Buffer and the ambient occlusion to the swapchain
+			This pass renders to the swapchain, so it's external to the graph and never culled
 		*/
-		{
+		vks::RenderGraph::Pass& compositionPass = renderGraph.addPass("Composition", [this](VkCommandBuffer cmdBuffer) {
 			std::array<VkClearValue, 2> clearValues{};
 			clearValues[0].color = defaultClearColor;
 			clearValues[1].depthStencil = { 1.0f, 0 };
@@ -880,7 +1259,7 @@ public:
 			VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
 			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
-			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.composition, 0, 1, &descriptorSets[currentBuffer].composition, 0, nullptr);
+			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.composition, 0, 1, &descriptorSets[currentBuffer].composition[historyIndex], 0, nullptr);
 
 			// Final composition pass
 			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.composition);
@@ -889,7 +1268,27 @@ public:
 			drawUI(cmdBuffer);
 
 			vkCmdEndRenderPass(cmdBuffer);
+		})
+			.external()
+			.read(position, vks::RenderGraph::sampledFragment)
+			.read(normal, vks::RenderGraph::sampledFragment)
+			.read(albedo, vks::RenderGraph::sampledFragment);
+		// The ambient occlusion and error images are bound to the composition descriptor set, but the shader only samples them if selected by the settings
+		// Otherwise they are only referenced, so they're in the right layout for the descriptor but don't keep the passes writing them alive
+		const bool ssaoUsed = uboSSAOParams.ssao || uboSSAOParams.ssaoOnly;
+		if (ssaoUsed) {
+			compositionPass.read(histories[historyIndex], vks::RenderGraph::sampledFragment);
+		} else {
+			compositionPass.reference(histories[historyIndex], vks::RenderGraph::sampledFragment);
 		}
+		if (aoSettings.compareReference && aoSettings.showError) {
+			compositionPass.read(error, vks::RenderGraph::sampledFragment);
+		} else {
+			compositionPass.reference(error, vks::RenderGraph::sampledFragment);
+		}
+
+		renderGraph.compile();
+		renderGraph.execute(cmdBuffer);
 
 		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
 	}
@@ -900,6 +1299,8 @@ public:
 			return;
 		}
 		VulkanExampleBase::prepareFrame();
+		readTimestamps();
+		readErrorStats();
 		updateUniformBuffers();
 		buildCommandBuffer();
 		VulkanExampleBase::submitFrame();
@@ -912,6 +1313,55 @@ public:
 			overlay->checkBox("SSAO blur", &uboSSAOParams.ssaoBlur);
 			overlay->checkBox("SSAO pass only", &uboSSAOParams.ssaoOnly);
 		}
+		if (overlay->header("Quality")) {
+			std::vector<std::string> presetNames;
+			for (auto& preset : aoPresets) {
+				presetNames.push_back(preset.name);
+			}
+			if (overlay->comboBox("Preset", &aoSettings.preset, presetNames)) {
+				applyPreset(aoSettings.preset);
+			}
+			overlay->comboBox("Resolution", &aoSettings.resolution, { "Full", "Half", "Quarter" });
+			overlay->comboBox("Samples", &aoSettings.sampleCount, { "8", "16", "32", "64" });
+			overlay->checkBox("Temporal accumulation", &aoSettings.temporal);
+			if (aoSettings.temporal) {
+				overlay->sliderFloat("History weight", &aoSettings.historyWeight, 0.5f, 0.98f);
+			}
+		}
+		if (overlay->header("Full resolution reference")) {
+			overlay->checkBox("Compare", &aoSettings.compareReference);
+			if (aoSettings.compareReference) {
+				overlay->checkBox("Show error", &aoSettings.showError);
+				overlay->text("Mean error: %.4f (RMS %.4f)", errorStats.meanError, errorStats.rmsError);
+				overlay->text("Max error: %.3f, PSNR: %.1f dB", errorStats.maxError, errorStats.psnr);
+			}
+		}
+		if (overlay->header("GPU time")) {
+			if (timing.supported) {
+				const std::array<float, Timing::PassCount>& times = timing.passTimes;
+				overlay->text("SSAO: %.3f ms", times[Timing::SSAO]);
+				overlay->text("Blur: %.3f ms", times[Timing::Blur]);
+				overlay->text("Temporal: %.3f ms", times[Timing::Temporal]);
+				overlay->text("Total: %.3f ms", times[Timing::SSAO] + times[Timing::Blur] + times[Timing::Temporal]);
+				if (aoSettings.compareReference) {
+					overlay->text("Reference: %.3f ms", times[Timing::ReferenceSSAO] + times[Timing::ReferenceBlur]);
+				}
+			} else {
+				overlay->text("Timestamps not supported");
+			}
+		}
+		if (overlay->header("Render graph")) {
+			overlay->text("Synchronization2: %s", renderGraph.synchronization2 ? "yes" : "no");
+			overlay->text("Passes: %d (%d culled)", renderGraph.stats.passes, renderGraph.stats.culledPasses);
+			overlay->text("Barriers: %d (%d image, %d buffer)", renderGraph.stats.barrierBatches, renderGraph.stats.imageBarriers, renderGraph.stats.bufferBarriers);
+		}
+		if (overlay->header("Attachment memory")) {
+			transientAllocator.updateCommitment();
+			const vks::TransientAllocator::Stats& stats = transientAllocator.stats;
+			overlay->text("Images: %d in %d allocations", stats.images, stats.allocations);
+			overlay->text("Allocated: %.2f MiB (%.2f MiB without aliasing)", stats.allocatedSize / (1024.0f * 1024.0f), stats.unaliasedSize / (1024.0f * 1024.0f));
+			overlay->text("Lazy: %d images, %.2f MiB (%.2f MiB committed)", stats.lazyImages, stats.lazySize / (1024.0f * 1024.0f), stats.lazyCommittedSize / (1024.0f * 1024.0f));
+		}
 	}
 };
 
@@ -18,6 +18,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanTransientAllocator.h"
 
 class VulkanExample : public VulkanExampleBase
 {
@@ -77,9 +78,10 @@ public:
 	std::array<DescriptorSets, maxConcurrentFrames> descriptorSets;
 
 	// G-Buffer framebuffer attachments
+	// The G-Buffer is only read as input attachments within the render pass, so it never needs to be written to memory
+	// The images are transient and use lazily allocated memory where available, which is owned by the transient allocator
 	struct FrameBufferAttachment {
 		VkImage image = VK_NULL_HANDLE;
-		VkDeviceMemory mem = VK_NULL_HANDLE;
 		VkImageView view = VK_NULL_HANDLE;
 		VkFormat format;
 	};
@@ -88,6 +90,7 @@ public:
 		int32_t width;
 		int32_t height;
 	} attachments;
+	vks::TransientAllocator transientAllocator;
 
 	VulkanExample() : VulkanExampleBase()
 	{
@@ -120,6 +123,7 @@ public:
 			clearAttachment(&attachments.position);
 			clearAttachment(&attachments.normal);
 			clearAttachment(&attachments.albedo);
+			transientAllocator.destroy();
 			textures.glass.destroy();
 			for (auto& buffer : uniformBuffers) {
 				buffer.GBuffer.destroy();
@@ -137,35 +141,19 @@ public:
 		}
 	};
 
+	// The image itself is destroyed along with its memory by the transient allocator
 	void clearAttachment(FrameBufferAttachment* attachment)
 	{
 		vkDestroyImageView(device, attachment->view, nullptr);
-		vkDestroyImage(device, attachment->image, nullptr);
-		vkFreeMemory(device, attachment->mem, nullptr);
+		attachment->view = VK_NULL_HANDLE;
+		attachment->image = VK_NULL_HANDLE;
 	}
 
-	// Create a frame buffer attachment
+	// Create the image of a frame buffer attachment, memory is allocated for all attachments at once by the transient allocator
 	void createAttachment(VkFormat format, VkImageUsageFlags usage, FrameBufferAttachment *attachment)
 	{
-		if (attachment->image != VK_NULL_HANDLE) {
-			clearAttachment(attachment);
-		}
-
-		VkImageAspectFlags aspectMask = 0;
-
 		attachment->format = format;
 
-		if (usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
-		{
-			aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		}
-		if (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
-		{
-			aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
-		}
-
-		assert(aspectMask > 0);
-
 		VkImageCreateInfo image = vks::initializers::imageCreateInfo();
 		image.imageType = VK_IMAGE_TYPE_2D;
 		image.format = format;
@@ -179,22 +167,18 @@ public:
 		// VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT flag is required for input attachments
 		image.usage = usage | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
 		image.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		// All attachments live within the single render pass of this sample
+		attachment->image = transientAllocator.createImage(image, 0, 0);
+	}
 
-		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
-
-		VK_CHECK_RESULT(vkCreateImage(device, &image, nullptr, &attachment->image));
-		vkGetImageMemoryRequirements(device, attachment->image, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-		memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &attachment->mem));
-		VK_CHECK_RESULT(vkBindImageMemory(device, attachment->image, attachment->mem, 0));
-
+	// Create the view of a frame buffer attachment, this can only be done once memory has been bound to the image
+	void createAttachmentView(FrameBufferAttachment *attachment)
+	{
 		VkImageViewCreateInfo imageView = vks::initializers::imageViewCreateInfo();
 		imageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		imageView.format = format;
+		imageView.format = attachment->format;
 		imageView.subresourceRange = {};
-		imageView.subresourceRange.aspectMask = aspectMask;
+		imageView.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		imageView.subresourceRange.baseMipLevel = 0;
 		imageView.subresourceRange.levelCount = 1;
 		imageView.subresourceRange.baseArrayLayer = 0;
@@ -206,9 +190,20 @@ public:
 	// Create color attachments for the G-Buffer components
 	void createGBufferAttachments()
 	{
+		if (attachments.position.image != VK_NULL_HANDLE) {
+			clearAttachment(&attachments.position);
+			clearAttachment(&attachments.normal);
+			clearAttachment(&attachments.albedo);
+			transientAllocator.destroy();
+		}
+		transientAllocator.create(vulkanDevice);
 		createAttachment(VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &attachments.position);	// (World space) Positions
 		createAttachment(VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &attachments.normal);		// (World space) Normals
 		createAttachment(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, &attachments.albedo);			// Albedo (color)
+		transientAllocator.allocate();
+		createAttachmentView(&attachments.position);
+		createAttachmentView(&attachments.normal);
+		createAttachmentView(&attachments.albedo);
 	}
 
 	// Override framebuffer setup from base class, will automatically be called upon setup and if a window is resized
@@ -278,7 +273,7 @@ public:
 		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		attachments[0].finalLayout = swapChain.presentLayout;
 
 		// Deferred attachments
 		// Position
@@ -759,6 +754,13 @@ public:
 				initLights();
 			}
 		}
+		if (overlay->header("Attachment memory")) {
+			transientAllocator.updateCommitment();
+			const vks::TransientAllocator::Stats& stats = transientAllocator.stats;
+			overlay->text("Images: %d in %d allocations", stats.images, stats.allocations);
+			overlay->text("Allocated: %.2f MiB (%.2f MiB without aliasing)", stats.allocatedSize / (1024.0f * 1024.0f), stats.unaliasedSize / (1024.0f * 1024.0f));
+			overlay->text("Lazy: %d images, %.2f MiB (%.2f MiB committed)", stats.lazyImages, stats.lazySize / (1024.0f * 1024.0f), stats.lazyCommittedSize / (1024.0f * 1024.0f));
+		}
 	}
 };
 
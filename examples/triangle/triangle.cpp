@@ -116,6 +116,8 @@ public:
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Basic indexed triangle";
+		// This sample does its own swapchain image acquisition and presentation
+		requiresSwapChain = true;
 		// To keep things simple, we don't use the UI overlay from the framework
 		settings.overlay = false;
 		// Setup a default look-at camera
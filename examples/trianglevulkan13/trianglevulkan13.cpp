@@ -103,6 +103,8 @@ public:
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Basic indexed triangle using Vulkan 1.3";
+		// This sample does its own swapchain image acquisition and presentation
+		requiresSwapChain = true;
 		// To keep things simple, we don't use the UI overlay from the framework
 		settings.overlay = false;
 		// Setup a default look-at camera
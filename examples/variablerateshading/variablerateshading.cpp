@@ -121,7 +121,7 @@ void VulkanExample::setupRenderPass()
 	attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	attachments[0].finalLayout = swapChain.presentLayout;
 	// Depth attachment
 	attachments[1].sType = VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2;
 	attachments[1].format = depthFormat;
@@ -571,10 +571,11 @@ void VulkanExample::buildCommandBuffer()
 	vkCmdSetFragmentShadingRateKHR(cmdBuffer, &fragmentSize, combinerOps);
 
 	// Render the scene
-	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.opaque);
-	scene.draw(cmdBuffer, vkglTF::RenderFlags::BindImages | vkglTF::RenderFlags::RenderOpaqueNodes, pipelineLayout);
-	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.masked);
-	scene.draw(cmdBuffer, vkglTF::RenderFlags::BindImages | vkglTF::RenderFlags::RenderAlphaMaskedNodes, pipelineLayout);
+	// Opaque and masked primitives are gathered and sorted by material in a single pass, the pipeline is switched once between the two buckets
+	scene.buildDrawList(glm::vec3(glm::inverse(camera.matrices.view)[3]));
+	scene.drawSorted(cmdBuffer, vkglTF::RenderFlags::BindImages | vkglTF::RenderFlags::RenderOpaqueNodes | vkglTF::RenderFlags::RenderAlphaMaskedNodes, pipelineLayout, 1, [this](VkCommandBuffer commandBuffer, vks::DrawList::Bucket bucket) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, (bucket == vks::DrawList::Bucket::Opaque) ? pipelines.opaque : pipelines.masked);
+	});
 
 	drawUI(cmdBuffer);
 	vkCmdEndRenderPass(cmdBuffer);
@@ -3942,6 +3942,24 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
     return false;
   }
 
+  // EXT_meshopt_compression fallback buffers don't contain any data, the
+  // buffer views referencing them are decoded from compressed buffers by the
+  // application
+  {
+    json_const_iterator extensionsIt, meshoptIt;
+    bool fallback = false;
+    if (FindMember(o, "extensions", extensionsIt) &&
+        FindMember(GetValue(extensionsIt), "EXT_meshopt_compression",
+                   meshoptIt) &&
+        ParseBooleanProperty(&fallback, nullptr, GetValue(meshoptIt),
+                             "fallback", false) &&
+        fallback) {
+      buffer->uri.clear();
+      ParseExtensionsProperty(&buffer->extensions, err, o);
+      return true;
+    }
+  }
+
   // In glTF 2.0, uri is not mandatory anymore
   buffer->uri.clear();
   ParseStringProperty(&buffer->uri, err, o, "uri", false, "Buffer");
@@ -0,0 +1,41 @@
+#version 450
+
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec3 inColor;
+// Per-instance node matrix
+layout (location = 3) in mat4 inNodeMatrix;
+
+layout (set = 0, binding = 0) uniform UBO {
+	mat4 projection;
+	mat4 view;
+	mat4 model;
+} ubo;
+
+layout(push_constant) uniform PushBlock {
+	vec4 baseColorFactor;
+} material;
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+layout (location = 2) out vec3 outViewVec;
+layout (location = 3) out vec3 outLightVec;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main() 
+{
+	outColor = material.baseColorFactor.rgb;
+	vec4 pos = vec4(inPos, 1.0);
+	gl_Position = ubo.projection * ubo.view * ubo.model * inNodeMatrix * pos;
+
+	outNormal = mat3(ubo.view * ubo.model * inNodeMatrix) * inNormal;
+
+	vec4 localpos = ubo.view * ubo.model * inNodeMatrix * pos;
+	vec3 lightPos = vec3(10.0f, -10.0f, 10.0f);
+	outLightVec = lightPos.xyz - localpos.xyz;
+	outViewVec = -localpos.xyz;		
+}
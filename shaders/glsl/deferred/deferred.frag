@@ -1,5 +1,11 @@
 #version 450
 
+// Must match the values used in the light culling compute shader and the sample
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define MAX_LIGHTS_PER_CLUSTER 256
+
 layout (binding = 1) uniform sampler2D samplerposition;
 layout (binding = 2) uniform sampler2D samplerNormal;
 layout (binding = 3) uniform sampler2D samplerAlbedo;
@@ -9,86 +15,144 @@ layout (location = 0) in vec2 inUV;
 layout (location = 0) out vec4 outFragcolor;
 
 struct Light {
+	// xyz = position, w = range (no influence beyond that distance)
 	vec4 position;
-	vec3 color;
-	float radius;
+	// rgb = color, a = intensity
+	vec4 color;
+	// xyz = spot direction, w = cosine of the spot cone angle (-1 for point lights)
+	vec4 direction;
 };
 
-layout (binding = 4) uniform UBO 
+layout (binding = 4) uniform UBO
 {
-	Light lights[6];
+	mat4 view;
+	mat4 projection;
+	mat4 inverseProjection;
 	vec4 viewPos;
 	int displayDebugTarget;
+	uint lightCount;
+	uint clustered;
+	float zNear;
+	float zFar;
 } ubo;
 
-void main() 
+layout (std430, binding = 5) readonly buffer Lights {
+	Light lights[];
+};
+
+// Number of lights affecting each cluster
+layout (std430, binding = 6) readonly buffer LightGrid {
+	uint lightGrid[];
+};
+
+// Fixed size light index list for each cluster
+layout (std430, binding = 7) readonly buffer LightIndices {
+	uint lightIndices[];
+};
+
+uint clusterIndex(vec3 viewSpacePos)
+{
+	vec4 clip = ubo.projection * vec4(viewSpacePos, 1.0);
+	vec2 ndc = clamp(clip.xy / clip.w, vec2(-1.0), vec2(1.0));
+	uvec2 tile = min(uvec2((ndc * 0.5 + 0.5) * vec2(CLUSTER_X, CLUSTER_Y)), uvec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+	// Depth slices are distributed exponentially, so clusters are roughly cube shaped in view space
+	float slice = log(max(-viewSpacePos.z, ubo.zNear) / ubo.zNear) / log(ubo.zFar / ubo.zNear) * float(CLUSTER_Z);
+	uint z = min(uint(slice), CLUSTER_Z - 1);
+	return tile.x + tile.y * CLUSTER_X + z * CLUSTER_X * CLUSTER_Y;
+}
+
+vec3 shadeLight(Light light, vec3 fragPos, vec3 N, vec3 V, vec4 albedo)
+{
+	// Vector to light
+	vec3 L = light.position.xyz - fragPos;
+	// Distance from light to fragment position
+	float dist = length(L);
+	if (dist > light.position.w) {
+		return vec3(0.0);
+	}
+	// Light to fragment
+	L = normalize(L);
+
+	// Attenuation, windowed so the light has no influence beyond its range
+	float window = clamp(1.0 - pow(dist / light.position.w, 4.0), 0.0, 1.0);
+	float atten = light.color.a / (pow(dist, 2.0) + 1.0) * window * window;
+
+	// Spot cone
+	if (light.direction.w > -1.0) {
+		float cosAngle = dot(-L, light.direction.xyz);
+		atten *= smoothstep(light.direction.w, min(light.direction.w + 0.05, 1.0), cosAngle);
+	}
+
+	// Diffuse part
+	float NdotL = max(0.0, dot(N, L));
+	vec3 diff = light.color.rgb * albedo.rgb * NdotL * atten;
+
+	// Specular part
+	// Specular map values are stored in alpha of albedo mrt
+	vec3 R = reflect(-L, N);
+	float NdotR = max(0.0, dot(R, V));
+	vec3 spec = light.color.rgb * albedo.a * pow(NdotR, 16.0) * atten;
+
+	return diff + spec;
+}
+
+void main()
 {
 	// Get G-Buffer values
 	vec3 fragPos = texture(samplerposition, inUV).rgb;
 	vec3 normal = texture(samplerNormal, inUV).rgb;
 	vec4 albedo = texture(samplerAlbedo, inUV);
-	
+
 	// Debug display
 	if (ubo.displayDebugTarget > 0) {
 		switch (ubo.displayDebugTarget) {
-			case 1: 
+			case 1:
 				outFragcolor.rgb = fragPos;
 				break;
-			case 2: 
+			case 2:
 				outFragcolor.rgb = normal;
 				break;
-			case 3: 
+			case 3:
 				outFragcolor.rgb = albedo.rgb;
 				break;
-			case 4: 
+			case 4:
 				outFragcolor.rgb = albedo.aaa;
 				break;
-		}		
+			case 5: {
+				// Number of lights in the fragment's cluster
+				uint cluster = clusterIndex((ubo.view * vec4(fragPos, 1.0)).xyz);
+				outFragcolor.rgb = mix(vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0), float(min(lightGrid[cluster], MAX_LIGHTS_PER_CLUSTER)) / 64.0);
+				break;
+			}
+		}
 		outFragcolor.a = 1.0;
 		return;
 	}
 
 	// Render-target composition
 
-	#define lightCount 6
 	#define ambient 0.0
-	
+
 	// Ambient part
 	vec3 fragcolor  = albedo.rgb * ambient;
-	
-	for(int i = 0; i < lightCount; ++i)
-	{
-		// Vector to light
-		vec3 L = ubo.lights[i].position.xyz - fragPos;
-		// Distance from light to fragment position
-		float dist = length(L);
-
-		// Viewer to fragment
-		vec3 V = ubo.viewPos.xyz - fragPos;
-		V = normalize(V);
-		
-		//if(dist < ubo.lights[i].radius)
-		{
-			// Light to fragment
-			L = normalize(L);
-
-			// Attenuation
-			float atten = ubo.lights[i].radius / (pow(dist, 2.0) + 1.0);
-
-			// Diffuse part
-			vec3 N = normalize(normal);
-			float NdotL = max(0.0, dot(N, L));
-			vec3 diff = ubo.lights[i].color * albedo.rgb * NdotL * atten;
-
-			// Specular part
-			// Specular map values are stored in alpha of albedo mrt
-			vec3 R = reflect(-L, N);
-			float NdotR = max(0.0, dot(R, V));
-			vec3 spec = ubo.lights[i].color * albedo.a * pow(NdotR, 16.0) * atten;
-
-			fragcolor += diff + spec;	
-		}	
-	}    	
-   
-  outFragcolor = vec4(fragcolor, 1.0);	
-}
\ No newline at end of file
+
+	vec3 N = normalize(normal);
+	// Viewer to fragment
+	vec3 V = normalize(ubo.viewPos.xyz - fragPos);
+
+	if (ubo.clustered == 1) {
+		// Only iterate over the lights that have been binned into this fragment's cluster by the light culling compute pass
+		uint cluster = clusterIndex((ubo.view * vec4(fragPos, 1.0)).xyz);
+		uint count = min(lightGrid[cluster], MAX_LIGHTS_PER_CLUSTER);
+		for (uint i = 0; i < count; ++i) {
+			fragcolor += shadeLight(lights[lightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + i]], fragPos, N, V, albedo);
+		}
+	} else {
+		// Brute force: Iterate over all lights
+		for (uint i = 0; i < ubo.lightCount; ++i) {
+			fragcolor += shadeLight(lights[i], fragPos, N, V, albedo);
+		}
+	}
+
+	outFragcolor = vec4(fragcolor, 1.0);
+}
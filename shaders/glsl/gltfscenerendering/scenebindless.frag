@@ -0,0 +1,58 @@
+#version 450
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+// All textures are accessed through the global bindless table
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+
+struct Material {
+	uint baseColorTextureIndex;
+	uint normalTextureIndex;
+};
+
+layout (set = 0, binding = 1) readonly buffer Materials {
+	Material materials[];
+};
+
+layout(push_constant) uniform PushConsts {
+	layout(offset = 64) uint materialIndex;
+} primitive;
+
+layout (location = 0) in vec3 inNormal;
+layout (location = 1) in vec3 inColor;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec3 inViewVec;
+layout (location = 4) in vec3 inLightVec;
+layout (location = 5) in vec4 inTangent;
+
+layout (location = 0) out vec4 outFragColor;
+
+layout (constant_id = 0) const bool ALPHA_MASK = false;
+layout (constant_id = 1) const float ALPHA_MASK_CUTOFF = 0.0f;
+
+void main() 
+{
+	// The material index comes from a push constant, so the texture indices are dynamically uniform
+	Material material = materials[primitive.materialIndex];
+	vec4 color = texture(textures[material.baseColorTextureIndex], inUV) * vec4(inColor, 1.0);
+
+	if (ALPHA_MASK) {
+		if (color.a < ALPHA_MASK_CUTOFF) {
+			discard;
+		}
+	}
+
+	vec3 N = normalize(inNormal);
+	vec3 T = normalize(inTangent.xyz);
+	vec3 B = cross(inNormal, inTangent.xyz) * inTangent.w;
+	mat3 TBN = mat3(T, B, N);
+	N = TBN * normalize(texture(textures[material.normalTextureIndex], inUV).xyz * 2.0 - vec3(1.0));
+
+	const float ambient = 0.1;
+	vec3 L = normalize(inLightVec);
+	vec3 V = normalize(inViewVec);
+	vec3 R = reflect(-L, N);
+	vec3 diffuse = max(dot(N, L), ambient).rrr;
+	float specular = pow(max(dot(R, V), 0.0), 32.0);
+	outFragColor = vec4(diffuse * color.rgb + specular, color.a);
+}
@@ -0,0 +1,50 @@
+#version 450
+
+#extension GL_ARB_shader_viewport_layer_array : require
+
+// Single pass cube map rendering: Each object is drawn with one instance per cube map face it's visible in
+// The face for the current instance is the n-th set bit of the object's face mask, and is used as the target layer
+
+layout (location = 0) in vec3 inPos;
+
+layout (location = 0) out vec4 outPos;
+layout (location = 1) out vec3 outLightPos;
+
+layout (binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 view; 
+	mat4 model;
+	vec4 lightPos;
+	mat4 faceViews[6];
+} ubo;
+
+layout(push_constant) uniform PushConsts 
+{
+	uint faceMask;
+} pushConsts;
+ 
+out gl_PerVertex 
+{
+	vec4 gl_Position;
+};
+ 
+void main()
+{
+	uint face = 0;
+	uint instance = gl_InstanceIndex;
+	for (face = 0; face < 6; face++) {
+		if ((pushConsts.faceMask & (1u << face)) != 0) {
+			if (instance == 0) {
+				break;
+			}
+			instance--;
+		}
+	}
+
+	gl_Layer = int(face);
+	gl_Position = ubo.projection * ubo.faceViews[face] * ubo.model * vec4(inPos, 1.0);
+
+	outPos = vec4(inPos, 1.0);	
+	outLightPos = ubo.lightPos.xyz; 
+}
@@ -1,25 +1,60 @@
 #version 450
 
 layout (binding = 0) uniform sampler2D samplerSSAO;
+layout (binding = 1) uniform sampler2D samplerPositionDepth;
+layout (binding = 2) uniform sampler2D samplerNormal;
+
+layout (push_constant) uniform PushConsts
+{
+	// Size of the area of the SSAO image that has been rendered to, in texels
+	vec2 ssaoSize;
+	// Weight samples by depth and normal similarity instead of averaging them
+	int bilateral;
+} pushConsts;
 
 layout (location = 0) in vec2 inUV;
 
 layout (location = 0) out float outFragColor;
 
+// Relative depth difference at which a sample no longer contributes
+#define DEPTH_TOLERANCE 0.05
+#define NORMAL_POWER 8.0
+
 void main() 
 {
 	const int blurRange = 2;
-	int n = 0;
 	vec2 texelSize = 1.0 / vec2(textureSize(samplerSSAO, 0));
+	// SSAO texel containing this fragment, the SSAO image may have a lower resolution than the output
+	vec2 center = floor(inUV * pushConsts.ssaoSize);
+
+	// Full resolution depth and normal guide the filter, so occlusion doesn't bleed across edges when upsampling
+	float depth = texture(samplerPositionDepth, inUV).w;
+	vec3 normal = normalize(texture(samplerNormal, inUV).rgb * 2.0 - 1.0);
+
 	float result = 0.0;
+	float weightSum = 0.0;
 	for (int x = -blurRange; x <= blurRange; x++) 
 	{
 		for (int y = -blurRange; y <= blurRange; y++) 
 		{
-			vec2 offset = vec2(float(x), float(y)) * texelSize;
-			result += texture(samplerSSAO, inUV + offset).r;
-			n++;
+			vec2 texel = clamp(center + vec2(float(x), float(y)), vec2(0.0), pushConsts.ssaoSize - 1.0) + 0.5;
+			float weight = 1.0;
+			if (pushConsts.bilateral == 1) {
+				// The G-Buffer values the SSAO pass used for this texel
+				vec2 guideUV = texel / pushConsts.ssaoSize;
+				float sampleDepth = texture(samplerPositionDepth, guideUV).w;
+				vec3 sampleNormal = normalize(texture(samplerNormal, guideUV).rgb * 2.0 - 1.0);
+				weight = max(1.0 - abs(depth - sampleDepth) / (DEPTH_TOLERANCE * max(depth, 0.001)), 0.0);
+				weight *= pow(max(dot(normal, sampleNormal), 0.0), NORMAL_POWER);
+			}
+			result += texture(samplerSSAO, texel * texelSize).r * weight;
+			weightSum += weight;
 		}
 	}
-	outFragColor = result / (float(n));
-}
\ No newline at end of file
+	// No similar sample (e.g. a thin feature that fell between the SSAO texels), use the closest one
+	if (weightSum < 0.0001) {
+		outFragColor = texture(samplerSSAO, (center + 0.5) * texelSize).r;
+		return;
+	}
+	outFragColor = result / weightSum;
+}
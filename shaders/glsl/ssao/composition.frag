@@ -3,14 +3,17 @@
 layout (binding = 0) uniform sampler2D samplerposition;
 layout (binding = 1) uniform sampler2D samplerNormal;
 layout (binding = 2) uniform sampler2D samplerAlbedo;
+// Resolved (upsampled and accumulated) occlusion
 layout (binding = 3) uniform sampler2D samplerSSAO;
-layout (binding = 4) uniform sampler2D samplerSSAOBlur;
+// Difference to the full resolution reference
+layout (binding = 4) uniform sampler2D samplerSSAOError;
 layout (binding = 5) uniform UBO 
 {
 	mat4 _dummy;
 	int ssao;
 	int ssaoOnly;
 	int ssaoBlur;
+	int errorView;
 } uboParams;
 
 layout (location = 0) in vec2 inUV;
@@ -23,13 +26,18 @@ void main()
 	vec3 normal = normalize(texture(samplerNormal, inUV).rgb * 2.0 - 1.0);
 	vec4 albedo = texture(samplerAlbedo, inUV);
 	 
-	float ssao = (uboParams.ssaoBlur == 1) ? texture(samplerSSAOBlur, inUV).r : texture(samplerSSAO, inUV).r;
+	float ssao = texture(samplerSSAO, inUV).r;
 
 	vec3 lightPos = vec3(0.0);
 	vec3 L = normalize(lightPos - fragPos);
 	float NdotL = max(0.5, dot(normal, L));
 
-	if (uboParams.ssaoOnly == 1)
+	if (uboParams.errorView == 1)
+	{
+		// Errors are scaled up to make them visible
+		outFragColor.rgb = vec3(1.0, 0.25, 0.0) * min(texture(samplerSSAOError, inUV).r * 4.0, 1.0);
+	}
+	else if (uboParams.ssaoOnly == 1)
 	{
 		outFragColor.rgb = ssao.rrr;
 	}
@@ -0,0 +1,13 @@
+#version 450
+
+layout (binding = 0) uniform sampler2D samplerSSAO;
+layout (binding = 1) uniform sampler2D samplerReference;
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out float outFragColor;
+
+void main() 
+{
+	outFragColor = abs(texture(samplerSSAO, inUV).r - texture(samplerReference, inUV).r);
+}
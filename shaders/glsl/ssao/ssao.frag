@@ -17,6 +17,14 @@ layout (binding = 4) uniform UBO
 	mat4 projection;
 } ubo;
 
+layout (push_constant) uniform PushConsts
+{
+	// Number of kernel samples taken per fragment, the kernel is traversed with a stride of SSAO_KERNEL_SIZE / sampleCount
+	int sampleCount;
+	// Selects the kernel samples and rotates the noise, so consecutive frames use different samples that can be accumulated
+	int frameIndex;
+} pushConsts;
+
 layout (location = 0) in vec2 inUV;
 
 layout (location = 0) out float outFragColor;
@@ -28,10 +36,13 @@ void main()
 	vec3 normal = normalize(texture(samplerNormal, inUV).rgb * 2.0 - 1.0);
 
 	// Get a random vector using a noise lookup
-	ivec2 texDim = textureSize(samplerPositionDepth, 0); 
+	// The noise is tiled per rendered fragment, so it's not undersampled if rendering at a lower resolution than the G-Buffer
 	ivec2 noiseDim = textureSize(ssaoNoise, 0);
-	const vec2 noiseUV = vec2(float(texDim.x)/float(noiseDim.x), float(texDim.y)/(noiseDim.y)) * inUV;  
+	const vec2 noiseUV = gl_FragCoord.xy / vec2(noiseDim);
 	vec3 randomVec = texture(ssaoNoise, noiseUV).xyz * 2.0 - 1.0;
+	// Rotate the noise by the golden angle every frame
+	float angle = float(pushConsts.frameIndex) * 2.39996323;
+	randomVec.xy = mat2(cos(angle), sin(angle), -sin(angle), cos(angle)) * randomVec.xy;
 	
 	// Create TBN matrix
 	vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
@@ -42,9 +53,11 @@ void main()
 	float occlusion = 0.0f;
 	// remove banding
 	const float bias = 0.025f;
-	for(int i = 0; i < SSAO_KERNEL_SIZE; i++)
+	const int sampleStride = SSAO_KERNEL_SIZE / pushConsts.sampleCount;
+	const int sampleOffset = pushConsts.frameIndex % sampleStride;
+	for(int i = 0; i < pushConsts.sampleCount; i++)
 	{		
-		vec3 samplePos = TBN * uboSSAOKernel.samples[i].xyz; 
+		vec3 samplePos = TBN * uboSSAOKernel.samples[i * sampleStride + sampleOffset].xyz; 
 		samplePos = fragPos + samplePos * SSAO_RADIUS; 
 		
 		// project
@@ -58,7 +71,7 @@ void main()
 		float rangeCheck = smoothstep(0.0f, 1.0f, SSAO_RADIUS / abs(fragPos.z - sampleDepth));
 		occlusion += (sampleDepth >= samplePos.z + bias ? 1.0f : 0.0f) * rangeCheck;           
 	}
-	occlusion = 1.0 - (occlusion / float(SSAO_KERNEL_SIZE));
+	occlusion = 1.0 - (occlusion / float(pushConsts.sampleCount));
 	
 	outFragColor = occlusion;
 }
@@ -0,0 +1,49 @@
+#version 450
+
+layout (binding = 0) uniform sampler2D samplerPositionDepth;
+layout (binding = 1) uniform sampler2D samplerSSAO;
+layout (binding = 2) uniform sampler2D samplerSSAOBlur;
+layout (binding = 3) uniform sampler2D samplerHistory;
+
+layout (push_constant) uniform PushConsts
+{
+	// Transforms view space positions of this frame to clip space of the previous frame
+	mat4 reprojection;
+	// Part of the SSAO image that has been rendered to
+	vec2 ssaoScale;
+	// Weight of the accumulated history, 0.0 only resolves the current frame
+	float historyWeight;
+	int ssaoBlur;
+} pushConsts;
+
+layout (location = 0) in vec2 inUV;
+
+// Occlusion and linear depth, the depth is used to reject the history in the next frame
+layout (location = 0) out vec2 outFragColor;
+
+// Relative depth difference at which the history is considered to belong to a different surface
+#define DEPTH_TOLERANCE 0.05
+
+void main() 
+{
+	vec3 fragPos = texture(samplerPositionDepth, inUV).xyz;
+	float occlusion = (pushConsts.ssaoBlur == 1) ? texture(samplerSSAOBlur, inUV).r : texture(samplerSSAO, inUV * pushConsts.ssaoScale).r;
+
+	if (pushConsts.historyWeight > 0.0)
+	{
+		// Find this surface in the previous frame
+		vec4 previousPos = pushConsts.reprojection * vec4(fragPos, 1.0);
+		vec2 previousUV = previousPos.xy / previousPos.w * 0.5 + 0.5;
+		if (all(greaterThanEqual(previousUV, vec2(0.0))) && all(lessThanEqual(previousUV, vec2(1.0))))
+		{
+			vec2 history = texture(samplerHistory, previousUV).rg;
+			// Reject the history if a different surface was visible at that position (disocclusion)
+			if (abs(history.g - previousPos.w) < DEPTH_TOLERANCE * previousPos.w)
+			{
+				occlusion = mix(occlusion, history.r, pushConsts.historyWeight);
+			}
+		}
+	}
+
+	outFragColor = vec2(occlusion, -fragPos.z);
+}
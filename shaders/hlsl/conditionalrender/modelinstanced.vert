@@ -0,0 +1,55 @@
+// Copyright 2026 Sascha Willems
+
+struct VSInput
+{
+[[vk::location(0)]] float3 Pos : POSITION0;
+[[vk::location(1)]] float3 Normal : NORMAL0;
+[[vk::location(2)]] float3 Color : COLOR0;
+// Per-instance node matrix, passed as one vector per column
+[[vk::location(3)]] float4 NodeMatrix0 : TEXCOORD0;
+[[vk::location(4)]] float4 NodeMatrix1 : TEXCOORD1;
+[[vk::location(5)]] float4 NodeMatrix2 : TEXCOORD2;
+[[vk::location(6)]] float4 NodeMatrix3 : TEXCOORD3;
+};
+
+struct UBO
+{
+	float4x4 projection;
+	float4x4 view;
+	float4x4 model;
+};
+
+cbuffer ubo : register(b0) { UBO ubo; }
+
+struct PushConstant
+{
+	float4 baseColorFactor;
+};
+
+[[vk::push_constant]] PushConstant material;
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+[[vk::location(0)]] float3 Normal : NORMAL0;
+[[vk::location(1)]] float3 Color : COLOR0;
+[[vk::location(2)]] float3 ViewVec : TEXCOORD1;
+[[vk::location(3)]] float3 LightVec : TEXCOORD2;
+};
+
+VSOutput main(VSInput input)
+{
+	VSOutput output = (VSOutput)0;
+	float4x4 nodeMatrix = transpose(float4x4(input.NodeMatrix0, input.NodeMatrix1, input.NodeMatrix2, input.NodeMatrix3));
+	output.Color = material.baseColorFactor.rgb;
+	float4 pos = float4(input.Pos, 1.0);
+	output.Pos = mul(ubo.projection, mul(ubo.view, mul(ubo.model, mul(nodeMatrix, pos))));
+
+	output.Normal = mul((float4x3)mul(ubo.view, mul(ubo.model, nodeMatrix)), input.Normal).xyz;
+
+	float4 localpos = mul(ubo.view, mul(ubo.model, mul(nodeMatrix, pos)));
+	float3 lightPos = float3(10.0f, -10.0f, 10.0f);
+	output.LightVec = lightPos.xyz - localpos.xyz;
+	output.ViewVec = -localpos.xyz;
+	return output;
+}
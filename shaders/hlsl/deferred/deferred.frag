@@ -1,5 +1,11 @@
 // Copyright 2020 Google LLC
 
+// Must match the values used in the light culling compute shader and the sample
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define MAX_LIGHTS_PER_CLUSTER 256
+
 Texture2D textureposition : register(t1);
 SamplerState samplerposition : register(s1);
 Texture2D textureNormal : register(t2);
@@ -8,20 +14,79 @@ Texture2D textureAlbedo : register(t3);
 SamplerState samplerAlbedo : register(s3);
 
 struct Light {
+	// xyz = position, w = range (no influence beyond that distance)
 	float4 position;
-	float3 color;
-	float radius;
+	// rgb = color, a = intensity
+	float4 color;
+	// xyz = spot direction, w = cosine of the spot cone angle (-1 for point lights)
+	float4 direction;
 };
 
 struct UBO
 {
-	Light lights[6];
+	float4x4 view;
+	float4x4 projection;
+	float4x4 inverseProjection;
 	float4 viewPos;
 	int displayDebugTarget;
+	uint lightCount;
+	uint clustered;
+	float zNear;
+	float zFar;
 };
-
 cbuffer ubo : register(b4) { UBO ubo; }
 
+StructuredBuffer<Light> lights : register(t5);
+// Number of lights affecting each cluster
+StructuredBuffer<uint> lightGrid : register(t6);
+// Fixed size light index list for each cluster
+StructuredBuffer<uint> lightIndices : register(t7);
+
+uint clusterIndex(float3 viewSpacePos)
+{
+	float4 clip = mul(ubo.projection, float4(viewSpacePos, 1.0));
+	float2 ndc = clamp(clip.xy / clip.w, (float2)-1.0, (float2)1.0);
+	uint2 tile = min(uint2((ndc * 0.5 + 0.5) * float2(CLUSTER_X, CLUSTER_Y)), uint2(CLUSTER_X - 1, CLUSTER_Y - 1));
+	// Depth slices are distributed exponentially, so clusters are roughly cube shaped in view space
+	float slice = log(max(-viewSpacePos.z, ubo.zNear) / ubo.zNear) / log(ubo.zFar / ubo.zNear) * float(CLUSTER_Z);
+	uint z = min(uint(slice), CLUSTER_Z - 1);
+	return tile.x + tile.y * CLUSTER_X + z * CLUSTER_X * CLUSTER_Y;
+}
+
+float3 shadeLight(Light light, float3 fragPos, float3 N, float3 V, float4 albedo)
+{
+	// Vector to light
+	float3 L = light.position.xyz - fragPos;
+	// Distance from light to fragment position
+	float dist = length(L);
+	if (dist > light.position.w) {
+		return (float3)0.0;
+	}
+	// Light to fragment
+	L = normalize(L);
+
+	// Attenuation, windowed so the light has no influence beyond its range
+	float window = clamp(1.0 - pow(dist / light.position.w, 4.0), 0.0, 1.0);
+	float atten = light.color.a / (pow(dist, 2.0) + 1.0) * window * window;
+
+	// Spot cone
+	if (light.direction.w > -1.0) {
+		float cosAngle = dot(-L, light.direction.xyz);
+		atten *= smoothstep(light.direction.w, min(light.direction.w + 0.05, 1.0), cosAngle);
+	}
+
+	// Diffuse part
+	float NdotL = max(0.0, dot(N, L));
+	float3 diff = light.color.rgb * albedo.rgb * NdotL * atten;
+
+	// Specular part
+	// Specular map values are stored in alpha of albedo mrt
+	float3 R = reflect(-L, N);
+	float NdotR = max(0.0, dot(R, V));
+	float3 spec = light.color.rgb * albedo.a * pow(NdotR, 16.0) * atten;
+
+	return diff + spec;
+}
 
 float4 main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
 {
@@ -47,49 +112,38 @@ float4 main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
 			case 4: 
 				fragcolor.rgb = albedo.aaa;
 				break;
+			case 5: {
+				// Number of lights in the fragment's cluster
+				uint cluster = clusterIndex(mul(ubo.view, float4(fragPos, 1.0)).xyz);
+				fragcolor.rgb = lerp(float3(0.0, 0.0, 1.0), float3(1.0, 0.0, 0.0), float(min(lightGrid[cluster], MAX_LIGHTS_PER_CLUSTER)) / 64.0);
+				break;
+			}
 		}		
 		return float4(fragcolor, 1.0);
 	}
 
-	#define lightCount 6
 	#define ambient 0.0
 
 	// Ambient part
 	fragcolor = albedo.rgb * ambient;
 
-	for(int i = 0; i < lightCount; ++i)
-	{
-		// Vector to light
-		float3 L = ubo.lights[i].position.xyz - fragPos;
-		// Distance from light to fragment position
-		float dist = length(L);
-
-		// Viewer to fragment
-		float3 V = ubo.viewPos.xyz - fragPos;
-		V = normalize(V);
-
-		//if(dist < ubo.lights[i].radius)
-		{
-			// Light to fragment
-			L = normalize(L);
-
-			// Attenuation
-			float atten = ubo.lights[i].radius / (pow(dist, 2.0) + 1.0);
-
-			// Diffuse part
-			float3 N = normalize(normal);
-			float NdotL = max(0.0, dot(N, L));
-			float3 diff = ubo.lights[i].color * albedo.rgb * NdotL * atten;
-
-			// Specular part
-			// Specular map values are stored in alpha of albedo mrt
-			float3 R = reflect(-L, N);
-			float NdotR = max(0.0, dot(R, V));
-			float3 spec = ubo.lights[i].color * albedo.a * pow(NdotR, 16.0) * atten;
-
-			fragcolor += diff + spec;
+	float3 N = normalize(normal);
+	// Viewer to fragment
+	float3 V = normalize(ubo.viewPos.xyz - fragPos);
+
+	if (ubo.clustered == 1) {
+		// Only iterate over the lights that have been binned into this fragment's cluster by the light culling compute pass
+		uint cluster = clusterIndex(mul(ubo.view, float4(fragPos, 1.0)).xyz);
+		uint count = min(lightGrid[cluster], MAX_LIGHTS_PER_CLUSTER);
+		for (uint i = 0; i < count; ++i) {
+			fragcolor += shadeLight(lights[lightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + i]], fragPos, N, V, albedo);
+		}
+	} else {
+		// Brute force: Iterate over all lights
+		for (uint i = 0; i < ubo.lightCount; ++i) {
+			fragcolor += shadeLight(lights[i], fragPos, N, V, albedo);
 		}
 	}
 
   return float4(fragcolor, 1.0);
-}
\ No newline at end of file
+}
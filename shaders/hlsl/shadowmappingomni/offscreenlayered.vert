@@ -0,0 +1,51 @@
+// Copyright 2020 Google LLC
+
+// Single pass cube map rendering: Each object is drawn with one instance per cube map face it's visible in
+// The face for the current instance is the n-th set bit of the object's face mask, and is used as the target layer
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+[[vk::location(0)]] float4 WorldPos : POSITION0;
+[[vk::location(1)]] float3 LightPos : POSITION1;
+	uint Layer : SV_RenderTargetArrayIndex;
+};
+
+struct UBO
+{
+	float4x4 projection;
+	float4x4 view;
+	float4x4 model;
+	float4 lightPos;
+	float4x4 faceViews[6];
+};
+
+cbuffer ubo : register(b0) { UBO ubo; }
+
+struct PushConsts
+{
+	uint faceMask;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
+VSOutput main([[vk::location(0)]] float3 Pos : POSITION0, uint InstanceIndex : SV_InstanceID)
+{
+	uint face = 0;
+	uint instance = InstanceIndex;
+	for (face = 0; face < 6; face++) {
+		if ((pushConsts.faceMask & (1u << face)) != 0) {
+			if (instance == 0) {
+				break;
+			}
+			instance--;
+		}
+	}
+
+	VSOutput output = (VSOutput)0;
+	output.Layer = face;
+	output.Pos = mul(ubo.projection, mul(ubo.faceViews[face], mul(ubo.model, float4(Pos, 1.0))));
+
+	output.WorldPos = float4(Pos, 1.0);
+	output.LightPos = ubo.lightPos.xyz;
+	return output;
+}
@@ -2,23 +2,60 @@
 
 Texture2D textureSSAO : register(t0);
 SamplerState samplerSSAO : register(s0);
+Texture2D texturePositionDepth : register(t1);
+SamplerState samplerPositionDepth : register(s1);
+Texture2D textureNormal : register(t2);
+SamplerState samplerNormal : register(s2);
+
+struct PushConsts
+{
+	// Size of the area of the SSAO image that has been rendered to, in texels
+	float2 ssaoSize;
+	// Weight samples by depth and normal similarity instead of averaging them
+	int bilateral;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
+// Relative depth difference at which a sample no longer contributes
+#define DEPTH_TOLERANCE 0.05
+#define NORMAL_POWER 8.0
 
 float4 main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
 {
 	const int blurRange = 2;
-	int n = 0;
 	int2 texDim;
 	textureSSAO.GetDimensions(texDim.x, texDim.y);
 	float2 texelSize = 1.0 / (float2)texDim;
+	// SSAO texel containing this fragment, the SSAO image may have a lower resolution than the output
+	float2 center = floor(inUV * pushConsts.ssaoSize);
+
+	// Full resolution depth and normal guide the filter, so occlusion doesn't bleed across edges when upsampling
+	float depth = texturePositionDepth.Sample(samplerPositionDepth, inUV).w;
+	float3 normal = normalize(textureNormal.Sample(samplerNormal, inUV).rgb * 2.0 - 1.0);
+
 	float result = 0.0;
+	float weightSum = 0.0;
 	for (int x = -blurRange; x <= blurRange; x++)
 	{
 		for (int y = -blurRange; y <= blurRange; y++)
 		{
-			float2 offset = float2(float(x), float(y)) * texelSize;
-			result += textureSSAO.Sample(samplerSSAO, inUV + offset).r;
-			n++;
+			float2 texel = clamp(center + float2(float(x), float(y)), float2(0.0, 0.0), pushConsts.ssaoSize - 1.0) + 0.5;
+			float weight = 1.0;
+			if (pushConsts.bilateral == 1) {
+				// The G-Buffer values the SSAO pass used for this texel
+				float2 guideUV = texel / pushConsts.ssaoSize;
+				float sampleDepth = texturePositionDepth.Sample(samplerPositionDepth, guideUV).w;
+				float3 sampleNormal = normalize(textureNormal.Sample(samplerNormal, guideUV).rgb * 2.0 - 1.0);
+				weight = max(1.0 - abs(depth - sampleDepth) / (DEPTH_TOLERANCE * max(depth, 0.001)), 0.0);
+				weight *= pow(max(dot(normal, sampleNormal), 0.0), NORMAL_POWER);
+			}
+			result += textureSSAO.Sample(samplerSSAO, texel * texelSize).r * weight;
+			weightSum += weight;
 		}
 	}
-	return result / (float(n));
-}
\ No newline at end of file
+	// No similar sample (e.g. a thin feature that fell between the SSAO texels), use the closest one
+	if (weightSum < 0.0001) {
+		return textureSSAO.Sample(samplerSSAO, (center + 0.5) * texelSize).r;
+	}
+	return result / weightSum;
+}
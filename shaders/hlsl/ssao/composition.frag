@@ -6,16 +6,19 @@ Texture2D textureNormal : register(t1);
 SamplerState samplerNormal : register(s1);
 Texture2D textureAlbedo : register(t2);
 SamplerState samplerAlbedo : register(s2);
+// Resolved (upsampled and accumulated) occlusion
 Texture2D textureSSAO : register(t3);
 SamplerState samplerSSAO : register(s3);
-Texture2D textureSSAOBlur : register(t4);
-SamplerState samplerSSAOBlur : register(s4);
+// Difference to the full resolution reference
+Texture2D textureSSAOError : register(t4);
+SamplerState samplerSSAOError : register(s4);
 struct UBO
 {
 	float4x4 _dummy;
 	int ssao;
 	int ssaoOnly;
 	int ssaoBlur;
+	int errorView;
 };
 cbuffer uboParams : register(b5) { UBO uboParams; };
 
@@ -25,14 +28,19 @@ float4 main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
 	float3 normal = normalize(textureNormal.Sample(samplerNormal, inUV).rgb * 2.0 - 1.0);
 	float4 albedo = textureAlbedo.Sample(samplerAlbedo, inUV);
 
-	float ssao = (uboParams.ssaoBlur == 1) ? textureSSAOBlur.Sample(samplerSSAOBlur, inUV).r : textureSSAO.Sample(samplerSSAO, inUV).r;
+	float ssao = textureSSAO.Sample(samplerSSAO, inUV).r;
 
 	float3 lightPos = float3(0.0, 0.0, 0.0);
 	float3 L = normalize(lightPos - fragPos);
 	float NdotL = max(0.5, dot(normal, L));
 
 	float4 outFragColor;
-	if (uboParams.ssaoOnly == 1)
+	if (uboParams.errorView == 1)
+	{
+		// Errors are scaled up to make them visible
+		outFragColor.rgb = float3(1.0, 0.25, 0.0) * min(textureSSAOError.Sample(samplerSSAOError, inUV).r * 4.0, 1.0);
+	}
+	else if (uboParams.ssaoOnly == 1)
 	{
 		outFragColor.rgb = ssao.rrr;
 	}
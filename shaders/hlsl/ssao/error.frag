@@ -0,0 +1,11 @@
+// Copyright 2026 Sascha Willems
+
+Texture2D textureSSAO : register(t0);
+SamplerState samplerSSAO : register(s0);
+Texture2D textureReference : register(t1);
+SamplerState samplerReference : register(s1);
+
+float main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
+{
+	return abs(textureSSAO.Sample(samplerSSAO, inUV).r - textureReference.Sample(samplerReference, inUV).r);
+}
@@ -23,19 +23,30 @@ struct UBO
 };
 cbuffer ubo : register(b4) { UBO ubo; };
 
-float main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
+struct PushConsts
+{
+	// Number of kernel samples taken per fragment, the kernel is traversed with a stride of SSAO_KERNEL_SIZE / sampleCount
+	int sampleCount;
+	// Selects the kernel samples and rotates the noise, so consecutive frames use different samples that can be accumulated
+	int frameIndex;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
+float main(float4 fragCoord : SV_POSITION, [[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
 {
 	// Get G-Buffer values
 	float3 fragPos = texturePositionDepth.Sample(samplerPositionDepth, inUV).rgb;
 	float3 normal = normalize(textureNormal.Sample(samplerNormal, inUV).rgb * 2.0 - 1.0);
 
 	// Get a random vector using a noise lookup
-	int2 texDim;
-	texturePositionDepth.GetDimensions(texDim.x, texDim.y);
+	// The noise is tiled per rendered fragment, so it's not undersampled if rendering at a lower resolution than the G-Buffer
 	int2 noiseDim;
 	ssaoNoiseTexture.GetDimensions(noiseDim.x, noiseDim.y);
-	const float2 noiseUV = float2(float(texDim.x)/float(noiseDim.x), float(texDim.y)/(noiseDim.y)) * inUV;
+	const float2 noiseUV = fragCoord.xy / float2(noiseDim);
 	float3 randomVec = ssaoNoiseTexture.Sample(ssaoNoiseSampler, noiseUV).xyz * 2.0 - 1.0;
+	// Rotate the noise by the golden angle every frame
+	float angle = float(pushConsts.frameIndex) * 2.39996323;
+	randomVec.xy = mul(float2x2(cos(angle), -sin(angle), sin(angle), cos(angle)), randomVec.xy);
 
 	// Create TBN matrix
 	float3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
@@ -44,9 +55,11 @@ float main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
 
 	// Calculate occlusion value
 	float occlusion = 0.0f;
-	for(int i = 0; i < SSAO_KERNEL_SIZE; i++)
+	const int sampleStride = SSAO_KERNEL_SIZE / pushConsts.sampleCount;
+	const int sampleOffset = pushConsts.frameIndex % sampleStride;
+	for(int i = 0; i < pushConsts.sampleCount; i++)
 	{
-		float3 samplePos = mul(TBN, uboSSAOKernel.samples[i].xyz);
+		float3 samplePos = mul(TBN, uboSSAOKernel.samples[i * sampleStride + sampleOffset].xyz);
 		samplePos = fragPos + samplePos * SSAO_RADIUS;
 
 		// project
@@ -60,7 +73,7 @@ float main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
 		float rangeCheck = smoothstep(0.0f, 1.0f, SSAO_RADIUS / abs(fragPos.z - sampleDepth));
 		occlusion += (sampleDepth >= samplePos.z ? 1.0f : 0.0f) * rangeCheck;
 	}
-	occlusion = 1.0 - (occlusion / float(SSAO_KERNEL_SIZE));
+	occlusion = 1.0 - (occlusion / float(pushConsts.sampleCount));
 
 	return occlusion;
 }
@@ -0,0 +1,50 @@
+// Copyright 2026 Sascha Willems
+
+Texture2D texturePositionDepth : register(t0);
+SamplerState samplerPositionDepth : register(s0);
+Texture2D textureSSAO : register(t1);
+SamplerState samplerSSAO : register(s1);
+Texture2D textureSSAOBlur : register(t2);
+SamplerState samplerSSAOBlur : register(s2);
+Texture2D textureHistory : register(t3);
+SamplerState samplerHistory : register(s3);
+
+struct PushConsts
+{
+	// Transforms view space positions of this frame to clip space of the previous frame
+	float4x4 reprojection;
+	// Part of the SSAO image that has been rendered to
+	float2 ssaoScale;
+	// Weight of the accumulated history, 0.0 only resolves the current frame
+	float historyWeight;
+	int ssaoBlur;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
+// Relative depth difference at which the history is considered to belong to a different surface
+#define DEPTH_TOLERANCE 0.05
+
+// Occlusion and linear depth, the depth is used to reject the history in the next frame
+float2 main([[vk::location(0)]] float2 inUV : TEXCOORD0) : SV_TARGET
+{
+	float3 fragPos = texturePositionDepth.Sample(samplerPositionDepth, inUV).xyz;
+	float occlusion = (pushConsts.ssaoBlur == 1) ? textureSSAOBlur.Sample(samplerSSAOBlur, inUV).r : textureSSAO.Sample(samplerSSAO, inUV * pushConsts.ssaoScale).r;
+
+	if (pushConsts.historyWeight > 0.0)
+	{
+		// Find this surface in the previous frame
+		float4 previousPos = mul(pushConsts.reprojection, float4(fragPos, 1.0));
+		float2 previousUV = previousPos.xy / previousPos.w * 0.5 + 0.5;
+		if (all(previousUV >= 0.0) && all(previousUV <= 1.0))
+		{
+			float2 history = textureHistory.Sample(samplerHistory, previousUV).rg;
+			// Reject the history if a different surface was visible at that position (disocclusion)
+			if (abs(history.g - previousPos.w) < DEPTH_TOLERANCE * previousPos.w)
+			{
+				occlusion = lerp(occlusion, history.r, pushConsts.historyWeight);
+			}
+		}
+	}
+
+	return float2(occlusion, -fragPos.z);
+}